@@ -44,4 +44,9 @@ if command -v file &>/dev/null; then
     echo ${FILE_INFO} | grep -qi "arm\|ARM" || log_error "产物不是ARM架构"
 fi
 
+# 链接校验：链接参数带了unresolved-symbols=ignore-all，SDK源码漏编时不会报错，
+# 这里确认本仓库编译的SDK符号（jqutil_v2、StealingThreadPool）在so里没有未定义的
+UNDEF_SDK=$(${TOOLCHAIN_PREFIX}nm -uC ${SO_FILE} | grep -E "jqutil_dist::|JQuick::StealingThreadPool" || true)
+[ -n "${UNDEF_SDK}" ] && { echo "${UNDEF_SDK}"; log_error "SDK符号未链接进SO库"; }
+
 log_success "最终版SO库编译成功！路径: ${SO_FILE}"
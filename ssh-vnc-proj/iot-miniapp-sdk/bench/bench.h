@@ -0,0 +1,37 @@
+#ifndef ___SDK_BENCH_H___
+#define ___SDK_BENCH_H___
+
+#include <stdint.h>
+#include <vector>
+
+/*
+ * SDK微基准：每个文件用BENCH_REGISTER登记一个入口，sdk-bench [名字...] 运行指定项，不带参数全部运行。
+ * 结果每行一条：<名字> <变体> 指标...，同一项里新旧实现用变体区分。
+ * 用Release构建（-Os）的结果才有参考意义。
+ * 只覆盖不依赖宿主运行时的部分：JQAsyncExecutor的promise往返、bsonToJSValue要QuickJS上下文和宿主Looper，
+ * 只能在设备上通过页面测，这里没有对应项。
+ */
+
+typedef void (*BenchFunc)();
+
+int benchRegister(const char* name, BenchFunc func);
+#define BENCH_REGISTER(name, func) static int _bench_reg_##func = benchRegister(name, func)
+
+// 单调时钟
+long long benchNowNs();
+// 在线CPU数，至少为1
+int32_t benchCpus();
+// 排序后取p分位（0~1），单位微秒；样本为空时返回0
+double benchPercentileUs(std::vector<long long>& samplesNs, double p);
+// 每秒次数
+double benchRate(uint64_t count, long long elapsedNs);
+void benchReport(const char* name, const char* variant, const char* fmt, ...) __attribute__((format(printf, 3, 4)));
+
+// 全局operator new在bench_main.cpp里替换：分配次数、当前在用字节、峰值字节（只含C++分配）
+uint64_t benchAllocCount();
+long long benchHeapLive();
+// 峰值重置为当前在用值，之后benchHeapPeak返回这期间的最高值
+void benchHeapPeakReset();
+long long benchHeapPeak();
+
+#endif  // ___SDK_BENCH_H___
@@ -0,0 +1,339 @@
+// Bson构造、dump耗时和构造期间的堆峰值：改造前的布局（sp<BsonValue>多态节点+std::map对象）对比现在的内联小值+扁平对象，
+// 三种典型负载：终端输出事件、文件列表、数值数组；现在的布局另测Bson::parse吞吐。
+// bsonToJSValue要QuickJS上下文，只能在设备上测，这里没有对应项
+#include "bench.h"
+#include "jqutil_v2/jqbson.h"
+#include "utils/REF.h"
+#include <math.h>
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <vector>
+
+// 每项至少跑这么久
+#define BSON_MIN_NS 300000000LL
+
+using namespace JQUTIL_NS;
+
+// 改造前Bson的布局：每个值一个引用计数的多态节点，null/true/false共享静态节点，对象为std::map，
+// 数组/对象构造时整体拷贝。只保留基准用到的构造和dump，dump和改造前逐字符追加的写法一致
+class MapBson;
+
+class MapBsonValue : public JQuick::REF_BASE
+{
+public:
+    virtual ~MapBsonValue() {}
+    virtual void dump(std::string& out) const = 0;
+};
+
+class MapBson
+{
+public:
+    typedef std::vector< MapBson > array;
+    typedef std::map< std::string, MapBson > object;
+
+    MapBson();
+    MapBson(double value);
+    MapBson(int value);
+    MapBson(bool value);
+    MapBson(const std::string& value);
+    MapBson(const char* value);
+    MapBson(const array& values);
+    MapBson(const object& values);
+
+    void dump(std::string& out) const
+    {
+        m_ptr->dump(out);
+    }
+
+private:
+    JQuick::sp< MapBsonValue > m_ptr;
+};
+
+static void mapDump(double value, std::string& out)
+{
+    if (isfinite(value)) {
+        char buf[32];
+        snprintf(buf, sizeof buf, "%.17g", value);
+        out += buf;
+    } else {
+        out += "null";
+    }
+}
+
+static void mapDump(int value, std::string& out)
+{
+    char buf[32];
+    snprintf(buf, sizeof buf, "%d", value);
+    out += buf;
+}
+
+static void mapDump(bool value, std::string& out)
+{
+    out += value ? "true" : "false";
+}
+
+static void mapDump(const std::string& value, std::string& out)
+{
+    out += '"';
+    for (size_t i = 0; i < value.length(); i++) {
+        const char ch = value[i];
+        if (ch == '\\') {
+            out += "\\\\";
+        } else if (ch == '"') {
+            out += "\\\"";
+        } else if (ch == '\b') {
+            out += "\\b";
+        } else if (ch == '\f') {
+            out += "\\f";
+        } else if (ch == '\n') {
+            out += "\\n";
+        } else if (ch == '\r') {
+            out += "\\r";
+        } else if (ch == '\t') {
+            out += "\\t";
+        } else if (static_cast< uint8_t >(ch) <= 0x1f) {
+            char buf[8];
+            snprintf(buf, sizeof buf, "\\u%04x", ch);
+            out += buf;
+        } else if (static_cast< uint8_t >(ch) == 0xe2 && static_cast< uint8_t >(value[i + 1]) == 0x80 && static_cast< uint8_t >(value[i + 2]) == 0xa8) {
+            out += "\\u2028";
+            i += 2;
+        } else if (static_cast< uint8_t >(ch) == 0xe2 && static_cast< uint8_t >(value[i + 1]) == 0x80 && static_cast< uint8_t >(value[i + 2]) == 0xa9) {
+            out += "\\u2029";
+            i += 2;
+        } else {
+            out += ch;
+        }
+    }
+    out += '"';
+}
+
+static void mapDump(const MapBson::array& values, std::string& out)
+{
+    out += "[";
+    for (size_t i = 0; i < values.size(); i++) {
+        if (i) {
+            out += ", ";
+        }
+        values[i].dump(out);
+    }
+    out += "]";
+}
+
+static void mapDump(const MapBson::object& values, std::string& out)
+{
+    bool first = true;
+    out += "{";
+    for (MapBson::object::const_iterator iter = values.begin(); iter != values.end(); iter++) {
+        if (!first) {
+            out += ", ";
+        }
+        mapDump(iter->first, out);
+        out += ": ";
+        iter->second.dump(out);
+        first = false;
+    }
+    out += "}";
+}
+
+template < typename T >
+class MapValue : public MapBsonValue
+{
+public:
+    explicit MapValue(const T& value) : m_value(value) {}
+    void dump(std::string& out) const
+    {
+        mapDump(m_value, out);
+    }
+
+private:
+    const T m_value;
+};
+
+class MapNull : public MapBsonValue
+{
+public:
+    void dump(std::string& out) const
+    {
+        out += "null";
+    }
+};
+
+static const JQuick::sp< MapBsonValue >& mapStatic(int which)
+{
+    static const JQuick::sp< MapBsonValue > null = new MapNull;
+    static const JQuick::sp< MapBsonValue > t = new MapValue< bool >(true);
+    static const JQuick::sp< MapBsonValue > f = new MapValue< bool >(false);
+    return which == 0 ? null : (which == 1 ? t : f);
+}
+
+MapBson::MapBson() : m_ptr(mapStatic(0)) {}
+MapBson::MapBson(double value) : m_ptr(new MapValue< double >(value)) {}
+MapBson::MapBson(int value) : m_ptr(new MapValue< int >(value)) {}
+MapBson::MapBson(bool value) : m_ptr(mapStatic(value ? 1 : 2)) {}
+MapBson::MapBson(const std::string& value) : m_ptr(new MapValue< std::string >(value)) {}
+MapBson::MapBson(const char* value) : m_ptr(new MapValue< std::string >(value)) {}
+MapBson::MapBson(const array& values) : m_ptr(new MapValue< array >(values)) {}
+MapBson::MapBson(const object& values) : m_ptr(new MapValue< object >(values)) {}
+
+// 两种布局各自的常规构造写法：改造前逐个operator[]插入再整体拷贝，现在用BsonObjectBuilder追加、数组移动进去
+struct MapLayout {
+    typedef MapBson Value;
+    struct Object {
+        MapBson::object o;
+        void add(const char* key, MapBson value)
+        {
+            o[key] = value;
+        }
+        MapBson build()
+        {
+            return MapBson(o);
+        }
+    };
+    static MapBson array(std::vector< MapBson >& items)
+    {
+        return MapBson(items);
+    }
+};
+
+struct FlatLayout {
+    typedef Bson Value;
+    struct Object {
+        BsonObjectBuilder b;
+        void add(const char* key, Bson value)
+        {
+            b.add(key, std::move(value));
+        }
+        Bson build()
+        {
+            return b.build();
+        }
+    };
+    static Bson array(std::vector< Bson >& items)
+    {
+        return Bson(std::move(items));
+    }
+};
+
+// 4KB左右的终端输出：ASCII为主，夹杂换行、制表、ESC控制序列和中文
+static std::string sshData()
+{
+    std::string data;
+    while (data.size() < 4096) {
+        data += "drwxr-xr-x  2 root root  4096 Oct 19 08:00 \xe6\x96\x87\xe4\xbb\xb6\xe5\xa4\xb9\r\n";
+        data += "\x1b[01;34mbin\x1b[0m\t\"quoted\" path\\with\\slashes\n";
+    }
+    return data;
+}
+
+template < typename L >
+static typename L::Value sshEvent(const std::string& data)
+{
+    typename L::Object o;
+    o.add("connId", typename L::Value(3));
+    o.add("type", typename L::Value("data"));
+    o.add("data", typename L::Value(data));
+    return o.build();
+}
+
+template < typename L >
+static typename L::Value fileList()
+{
+    std::vector< typename L::Value > items;
+    char name[64];
+    for (int i = 0; i < 200; i++) {
+        snprintf(name, sizeof(name), "file_%04d.log", i);
+        typename L::Object o;
+        o.add("name", typename L::Value(name));
+        o.add("path", typename L::Value(std::string("/var/log/app/") + name));
+        o.add("size", typename L::Value(i * 1237));
+        o.add("mtime", typename L::Value(1760860800.0 + i * 61.5));
+        o.add("isDir", typename L::Value(i % 7 == 0));
+        items.push_back(o.build());
+    }
+    return L::array(items);
+}
+
+template < typename L >
+static typename L::Value numbers()
+{
+    std::vector< typename L::Value > items;
+    for (int i = 0; i < 10000; i++) {
+        items.push_back(typename L::Value(i % 3 == 0 ? (double)i : i * 0.1 + 1.0 / 3));
+    }
+    return L::array(items);
+}
+
+template < typename Build >
+static void runLayout(const char* variant, Build build, bool parse)
+{
+    // 构造期间的峰值和构造完成后留下的字节数，都相对构造前的在用量
+    long long base = benchHeapLive();
+    benchHeapPeakReset();
+    std::string json;
+    double peakKB;
+    double retainedKB;
+    {
+        auto value = build();
+        peakKB = (benchHeapPeak() - base) / 1024.0;
+        retainedKB = (benchHeapLive() - base) / 1024.0;
+        value.dump(json);
+    }
+
+    uint64_t builds = 0;
+    long long start = benchNowNs();
+    long long elapsed;
+    do {
+        for (int i = 0; i < 8; i++) {
+            auto value = build();
+            builds++;
+        }
+        elapsed = benchNowNs() - start;
+    } while (elapsed < BSON_MIN_NS);
+    double buildUs = elapsed / 1e3 / builds;
+
+    auto value = build();
+    uint64_t bytes = 0;
+    start = benchNowNs();
+    do {
+        for (int i = 0; i < 16; i++) {
+            std::string out;
+            value.dump(out);
+            bytes += out.size();
+        }
+        elapsed = benchNowNs() - start;
+    } while (elapsed < BSON_MIN_NS);
+    double dumpMBs = bytes / 1e6 / (elapsed / 1e9);
+
+    char parsed[64] = "";
+    if (parse) {
+        std::string err;
+        bytes = 0;
+        start = benchNowNs();
+        do {
+            for (int i = 0; i < 16; i++) {
+                Bson v = Bson::parse(json, err);
+                bytes += json.size();
+            }
+            elapsed = benchNowNs() - start;
+        } while (elapsed < BSON_MIN_NS);
+        snprintf(parsed, sizeof(parsed), "  parse %7.1f MB/s%s", bytes / 1e6 / (elapsed / 1e9), err.empty() ? "" : " ERROR");
+    }
+
+    benchReport("bson", variant, "%7zu B  build %8.1f us  dump %7.1f MB/s  heap peak %7.1f KB  retained %7.1f KB%s",
+                json.size(), buildUs, dumpMBs, peakKB, retainedKB, parsed);
+}
+
+static void benchBson()
+{
+    std::string data = sshData();
+    runLayout("ssh-event/map", [&data]() { return sshEvent< MapLayout >(data); }, false);
+    runLayout("ssh-event/flat", [&data]() { return sshEvent< FlatLayout >(data); }, true);
+    runLayout("file-list/map", &fileList< MapLayout >, false);
+    runLayout("file-list/flat", &fileList< FlatLayout >, true);
+    runLayout("numbers/map", &numbers< MapLayout >, false);
+    runLayout("numbers/flat", &numbers< FlatLayout >, true);
+}
+
+BENCH_REGISTER("bson", benchBson);
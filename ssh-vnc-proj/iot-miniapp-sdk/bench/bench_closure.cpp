@@ -0,0 +1,150 @@
+// 每个任务的堆分配次数和耗时：引用计数的Closure+bind拷贝参数，对比UniqueClosure内联存放+移动参数
+#include "bench.h"
+#include "jqutil_v2/JQNamedThread.h"
+#include "utils/Functional.h"
+#include "utils/REF.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#define CLOSURE_TASKS 200000
+
+using namespace JQuick;
+using namespace JQUTIL_NS;
+
+class BenchTarget : public REF_BASE
+{
+public:
+    BenchTarget() : hits(0) {}
+    std::atomic< uint64_t > hits;
+};
+
+static void work(const sp< BenchTarget >& target, const std::string& path, const std::string& name)
+{
+    target->hits.fetch_add(path.size() + name.size(), std::memory_order_relaxed);
+}
+
+// 任务参数由调用方逐个构造（超过SSO长度），两种方式都计入这部分分配
+static std::string makePath(int32_t i)
+{
+    char buf[64];
+    snprintf(buf, sizeof(buf), "/home/user/projects/ssh-vnc/logs/session-%06d.txt", i);
+    return buf;
+}
+
+static void report(const char* variant, uint64_t allocs, long long elapsed, int32_t n)
+{
+    benchReport("closure", variant, "%6.2f allocs/task  %8.1f ns/task", (double)allocs / n, (double)elapsed / n);
+}
+
+// 只看闭包本身：构造、放进预留好的队列、取出执行、销毁
+static void runLocal(sp< BenchTarget > target)
+{
+    std::string name("connection-worker-name");
+    {
+        std::vector< Closure > queue;
+        queue.reserve(CLOSURE_TASKS);
+        uint64_t a0 = benchAllocCount();
+        long long start = benchNowNs();
+        for (int32_t i = 0; i < CLOSURE_TASKS; i++) {
+            std::string path = makePath(i);
+            Closure c = bind(&work, target, path, name);
+            queue.push_back(c);
+        }
+        for (size_t i = 0; i < queue.size(); i++) {
+            queue[i]();
+        }
+        queue.clear();
+        report("local/closure-copy", benchAllocCount() - a0, benchNowNs() - start, CLOSURE_TASKS);
+    }
+    {
+        std::vector< UniqueClosure > queue;
+        queue.reserve(CLOSURE_TASKS);
+        uint64_t a0 = benchAllocCount();
+        long long start = benchNowNs();
+        for (int32_t i = 0; i < CLOSURE_TASKS; i++) {
+            std::string path = makePath(i);
+            queue.push_back(bind(&work, target, std::move(path), name));
+        }
+        for (size_t i = 0; i < queue.size(); i++) {
+            queue[i]();
+        }
+        queue.clear();
+        report("local/bind-move", benchAllocCount() - a0, benchNowNs() - start, CLOSURE_TASKS);
+    }
+    {
+        std::vector< UniqueClosure > queue;
+        queue.reserve(CLOSURE_TASKS);
+        uint64_t a0 = benchAllocCount();
+        long long start = benchNowNs();
+        for (int32_t i = 0; i < CLOSURE_TASKS; i++) {
+            std::string path = makePath(i);
+            queue.push_back([target, path = std::move(path), name]() { work(target, path, name); });
+        }
+        for (size_t i = 0; i < queue.size(); i++) {
+            queue[i]();
+        }
+        queue.clear();
+        report("local/unique-lambda", benchAllocCount() - a0, benchNowNs() - start, CLOSURE_TASKS);
+    }
+}
+
+static void waitHits(sp< BenchTarget > target, uint64_t expect)
+{
+    while (target->hits.load() < expect) {
+        usleep(200);
+    }
+}
+
+// 经过命名线程真实抛送，分配包括队列节点和执行线程一侧
+static void runPosted(sp< BenchTarget > target)
+{
+    std::string name("connection-worker-name");
+    uint64_t perTask = makePath(0).size() + name.size();
+    int32_t route = InternNamedThread("bench-closure");
+    // 先抛一个把线程拉起来，线程创建的分配不计入
+    PostOnNamedThread(route, []() {});
+    usleep(10000);
+
+    target->hits.store(0);
+    uint64_t a0 = benchAllocCount();
+    long long start = benchNowNs();
+    for (int32_t i = 0; i < CLOSURE_TASKS; i++) {
+        std::string path = makePath(i);
+        PostOnNamedThread("bench-closure", Closure(bind(&work, target, path, name)));
+    }
+    waitHits(target, perTask * CLOSURE_TASKS);
+    report("posted/name-closure", benchAllocCount() - a0, benchNowNs() - start, CLOSURE_TASKS);
+
+    target->hits.store(0);
+    a0 = benchAllocCount();
+    start = benchNowNs();
+    for (int32_t i = 0; i < CLOSURE_TASKS; i++) {
+        std::string path = makePath(i);
+        PostOnNamedThread(route, bind(&work, target, std::move(path), name));
+    }
+    waitHits(target, perTask * CLOSURE_TASKS);
+    report("posted/route-bind", benchAllocCount() - a0, benchNowNs() - start, CLOSURE_TASKS);
+
+    target->hits.store(0);
+    a0 = benchAllocCount();
+    start = benchNowNs();
+    for (int32_t i = 0; i < CLOSURE_TASKS; i++) {
+        std::string path = makePath(i);
+        PostOnNamedThread(route, [target, path = std::move(path), name]() { work(target, path, name); });
+    }
+    waitHits(target, perTask * CLOSURE_TASKS);
+    report("posted/route-lambda", benchAllocCount() - a0, benchNowNs() - start, CLOSURE_TASKS);
+    ReleaseNamedThread(route);
+}
+
+static void benchClosure()
+{
+    sp< BenchTarget > target = new BenchTarget();
+    runLocal(target);
+    runPosted(target);
+}
+
+BENCH_REGISTER("closure", benchClosure);
@@ -0,0 +1,63 @@
+// 宿主运行时之外运行基准时的Looper/Handler替身：只够JQSignal这类"构造时绑定当前线程Handler"的对象创建和同步调用，
+// 不实现消息循环，Handler::run直接在调用线程执行任务。弱符号，和真实运行时一起链接时以运行时为准
+#include "looper/Handler.h"
+#include "looper/Looper.h"
+#include "looper/MessageQueue.h"
+#include "port/jquick_thread.h"
+
+#define BENCH_WEAK __attribute__((weak))
+
+namespace JQuick
+{
+BENCH_WEAK MessageQueue::MessageQueue(bool quitAllowed) :
+        mMessages(NULL), mQuitAllowed(quitAllowed), mBlocked(false), mQuitting(false), mIdling(false), mNotifier(NULL)
+{
+}
+
+BENCH_WEAK MessageQueue::~MessageQueue() {}
+
+BENCH_WEAK Looper::Looper(bool quitAllowed) :
+        mQueue(quitAllowed), _tid(jquick_thread_get_current()), _callback(NULL), _context(NULL), _timeoutThreshold(0)
+{
+}
+
+BENCH_WEAK Looper::~Looper() {}
+
+BENCH_WEAK sp< Looper > Looper::myLooper()
+{
+    static thread_local sp< Looper > looper;
+    if (looper.get() == NULL) {
+        looper = new Looper(true);
+    }
+    return looper;
+}
+
+BENCH_WEAK JQuick_Thread Looper::getThreadId() const
+{
+    return _tid;
+}
+
+BENCH_WEAK Handler::Handler(sp< Looper > looper) : mLooper(looper) {}
+
+BENCH_WEAK Handler::~Handler() {}
+
+BENCH_WEAK sp< Looper > Handler::getLooper() const
+{
+    return mLooper;
+}
+
+BENCH_WEAK bool Handler::run(Task* task)
+{
+    task->run();
+    task->tryCleanup();
+    return true;
+}
+
+BENCH_WEAK void Handler::removeTasksAndMessages() {}
+
+BENCH_WEAK void Handler::dispatchMessage(Message*) {}
+
+BENCH_WEAK void Handler::handleMessage(Message*) {}
+
+BENCH_WEAK void Handler::handleRecycleMessage(Message*) {}
+}  // namespace JQuick
@@ -0,0 +1,128 @@
+// LruCache对比ShardedLruCache：多线程get/put混合吞吐，以及一次大目录扫描之后热点键还剩多少命中（TinyLFU准入）
+#include "bench.h"
+#include "utils/LruCache.h"
+#include "utils/ShardedLruCache.h"
+#include <stdio.h>
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define LRU_CAPACITY 512
+#define LRU_KEYS 2048
+#define LRU_OPS 400000
+#define LRU_HOT 256
+#define LRU_SCAN 2048
+
+using namespace JQuick;
+
+class StringDelegator : public LruCacheDelegator< std::string, int32_t >
+{
+public:
+    virtual uint32_t hash(const std::string& key)
+    {
+        return (uint32_t)std::hash< std::string >()(key);
+    }
+};
+
+static std::vector< std::string > makeKeys(const char* prefix, int32_t n)
+{
+    std::vector< std::string > keys;
+    char buf[64];
+    for (int32_t i = 0; i < n; i++) {
+        snprintf(buf, sizeof(buf), "/sdcard/%s/file_%05d.png", prefix, i);
+        keys.push_back(buf);
+    }
+    return keys;
+}
+
+// 80%的访问落在20%的键上；不命中就put，和file_type查mime的用法一样
+template < typename Cache >
+static void runMixed(const char* impl, Cache& cache, int32_t threads)
+{
+    std::vector< std::string > keys = makeKeys("mixed", LRU_KEYS);
+    std::atomic< uint64_t > hits(0);
+    int32_t perThread = LRU_OPS / threads;
+    long long start = benchNowNs();
+    std::vector< std::thread > workers;
+    for (int32_t t = 0; t < threads; t++) {
+        workers.push_back(std::thread([&cache, &keys, &hits, perThread, t]() {
+            uint32_t seed = 12345 + t * 7919;
+            uint64_t localHits = 0;
+            int32_t v;
+            for (int32_t i = 0; i < perThread; i++) {
+                seed = seed * 1103515245 + 12345;
+                uint32_t r = seed >> 8;
+                int32_t idx = (r % 10 < 8) ? (int32_t)(r / 10 % (LRU_KEYS / 5)) : (int32_t)(r / 10 % LRU_KEYS);
+                if (cache.getCache(keys[idx], v)) {
+                    localHits++;
+                } else {
+                    cache.putCache(keys[idx], idx);
+                }
+            }
+            hits.fetch_add(localHits);
+        }));
+    }
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+    long long elapsed = benchNowNs() - start;
+    uint64_t total = (uint64_t)perThread * threads;
+    char variant[32];
+    snprintf(variant, sizeof(variant), "%s/%dt", impl, threads);
+    benchReport("lru", variant, "%10.0f ops/s  hit %5.1f%%", benchRate(total, elapsed), hits.load() * 100.0 / total);
+}
+
+// 热点键先各访问几次，再顺序扫一遍从没见过的LRU_SCAN个键，最后看热点键还命中多少
+template < typename Cache >
+static void runScan(const char* impl, Cache& cache)
+{
+    std::vector< std::string > hot = makeKeys("hot", LRU_HOT);
+    std::vector< std::string > scan = makeKeys("scan", LRU_SCAN);
+    int32_t v;
+    for (int32_t round = 0; round < 4; round++) {
+        for (int32_t i = 0; i < LRU_HOT; i++) {
+            if (!cache.getCache(hot[i], v)) {
+                cache.putCache(hot[i], i);
+            }
+        }
+    }
+    for (int32_t i = 0; i < LRU_SCAN; i++) {
+        if (!cache.getCache(scan[i], v)) {
+            cache.putCache(scan[i], i);
+        }
+    }
+    int32_t hits = 0;
+    for (int32_t i = 0; i < LRU_HOT; i++) {
+        if (cache.getCache(hot[i], v)) {
+            hits++;
+        }
+    }
+    char variant[32];
+    snprintf(variant, sizeof(variant), "%s/scan", impl);
+    benchReport("lru", variant, "capacity %d  after %d-key scan  hot hits %d/%d", LRU_CAPACITY, LRU_SCAN, hits, LRU_HOT);
+}
+
+static void benchLru()
+{
+    StringDelegator delegator;
+    const int32_t threadCounts[] = {1, 2, 4, 8};
+    for (size_t i = 0; i < sizeof(threadCounts) / sizeof(threadCounts[0]); i++) {
+        LruCache< std::string, int32_t > lru(LRU_CAPACITY, &delegator);
+        runMixed("lru", lru, threadCounts[i]);
+        ShardedLruCache< std::string, int32_t > sharded(LRU_CAPACITY);
+        runMixed("sharded", sharded, threadCounts[i]);
+        ShardedLruCache< std::string, int32_t > admitted(LRU_CAPACITY, true);
+        runMixed("sharded+tinylfu", admitted, threadCounts[i]);
+    }
+
+    LruCache< std::string, int32_t > lru(LRU_CAPACITY, &delegator);
+    runScan("lru", lru);
+    ShardedLruCache< std::string, int32_t > sharded(LRU_CAPACITY);
+    runScan("sharded", sharded);
+    ShardedLruCache< std::string, int32_t > admitted(LRU_CAPACITY, true);
+    runScan("sharded+tinylfu", admitted);
+}
+
+BENCH_REGISTER("lru", benchLru);
@@ -0,0 +1,150 @@
+#include "bench.h"
+#include <malloc.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <new>
+
+struct BenchEntry {
+    const char* name;
+    BenchFunc func;
+};
+
+// 静态初始化顺序不定，登记表用函数内静态变量
+static std::vector<BenchEntry>& benchEntries()
+{
+    static std::vector<BenchEntry> entries;
+    return entries;
+}
+
+int benchRegister(const char* name, BenchFunc func)
+{
+    BenchEntry e = {name, func};
+    benchEntries().push_back(e);
+    return 0;
+}
+
+long long benchNowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int32_t benchCpus()
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int32_t)n : 1;
+}
+
+double benchPercentileUs(std::vector<long long>& samplesNs, double p)
+{
+    if (samplesNs.empty()) {
+        return 0;
+    }
+    size_t idx = (size_t)(p * (samplesNs.size() - 1));
+    std::nth_element(samplesNs.begin(), samplesNs.begin() + idx, samplesNs.end());
+    return samplesNs[idx] / 1000.0;
+}
+
+double benchRate(uint64_t count, long long elapsedNs)
+{
+    return elapsedNs > 0 ? count * 1e9 / elapsedNs : 0;
+}
+
+void benchReport(const char* name, const char* variant, const char* fmt, ...)
+{
+    printf("%-14s %-22s ", name, variant);
+    va_list ap;
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+    printf("\n");
+    fflush(stdout);
+}
+
+// 替换全局operator new/delete，统计C++堆分配次数和在用字节（按malloc_usable_size计）
+static std::atomic< uint64_t > s_allocCount(0);
+static std::atomic< long long > s_heapLive(0);
+static std::atomic< long long > s_heapPeak(0);
+
+void* operator new(size_t size)
+{
+    void* p = malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    s_allocCount.fetch_add(1, std::memory_order_relaxed);
+    long long live = s_heapLive.fetch_add(malloc_usable_size(p), std::memory_order_relaxed) + malloc_usable_size(p);
+    long long peak = s_heapPeak.load(std::memory_order_relaxed);
+    while (live > peak && !s_heapPeak.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    if (p) {
+        s_heapLive.fetch_sub(malloc_usable_size(p), std::memory_order_relaxed);
+        free(p);
+    }
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    operator delete(p);
+}
+
+uint64_t benchAllocCount()
+{
+    return s_allocCount.load();
+}
+
+long long benchHeapLive()
+{
+    return s_heapLive.load();
+}
+
+void benchHeapPeakReset()
+{
+    s_heapPeak.store(s_heapLive.load());
+}
+
+long long benchHeapPeak()
+{
+    return s_heapPeak.load();
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<BenchEntry>& entries = benchEntries();
+    std::sort(entries.begin(), entries.end(), [](const BenchEntry& a, const BenchEntry& b) {
+        return strcmp(a.name, b.name) < 0;
+    });
+
+    int ran = 0;
+    for (size_t i = 0; i < entries.size(); i++) {
+        bool selected = argc <= 1;
+        for (int k = 1; k < argc && !selected; k++) {
+            selected = strcmp(argv[k], entries[i].name) == 0;
+        }
+        if (selected) {
+            entries[i].func();
+            ran++;
+        }
+    }
+    if (ran == 0) {
+        fprintf(stderr, "usage: %s [bench...]\navailable:", argv[0]);
+        for (size_t i = 0; i < entries.size(); i++) {
+            fprintf(stderr, " %s", entries[i].name);
+        }
+        fprintf(stderr, "\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,186 @@
+// 多个抛送方同时往多个命名线程抛任务：旧实现（全局锁+std::queue）对比按名字/按路由号的无锁队列
+#include "bench.h"
+#include "jqutil_v2/JQNamedThread.h"
+#include "looper/Thread.h"
+#include "utils/Functional.h"
+#include "utils/Mutex.h"
+#include "utils/Condition.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <atomic>
+#include <map>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define NT_PRODUCERS 4
+#define NT_THREADS 8
+#define NT_POSTS 50000
+#define NT_BURSTS 20
+#define NT_BURST_POSTS 1000
+#define NT_BURST_GAP_MS 30
+
+using namespace JQuick;
+using namespace JQUTIL_NS;
+
+// 改造前的JQNamedThread：所有命名线程共用一把锁，按名字查map，队列是std::queue<Closure>
+static Mutex s_lockedMutex;
+
+class LockedNamedThread : public Thread
+{
+public:
+    LockedNamedThread(const std::string& name) : Thread(name) {}
+
+    virtual void run()
+    {
+        while (true) {
+            Closure c;
+            {
+                Mutex::Autolock l(s_lockedMutex);
+                if (_queue.empty()) {
+                    _condition.waitRelative(s_lockedMutex, 10000);
+                }
+                if (_queue.empty()) {
+                    s_lockedThreads().erase(_threadName);
+                    break;
+                }
+                c = _queue.front();
+                _queue.pop();
+            }
+            c();
+        }
+    }
+
+    static std::map< std::string, LockedNamedThread* >& s_lockedThreads()
+    {
+        static std::map< std::string, LockedNamedThread* > threads;
+        return threads;
+    }
+
+    std::queue< Closure > _queue;
+    Condition _condition;
+};
+
+static void lockedPost(const std::string& name, Closure c)
+{
+    Mutex::Autolock l(s_lockedMutex);
+    std::map< std::string, LockedNamedThread* >& threads = LockedNamedThread::s_lockedThreads();
+    std::map< std::string, LockedNamedThread* >::iterator it = threads.find(name);
+    LockedNamedThread* t;
+    if (it == threads.end()) {
+        t = new LockedNamedThread(name);
+        threads[name] = t;
+        t->start();
+    } else {
+        t = it->second;
+    }
+    t->_queue.push(c);
+    t->_condition.signal();
+}
+
+static void countRun(std::atomic< int32_t >* done)
+{
+    done->fetch_add(1, std::memory_order_relaxed);
+}
+
+static std::vector< std::string > threadNames(const char* prefix)
+{
+    std::vector< std::string > names;
+    char buf[32];
+    for (int32_t i = 0; i < NT_THREADS; i++) {
+        snprintf(buf, sizeof(buf), "%s-%d", prefix, i);
+        names.push_back(buf);
+    }
+    return names;
+}
+
+// 每个抛送方轮流往所有线程抛NT_POSTS个任务，计时到全部执行完
+template < typename Post >
+static void runContention(const char* variant, Post post)
+{
+    std::atomic< int32_t > done(0);
+    const int32_t total = NT_PRODUCERS * NT_POSTS;
+    long long start = benchNowNs();
+    std::vector< std::thread > producers;
+    for (int32_t p = 0; p < NT_PRODUCERS; p++) {
+        producers.push_back(std::thread([&post, &done, p]() {
+            for (int32_t i = 0; i < NT_POSTS; i++) {
+                post((p + i) % NT_THREADS, &done);
+            }
+        }));
+    }
+    for (size_t i = 0; i < producers.size(); i++) {
+        producers[i].join();
+    }
+    long long postedNs = benchNowNs() - start;
+    while (done.load() < total) {
+        usleep(200);
+    }
+    long long elapsed = benchNowNs() - start;
+    benchReport("named_thread", variant, "%10.0f posts/s  post %7.0f ns/op  drained %7.1f ms",
+                benchRate(total, elapsed), (double)postedNs * NT_PRODUCERS / total, elapsed / 1e6);
+}
+
+static const JQNamedThreadStats* findStats(const std::vector< JQNamedThreadStats >& all, const std::string& name)
+{
+    for (size_t i = 0; i < all.size(); i++) {
+        if (all[i].name == name) {
+            return &all[i];
+        }
+    }
+    return NULL;
+}
+
+// 突发抛送之间的间隔比keepAliveMs长时线程会反复重建，统计里的spawns可以看出来
+static void runBursts(const char* variant, uint32_t keepAliveMs)
+{
+    std::string name = std::string("nt-burst-") + variant;
+    int32_t route = InternNamedThread(name);
+    std::atomic< int32_t > done(0);
+    std::atomic< int32_t >* dp = &done;
+    for (int32_t b = 0; b < NT_BURSTS; b++) {
+        for (int32_t i = 0; i < NT_BURST_POSTS; i++) {
+            PostOnNamedThread(route, [dp]() { countRun(dp); }, 0, 0, keepAliveMs);
+        }
+        usleep(NT_BURST_GAP_MS * 1000);
+    }
+    while (done.load() < NT_BURSTS * NT_BURST_POSTS) {
+        usleep(200);
+    }
+    std::vector< JQNamedThreadStats > all;
+    GetNamedThreadStats(all);
+    const JQNamedThreadStats* s = findStats(all, name);
+    if (s) {
+        benchReport("named_thread", variant, "keepAlive %ums  spawns %u  idleExpiries %u  depthHighWater %d",
+                    keepAliveMs, s->spawns, s->idleExpiries, s->depthHighWater);
+    }
+    ReleaseNamedThread(route);
+}
+
+static void benchNamedThread()
+{
+    std::vector< std::string > lockedNames = threadNames("nt-locked");
+    runContention("locked/name", [&lockedNames](int32_t t, std::atomic< int32_t >* done) {
+        lockedPost(lockedNames[t], bind(&countRun, done));
+    });
+
+    std::vector< std::string > names = threadNames("nt-name");
+    runContention("mpsc/name", [&names](int32_t t, std::atomic< int32_t >* done) {
+        PostOnNamedThread(names[t], bind(&countRun, done));
+    });
+
+    std::vector< std::string > routeNames = threadNames("nt-route");
+    std::vector< int32_t > routes;
+    for (size_t i = 0; i < routeNames.size(); i++) {
+        routes.push_back(InternNamedThread(routeNames[i]));
+    }
+    runContention("mpsc/route", [&routes](int32_t t, std::atomic< int32_t >* done) {
+        PostOnNamedThread(routes[t], [done]() { countRun(done); });
+    });
+
+    runBursts("burst/keepalive-10ms", 10);
+    runBursts("burst/keepalive-100ms", 100);
+}
+
+BENCH_REGISTER("named_thread", benchNamedThread);
@@ -0,0 +1,186 @@
+// 宿主运行时之外运行基准时的port层：pthread实现，弱符号，和真实运行时一起链接时以运行时为准
+#include "port/jquick_mutex.h"
+#include "port/jquick_condition.h"
+#include "port/jquick_thread.h"
+#include "port/jquick_time.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+#define BENCH_WEAK __attribute__((weak))
+
+extern "C" {
+
+BENCH_WEAK JQuick_Mutex jquick_mutex_create()
+{
+    pthread_mutex_t* m = new pthread_mutex_t;
+    pthread_mutex_init(m, NULL);
+    return m;
+}
+
+BENCH_WEAK int jquick_mutex_lock(JQuick_Mutex m)
+{
+    return pthread_mutex_lock((pthread_mutex_t*)m);
+}
+
+BENCH_WEAK int jquick_mutex_unlock(JQuick_Mutex m)
+{
+    return pthread_mutex_unlock((pthread_mutex_t*)m);
+}
+
+BENCH_WEAK int jquick_mutex_destroy(JQuick_Mutex m)
+{
+    pthread_mutex_destroy((pthread_mutex_t*)m);
+    delete (pthread_mutex_t*)m;
+    return 0;
+}
+
+BENCH_WEAK JQuick_Condition jquick_condition_create()
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_t* c = new pthread_cond_t;
+    pthread_cond_init(c, &attr);
+    pthread_condattr_destroy(&attr);
+    return c;
+}
+
+BENCH_WEAK int jquick_condition_wait(JQuick_Condition condition, JQuick_Mutex mutex)
+{
+    return pthread_cond_wait((pthread_cond_t*)condition, (pthread_mutex_t*)mutex);
+}
+
+BENCH_WEAK int jquick_condition_wait_with_timeout(JQuick_Condition condition, JQuick_Mutex mutex, int millisecond)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec += millisecond / 1000;
+    ts.tv_nsec += (long)(millisecond % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return pthread_cond_timedwait((pthread_cond_t*)condition, (pthread_mutex_t*)mutex, &ts);
+}
+
+BENCH_WEAK int jquick_condition_signal(JQuick_Condition condition)
+{
+    return pthread_cond_signal((pthread_cond_t*)condition);
+}
+
+BENCH_WEAK int jquick_condition_broadcast(JQuick_Condition condition)
+{
+    return pthread_cond_broadcast((pthread_cond_t*)condition);
+}
+
+BENCH_WEAK int jquick_condition_destroy(JQuick_Condition condition)
+{
+    pthread_cond_destroy((pthread_cond_t*)condition);
+    delete (pthread_cond_t*)condition;
+    return 0;
+}
+
+// 线程分离创建，句柄只用于改名，由Thread::threadRun在线程结束前销毁
+struct BenchThread {
+    pthread_t tid;
+};
+
+static JQuick_Thread benchThreadCreate(Runner runner, void* args, int stackSize)
+{
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (stackSize > 0) {
+        pthread_attr_setstacksize(&attr, stackSize);
+    }
+    BenchThread* t = new BenchThread;
+    int ret = pthread_create(&t->tid, &attr, runner, args);
+    pthread_attr_destroy(&attr);
+    if (ret != 0) {
+        delete t;
+        return NULL;
+    }
+    return t;
+}
+
+BENCH_WEAK JQuick_Thread jquick_thread_create(const char* name, Runner runner, void* args)
+{
+    return benchThreadCreate(runner, args, 0);
+}
+
+BENCH_WEAK JQuick_Thread jquick_thread_create_with_stack_size(const char* name, Runner runner, void* args, int stackSize)
+{
+    return benchThreadCreate(runner, args, stackSize);
+}
+
+BENCH_WEAK int jquick_thread_destroy(JQuick_Thread thread)
+{
+    delete (BenchThread*)thread;
+    return 0;
+}
+
+BENCH_WEAK void jquick_thread_set_current_name(const char* name)
+{
+    char buf[16];
+    strncpy(buf, name, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+    pthread_setname_np(pthread_self(), buf);
+}
+
+BENCH_WEAK void jquick_thread_set_name(JQuick_Thread thread, const char* name)
+{
+}
+
+BENCH_WEAK JQuick_Thread jquick_thread_get_current()
+{
+    return (JQuick_Thread)(uintptr_t)pthread_self();
+}
+
+BENCH_WEAK int jquick_thread_set_priority(JQuick_Thread thread, int priority)
+{
+    return 0;
+}
+
+BENCH_WEAK long long jquick_get_current_time_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+BENCH_WEAK long long jquick_get_current_time()
+{
+    return jquick_get_current_time_ns() / 1000000LL;
+}
+
+BENCH_WEAK void jquick_sleep(int millisecond)
+{
+    struct timespec ts;
+    ts.tv_sec = millisecond / 1000;
+    ts.tv_nsec = (long)(millisecond % 1000) * 1000000L;
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+BENCH_WEAK long long jquick_get_real_time()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (long long)ts.tv_sec * 1000LL + ts.tv_nsec / 1000000LL;
+}
+
+// 有的平台头文件里的原子操作不是内联的
+BENCH_WEAK int32_t jquick_atomic_inc(volatile int32_t* addr)
+{
+    return __atomic_fetch_add(addr, 1, __ATOMIC_RELEASE);
+}
+
+BENCH_WEAK int32_t jquick_atomic_dec(volatile int32_t* addr)
+{
+    return __atomic_fetch_sub(addr, 1, __ATOMIC_RELEASE);
+}
+
+}  // extern "C"
@@ -0,0 +1,103 @@
+// JQSignal::emit吞吐：旧实现（每次emit在锁内拷贝整个std::map槽表）对比写时复制快照
+// 另有一个线程不停connect/disconnect一个额外的槽；emit在创建信号的线程上，AUTO连接直接调用
+#include "bench.h"
+#include "jqutil_v2/JQSignal.h"
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <stdio.h>
+#include <thread>
+
+// 每个变体至少跑这么久
+#define SIGNAL_MIN_NS 300000000LL
+
+using namespace JQUTIL_NS;
+
+// 改造前JQSignal的槽表和emit路径，只保留基准用到的部分
+class MapSignal
+{
+public:
+    using FuncType = std::function<void(int)>;
+
+    int connect(FuncType const& slot)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        int id = ++_currentId;
+        _slots[id] = slot;
+        return id;
+    }
+
+    void disconnect(int id)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _slots.erase(id);
+    }
+
+    void emit(int v) const
+    {
+        std::map<int, FuncType> slots;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            slots = _slots;
+        }
+        for (auto const& it : slots) {
+            it.second(v);
+        }
+    }
+
+private:
+    mutable std::mutex _mutex;
+    std::map<int, FuncType> _slots;
+    int _currentId{0};
+};
+
+template <typename Signal>
+static void runSignal(const char* impl, int32_t slots)
+{
+    Signal signal;
+    std::atomic<uint64_t> sum(0);
+    for (int32_t i = 0; i < slots; i++) {
+        signal.connect([&sum](int v) { sum.fetch_add(v, std::memory_order_relaxed); });
+    }
+
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> churns(0);
+    std::thread churn([&signal, &stop, &churns]() {
+        while (!stop.load(std::memory_order_relaxed)) {
+            int id = signal.connect([](int) {});
+            signal.disconnect(id);
+            churns.fetch_add(1, std::memory_order_relaxed);
+            std::this_thread::yield();
+        }
+    });
+
+    uint64_t emits = 0;
+    long long start = benchNowNs();
+    long long elapsed;
+    do {
+        for (int32_t i = 0; i < 256; i++) {
+            signal.emit(1);
+        }
+        emits += 256;
+        elapsed = benchNowNs() - start;
+    } while (elapsed < SIGNAL_MIN_NS);
+    stop.store(true);
+    churn.join();
+
+    char variant[32];
+    snprintf(variant, sizeof(variant), "%s/%d", impl, slots);
+    benchReport("signal", variant, "%10.0f emits/s  %10.0f slot calls/s  churns %llu",
+                benchRate(emits, elapsed), benchRate(sum.load(), elapsed), (unsigned long long)churns.load());
+}
+
+static void benchSignal()
+{
+    const int32_t slotCounts[] = {1, 8, 64};
+    for (size_t i = 0; i < sizeof(slotCounts) / sizeof(slotCounts[0]); i++) {
+        runSignal<MapSignal>("map-copy", slotCounts[i]);
+        runSignal<JQSignal<int> >("snapshot", slotCounts[i]);
+    }
+}
+
+BENCH_REGISTER("signal", benchSignal);
@@ -0,0 +1,264 @@
+// StealingThreadPool对比ThreadPool的结构：吞吐（任务/秒）和提交到开始执行的时延分位
+#include "bench.h"
+#include "threadpool/StealingThreadPool.h"
+#include "looper/Thread.h"
+#include "utils/Functional.h"
+#include "utils/Mutex.h"
+#include "utils/Condition.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <atomic>
+#include <list>
+#include <string>
+#include <vector>
+
+#define POOL_TASKS 200000
+#define POOL_FANOUT 16
+// 超过StealingThreadPool组回收阈值（1024）的groupId数
+#define POOL_GROUPS 4096
+
+using namespace JQuick;
+
+// ThreadPool本体由宿主运行时提供，不能单独链接。这里按ThreadPool.h的布局复刻一份：
+// 一把锁+一个条件变量+std::list，每次execute分配一个带两个std::string的任务对象，闭包是引用计数的Closure
+class ListPool
+{
+public:
+    struct ListTask {
+        ListTask(const std::string& g, const std::string& n, Closure f) : groupId(g), taskName(n), func(f) {}
+        std::string groupId;
+        std::string taskName;
+        Closure func;
+    };
+
+    class Worker : public Thread
+    {
+    public:
+        Worker(ListPool* pool) : Thread("listpool"), _pool(pool) {}
+        virtual void run() { _pool->workerLoop(); }
+        ListPool* _pool;
+    };
+
+    ListPool(int32_t workers) : _active(true), _live(workers)
+    {
+        for (int32_t i = 0; i < workers; i++) {
+            (new Worker(this))->start();
+        }
+    }
+
+    void execute(const std::string& groupId, const std::string& taskName, Closure func)
+    {
+        ListTask* task = new ListTask(groupId, taskName, func);
+        Mutex::Autolock l(_taskLock);
+        _tasks.push_back(task);
+        _condition.signal();
+    }
+
+    // 等所有worker退出
+    void shutdown()
+    {
+        Mutex::Autolock l(_taskLock);
+        _active = false;
+        _condition.broadcast();
+        while (_live > 0) {
+            _condition.wait(_taskLock);
+        }
+    }
+
+    void workerLoop()
+    {
+        while (true) {
+            ListTask* task = NULL;
+            {
+                Mutex::Autolock l(_taskLock);
+                while (_active && _tasks.empty()) {
+                    _condition.wait(_taskLock);
+                }
+                if (_tasks.empty()) {
+                    _live--;
+                    _condition.broadcast();
+                    return;
+                }
+                task = _tasks.front();
+                _tasks.pop_front();
+            }
+            task->func();
+            delete task;
+        }
+    }
+
+private:
+    Mutex _taskLock;
+    Condition _condition;
+    std::list< ListTask* > _tasks;
+    bool _active;
+    int32_t _live;
+};
+
+struct PoolRun {
+    PoolRun(int32_t n) : latNs(n), done(0) {}
+    std::vector< long long > latNs;
+    std::atomic< int32_t > done;
+};
+
+static void recordRun(PoolRun* r, int32_t i, long long t0)
+{
+    r->latNs[i] = benchNowNs() - t0;
+    r->done.fetch_add(1, std::memory_order_release);
+}
+
+static std::string groupName(int32_t i, int32_t groups)
+{
+    char buf[16];
+    snprintf(buf, sizeof(buf), "g%d", i % groups);
+    return buf;
+}
+
+static ListPool* s_listPool;
+static StealingThreadPool* s_stealPool;
+
+static void listSubmit(PoolRun* r, int32_t i, const std::string& g)
+{
+    s_listPool->execute(g, "bench", bind(&recordRun, r, i, benchNowNs()));
+}
+
+static void stealSubmit(PoolRun* r, int32_t i, const std::string& g)
+{
+    long long t0 = benchNowNs();
+    s_stealPool->execute(g, "bench", [r, i, t0]() { recordRun(r, i, t0); });
+}
+
+static void stealHandleSubmit(PoolRun* r, int32_t i, int32_t group)
+{
+    long long t0 = benchNowNs();
+    s_stealPool->execute(group, [r, i, t0]() { recordRun(r, i, t0); });
+}
+
+// 父任务在worker上再提交POOL_FANOUT个子任务，子任务走ThreadPool的全局队列或自己的双端队列
+static void listParent(PoolRun* r, int32_t base)
+{
+    for (int32_t k = 0; k < POOL_FANOUT; k++) {
+        listSubmit(r, base + k, std::string());
+    }
+}
+
+static void stealParent(PoolRun* r, int32_t base)
+{
+    for (int32_t k = 0; k < POOL_FANOUT; k++) {
+        stealSubmit(r, base + k, std::string());
+    }
+}
+
+static void waitDone(PoolRun& r, int32_t n)
+{
+    while (r.done.load(std::memory_order_acquire) < n) {
+        usleep(200);
+    }
+}
+
+static void report(const char* variant, PoolRun& r, int32_t n, long long elapsed)
+{
+    benchReport("threadpool", variant, "%10.0f tasks/s  p50 %8.1fus  p99 %8.1fus  p999 %8.1fus",
+                benchRate(n, elapsed), benchPercentileUs(r.latNs, 0.50),
+                benchPercentileUs(r.latNs, 0.99), benchPercentileUs(r.latNs, 0.999));
+}
+
+template < typename Submit >
+static void runFlat(const char* variant, Submit submit, int32_t groups)
+{
+    PoolRun r(POOL_TASKS);
+    std::vector< std::string > names;
+    for (int32_t i = 0; i < groups; i++) {
+        names.push_back(groupName(i, groups));
+    }
+    long long start = benchNowNs();
+    for (int32_t i = 0; i < POOL_TASKS; i++) {
+        submit(&r, i, groups > 0 ? names[i % groups] : std::string());
+    }
+    waitDone(r, POOL_TASKS);
+    report(variant, r, POOL_TASKS, benchNowNs() - start);
+}
+
+static void benchThreadPool()
+{
+    int32_t workers = benchCpus() > 1 ? benchCpus() : 2;
+
+    s_listPool = new ListPool(workers);
+    s_stealPool = new StealingThreadPool("bench", workers);
+
+    runFlat("list/external", &listSubmit, 0);
+    runFlat("stealing/external", &stealSubmit, 0);
+    runFlat("list/groups", &listSubmit, POOL_GROUPS);
+    runFlat("stealing/groups", &stealSubmit, POOL_GROUPS);
+    {
+        // 先驻留拿到组号，提交时不再按名字查表
+        std::vector< int32_t > handles;
+        for (int32_t i = 0; i < POOL_GROUPS; i++) {
+            handles.push_back(s_stealPool->internGroup(groupName(i, POOL_GROUPS)));
+        }
+        PoolRun r(POOL_TASKS);
+        long long start = benchNowNs();
+        for (int32_t i = 0; i < POOL_TASKS; i++) {
+            stealHandleSubmit(&r, i, handles[i % POOL_GROUPS]);
+        }
+        waitDone(r, POOL_TASKS);
+        report("stealing/group-handles", r, POOL_TASKS, benchNowNs() - start);
+        for (size_t i = 0; i < handles.size(); i++) {
+            s_stealPool->releaseGroup(handles[i]);
+        }
+    }
+
+    {
+        PoolRun r(POOL_TASKS);
+        long long start = benchNowNs();
+        for (int32_t base = 0; base < POOL_TASKS; base += POOL_FANOUT) {
+            s_listPool->execute(std::string(), "parent", bind(&listParent, &r, base));
+        }
+        waitDone(r, POOL_TASKS);
+        report("list/fanout", r, POOL_TASKS, benchNowNs() - start);
+    }
+    {
+        PoolRun r(POOL_TASKS);
+        long long start = benchNowNs();
+        for (int32_t base = 0; base < POOL_TASKS; base += POOL_FANOUT) {
+            PoolRun* rp = &r;
+            s_stealPool->execute([rp, base]() { stealParent(rp, base); });
+        }
+        waitDone(r, POOL_TASKS);
+        report("stealing/fanout", r, POOL_TASKS, benchNowNs() - start);
+    }
+
+    // 占住所有worker后提交POOL_GROUPS个不同组：排队中的组不能回收，组表要继续扩，
+    // removeTaskGroup仍按名字生效，应正好丢弃1个任务
+    {
+        std::atomic< bool > release(false);
+        std::atomic< int32_t > ran(0);
+        std::atomic< bool >* rel = &release;
+        std::atomic< int32_t >* cnt = &ran;
+        for (int32_t i = 0; i < workers; i++) {
+            s_stealPool->execute([rel]() {
+                while (!rel->load()) {
+                    usleep(100);
+                }
+            });
+        }
+        for (int32_t i = 0; i < POOL_GROUPS; i++) {
+            s_stealPool->execute(groupName(i, POOL_GROUPS), "late", [cnt]() { cnt->fetch_add(1); });
+        }
+        int32_t removed = s_stealPool->removeTaskGroup(groupName(POOL_GROUPS - 1, POOL_GROUPS));
+        release.store(true);
+        StealingPoolStats stats;
+        do {
+            usleep(1000);
+            s_stealPool->getStats(stats);
+        } while (ran.load() + (int32_t)stats.discarded < POOL_GROUPS);
+        benchReport("threadpool", "stealing/recycle", "groups %d  removed %d  ran %d  discarded %llu",
+                    POOL_GROUPS, removed, ran.load(), (unsigned long long)stats.discarded);
+    }
+
+    s_listPool->shutdown();
+    delete s_listPool;
+    s_stealPool->shutdown();
+}
+
+BENCH_REGISTER("threadpool", benchThreadPool);
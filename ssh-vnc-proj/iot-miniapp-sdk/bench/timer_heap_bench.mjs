@@ -0,0 +1,150 @@
+// ui/src/timer-heap.js的基准：node timer_heap_bench.mjs
+// 宿主定时器用虚拟时钟模拟，对比每个页面定时器各挂一个宿主定时器（宿主消息队列按when有序链表插入）
+// 和TimerHeap只挂一个宿主定时器两种方式；时间只统计JS侧，宿主链表插入按扫描步数折算
+import { readFileSync } from 'fs'
+import { fileURLToPath } from 'url'
+import { dirname, join } from 'path'
+
+const here = dirname(fileURLToPath(import.meta.url))
+const src = readFileSync(join(here, '../../ui/src/timer-heap.js'), 'utf8')
+const { TimerHeap } = await import('data:text/javascript,' + encodeURIComponent(src))
+
+// 虚拟宿主：有序单链表，和MessageQueue::enqueueMessage一样从表头线性找插入点
+class HostQueue {
+  constructor() {
+    this.head = null
+    this.now = 0
+    this.nextId = 1
+    this.live = new Map()
+    this.scanSteps = 0
+    this.armed = 0
+  }
+  setTimeout(func, ms) {
+    const msg = { id: this.nextId++, when: this.now + Math.max(0, ms), func, next: null, dead: false }
+    this.armed++
+    if (!this.head || msg.when < this.head.when) {
+      msg.next = this.head
+      this.head = msg
+    } else {
+      let p = this.head
+      while (p.next && p.next.when <= msg.when) {
+        p = p.next
+        this.scanSteps++
+      }
+      msg.next = p.next
+      p.next = msg
+    }
+    this.live.set(msg.id, msg)
+    return msg.id
+  }
+  clearTimeout(id) {
+    const msg = this.live.get(id)
+    if (msg) {
+      msg.dead = true
+      this.live.delete(id)
+    }
+  }
+  // 推进虚拟时间直到队列空，返回执行的回调数
+  run() {
+    let fired = 0
+    while (this.head) {
+      const msg = this.head
+      this.head = msg.next
+      if (msg.dead) {
+        continue
+      }
+      this.live.delete(msg.id)
+      this.now = Math.max(this.now, msg.when)
+      msg.func()
+      fired++
+    }
+    return fired
+  }
+}
+
+function installHost() {
+  const host = new HostQueue()
+  globalThis.setTimeout = (f, ms) => host.setTimeout(f, ms)
+  globalThis.clearTimeout = id => host.clearTimeout(id)
+  return host
+}
+
+// 每轮：加n个随机延时的定时器，取消一半，跑到全部到期
+function runDirect(n, delays) {
+  const host = installHost()
+  let fired = 0
+  const tokens = []
+  const t0 = process.hrtime.bigint()
+  for (let i = 0; i < n; i++) {
+    tokens.push(host.setTimeout(() => { fired++ }, delays[i]))
+  }
+  for (let i = 0; i < n; i += 2) {
+    host.clearTimeout(tokens[i])
+  }
+  host.run()
+  const ns = Number(process.hrtime.bigint() - t0)
+  return { ns, fired, armed: host.armed, scanSteps: host.scanSteps }
+}
+
+function runHeap(n, delays) {
+  const host = installHost()
+  const timers = new TimerHeap(() => host.now)
+  let fired = 0
+  let early = 0
+  const tokens = []
+  const t0 = process.hrtime.bigint()
+  for (let i = 0; i < n; i++) {
+    const due = host.now + delays[i]
+    tokens.push(timers.add(() => {
+      fired++
+      if (host.now < due) {
+        early++
+      }
+    }, delays[i], false))
+  }
+  for (let i = 0; i < n; i += 2) {
+    timers.remove(tokens[i])
+  }
+  host.run()
+  const ns = Number(process.hrtime.bigint() - t0)
+  return { ns, fired, armed: host.armed, scanSteps: host.scanSteps, early }
+}
+
+function report(variant, n, r) {
+  const opsPerSec = (n * 1e9 / r.ns).toFixed(0)
+  console.log(`${'timer_heap'.padEnd(14)} ${variant.padEnd(22)} ${String(opsPerSec).padStart(10)} timers/s  ` +
+    `fired ${r.fired}  hostTimers ${r.armed}  hostScanSteps ${r.scanSteps}` +
+    (r.early !== undefined ? `  early ${r.early}` : ''))
+}
+
+// 固定种子，两种方式用同一组延时
+let seed = 12345
+function rand() {
+  seed = (seed * 1103515245 + 12345) & 0x7fffffff
+  return seed / 0x7fffffff
+}
+
+for (const n of [1000, 5000, 20000]) {
+  const delays = []
+  for (let i = 0; i < n; i++) {
+    delays.push(Math.floor(rand() * 60000))
+  }
+  report(`direct/${n}`, n, runDirect(n, delays))
+  report(`heap/${n}`, n, runHeap(n, delays))
+}
+
+// 回调抛异常：其余定时器照常执行，异常在本轮结束后抛给宿主
+{
+  const host = installHost()
+  const timers = new TimerHeap(() => host.now)
+  let ran = 0
+  timers.add(() => { throw new Error('boom') }, 10, false)
+  timers.add(() => { ran++ }, 10, false)
+  let thrown = null
+  try {
+    host.run()
+  } catch (err) {
+    thrown = err
+  }
+  console.log(`${'timer_heap'.padEnd(14)} ${'throw'.padEnd(22)} rethrown ${thrown ? thrown.message : 'none'}  othersRan ${ran}`)
+}
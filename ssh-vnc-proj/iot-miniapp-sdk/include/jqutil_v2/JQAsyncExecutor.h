@@ -5,8 +5,9 @@
 #include "jqutil_v2/jqmisc.h"
 #include "quickjs/quickjs.h"
 #include "utils/REF.h"
-#include <map>
+#include <atomic>
 #include <string>
+#include <vector>
 
 namespace JQUTIL_NS {
 
@@ -21,8 +22,24 @@ typedef enum {
 typedef struct {
     JQCallbackType type;
     JSValue func;
+    // 在全局回调表里保活func用的key，进程内唯一
+    uint32_t pin;
 } JQCallbackDesc;
 
+// 一个callbackid最多对应两个回调（promise的resolve/reject），内联存放
+#define JQ_CALLBACK_INLINE 2
+
+// callbackid = (generation << JQ_CALLBACK_SLOT_BITS) | (slot + 1)，槽位复用时generation加一，旧id自然失效
+#define JQ_CALLBACK_SLOT_BITS 20
+#define JQ_CALLBACK_SLOT_MAX ((1u << JQ_CALLBACK_SLOT_BITS) - 1)
+
+typedef struct {
+    uint32_t id;  // 0表示空闲
+    uint32_t generation;
+    int count;
+    JQCallbackDesc descs[JQ_CALLBACK_INLINE];
+} JQCallbackSlot;
+
 class JQErrorDesc {
 public:
     JQErrorDesc(const std::string &name, const std::string &message, int code=0)
@@ -69,18 +86,31 @@ protected:
     uint32_t _addResolvingFuncs(JSContext *ctx, JSValue resolve, JSValue reject);
 
 protected:
-    inline uint32_t _genId() { return ++JQAsyncExecutor::_tokenId; }
-    void _freeDescVec(JSContext *ctx, uint32_t callbackid, std::vector<JQCallbackDesc> &descVec);
-
-    // auxiliary functions
-    void _onCallbackJSONJSThread(uint32_t callbackid, const std::string &json, const JQErrorDesc &errDesc, bool autoDel, bool hasErrDesc);
-    void _onCallbackJSThread(uint32_t callbackid, const Bson &bson, const JQErrorDesc &errDesc, bool autoDel, bool hasErrDesc);
+    // 分配槽位并登记回调，失败返回0
+    uint32_t _allocSlot(JSContext *ctx, const JQCallbackDesc *descs, int count);
+    JQCallbackSlot* _findSlot(uint32_t callbackid);
+    const JQCallbackSlot* _findSlot(uint32_t callbackid) const;
+    void _freeSlot(JSContext *ctx, JQCallbackSlot *slot);
+    void _callSlot(JSContext *ctx, uint32_t callbackid, const JQErrorDesc * errDesc, int argc, JSValueConst *argv, bool autoDel);
+
+    // 其他线程的完成通知先入无锁栈，JS线程一次取走一批处理，不再每个完成都抛一个任务
+    struct Completion;
+    void _pushCompletion(Completion *c);
+    void _drainCompletions();
+    void _runCompletion(Completion *c);
 
 protected:
-    static uint32_t _tokenId;
+    static std::atomic<uint32_t> _pinSeq;
+
+    // for async method callback, only accessed on js thread
+    std::vector<JQCallbackSlot> _slots;
+    std::vector<uint32_t> _freeSlots;
 
-    // for async method callback
-    std::map<uint32_t/*callbackid*/, std::vector<JQCallbackDesc>/*callback list*/> _callbackMap;
+    std::atomic<Completion*> _completions;
+    std::atomic<bool> _drainPosted;
+    // 上一轮时间片内没处理完的，只在JS线程访问
+    Completion *_backlogHead = NULL;
+    Completion *_backlogTail = NULL;
 
     JQuick::wp<CtxHolder> _ctxHolder;
 
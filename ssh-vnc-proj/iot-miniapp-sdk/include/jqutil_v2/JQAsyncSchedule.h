@@ -58,15 +58,32 @@ public:
         MODE_OBJECT     = 1<<3,
     };
 
+    JQAsyncSchedule() {}
+    // 路由缓存和模板绑定，拷贝（如clone模板）时只拷贝配置
+    JQAsyncSchedule(const JQAsyncSchedule &o);
+    JQAsyncSchedule& operator=(const JQAsyncSchedule &o);
+
     void setMode(int mode);
-    void dispatch(JQuick::sp<JQObjectTemplate> objTpl, JQuick::sp<JQBaseObject> cppObj,
-                  JQObjectProperty &property, JQAsyncInfo &asyncInfo);
+    // asyncInfo被移动进投递的任务，调用方之后不能再使用；
+    // objTpl/cppObj由调用方和asyncInfo保活，这里传裸指针，默认路径不再产生sp拷贝的原子操作
+    void dispatch(JQObjectTemplate *objTpl, JQBaseObject *cppObj,
+                  JQAsyncInfo &&asyncInfo);
 
     void setHook(JQAsyncScheduleHook hook);
 
 private:
+    void _prepareRoute(JQObjectTemplate *objTpl);
+    int32_t _objectRoute(JQBaseObject *cppObj);
+    std::string _objectKey(JQBaseObject *cppObj) const;
+
     int _mode = MODE_MODULE;
     JQAsyncScheduleHook _hook;
+
+    // module/function/app部分对同一模板不变，首次dispatch时拼好并驻留为路由号，
+    // MODE_OBJECT时对象部分的路由号缓存在JQBaseObject上；dispatch只在JS线程调用，无需加锁
+    bool _routeReady = false;
+    std::string _routePrefix;
+    int32_t _routeId = -1;
 };
 
 }  // namespace JQUTIL_NS
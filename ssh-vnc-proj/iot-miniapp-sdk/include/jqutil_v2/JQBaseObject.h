@@ -131,6 +131,8 @@ private:
     static void __js_object_finalizer(JSRuntime *rt, JSValue v);
     static void __js_object_gc_mark(JSRuntime *rt, JSValueConst v, JS_MarkFunc *mark_func);
 
+    friend class JQAsyncSchedule;
+
     friend class JQObjectSignalRegister;
     JQObjectSignalRegister* getOrCreateSignalRegister();
     JQObjectSignalRegister* getSignalRegister() const;
@@ -156,6 +158,9 @@ private:
     void*                               _valuePtr = NULL;
     JSContext*                          _ctx = NULL;
     JQuick::sp<JQObjectTemplate>        _objTpl;
+    // MODE_OBJECT异步调度时本对象的命名线程路由号，及其所属模板路由前缀
+    int32_t                             _asyncRouteId = -1;
+    int32_t                             _asyncRouteOwner = -1;
 #ifdef ENABLE_JQBASEOBJECT_FLAG
     uint32_t                            _flags = 0;
 #endif
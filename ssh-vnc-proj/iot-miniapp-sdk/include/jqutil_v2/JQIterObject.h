@@ -1,7 +1,10 @@
 #pragma once
 #include "jqutil_v2/JQDefs.h"
 #include "jqutil_v2/JQBaseObject.h"
+#include "jqutil_v2/JQFunctionTemplate.h"
 #include "jqutil_v2/JQKeepPtr.h"
+#include "jqutil_v2/jqbson.h"
+#include <string>
 
 namespace JQUTIL_NS {
 
@@ -45,5 +48,45 @@ protected:
     JSValue _target = JS_UNDEFINED;
 };
 
+// 异步迭代的一页，结构化数据用set，原生侧已经是JSON文本的用setJSON，省一次转换
+class JQAsyncIterPage {
+public:
+    void set(Bson value) { _value = std::move(value); _json.clear(); _isJSON = false; }
+    void setJSON(std::string json) { _json = std::move(json); _isJSON = true; }
+
+private:
+    friend class JQAsyncIterObject;
+    Bson _value;
+    std::string _json;
+    bool _isJSON = false;
+};
+
+/*
+ * 原生按需产出分页的异步迭代器：for await (const page of obj) {...}
+ * next()/return()走promise，按对象路由到该对象自己的异步线程，同一对象的调用串行执行，
+ * JS侧每取一页原生侧才生产一页，常驻内存以页大小为界而不是整个结果。
+ * 子类实现onAsyncIteratorNext；游标等资源在onAsyncIteratorReturn和析构里释放
+ * （JS对象回收时异步线程上可能还有next在执行，析构在最后一个引用释放后才发生）
+ */
+class JQAsyncIterObject: public JQIterObject {
+public:
+    JQAsyncIterObject();
+    virtual ~JQAsyncIterObject();
+    virtual void OnInit() override;
+
+    // 设置next/return，异步调度改为按对象路由
+    static void InitTpl(JQFunctionTemplateRef &tpl);
+
+protected:
+    // 运行在该对象的异步线程。返回>0并填好page表示产出一页，0表示迭代结束，负数为错误码（next被reject）
+    virtual int onAsyncIteratorNext(JQAsyncIterPage &page) = 0;
+    // 运行在该对象的异步线程，迭代提前结束（break/return）时调用一次
+    virtual void onAsyncIteratorReturn() {}
+
+private:
+    void _next(JQAsyncInfo &info);
+    void _return(JQAsyncInfo &info);
+};
+
 
 }  // namespace JQUTIL_NS
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+#include "jqutil_v2/JQDefs.h"
+#include "jqutil_v2/jqbson.h"
+#include "looper/Handler.h"
+#include "utils/Functional.h"
+#include "utils/Mutex.h"
+#include <stdint.h>
+#include <deque>
+
+namespace JQUTIL_NS {
+
+// 抛往JS线程的任务分道，数字越小越优先。
+// 只调度经JQPublishObject异步推送的任务；宿主$falcon接口（终端读写、VNC帧和指针）不经过这里
+typedef enum {
+    JQ_LANE_INPUT = 0,      // 需要立即响应用户操作的推送
+    JQ_LANE_INTERACTIVE,    // 交互渲染，默认：文件监听变化
+    JQ_LANE_BULK,           // 批量输出：搜索结果、目录用量
+    JQ_LANE_IDLE,           // 其他分道都空时才执行
+    JQ_LANE_COUNT,
+} JQLane;
+
+// 排队时延直方图，第i档为 < (64us << i)，最后一档为更大的
+#define JQ_LANE_HIST_BUCKETS 12
+
+struct JQLaneStats {
+    uint64_t count;
+    uint64_t maxUs;
+    uint64_t totalUs;
+    uint64_t hist[JQ_LANE_HIST_BUCKETS];
+    int32_t depth;
+};
+
+/*
+ * 按分道调度的JS线程任务泵。宿主Handler里同一时刻最多挂一个泵任务，
+ * 泵每次按优先级取任务执行，超过时间片就重新抛送自己，让出给宿主的输入/定时器消息；
+ * 低优先级任务等待超过饥饿阈值时提前执行一个，不会被一直压住。
+ * 同一分道内先进先出，不同分道之间不保证顺序。
+ */
+class JQLaneDispatcher: public JQuick::REF_BASE {
+public:
+    // 每个JS线程（Looper）一个实例，同一线程上各模块的推送共用分道。
+    // 注册表只持弱引用，最后一个推送对象和挂起的泵任务释放后实例随之释放
+    static JQuick::sp<JQLaneDispatcher> Get(JQuick::sp<JQuick::Handler> handler);
+    // 只查不建，该线程还没有推送对象时返回NULL
+    static JQuick::sp<JQLaneDispatcher> Find(JQuick::sp<JQuick::Looper> looper);
+
+    void post(JQLane lane, JQuick::UniqueClosure func);
+    void getStats(JQLaneStats stats[JQ_LANE_COUNT]) const;
+    // { input|interactive|bulk|idle: {count, depth, maxUs, meanUs, hist: [...]} }
+    Bson statsToBson() const;
+
+    ~JQLaneDispatcher();
+
+private:
+    JQLaneDispatcher(JQuick::sp<JQuick::Handler> handler);
+
+    struct Item {
+        JQuick::UniqueClosure func;
+        long long enqueueNs;
+    };
+
+    void _pump();
+    bool _takeLocked(long long nowNs, Item &item, int &lane);
+    void _postPumpLocked();
+    void _recordLocked(int lane, long long waitNs);
+
+    JQuick::sp<JQuick::Handler> _handler;
+    mutable JQuick::Mutex _lock;
+    std::deque<Item> _lanes[JQ_LANE_COUNT];
+    bool _pumpPosted;
+    JQLaneStats _stats[JQ_LANE_COUNT];
+};
+
+}  // namespace JQUTIL_NS
@@ -4,14 +4,38 @@
 #include <string>
 #include <stdint.h>
 #include <functional>
+#include <vector>
 
 namespace JQUTIL_NS {
 
-void PostOnNamedThread(const std::string &name, JQuick::Closure c,
+// Closure、std::function、lambda和bind的结果都可以直接传，小闭包存放在任务节点内
+void PostOnNamedThread(const std::string &name, JQuick::UniqueClosure c,
                          int32_t stackSize=0, int32_t priority=0,
                          uint32_t keepAliveMs=10000);
-void PostOnNamedThread(const std::string &name, std::function<void()> c,
+
+// 线程名驻留为整数路由号，之后按路由号抛送不再拼接/查找字符串，也不走全局锁
+// 同名多次驻留返回同一路由号，表满时返回-1
+int32_t InternNamedThread(const std::string &name);
+// 按路由号抛送可直接传lambda，小闭包存放在任务节点内
+void PostOnNamedThread(int32_t routeId, JQuick::UniqueClosure c,
                          int32_t stackSize=0, int32_t priority=0,
                          uint32_t keepAliveMs=10000);
+// 路由号不再使用（如按对象分线程时对象析构），线程空闲退出后路由号可被复用
+void ReleaseNamedThread(int32_t routeId);
+
+struct JQNamedThreadStats {
+    std::string name;
+    uint64_t posted;
+    uint64_t executed;
+    // 新建线程次数，远大于1说明keepAliveMs偏小、线程反复重建
+    uint32_t spawns;
+    // 空闲超时退出次数
+    uint32_t idleExpiries;
+    int32_t depth;
+    int32_t depthHighWater;
+    bool alive;
+};
+// 所有未释放路由的统计快照
+void GetNamedThreadStats(std::vector<JQNamedThreadStats> &out);
 
 }  // namespace JQUTIL_NS
@@ -150,6 +150,10 @@ public:
 
 public:
     JSAtom prop;
+    // 在所属模板_propertySlots中的下标，注入时作为C函数的magic
+    int slot = -1;
+    // 异步接口的追踪编号，首次分发时按 函数名.属性名 注册，见JQTrace.h
+    mutable int32_t traceId = -1;
     // accessor: get/ set
     // func property: get
     JQObjectPropertyType type;
@@ -429,6 +433,10 @@ protected:
     JQObjectProperty& _SetPromise(JSAtom prop, JQAsyncCallbackType func);
     JQObjectProperty& _setProperty(JSAtom prop, JQObjectProperty &property);
     bool _hasAsyncProperty() const;
+    inline JQObjectProperty* _propertyAt(int slot) const
+    {
+        return (uint32_t)slot < _propertySlots.size() ? _propertySlots[slot] : NULL;
+    }
 
 protected:
     JQInternalValueHolder* getOrCreateInternalValueHolder(uintptr_t objPtr);
@@ -459,6 +467,9 @@ protected:
     friend class JQFunctionInfo;
 
     std::map<JSAtom, JQObjectProperty> _propertyMap;
+    // 按注册顺序编号的属性表，指向_propertyMap中的节点（map节点地址不变）；
+    // JS侧调用按magic直接取下标，不再查map。QuickJS的magic只有16位，不能直接放atom
+    std::vector<JQObjectProperty*> _propertySlots;
 
     JQBaseObject::CreatorType _objCreator;
 
@@ -2,6 +2,8 @@
 #include "jqutil_v2/JQDefs.h"
 #include "jqutil_v2/JQObjectTemplate.h"
 #include "jqutil_v2/JQFunctionTemplate.h"
+#include "jqutil_v2/JQLaneDispatcher.h"
+#include "jqutil_v2/JQShapeCache.h"
 #include <string>
 #include <vector>
 #include <map>
@@ -21,10 +23,14 @@ public:
     static void InitTpl(JQFunctionTemplateRef &tpl);
     static void InitTpl(JQObjectTemplateRef &tpl);
 
-    void publishJSON(const std::string &topic, const std::string &json,
-                     JQPublishType pubType=JQ_PUBLISH_TYPE_AUTO);
+    // 异步推送按lane分道排队，同一对象同一lane内保持顺序
+    // 已有结构化数据时优先用publish(Bson)：JS线程上直接构造对象，不用先dump再JS_ParseJSON
+    void publishJSON(const std::string &topic, std::string json,
+                     JQPublishType pubType=JQ_PUBLISH_TYPE_AUTO,
+                     JQLane lane=JQ_LANE_INTERACTIVE);
     void publish(const std::string &topic, const Bson &bson,
-                 JQPublishType pubType=JQ_PUBLISH_TYPE_AUTO);
+                 JQPublishType pubType=JQ_PUBLISH_TYPE_AUTO,
+                 JQLane lane=JQ_LANE_INTERACTIVE);
     virtual void onSubscribe(const char* topic);
     virtual void onUnsubscribe(const char* topic);
 
@@ -34,10 +40,15 @@ private:
     void _UnsubscribeTopic(JQFunctionInfo &info);
     void _OnPublishJSON(const std::string &topic, const std::string &json);
     void _OnPublish(const std::string &topic, const Bson &json);
+    void _dispatchAsync(JQLane lane, JQuick::UniqueClosure c);
 
     // topic to callbacks as <token, callback> list
     std::map<std::string/*topic*/, std::vector<std::pair<uint32_t, JSValue> > > _topicCallbacksMap;
     uint32_t _pubCbTokenId;
+    // OnInit时取好，推送线程直接用
+    JQuick::sp<JQLaneDispatcher> _dispatcher;
+    // publish(Bson)转换JS对象用的key布局缓存，GC回收时释放atom
+    JQShapeCache _shapes;
 };
 
 }  // namespace JQUTIL_NS
\ No newline at end of file
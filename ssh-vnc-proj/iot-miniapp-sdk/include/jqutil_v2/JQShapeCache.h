@@ -0,0 +1,50 @@
+#pragma once
+#include "jqutil_v2/JQDefs.h"
+#include "jqutil_v2/jqbson.h"
+#include "quickjs/quickjs.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace JQUTIL_NS {
+
+#define JQ_SHAPE_CACHE_SLOTS 32
+// key超过该数量的对象不缓存，转换时子值暂存在栈上
+#define JQ_SHAPE_MAX_KEYS 16
+
+struct JQShapeCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+};
+
+/*
+ * Bson对象的key列表 -> 已驻留的JSAtom列表。
+ * 同一布局的消息（终端分块、帧信息等）反复推送时，不再每个key都按字符串查一次atom表。
+ * 直接映射，冲突时覆盖旧布局。只在JS线程使用，持有的atom要在context销毁前clear。
+ */
+class JQShapeCache {
+public:
+    JQShapeCache();
+
+    // 返回与obj的key按顺序一一对应的atom，空对象或key太多时返回NULL
+    // 返回的指针在下一次lookup前有效
+    const JSAtom* lookup(JSContext *ctx, const Bson::object &obj);
+    void clear(JSContext *ctx);
+    JQShapeCacheStats stats() const { return _stats; }
+
+private:
+    JQShapeCache(const JQShapeCache&);
+    JQShapeCache& operator=(const JQShapeCache&);
+
+    struct Shape {
+        uint32_t hash;
+        std::vector<std::string> keys;
+        std::vector<JSAtom> atoms;
+    };
+    static void _freeShape(JSContext *ctx, Shape &shape);
+
+    Shape _slots[JQ_SHAPE_CACHE_SLOTS];
+    JQShapeCacheStats _stats;
+};
+
+}  // namespace JQUTIL_NS
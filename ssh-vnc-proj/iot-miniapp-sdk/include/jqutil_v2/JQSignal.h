@@ -7,7 +7,8 @@
 #include <atomic>
 #include <mutex>
 #include <functional>
-#include <map>
+#include <memory>
+#include <vector>
 #include <assert.h>
 #include "JQuickContext.h"
 
@@ -64,6 +65,11 @@ private:
         JQuick::wp<JQuick::REF_BASE> instWeakPtr;
     };
 
+    // 槽列表写时复制：connect/disconnect在锁内复制一份再整体发布，
+    // emit只原子地取一次快照引用，遍历过程中不加锁、不拷贝槽
+    using SlotList = std::vector<Connection>;
+    using SlotsRef = std::shared_ptr<const SlotList>;
+
 public:
     // JQSignal()  = default;
     JQSignal() { _initHandler( new JQuick::Handler(JQuick::Looper::myLooper()) ); }
@@ -71,7 +77,7 @@ public:
     ~JQSignal() { _handler->removeTasksAndMessages(); }
 
     // Copy constructor and assignment create a new JQSignal.
-    JQSignal(JQSignal const& /*unused*/) {}
+    JQSignal(JQSignal const& /*unused*/) { _initHandler( new JQuick::Handler(JQuick::Looper::myLooper()) ); }
 
     JQSignal& operator=(JQSignal const& other) {
         if (this != &other) {
@@ -87,8 +93,9 @@ public:
     JQSignal(JQSignal&& other) noexcept
     {
         lock_type lock(other.m_mutex);
-        _slots = std::move(other._slots);
+        std::atomic_store(&_slots, std::atomic_exchange(&other._slots, SlotsRef()));
         _current_id = other._current_id;
+        _initHandler(other._handler);
     }
 
     JQSignal& operator=(JQSignal&& other) noexcept {
@@ -97,7 +104,7 @@ public:
             lock_type lock2(other.m_mutex, std::defer_lock);
             std::lock(lock1, lock2);
 
-            _slots     = std::move(other._slots);
+            std::atomic_store(&_slots, std::atomic_exchange(&other._slots, SlotsRef()));
             _current_id = other._current_id;
         }
 
@@ -109,7 +116,7 @@ public:
     // value can be used to disconnect the function again.
     inline int connect(FuncType const& slot, JQSignalConnType connType=JQ_SIGNAL_CONN_TYPE_AUTO) const {
         lock_type lock(m_mutex);
-        return _connect(slot, connType, TARGET_TYPE_GENERIC).id;
+        return _publish(_newConnection(slot, connType, TARGET_TYPE_GENERIC));
     }
 
     // Convenience method to connect a member function of an
@@ -120,14 +127,14 @@ public:
         lock_type lock(m_mutex);
         assert(inst->handler() != nullptr);
         JQuick::wp<JQuick::REF_BASE> instWeakPtr = inst;
-        Connection &conn = _connect([instWeakPtr, func](Args... args) {
+        Connection conn = _newConnection([instWeakPtr, func](Args... args) {
             JQuick::sp<T> instPtr = instWeakPtr.promote();
             if (instPtr.get() != NULL) {
                 (instPtr.get()->*func)(args...);
             }
         }, connType, TARGET_TYPE_MEMBER);
         conn.instWeakPtr = inst;
-        return conn.id;
+        return _publish(conn);
     }
 
     // Convenience method to connect a const member function
@@ -138,14 +145,14 @@ public:
         lock_type lock(m_mutex);
         assert(inst->handler() != nullptr);
         JQuick::wp<JQuick::REF_BASE> instWeakPtr = inst;
-        Connection &conn = _connect([instWeakPtr, func](Args... args) {
+        Connection conn = _newConnection([instWeakPtr, func](Args... args) {
             JQuick::sp<T> instPtr = instWeakPtr.promote();
             if (instPtr.get() != NULL) {
                 (instPtr.get()->*func)(args...);
             }
         }, connType, TARGET_TYPE_MEMBER);
         conn.instWeakPtr = inst;
-        return conn.id;
+        return _publish(conn);
     }
 
     // connect member function with magic
@@ -155,14 +162,14 @@ public:
         lock_type lock(m_mutex);
         assert(inst->jsHandler() != nullptr);
         JQuick::wp<T> instWeakPtr = inst;
-        Connection &conn = _connect([instWeakPtr, func, magic](Args... args) {
+        Connection conn = _newConnection([instWeakPtr, func, magic](Args... args) {
             JQuick::sp<T> instPtr = instWeakPtr.promote();
             if (instPtr.get() != NULL) {
                 (instPtr.get()->*func)(magic, args...);
             }
         }, connType, TARGET_TYPE_MEMBER);
         conn.instWeakPtr = inst;
-        return conn.id;
+        return _publish(conn);
     }
 
     template<typename T>
@@ -171,64 +178,82 @@ public:
         lock_type lock(m_mutex);
         assert(inst->handler() != nullptr);
         JQuick::wp<JQuick::REF_BASE> instWeakPtr = inst;
-        Connection &conn = _connect([instWeakPtr, func, magic](Args... args) {
+        Connection conn = _newConnection([instWeakPtr, func, magic](Args... args) {
             JQuick::sp<T> instPtr = instWeakPtr.promote();
             if (instPtr.get() != NULL) {
                 (instPtr.get()->*func)(magic, args...);
             }
         }, connType, TARGET_TYPE_MEMBER);
         conn.instWeakPtr = inst;
-        return conn.id;
+        return _publish(conn);
     }
 
     // disconnects a previously connected function.
     inline void disconnect(int id) const {
         lock_type lock(m_mutex);
-        _slots.erase(id);
+        SlotsRef cur = std::atomic_load(&_slots);
+        if (!cur) {
+            return;
+        }
+        for (size_t i = 0; i < cur->size(); i++) {
+            if ((*cur)[i].id == id) {
+                std::shared_ptr<SlotList> next = std::make_shared<SlotList>();
+                next->reserve(cur->size() - 1);
+                next->insert(next->end(), cur->begin(), cur->begin() + i);
+                next->insert(next->end(), cur->begin() + i + 1, cur->end());
+                std::atomic_store(&_slots, SlotsRef(std::move(next)));
+                return;
+            }
+        }
     }
 
     // disconnects all previously connected functions.
     inline void disconnect_all() const {
         lock_type lock(m_mutex);
-        _slots.clear();
+        std::atomic_store(&_slots, SlotsRef());
     }
 
     // calls all connected functions.
     inline void emit(Args... p) const {
-        std::map<int, Connection> slots = slots_reference();
-        for (auto const& it : slots) {
-            _call(it.second, p...);
+        SlotsRef slots = slots_reference();
+        if (!slots) {
+            return;
+        }
+        for (auto const& conn : *slots) {
+            _call(slots, conn, p...);
         }
     }
 
     // Calls all connected functions except for one.
     inline void emit_for_all_but_one(int excludedConnectionID, Args... p) const {
-        std::map<int, FuncType> slots = slots_reference();
-        for (auto const& it : slots) {
-            if (it.first != excludedConnectionID) {
-                _call(it.second, p...);
+        SlotsRef slots = slots_reference();
+        if (!slots) {
+            return;
+        }
+        for (auto const& conn : *slots) {
+            if (conn.id != excludedConnectionID) {
+                _call(slots, conn, p...);
             }
         }
     }
 
     // calls only one connected function.
     inline void emit_for(int connectionID, Args... p) const {
-        Connection conn;
-        conn.id = 0;
-        {
-            lock_type lock(m_mutex);
-            auto const& it = _slots.find(connectionID);
-            if (it != _slots.end()) conn = it->second;
+        SlotsRef slots = slots_reference();
+        if (!slots) {
+            return;
         }
-        if (conn.id != 0) {
-            _call(conn, p...);
+        for (auto const& conn : *slots) {
+            if (conn.id == connectionID) {
+                _call(slots, conn, p...);
+                break;
+            }
         }
     }
 
-    // used to get a reference to the slots for reading
-    inline std::map<int, Connection> slots_reference() const {
-        lock_type lock(m_mutex);
-        return _slots;
+    // immutable snapshot of the slots for reading, may be null when nothing connected
+    inline SlotsRef slots_reference() const {
+        return std::atomic_load(&_slots);
     }
 
     // thread relative
@@ -263,17 +288,30 @@ private:
         _tid = handler->getLooper()->getThreadId();
     }
 
-    inline Connection& _connect(FuncType const& slot, JQSignalConnType connType, TargetType targetType) const {
-        return _slots.emplace(std::make_pair(_current_id, Connection({
-            .id=++_current_id,
-            .func = slot,
-            .targetType=targetType,
-            .connType=connType,
-            .instWeakPtr=nullptr
-        }))).first->second;
+    inline Connection _newConnection(FuncType const& slot, JQSignalConnType connType, TargetType targetType) const {
+        Connection conn;
+        conn.id = ++_current_id;
+        conn.func = slot;
+        conn.targetType = targetType;
+        conn.connType = connType;
+        return conn;
+    }
+
+    // NOTE: m_mutex must be held
+    inline int _publish(const Connection &conn) const {
+        SlotsRef cur = std::atomic_load(&_slots);
+        std::shared_ptr<SlotList> next = std::make_shared<SlotList>();
+        next->reserve((cur ? cur->size() : 0) + 1);
+        if (cur) {
+            next->insert(next->end(), cur->begin(), cur->end());
+        }
+        next->push_back(conn);
+        std::atomic_store(&_slots, SlotsRef(std::move(next)));
+        return conn.id;
     }
 
-    inline void _call(const Connection &conn, Args... p) const
+    // 异步投递时带上快照引用保活conn，不再拷贝整个Connection
+    inline void _call(const SlotsRef &slots, const Connection &conn, Args... p) const
     {
         if (conn.connType == JQ_SIGNAL_CONN_TYPE_AUTO) {
             // according to signal
@@ -281,14 +319,16 @@ private:
                 // call it directly
                 conn.func(p...);
             } else {
-                _handler->run(new JQSignal_C11FuncTask([=]() {
-                  conn.func(p...);
+                const Connection *pconn = &conn;
+                _handler->run(new JQSignal_C11FuncTask([slots, pconn, p...]() {
+                  pconn->func(p...);
                 }));
             }
         } else if (conn.connType == JQ_SIGNAL_CONN_TYPE_ASYNC) {
             // according to signal
-            _handler->run(new JQSignal_C11FuncTask([=]() {
-              conn.func(p...);
+            const Connection *pconn = &conn;
+            _handler->run(new JQSignal_C11FuncTask([slots, pconn, p...]() {
+              pconn->func(p...);
             }));
         } else { // (conn.connType == JQ_SIGNAL_CONN_TYPE_SYNC)
             // force to execute
@@ -298,7 +338,7 @@ private:
 
 private:
     mutable std::mutex                  m_mutex;
-    mutable std::map<int, Connection >  _slots;
+    mutable SlotsRef                    _slots;
     mutable int                         _current_id{0};
 
     JQuick::sp<JQuick::Handler>         _handler;
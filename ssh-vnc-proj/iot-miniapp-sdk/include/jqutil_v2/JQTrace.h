@@ -0,0 +1,80 @@
+#pragma once
+#include "jqutil_v2/JQDefs.h"
+#include "jqutil_v2/jqbson.h"
+#include "port/jquick_time.h"
+#include <stdint.h>
+
+/*
+ * 接口级请求追踪：每个接口一份对数线性的时延直方图（每个2的幂分4档，相对误差不超过25%），
+ * 记录调用次数、入/出字节数，异步接口另记在路由线程上的排队时间。
+ * 写入只落在当前线程自己的缓冲里（单写者relaxed存取，不加锁），
+ * JQTraceStats()在注册表锁下汇总所有线程，线程退出时缓冲并入总账。
+ * 定义JQ_TRACE_DISABLE（Release构建）后记录接口都是空函数，宏展开为空。
+ */
+
+// 最后一个编号留给注册表满之后的接口，统计名为"(overflow)"
+#define JQ_TRACE_MAX_APIS 128
+
+namespace JQUTIL_NS {
+
+#ifndef JQ_TRACE_DISABLE
+
+// 同名返回同一编号，线程安全；返回值总是可直接用于记录
+int32_t JQTraceRegister(const char* name);
+void JQTraceRecord(int32_t id, long long execNs, uint64_t bytesIn, uint64_t bytesOut);
+void JQTraceRecordWait(int32_t id, long long waitNs);
+// 记到当前线程最内层的JQTraceScope上，没有时忽略
+void JQTraceAddBytes(uint64_t bytesIn, uint64_t bytesOut);
+inline long long JQTraceNowNs() { return jquick_get_current_time_ns(); }
+
+/*
+ * 快照：{ "<接口名>": { calls, bytesIn, bytesOut,
+ *                      us: {p50, p90, p99, max, mean},
+ *                      waitUs: {...}（有排队记录时） } }
+ * 没有调用过的接口不出现
+ */
+Bson JQTraceStats();
+
+// 作用域计时，析构时记一次调用
+class JQTraceScope {
+public:
+    explicit JQTraceScope(int32_t id);
+    ~JQTraceScope();
+    JQTraceScope(const JQTraceScope&) = delete;
+    JQTraceScope& operator=(const JQTraceScope&) = delete;
+
+    inline void addBytes(uint64_t bytesIn, uint64_t bytesOut)
+    {
+        _bytesIn += bytesIn;
+        _bytesOut += bytesOut;
+    }
+
+private:
+    friend void JQTraceAddBytes(uint64_t bytesIn, uint64_t bytesOut);
+    int32_t _id;
+    long long _startNs;
+    uint64_t _bytesIn;
+    uint64_t _bytesOut;
+    JQTraceScope* _prev;
+};
+
+#define JQ_TRACE_SCOPE(name) \
+    static const int32_t _jqTraceId = JQUTIL_NS::JQTraceRegister(name); \
+    JQUTIL_NS::JQTraceScope _jqTraceScope(_jqTraceId)
+#define JQ_TRACE_BYTES(in, out) JQUTIL_NS::JQTraceAddBytes((in), (out))
+
+#else
+
+inline int32_t JQTraceRegister(const char*) { return 0; }
+inline void JQTraceRecord(int32_t, long long, uint64_t, uint64_t) {}
+inline void JQTraceRecordWait(int32_t, long long) {}
+inline void JQTraceAddBytes(uint64_t, uint64_t) {}
+inline long long JQTraceNowNs() { return 0; }
+inline Bson JQTraceStats() { return Bson(Bson::object()); }
+
+#define JQ_TRACE_SCOPE(name) do {} while (0)
+#define JQ_TRACE_BYTES(in, out) do {} while (0)
+
+#endif  // JQ_TRACE_DISABLE
+
+}  // namespace JQUTIL_NS
@@ -116,6 +116,11 @@ public:
             :JQValue(ctx, value) {}
 };
 
+/*
+ * 参数对象访问器。属性按需读取，读过的按atom缓存在本对象上，不会枚举整个对象；
+ * 热路径把字段名做成JQAtom（如对象模板成员）复用，避免每次由字符串创建atom。
+ * keyValueMap()才会枚举全部属性，只在确实需要所有字段时使用
+ */
 class JQObject: public JQValue {
 public:
     JQObject(JSContext *ctx, JSValueConst value=JS_UNDEFINED)
@@ -126,15 +131,24 @@ public:
     { if (!_extracted) { _tryExtract(); _extracted = true; }
         return _keyValueMap; }
 
-    bool getBool(const std::string &prop);
-    inline int32_t getInt32(const std::string &prop)
-    { int32_t val = 0; JS_ToInt32(_ctx, &val, getValue(prop)); return val; }
-    inline uint32_t getUint32(const std::string &prop)
-    { uint32_t val = 0; JS_ToUint32(_ctx, &val, getValue(prop)); return val; }
-    inline int64_t getInt64(const std::string &prop)
-    { int64_t val = 0; JS_ToInt64(_ctx, &val, getValue(prop)); return val; }
-    inline double getDouble(const std::string &prop)
-    { double val = 0; JS_ToFloat64(_ctx, &val, getValue(prop)); return val; }
+    // atom取值，JQAtom可隐式转换
+    bool has(JSAtom prop);
+    JSValueConst getValue(JSAtom prop);
+    inline JSValue getDupValue(JSAtom prop)
+    { return JS_DupValue(_ctx, getValue(prop)); }
+    inline bool getBool(JSAtom prop) { return _toBool(getValue(prop)); }
+    inline int32_t getInt32(JSAtom prop) { return _toInt32(getValue(prop)); }
+    inline uint32_t getUint32(JSAtom prop) { return _toUint32(getValue(prop)); }
+    inline int64_t getInt64(JSAtom prop) { return _toInt64(getValue(prop)); }
+    inline double getDouble(JSAtom prop) { return _toDouble(getValue(prop)); }
+    std::string getString(JSAtom prop);
+
+    // 字符串取值，每次要查一次atom表
+    inline bool getBool(const std::string &prop) { return _toBool(getValue(prop)); }
+    inline int32_t getInt32(const std::string &prop) { return _toInt32(getValue(prop)); }
+    inline uint32_t getUint32(const std::string &prop) { return _toUint32(getValue(prop)); }
+    inline int64_t getInt64(const std::string &prop) { return _toInt64(getValue(prop)); }
+    inline double getDouble(const std::string &prop) { return _toDouble(getValue(prop)); }
 
     std::string getString(const std::string &prop);
 
@@ -142,14 +156,56 @@ public:
     inline JSValue getDupValue(const std::string &prop)
     { return JS_DupValue(_ctx, getValue(prop)); }
 
-    void clearCache() { _clearKeyValueMap(); _extracted = false; }
+    void clearCache() { _clearKeyValueMap(); _clearPropCache(); _extracted = false; }
 
 private:
     bool _tryExtract();
     void _clearKeyValueMap();
+    void _clearPropCache();
+
+    // 整数/布尔标签直接取，其余走QuickJS的转换
+    inline bool _toBool(JSValueConst val)
+    {
+        if (JS_VALUE_GET_TAG(val) == JS_TAG_BOOL) return JS_VALUE_GET_BOOL(val) != 0;
+        // NOTE: -1 is exception, treating as false
+        return JS_IsException(val) ? false : JS_ToBool(_ctx, val) == 1;
+    }
+    inline int32_t _toInt32(JSValueConst val)
+    {
+        if (JS_VALUE_GET_TAG(val) == JS_TAG_INT) return JS_VALUE_GET_INT(val);
+        int32_t res = 0; JS_ToInt32(_ctx, &res, val); return res;
+    }
+    inline uint32_t _toUint32(JSValueConst val)
+    {
+        if (JS_VALUE_GET_TAG(val) == JS_TAG_INT) return (uint32_t)JS_VALUE_GET_INT(val);
+        uint32_t res = 0; JS_ToUint32(_ctx, &res, val); return res;
+    }
+    inline int64_t _toInt64(JSValueConst val)
+    {
+        if (JS_VALUE_GET_TAG(val) == JS_TAG_INT) return JS_VALUE_GET_INT(val);
+        int64_t res = 0; JS_ToInt64(_ctx, &res, val); return res;
+    }
+    inline double _toDouble(JSValueConst val)
+    {
+        if (JS_VALUE_GET_TAG(val) == JS_TAG_INT) return JS_VALUE_GET_INT(val);
+        double res = 0; JS_ToFloat64(_ctx, &res, val); return res;
+    }
 
 private:
+    // has和getValue各自缓存自己的结果：has始终按JS_HasProperty（含原型链、值为undefined也算有），
+    // 不从缓存的值推断
+    struct PropEntry {
+        JSAtom atom;
+        JSValue value;
+        bool loaded;
+        // -1未查过，0/1为JS_HasProperty的结果
+        int8_t has;
+    };
+    PropEntry& _propEntry(JSAtom prop);
+
     std::map<std::string, JSValue> _keyValueMap;
+    // 已读取的属性，参数对象通常只读几个字段，线性查找即可
+    std::vector<PropEntry> _propCache;
     bool _extracted;
 };
 
@@ -215,7 +271,12 @@ public:
     JQAtom(JSContext *ctx, JSAtom atom): _ctx(ctx), _atom(atom), _scope(false) {}
     JQAtom(JSContext *ctx, const std::string &name): _ctx(ctx)
     {
-        _atom = JS_NewAtom(ctx, name.c_str());
+        _atom = JS_NewAtomLen(ctx, name.data(), name.size());
+        _scope = true;
+    }
+    JQAtom(JSContext *ctx, const char *name): _ctx(ctx)
+    {
+        _atom = JS_NewAtom(ctx, name);
         _scope = true;
     }
     ~JQAtom() {
@@ -225,21 +286,33 @@ public:
         _ctx = nullptr;
         _atom = 0;
     }
+    // 可作为成员缓存和拷贝，持有的atom各自计数
     JQAtom(const JQAtom &rval)
+        : _ctx(rval._ctx), _atom(rval._atom), _scope(rval._scope)
     {
-        assert(rval._ctx == _ctx);
-        this->~JQAtom();
-        _ctx = rval._ctx;
-        _atom = rval._atom;
         if (_scope) {
             JS_DupAtom(_ctx, _atom);
         }
     }
+    JQAtom& operator=(const JQAtom &rval)
+    {
+        if (this != &rval) {
+            if (rval._scope) {
+                JS_DupAtom(rval._ctx, rval._atom);
+            }
+            this->~JQAtom();
+            _ctx = rval._ctx;
+            _atom = rval._atom;
+            _scope = rval._scope;
+        }
+        return *this;
+    }
 
     JSAtom getAtom() const
     {
         return _atom;
     }
+    inline operator JSAtom() const { return _atom; }
 
 protected:
     inline void _setScope(bool scope) { _scope = scope; }
@@ -4,14 +4,14 @@
  *
  * The core object provided by the library is Bson. A Bson object represents any JSON
  * value: null, bool, number (int or double), string (std::string), array (std::vector), or
- * object (std::map).
+ * object (BsonMap, a key-sorted flat vector).
  *
  * Bson objects act like values: they can be assigned, copied, moved, compared for equality or
  * order, etc. There are also helper methods Bson::dump, to serialize a Bson to a string, and
  * Bson::parse (static) to parse a std::string as a Bson object.
  *
- * Internally, the various types of Bson object are represented by the BsonValue class
- * hierarchy.
+ * Internally, null/bool/number are stored inline in the Bson itself; string, array, object
+ * and binary live in a single ref-counted BsonNode shared between copies.
  *
  * A note on numbers - JSON specifies the syntax of number formatting but not its semantics,
  * so some JSON implementations distinguish between integers and floating-point numbers, while
@@ -51,10 +51,12 @@
 #pragma once
 
 #include "jqutil_v2/JQDefs.h"
+#include <stdint.h>
 #include <string>
 #include <vector>
 #include <map>
 #include <memory>
+#include <utility>
 #include "utils/REF.h"
 
 #ifdef _MSC_VER
@@ -71,12 +73,18 @@
 
 namespace JQUTIL_NS {
 
+// 小值内联、对象为扁平vector的布局放在单独的内联命名空间里，改变Bson相关符号的修饰名：
+// 按旧布局编译的目标文件或宿主库混进来时直接链接失败，不会按不同布局静默互调
+inline namespace bson_flat {
+
 enum BsonParse {
     STANDARD,
     COMMENTS
 };
 
-class BsonValue;
+struct BsonNode;
+class BsonMap;
+class BsonObjectBuilder;
 
 class Bson
 {
@@ -96,19 +104,57 @@ public:
 
     // Array and object typedefs
     typedef std::vector< Bson > array;
-    typedef std::map< std::string, Bson > object;
+    typedef BsonMap object;
     typedef std::vector< uint8_t > binary;
 
     // Constructors for the various types of JSON value.
-    Bson();                          // NUL
-    Bson(double value);              // NUMBER DOUBLE
-    Bson(int value);                 // NUMBER INT
-    Bson(bool value);                // BOOL
+    // null/bool/number不分配堆内存
+    Bson() : m_type(NUL) { m_u.node = NULL; }          // NUL
+    Bson(double value) : m_type(DOUBLE) { m_u.d = value; }  // NUMBER DOUBLE
+    Bson(int value) : m_type(INT) { m_u.i = value; }        // NUMBER INT
+    Bson(bool value) : m_type(BOOL) { m_u.b = value; }      // BOOL
     Bson(const std::string& value);  // STRING
+    Bson(std::string&& value);       // STRING
     Bson(const char* value);         // STRING
     Bson(const array& values);       // ARRAY
+    Bson(array&& values);            // ARRAY
     Bson(const object& values);      // OBJECT
+    Bson(object&& values);           // OBJECT
     Bson(const std::vector<uint8_t> &binary);  // BINARY
+    Bson(std::vector<uint8_t> &&binary);       // BINARY
+
+    // 拷贝只增加引用计数，移动不碰引用计数
+    Bson(const Bson& other) :
+            m_type(other.m_type), m_u(other.m_u)
+    {
+        if (boxed()) retain(m_u.node);
+    }
+    Bson(Bson&& other) noexcept :
+            m_type(other.m_type), m_u(other.m_u)
+    {
+        other.m_type = NUL;
+    }
+    Bson& operator=(const Bson& other)
+    {
+        Bson tmp(other);
+        swap(tmp);
+        return *this;
+    }
+    Bson& operator=(Bson&& other) noexcept
+    {
+        Bson tmp(std::move(other));
+        swap(tmp);
+        return *this;
+    }
+    ~Bson()
+    {
+        if (boxed()) release(m_type, m_u.node);
+    }
+    void swap(Bson& other) noexcept
+    {
+        std::swap(m_type, other.m_type);
+        std::swap(m_u, other.m_u);
+    }
 
     // Implicit constructor: anything with a to_json() function.
     //    template < class T, class = decltype(&T::to_json) >
@@ -140,7 +186,10 @@ public:
     //    Bson(void*) = delete;
 
     // Accessors
-    Type type() const;
+    Type type() const
+    {
+        return static_cast< Type >(m_type);
+    }
 
     bool is_null() const
     {
@@ -182,12 +231,24 @@ public:
     // Return the enclosed value if this is a number, 0 otherwise. Note that json11 does not
     // distinguish between integer and non-integer numbers - number_value() and int_value()
     // can both be applied to a NUMBER-typed object.
-    double number_value() const;
-    double double_value() const;
-    int int_value() const;
+    double number_value() const
+    {
+        return m_type == DOUBLE ? m_u.d : (m_type == INT ? m_u.i : 0);
+    }
+    double double_value() const
+    {
+        return number_value();
+    }
+    int int_value() const
+    {
+        return m_type == INT ? m_u.i : (m_type == DOUBLE ? static_cast< int >(m_u.d) : 0);
+    }
 
     // Return the enclosed value if this is a boolean, false otherwise.
-    bool bool_value() const;
+    bool bool_value() const
+    {
+        return m_type == BOOL ? m_u.b : false;
+    }
     // Return the enclosed string if this is a string, "" otherwise.
     const std::string& string_value() const;
     // Return the enclosed std::vector if this is an array, or an empty vector otherwise.
@@ -214,17 +275,10 @@ public:
     static Bson parse(const std::string& in,
                       std::string& err,
                       BsonParse strategy = STANDARD);
+    // 直接解析C字符串，不再拷贝成std::string
     static Bson parse(const char* in,
                       std::string& err,
-                      BsonParse strategy = STANDARD)
-    {
-        if (in) {
-            return parse(std::string(in), err, strategy);
-        } else {
-            err = "null input";
-            return Bson();
-        }
-    }
+                      BsonParse strategy = STANDARD);
     // Parse multiple objects, concatenated or separated by whitespace
     static std::vector< Bson > parse_multi(
             const std::string& in,
@@ -269,31 +323,109 @@ public:
     //    bool has_shape(const shape& types, std::string& err) const;
 
 private:
-    JQuick::sp< BsonValue > m_ptr;
+    friend class BsonObjectBuilder;
+
+    bool boxed() const
+    {
+        return m_type >= STRING;
+    }
+    static void retain(BsonNode* node);
+    static void release(uint8_t type, BsonNode* node);
+
+    union Payload {
+        double d;
+        int i;
+        bool b;
+        BsonNode* node;
+    };
+    uint8_t m_type;
+    Payload m_u;
 };
 
-// Internal class hierarchy - BsonValue objects are not exposed to users of this API.
-class BsonValue : public JQuick::REF_BASE
+/* BsonMap
+ *
+ * Bson::object的实现：按key排序的扁平vector，接口保持std::map的常用部分，
+ * 遍历顺序与原std::map一致。小对象查找和遍历比红黑树快，且只有一次分配。
+ * 批量构造请用BsonObjectBuilder，逐个operator[]插入乱序key是O(n^2)。
+ */
+class BsonMap
 {
-protected:
-    friend class Bson;
-    friend class BsonInt;
-    friend class BsonDouble;
-    virtual Bson::Type type() const = 0;
-    virtual bool equals(const BsonValue* other) const = 0;
-    virtual bool less(const BsonValue* other) const = 0;
-    virtual void dump(std::string& out) const = 0;
-    virtual double number_value() const;
-    virtual double double_value() const;
-    virtual int int_value() const;
-    virtual bool bool_value() const;
-    virtual const std::string& string_value() const;
-    virtual const Bson::array& array_items() const;
-    virtual const Bson& operator[](size_t i) const;
-    virtual const Bson::object& object_items() const;
-    virtual const Bson& operator[](const std::string& key) const;
-    virtual const Bson::binary& binary_value() const;
-    virtual ~BsonValue() {}
+public:
+    typedef std::string key_type;
+    typedef Bson mapped_type;
+    typedef std::pair< std::string, Bson > value_type;
+    typedef std::vector< value_type >::iterator iterator;
+    typedef std::vector< value_type >::const_iterator const_iterator;
+
+    iterator begin() { return m_items.begin(); }
+    iterator end() { return m_items.end(); }
+    const_iterator begin() const { return m_items.begin(); }
+    const_iterator end() const { return m_items.end(); }
+    size_t size() const { return m_items.size(); }
+    bool empty() const { return m_items.empty(); }
+    void clear() { m_items.clear(); }
+    void reserve(size_t n) { m_items.reserve(n); }
+
+    iterator find(const std::string& key);
+    const_iterator find(const std::string& key) const;
+    size_t count(const std::string& key) const
+    {
+        return find(key) == end() ? 0 : 1;
+    }
+    Bson& operator[](const std::string& key);
+    std::pair< iterator, bool > insert(const value_type& item);
+    size_t erase(const std::string& key);
+    iterator erase(const_iterator pos)
+    {
+        return m_items.erase(pos);
+    }
+
+    bool operator==(const BsonMap& rhs) const
+    {
+        return m_items == rhs.m_items;
+    }
+    bool operator<(const BsonMap& rhs) const
+    {
+        return m_items < rhs.m_items;
+    }
+
+private:
+    friend class BsonObjectBuilder;
+    iterator lower_bound(const std::string& key);
+    std::vector< value_type > m_items;
+};
+
+/* BsonObjectBuilder
+ *
+ * 批量构造对象：add只做追加，build时一次排序去重（同名key保留最后一次）。
+ * 只能移动，build后builder为空。
+ */
+class BsonObjectBuilder
+{
+public:
+    BsonObjectBuilder() {}
+    BsonObjectBuilder(BsonObjectBuilder&& other) = default;
+    BsonObjectBuilder& operator=(BsonObjectBuilder&& other) = default;
+    BsonObjectBuilder(const BsonObjectBuilder&) = delete;
+    BsonObjectBuilder& operator=(const BsonObjectBuilder&) = delete;
+
+    void reserve(size_t n)
+    {
+        m_items.reserve(n);
+    }
+    void add(std::string key, Bson value)
+    {
+        m_items.emplace_back(std::move(key), std::move(value));
+    }
+    size_t size() const
+    {
+        return m_items.size();
+    }
+    Bson build();
+
+private:
+    std::vector< BsonMap::value_type > m_items;
 };
 
+}  // inline namespace bson_flat
 }  // namespace JQUTIL_NS
@@ -15,6 +15,8 @@
 
 namespace JQUTIL_NS {
 
+class JQShapeCache;
+
 void jq_dump_error1(JSContext* ctx, JSValueConst exception_val);
 void jq_dump_error(JSContext* ctx);
 int jq_eval_binary_with_exc(JSContext* ctx, const uint8_t* buf, size_t buf_len);
@@ -37,12 +39,19 @@ JSValue jq_call_method_return(JSContext *ctx, JSValueConst obj, const std::strin
 void jq_define_property(JSContext *ctx, JSValueConst target, const std::string &sourceKey, const std::string &key);
 
 JSValue bsonToJSValue(JSContext *ctx, const Bson& bson);
+// 对象key走布局缓存里的atom，适合同一布局反复转换的推送路径
+JSValue bsonToJSValue(JSContext *ctx, const Bson& bson, JQShapeCache *shapes);
 Bson JSValueToBson(JSContext *ctx, JSValueConst val);
 
 JSValue mapToJSValue(JSContext* ctx, const std::map<std::string, std::string> &map);
 
 JSValue getOrCreateFunc(JSContext *ctx, const char* funcName, const char* funcCode);
 bool JQ_IsABOrABView(JSContext *ctx, JSValueConst val);
+// 原生识别ArrayBuffer/TypedArray/DataView并借用其内存，不调用JS、不拷贝。
+// 返回所在的ArrayBuffer（调用方释放），其他类型返回JS_UNDEFINED；已detach时*bufferData为NULL、*byteLength为0。
+// 借来的指针只在本次同步调用内有效，JS再运行可能detach或改写
+JSValue JQ_BorrowArrayBuffer(JSContext *ctx, JSValueConst val, uint8_t **bufferData,
+                             size_t *byteOffset, size_t *byteLength, size_t *bytesPerElement=NULL);
 JSValue JQ_NewUint8Array(JSContext *ctx, JSValueConst arg0, JSValueConst arg1=JS_UNDEFINED, JSValueConst arg2=JS_UNDEFINED);
 JSValue JQ_ToArrayBuffer(JSContext *ctx, JSValueConst value);
 
@@ -58,6 +67,37 @@ public:
 };
 JQuick::wp<CtxHolder> getOrCreateCtxHolder(JSContext *ctx);
 
+/*
+ * 每个JSContext一份的原生缓存：ctxHolder和热路径上常用的atom，避免每次查全局对象、用C字符串建atom。
+ * 挂在全局对象上的一个内部对象管理生命周期，context销毁回收全局对象时释放；只在JS线程上使用
+ */
+struct JQCtxCache {
+    JSContext *ctx;
+    JQuick::sp<CtxHolder> holder;
+    JSAtom atomLength;
+    JSAtom atomThen;
+    JSAtom atomCode;
+    JSAtom atomData;
+    JSAtom atomMsg;
+    JSAtom atomName;
+    JSAtom atomMessage;
+    JSAtom atomStack;
+    JSAtom atomTip;
+    JSAtom atomRes;
+    // 原生识别ArrayBuffer及其视图用
+    JSAtom atomArrayBuffer;
+    JSAtom atomDataView;
+    JSAtom atomUint8Array;
+    JSAtom atomProto;
+    JSAtom atomBuffer;
+    JSAtom atomByteOffset;
+    JSAtom atomByteLength;
+    // JQAsyncExecutor回调表在全局对象上的key
+    JSAtom atomAsyncCbMap;
+};
+// run js thread
+JQCtxCache* jq_ctx_cache(JSContext *ctx);
+
 class JQStdFuncTask : public JQuick::Task
 {
 public:
@@ -69,6 +109,18 @@ private:
     std::function<void()> _func;
 };
 
+// 闭包内联存放在任务对象里，抛给宿主Handler只分配任务本身这一次
+class JQUniqueFuncTask : public JQuick::Task
+{
+public:
+    JQUniqueFuncTask(JQuick::UniqueClosure func);
+    virtual ~JQUniqueFuncTask();
+    virtual void run();
+
+private:
+    JQuick::UniqueClosure _func;
+};
+
 #define DEF_MODULE_LOAD_FUNC(NAME, INIT_FUNC) \
 static JSModuleDef* NAME##_module_load(JSContext *ctx, const char *moduleName) { \
     if (strcmp(moduleName, #NAME) == 0) { \
@@ -9,6 +9,7 @@
 #include "jqutil_v2/JQFunctionTemplate.h"
 #include "jqutil_v2/JQIterObject.h"
 #include "jqutil_v2/JQKeepPtr.h"
+#include "jqutil_v2/JQLaneDispatcher.h"
 #include "jqutil_v2/JQNamedThread.h"
 #include "jqutil_v2/JQObjectTemplate.h"
 #include "jqutil_v2/JQProperty.h"
@@ -17,6 +18,7 @@
 #include "jqutil_v2/JQSerializer.h"
 #include "jqutil_v2/JQSignal.h"
 #include "jqutil_v2/JQTemplateEnv.h"
+#include "jqutil_v2/JQTrace.h"
 #include "jqutil_v2/JQTypes.h"
 #include "jqutil_v2/jqbson.h"
 #include "jqutil_v2/jqmisc.h"
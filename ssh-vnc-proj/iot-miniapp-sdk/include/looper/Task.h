@@ -35,7 +35,7 @@ class FunctionalTask : public Task
 {
 public:
     FunctionalTask(Closure func) :
-            _closure(func)
+            _closure(std::move(func))
     {
     }
     virtual ~FunctionalTask() {}
@@ -0,0 +1,135 @@
+#ifndef ___JQUICK_STEALINGTHREADPOOL_H___
+#define ___JQUICK_STEALINGTHREADPOOL_H___
+
+#include "threadpool/ThreadPool.h"
+#include "utils/Mutex.h"
+#include "utils/Condition.h"
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace JQuick
+{
+class StealingWorker;
+class StealingDeque;
+struct StealingTaskNode;
+struct StealingGroup;
+struct StealingGroupTable;
+
+struct StealingPoolStats {
+    uint64_t executed;
+    // 从其他worker的队列偷来执行的任务数
+    uint64_t stolen;
+    // 非worker线程提交，经注入队列分发的任务数
+    uint64_t injected;
+    // 被removeTask/removeTaskGroup/shutdown丢弃的任务数
+    uint64_t discarded;
+    int32_t liveWorkers;
+};
+
+/**
+ * Work-stealing pool, same interface as ThreadPool.
+ * 每个worker一个Chase-Lev双端队列：worker内部提交的任务无锁入队，空闲worker从别人队列顶部偷取；
+ * 外部线程提交走注入队列。任务节点侵入式链表+对象池复用，groupId驻留为整数。
+ * 按名字提交时查驻留表不加锁；高频按组提交可以先internGroup拿到组号，之后不再查表。
+ * Exp: StealingThreadPool* t = new StealingThreadPool("myjob", 4);
+ *      t->execute("group", "task", func);
+ *      int32_t g = t->internGroup("group"); t->execute(g, func); t->releaseGroup(g);
+ */
+class StealingThreadPool
+{
+public:
+    /**
+     * create pool instance with {new StealingThreadPool}
+     * destroy with {shutdown()}, will delete self automatic when all worker thread exit.
+     * 核心线程常驻，动态线程在所有worker都忙时按需启动，空闲10秒后退出
+     */
+    StealingThreadPool(const std::string& poolName, int32_t corePoolSize = 1, int32_t dynamicPoolSize = 0, size_t stackSize = 0);
+    void execute(ThreadPoolTask* task);
+    // Closure和lambda都可以传，小闭包直接存在任务节点里
+    void execute(UniqueClosure func);
+    // taskName只用于调试，不保存
+    void execute(const std::string& groupId, const std::string& taskName, JQuick::UniqueClosure func);
+    // 驻留groupId并一直占住，组号在releaseGroup之前不会被回收给别的名字；组表满时返回-1
+    int32_t internGroup(const std::string& groupId);
+    void releaseGroup(int32_t group);
+    // group为internGroup的返回值，-1等同于不分组
+    void execute(int32_t group, JQuick::UniqueClosure func);
+    bool removeTask(ThreadPoolTask* task);
+    // 未开始执行的该组任务不再执行，返回丢弃的任务数
+    int32_t removeTaskGroup(const std::string& groupId);
+
+    void shutdown();
+
+    void getStats(StealingPoolStats& stats) const;
+
+private:
+    ~StealingThreadPool();
+    StealingThreadPool(const StealingThreadPool& o);
+    StealingThreadPool& operator=(const StealingThreadPool&);
+
+    void submit(StealingTaskNode* node);
+    StealingTaskNode* takeInjected();
+    StealingTaskNode* steal(int32_t self);
+    bool hasWork() const;
+    void runNode(StealingWorker* worker, StealingTaskNode* node);
+    void discardNode(StealingTaskNode* node);
+    void wakeOne();
+    void startWorker(int32_t slot);
+    void workerLoop(StealingWorker* worker);
+    void workerExit(StealingWorker* worker);
+    // 驻留groupId并占住该组（pending加一），组表满且没有可回收的组时返回-1
+    int32_t acquireGroup(const std::string& groupId);
+    int32_t lookupGroup(const std::string& groupId, uint32_t hash);
+    int32_t findGroupLocked(const std::string& groupId, uint32_t hash) const;
+    int32_t newGroup(const std::string& groupId, uint32_t hash);
+    int32_t recycleGroup(const std::string& groupId, uint32_t hash);
+    void tableInsertLocked(int32_t id, uint32_t hash);
+    void tableRemoveLocked(int32_t id, uint32_t hash);
+    StealingGroup* groupAt(int32_t id) const;
+
+private:
+    std::string _poolName;
+    int32_t _corePoolSize;
+    int32_t _maxPoolSize;
+    size_t _stackSize;
+
+    // 每个槽位一个队列，动态线程退出后队列保留给下一个线程，偷取方不会访问到已释放的队列
+    StealingDeque* _deques;
+    std::atomic<int32_t>* _slotLive;
+    std::atomic<int32_t> _liveWorkers;
+    std::atomic<int32_t> _idleWorkers;
+    std::atomic<bool> _shutdown;
+
+    // 注入队列：外部线程提交
+    mutable Mutex _injectLock;
+    StealingTaskNode* _injectHead;
+    StealingTaskNode* _injectTail;
+    std::atomic<int32_t> _injectCount;
+
+    // 空闲worker在这里等待
+    mutable Mutex _parkLock;
+    mutable Condition _parkCond;
+    std::atomic<int32_t> _sleepers;
+
+    // groupId驻留表：开放寻址的组号数组，读不加锁，增删和扩容持_groupLock；
+    // 组号分块存放，组多了以后回收没有排队任务的组
+    mutable Mutex _groupLock;
+    std::atomic< StealingGroupTable* > _groupTable;
+    std::vector< StealingGroupTable* > _retiredTables;
+    std::atomic< std::atomic< StealingGroup* >* >* _groupChunks;
+    int32_t _groupCount;
+    int32_t _groupCursor;
+
+    // 只有execute(ThreadPoolTask*)提交的任务需要按指针查找（removeTask）
+    Mutex _trackLock;
+    std::map< ThreadPoolTask*, StealingTaskNode* > _tracked;
+
+    std::atomic<uint64_t> _injected;
+    std::atomic<uint64_t> _discarded;
+
+    friend class StealingWorker;
+};
+}  // namespace JQuick
+#endif
@@ -30,6 +30,11 @@
 #define ___JQUICK_BASE_FUNCTIONAL_H_
 
 #include "utils/REF.h"
+#include <new>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
 namespace JQuick
 {
@@ -389,168 +394,67 @@ public:
     virtual R operator()() = 0;
 };
 
-template < typename FunctionWrapper, typename FunctionType >
-class BoundFunctionImpl;
-
-template < typename FunctionWrapper, typename R >
-class BoundFunctionImpl< FunctionWrapper, R() > : public FunctionImpl< typename FunctionWrapper::ResultType() >
-{
-public:
-    explicit BoundFunctionImpl(FunctionWrapper functionWrapper) :
-            m_functionWrapper(functionWrapper)
-    {
-    }
-
-    virtual ~BoundFunctionImpl() {}
-
-    virtual typename FunctionWrapper::ResultType operator()()
-    {
-        return m_functionWrapper();
-    }
-
-private:
-    FunctionWrapper m_functionWrapper;
-};
-
-template < typename FunctionWrapper, typename R, typename P1 >
-class BoundFunctionImpl< FunctionWrapper, R(P1) > : public FunctionImpl< typename FunctionWrapper::ResultType() >
-{
-public:
-    BoundFunctionImpl(FunctionWrapper functionWrapper, const P1& p1) :
-            m_functionWrapper(functionWrapper), m_p1(ParamStorageTraits< P1 >::wrap(p1))
-    {
-    }
-
-    virtual ~BoundFunctionImpl() {}
-
-    virtual typename FunctionWrapper::ResultType operator()()
-    {
-        return m_functionWrapper(ParamStorageTraits< P1 >::unwrap(m_p1));
-    }
-
-private:
-    FunctionWrapper m_functionWrapper;
-    typename ParamStorageTraits< P1 >::StorageType m_p1;
-};
-
-template < typename FunctionWrapper, typename R, typename P1, typename P2 >
-class BoundFunctionImpl< FunctionWrapper, R(P1, P2) > : public FunctionImpl< typename FunctionWrapper::ResultType() >
-{
-public:
-    BoundFunctionImpl(FunctionWrapper functionWrapper, const P1& p1, const P2& p2) :
-            m_functionWrapper(functionWrapper), m_p1(ParamStorageTraits< P1 >::wrap(p1)), m_p2(ParamStorageTraits< P2 >::wrap(p2))
-    {
-    }
-
-    virtual ~BoundFunctionImpl() {}
-
-    virtual typename FunctionWrapper::ResultType operator()()
-    {
-        return m_functionWrapper(ParamStorageTraits< P1 >::unwrap(m_p1), ParamStorageTraits< P2 >::unwrap(m_p2));
-    }
-
-private:
-    FunctionWrapper m_functionWrapper;
-    typename ParamStorageTraits< P1 >::StorageType m_p1;
-    typename ParamStorageTraits< P2 >::StorageType m_p2;
-};
+template < typename >
+class Function;
 
-template < typename FunctionWrapper, typename R, typename P1, typename P2, typename P3 >
-class BoundFunctionImpl< FunctionWrapper, R(P1, P2, P3) > : public FunctionImpl< typename FunctionWrapper::ResultType() >
+/*
+ * bind的结果：函数和按值保存的实参都放在对象自身里，只能移动；右值实参直接移动进来，不再多拷贝一次。
+ * 可以直接放进UniqueClosure（小的内联存放，不分配堆内存）；
+ * 需要Closure的地方（宿主预编译的ThreadPool、FunctionalTask等）隐式转换一次，这时才在堆上分配引用计数的实现。
+ */
+template < typename FunctionWrapper, typename... P >
+class BoundFunction
 {
 public:
-    BoundFunctionImpl(FunctionWrapper functionWrapper, const P1& p1, const P2& p2, const P3& p3) :
-            m_functionWrapper(functionWrapper), m_p1(ParamStorageTraits< P1 >::wrap(p1)), m_p2(ParamStorageTraits< P2 >::wrap(p2)), m_p3(ParamStorageTraits< P3 >::wrap(p3))
-    {
-    }
+    typedef typename FunctionWrapper::ResultType ResultType;
 
-    virtual ~BoundFunctionImpl() {}
-
-    virtual typename FunctionWrapper::ResultType operator()()
+    template < typename... A >
+    explicit BoundFunction(FunctionWrapper functionWrapper, A&&... a) :
+            m_functionWrapper(functionWrapper), m_params(std::forward< A >(a)...)
     {
-        return m_functionWrapper(ParamStorageTraits< P1 >::unwrap(m_p1), ParamStorageTraits< P2 >::unwrap(m_p2), ParamStorageTraits< P3 >::unwrap(m_p3));
     }
 
-private:
-    FunctionWrapper m_functionWrapper;
-    typename ParamStorageTraits< P1 >::StorageType m_p1;
-    typename ParamStorageTraits< P2 >::StorageType m_p2;
-    typename ParamStorageTraits< P3 >::StorageType m_p3;
-};
+    BoundFunction(BoundFunction&&) = default;
+    BoundFunction& operator=(BoundFunction&&) = default;
+    BoundFunction(const BoundFunction&) = delete;
+    BoundFunction& operator=(const BoundFunction&) = delete;
 
-template < typename FunctionWrapper, typename R, typename P1, typename P2, typename P3, typename P4 >
-class BoundFunctionImpl< FunctionWrapper, R(P1, P2, P3, P4) > : public FunctionImpl< typename FunctionWrapper::ResultType() >
-{
-public:
-    BoundFunctionImpl(FunctionWrapper functionWrapper, const P1& p1, const P2& p2, const P3& p3, const P4& p4) :
-            m_functionWrapper(functionWrapper), m_p1(ParamStorageTraits< P1 >::wrap(p1)), m_p2(ParamStorageTraits< P2 >::wrap(p2)), m_p3(ParamStorageTraits< P3 >::wrap(p3)), m_p4(ParamStorageTraits< P4 >::wrap(p4))
+    ResultType operator()()
     {
+        return invoke(std::index_sequence_for< P... >());
     }
 
-    virtual ~BoundFunctionImpl() {}
-
-    virtual typename FunctionWrapper::ResultType operator()()
-    {
-        return m_functionWrapper(ParamStorageTraits< P1 >::unwrap(m_p1), ParamStorageTraits< P2 >::unwrap(m_p2), ParamStorageTraits< P3 >::unwrap(m_p3), ParamStorageTraits< P4 >::unwrap(m_p4));
-    }
+    operator Function< ResultType() >() &&;
 
 private:
-    FunctionWrapper m_functionWrapper;
-    typename ParamStorageTraits< P1 >::StorageType m_p1;
-    typename ParamStorageTraits< P2 >::StorageType m_p2;
-    typename ParamStorageTraits< P3 >::StorageType m_p3;
-    typename ParamStorageTraits< P4 >::StorageType m_p4;
-};
-
-template < typename FunctionWrapper, typename R, typename P1, typename P2, typename P3, typename P4, typename P5 >
-class BoundFunctionImpl< FunctionWrapper, R(P1, P2, P3, P4, P5) > : public FunctionImpl< typename FunctionWrapper::ResultType() >
-{
-public:
-    BoundFunctionImpl(FunctionWrapper functionWrapper, const P1& p1, const P2& p2, const P3& p3, const P4& p4, const P5& p5) :
-            m_functionWrapper(functionWrapper), m_p1(ParamStorageTraits< P1 >::wrap(p1)), m_p2(ParamStorageTraits< P2 >::wrap(p2)), m_p3(ParamStorageTraits< P3 >::wrap(p3)), m_p4(ParamStorageTraits< P4 >::wrap(p4)), m_p5(ParamStorageTraits< P5 >::wrap(p5))
+    template < size_t... I >
+    ResultType invoke(std::index_sequence< I... >)
     {
+        return m_functionWrapper(ParamStorageTraits< P >::unwrap(std::get< I >(m_params))...);
     }
 
-    virtual ~BoundFunctionImpl() {}
-
-    virtual typename FunctionWrapper::ResultType operator()()
-    {
-        return m_functionWrapper(ParamStorageTraits< P1 >::unwrap(m_p1), ParamStorageTraits< P2 >::unwrap(m_p2), ParamStorageTraits< P3 >::unwrap(m_p3), ParamStorageTraits< P4 >::unwrap(m_p4), ParamStorageTraits< P5 >::unwrap(m_p5));
-    }
-
-private:
     FunctionWrapper m_functionWrapper;
-    typename ParamStorageTraits< P1 >::StorageType m_p1;
-    typename ParamStorageTraits< P2 >::StorageType m_p2;
-    typename ParamStorageTraits< P3 >::StorageType m_p3;
-    typename ParamStorageTraits< P4 >::StorageType m_p4;
-    typename ParamStorageTraits< P5 >::StorageType m_p5;
+    std::tuple< typename ParamStorageTraits< P >::StorageType... > m_params;
 };
 
-template < typename FunctionWrapper, typename R, typename P1, typename P2, typename P3, typename P4, typename P5, typename P6 >
-class BoundFunctionImpl< FunctionWrapper, R(P1, P2, P3, P4, P5, P6) > : public FunctionImpl< typename FunctionWrapper::ResultType() >
+template < typename Bound >
+class BoundFunctionImpl : public FunctionImpl< typename Bound::ResultType() >
 {
 public:
-    BoundFunctionImpl(FunctionWrapper functionWrapper, const P1& p1, const P2& p2, const P3& p3, const P4& p4, const P5& p5, const P6& p6) :
-            m_functionWrapper(functionWrapper), m_p1(ParamStorageTraits< P1 >::wrap(p1)), m_p2(ParamStorageTraits< P2 >::wrap(p2)), m_p3(ParamStorageTraits< P3 >::wrap(p3)), m_p4(ParamStorageTraits< P4 >::wrap(p4)), m_p5(ParamStorageTraits< P5 >::wrap(p5)), m_p6(ParamStorageTraits< P6 >::wrap(p6))
+    explicit BoundFunctionImpl(Bound&& bound) :
+            m_bound(std::move(bound))
     {
     }
 
     virtual ~BoundFunctionImpl() {}
 
-    virtual typename FunctionWrapper::ResultType operator()()
+    virtual typename Bound::ResultType operator()()
     {
-        return m_functionWrapper(ParamStorageTraits< P1 >::unwrap(m_p1), ParamStorageTraits< P2 >::unwrap(m_p2), ParamStorageTraits< P3 >::unwrap(m_p3), ParamStorageTraits< P4 >::unwrap(m_p4), ParamStorageTraits< P5 >::unwrap(m_p5), ParamStorageTraits< P6 >::unwrap(m_p6));
+        return m_bound();
     }
 
 private:
-    FunctionWrapper m_functionWrapper;
-    typename ParamStorageTraits< P1 >::StorageType m_p1;
-    typename ParamStorageTraits< P2 >::StorageType m_p2;
-    typename ParamStorageTraits< P3 >::StorageType m_p3;
-    typename ParamStorageTraits< P4 >::StorageType m_p4;
-    typename ParamStorageTraits< P5 >::StorageType m_p5;
-    typename ParamStorageTraits< P6 >::StorageType m_p6;
+    Bound m_bound;
 };
 
 class FunctionBase
@@ -581,9 +485,6 @@ private:
     sp< FunctionImplBase > m_impl;
 };
 
-template < typename >
-class Function;
-
 template < typename R >
 class Function< R() > : public FunctionBase
 {
@@ -603,50 +504,230 @@ public:
     }
 };
 
+template < typename FunctionWrapper, typename... P >
+BoundFunction< FunctionWrapper, P... >::operator Function< typename BoundFunction< FunctionWrapper, P... >::ResultType() >() &&
+{
+    return Function< ResultType() >(new BoundFunctionImpl< BoundFunction >(std::move(*this)));
+}
+
+// 按参数个数分别重载（不用变参）：不加限定调用时，比经ADL找到的std::bind更特化，不会有歧义
 template < typename FunctionType >
-Function< typename FunctionWrapper< FunctionType >::ResultType() > bind(FunctionType function)
+BoundFunction< FunctionWrapper< FunctionType > > bind(FunctionType function)
 {
-    return Function< typename FunctionWrapper< FunctionType >::ResultType() >(new BoundFunctionImpl< FunctionWrapper< FunctionType >, typename FunctionWrapper< FunctionType >::ResultType() >(FunctionWrapper< FunctionType >(function)));
+    return BoundFunction< FunctionWrapper< FunctionType > >(FunctionWrapper< FunctionType >(function));
 }
 
 template < typename FunctionType, typename A1 >
-Function< typename FunctionWrapper< FunctionType >::ResultType() > bind(FunctionType function, const A1& a1)
+BoundFunction< FunctionWrapper< FunctionType >, typename std::decay< A1 >::type > bind(FunctionType function, A1&& a1)
 {
-    return Function< typename FunctionWrapper< FunctionType >::ResultType() >(new BoundFunctionImpl< FunctionWrapper< FunctionType >, typename FunctionWrapper< FunctionType >::ResultType(A1) >(FunctionWrapper< FunctionType >(function), a1));
+    return BoundFunction< FunctionWrapper< FunctionType >, typename std::decay< A1 >::type >(FunctionWrapper< FunctionType >(function), std::forward< A1 >(a1));
 }
 
 template < typename FunctionType, typename A1, typename A2 >
-Function< typename FunctionWrapper< FunctionType >::ResultType() > bind(FunctionType function, const A1& a1, const A2& a2)
+BoundFunction< FunctionWrapper< FunctionType >, typename std::decay< A1 >::type, typename std::decay< A2 >::type > bind(FunctionType function, A1&& a1, A2&& a2)
 {
-    return Function< typename FunctionWrapper< FunctionType >::ResultType() >(new BoundFunctionImpl< FunctionWrapper< FunctionType >, typename FunctionWrapper< FunctionType >::ResultType(A1, A2) >(FunctionWrapper< FunctionType >(function), a1, a2));
+    return BoundFunction< FunctionWrapper< FunctionType >, typename std::decay< A1 >::type, typename std::decay< A2 >::type >(FunctionWrapper< FunctionType >(function), std::forward< A1 >(a1), std::forward< A2 >(a2));
 }
 
 template < typename FunctionType, typename A1, typename A2, typename A3 >
-Function< typename FunctionWrapper< FunctionType >::ResultType() > bind(FunctionType function, const A1& a1, const A2& a2, const A3& a3)
+BoundFunction< FunctionWrapper< FunctionType >, typename std::decay< A1 >::type, typename std::decay< A2 >::type, typename std::decay< A3 >::type > bind(FunctionType function, A1&& a1, A2&& a2, A3&& a3)
 {
-    return Function< typename FunctionWrapper< FunctionType >::ResultType() >(new BoundFunctionImpl< FunctionWrapper< FunctionType >, typename FunctionWrapper< FunctionType >::ResultType(A1, A2, A3) >(FunctionWrapper< FunctionType >(function), a1, a2, a3));
+    return BoundFunction< FunctionWrapper< FunctionType >, typename std::decay< A1 >::type, typename std::decay< A2 >::type, typename std::decay< A3 >::type >(FunctionWrapper< FunctionType >(function), std::forward< A1 >(a1), std::forward< A2 >(a2), std::forward< A3 >(a3));
 }
 
 template < typename FunctionType, typename A1, typename A2, typename A3, typename A4 >
-Function< typename FunctionWrapper< FunctionType >::ResultType() > bind(FunctionType function, const A1& a1, const A2& a2, const A3& a3, const A4& a4)
+BoundFunction< FunctionWrapper< FunctionType >, typename std::decay< A1 >::type, typename std::decay< A2 >::type, typename std::decay< A3 >::type, typename std::decay< A4 >::type > bind(FunctionType function, A1&& a1, A2&& a2, A3&& a3, A4&& a4)
 {
-    return Function< typename FunctionWrapper< FunctionType >::ResultType() >(new BoundFunctionImpl< FunctionWrapper< FunctionType >, typename FunctionWrapper< FunctionType >::ResultType(A1, A2, A3, A4) >(FunctionWrapper< FunctionType >(function), a1, a2, a3, a4));
+    return BoundFunction< FunctionWrapper< FunctionType >, typename std::decay< A1 >::type, typename std::decay< A2 >::type, typename std::decay< A3 >::type, typename std::decay< A4 >::type >(FunctionWrapper< FunctionType >(function), std::forward< A1 >(a1), std::forward< A2 >(a2), std::forward< A3 >(a3), std::forward< A4 >(a4));
 }
 
 template < typename FunctionType, typename A1, typename A2, typename A3, typename A4, typename A5 >
-Function< typename FunctionWrapper< FunctionType >::ResultType() > bind(FunctionType function, const A1& a1, const A2& a2, const A3& a3, const A4& a4, const A5& a5)
+BoundFunction< FunctionWrapper< FunctionType >, typename std::decay< A1 >::type, typename std::decay< A2 >::type, typename std::decay< A3 >::type, typename std::decay< A4 >::type, typename std::decay< A5 >::type > bind(FunctionType function, A1&& a1, A2&& a2, A3&& a3, A4&& a4, A5&& a5)
 {
-    return Function< typename FunctionWrapper< FunctionType >::ResultType() >(new BoundFunctionImpl< FunctionWrapper< FunctionType >, typename FunctionWrapper< FunctionType >::ResultType(A1, A2, A3, A4, A5) >(FunctionWrapper< FunctionType >(function), a1, a2, a3, a4, a5));
+    return BoundFunction< FunctionWrapper< FunctionType >, typename std::decay< A1 >::type, typename std::decay< A2 >::type, typename std::decay< A3 >::type, typename std::decay< A4 >::type, typename std::decay< A5 >::type >(FunctionWrapper< FunctionType >(function), std::forward< A1 >(a1), std::forward< A2 >(a2), std::forward< A3 >(a3), std::forward< A4 >(a4), std::forward< A5 >(a5));
 }
 
 template < typename FunctionType, typename A1, typename A2, typename A3, typename A4, typename A5, typename A6 >
-Function< typename FunctionWrapper< FunctionType >::ResultType() > bind(FunctionType function, const A1& a1, const A2& a2, const A3& a3, const A4& a4, const A5& a5, const A6& a6)
+BoundFunction< FunctionWrapper< FunctionType >, typename std::decay< A1 >::type, typename std::decay< A2 >::type, typename std::decay< A3 >::type, typename std::decay< A4 >::type, typename std::decay< A5 >::type, typename std::decay< A6 >::type > bind(FunctionType function, A1&& a1, A2&& a2, A3&& a3, A4&& a4, A5&& a5, A6&& a6)
 {
-    return Function< typename FunctionWrapper< FunctionType >::ResultType() >(new BoundFunctionImpl< FunctionWrapper< FunctionType >, typename FunctionWrapper< FunctionType >::ResultType(A1, A2, A3, A4, A5, A6) >(FunctionWrapper< FunctionType >(function), a1, a2, a3, a4, a5, a6));
+    return BoundFunction< FunctionWrapper< FunctionType >, typename std::decay< A1 >::type, typename std::decay< A2 >::type, typename std::decay< A3 >::type, typename std::decay< A4 >::type, typename std::decay< A5 >::type, typename std::decay< A6 >::type >(FunctionWrapper< FunctionType >(function), std::forward< A1 >(a1), std::forward< A2 >(a2), std::forward< A3 >(a3), std::forward< A4 >(a4), std::forward< A5 >(a5), std::forward< A6 >(a6));
 }
 
 typedef Function< void() > Closure;
 
+#ifndef JQUICK_UNIQUE_FUNCTION_SIZE
+// 能放下一个sp加两个std::string的lambda
+#define JQUICK_UNIQUE_FUNCTION_SIZE (6 * sizeof(void*) + 2 * sizeof(std::string))
+#endif
+
+/*
+ * UniqueFunction: 只能移动、单一所有者的闭包。
+ * 不超过JQUICK_UNIQUE_FUNCTION_SIZE的可调用对象直接存放在对象内部，不分配堆内存也没有原子引用计数；
+ * 更大的才在堆上分配。bind的结果直接内联存放，Closure也可以转换过来（只占一个指针）。
+ * 用于任务只被执行一次的队列；Closure仍保持原布局，预编译的ThreadPool等接口继续用它。
+ */
+template < typename >
+class UniqueFunction;
+
+template < typename R >
+class UniqueFunction< R() >
+{
+public:
+    UniqueFunction() :
+            m_ops(NULL)
+    {
+    }
+
+    template < typename F,
+               typename = typename std::enable_if< !std::is_same< typename std::decay< F >::type, UniqueFunction >::value >::type,
+               typename = decltype(std::declval< typename std::decay< F >::type& >()()) >
+    UniqueFunction(F&& f) :
+            m_ops(NULL)
+    {
+        typedef typename std::decay< F >::type Fn;
+        if (isNullCallable(f)) {
+            return;
+        }
+        init< Fn >(std::forward< F >(f), std::integral_constant< bool, sizeof(Fn) <= sizeof(Storage) && alignof(Fn) <= alignof(Storage) && std::is_nothrow_move_constructible< Fn >::value >());
+    }
+
+    UniqueFunction(UniqueFunction&& other) noexcept :
+            m_ops(other.m_ops)
+    {
+        if (m_ops) {
+            m_ops->move(&other.m_storage, &m_storage);
+            other.m_ops = NULL;
+        }
+    }
+
+    UniqueFunction& operator=(UniqueFunction&& other) noexcept
+    {
+        if (this != &other) {
+            reset();
+            if (other.m_ops) {
+                m_ops = other.m_ops;
+                m_ops->move(&other.m_storage, &m_storage);
+                other.m_ops = NULL;
+            }
+        }
+        return *this;
+    }
+
+    UniqueFunction(const UniqueFunction&) = delete;
+    UniqueFunction& operator=(const UniqueFunction&) = delete;
+
+    ~UniqueFunction()
+    {
+        reset();
+    }
+
+    bool isNull() const
+    {
+        return !m_ops;
+    }
+
+    R operator()()
+    {
+        return m_ops->invoke(&m_storage);
+    }
+
+    void reset()
+    {
+        if (m_ops) {
+            m_ops->destroy(&m_storage);
+            m_ops = NULL;
+        }
+    }
+
+private:
+    typedef typename std::aligned_storage< JQUICK_UNIQUE_FUNCTION_SIZE, alignof(void*) >= alignof(double) ? alignof(void*) : alignof(double) >::type Storage;
+
+    struct Ops {
+        R (*invoke)(void* storage);
+        void (*move)(void* from, void* to);
+        void (*destroy)(void* storage);
+    };
+
+    template < typename Fn >
+    struct InlineOps {
+        static R invoke(void* storage)
+        {
+            return (*static_cast< Fn* >(storage))();
+        }
+        static void move(void* from, void* to)
+        {
+            Fn* f = static_cast< Fn* >(from);
+            new (to) Fn(std::move(*f));
+            f->~Fn();
+        }
+        static void destroy(void* storage)
+        {
+            static_cast< Fn* >(storage)->~Fn();
+        }
+        static const Ops* get()
+        {
+            static const Ops ops = {&invoke, &move, &destroy};
+            return &ops;
+        }
+    };
+
+    template < typename Fn >
+    struct HeapOps {
+        static R invoke(void* storage)
+        {
+            return (**static_cast< Fn** >(storage))();
+        }
+        static void move(void* from, void* to)
+        {
+            *static_cast< Fn** >(to) = *static_cast< Fn** >(from);
+        }
+        static void destroy(void* storage)
+        {
+            delete *static_cast< Fn** >(storage);
+        }
+        static const Ops* get()
+        {
+            static const Ops ops = {&invoke, &move, &destroy};
+            return &ops;
+        }
+    };
+
+    template < typename Fn, typename F >
+    void init(F&& f, std::true_type)
+    {
+        new (&m_storage) Fn(std::forward< F >(f));
+        m_ops = InlineOps< Fn >::get();
+    }
+
+    template < typename Fn, typename F >
+    void init(F&& f, std::false_type)
+    {
+        *reinterpret_cast< Fn** >(&m_storage) = new Fn(std::forward< F >(f));
+        m_ops = HeapOps< Fn >::get();
+    }
+
+    template < typename F >
+    static bool isNullCallable(const F&)
+    {
+        return false;
+    }
+    template < typename FR >
+    static bool isNullCallable(const Function< FR() >& f)
+    {
+        return f.isNull();
+    }
+    template < typename FR >
+    static bool isNullCallable(FR (*f)())
+    {
+        return !f;
+    }
+
+    Storage m_storage;
+    const Ops* m_ops;
+};
+
+typedef UniqueFunction< void() > UniqueClosure;
+
 }  // namespace JQuick
 
 #endif /* JQuick_FUNCTIONAL_H_ */
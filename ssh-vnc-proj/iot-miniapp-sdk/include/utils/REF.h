@@ -26,9 +26,33 @@
 #include "utils/StrongPtr.h"
 
 //#define JQUICK_DEBUG_REF 1
+// 统计引用计数的原子RMW次数（按线程计），用于核对热点路径上拷贝sp/wp的开销
+//#define JQUICK_REF_STATS 1
 
 namespace JQuick
 {
+#ifdef JQUICK_REF_STATS
+inline uint64_t& ref_rmw_counter()
+{
+    static thread_local uint64_t count = 0;
+    return count;
+}
+#define JQUICK_REF_RMW() (JQuick::ref_rmw_counter()++)
+#else
+#define JQUICK_REF_RMW()
+#endif
+
+// 当前线程累计的引用计数原子操作次数，未开JQUICK_REF_STATS时恒为0；
+// 预编译库（Looper/Handler等）内联的引用计数不计入
+inline uint64_t ref_rmw_count()
+{
+#ifdef JQUICK_REF_STATS
+    return ref_rmw_counter();
+#else
+    return 0;
+#endif
+}
+
 class REF_BASE;
 class weakref_impl;
 
@@ -55,6 +79,7 @@ public:
 
     inline weakref_impl* ref_weak()
     {
+        JQUICK_REF_RMW();
         jquick_atomic_inc(&m_weakrefCount);
 #ifdef JQUICK_DEBUG_REF
         int count = m_weakrefCount;
@@ -69,6 +94,7 @@ public:
         int count = m_weakrefCount - 1;
         LOGI("deref_weak refCount=%d this=%p ref=%p", count, this, m_ref);
 #endif
+        JQUICK_REF_RMW();
         const int32_t c = jquick_atomic_dec(&m_weakrefCount);
         if (c == 1) {
             delete this;
@@ -78,10 +104,12 @@ public:
     inline bool attempt_refStrong()
     {
         ref_weak();
+        JQUICK_REF_RMW();
         const int32_t c = jquick_atomic_inc(&m_strongrefCount);
         bool r = c >= 1;
         if (!r) {
             deref_weak();
+            JQUICK_REF_RMW();
             jquick_atomic_dec(&m_strongrefCount);
         }
         return r;
@@ -103,6 +131,7 @@ public:
 
     inline void REF()
     {
+        JQUICK_REF_RMW();
         jquick_atomic_inc(&m_weakref->m_strongrefCount);
         m_weakref->ref_weak();
 #ifdef JQUICK_DEBUG_REF
@@ -117,6 +146,7 @@ public:
         int count = getStrongCount() - 1;
         LOGI("deref refCount=%d this=%p weak=%p", count, this, weakref);
 #endif
+        JQUICK_REF_RMW();
         const int32_t c = jquick_atomic_dec(&weakref->m_strongrefCount);
         if (c == 1) {
             weakref->m_ref = NULL;
@@ -190,6 +220,12 @@ public:
 
     wp(T* other);
     wp(const wp< T >& other);
+    // 移动不改引用计数
+    wp(wp< T >&& other) noexcept :
+            m_ptr(other.m_ptr)
+    {
+        other.m_ptr = NULL;
+    }
     wp(const sp< T >& other);
     template < typename U >
     wp(U* other);
@@ -204,6 +240,18 @@ public:
 
     wp& operator=(T* other);
     wp& operator=(const wp< T >& other);
+    wp& operator=(wp< T >&& other) noexcept
+    {
+        if (this != &other) {
+            weakref_impl* old = m_ptr;
+            m_ptr = other.m_ptr;
+            other.m_ptr = NULL;
+            if (old) {
+                old->deref_weak();
+            }
+        }
+        return *this;
+    }
     wp& operator=(const sp< T >& other);
 
     template < typename U >
@@ -0,0 +1,369 @@
+#ifndef ___JQUICK_SHARDEDLRUCACHE_H___
+#define ___JQUICK_SHARDEDLRUCACHE_H___
+
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+#include "utils/Mutex.h"
+
+namespace JQuick
+{
+/*
+ * TinyLFU的频率草图：4行饱和计数（上限15），估计值取4行最小值。
+ * 累计计数达到采样数后全部减半，让旧的热度随时间衰减
+ */
+class LruFrequencySketch
+{
+public:
+    LruFrequencySketch() : _mask(0), _additions(0), _sampleSize(0) {}
+
+    void reset(int32_t capacity)
+    {
+        uint32_t width = 16;
+        while ((int32_t)width < capacity) {
+            width <<= 1;
+        }
+        _mask = width - 1;
+        _table.assign(width * 4, 0);
+        _additions = 0;
+        _sampleSize = (capacity > 0 ? capacity : 1) * 10;
+    }
+
+    void increment(uint32_t hash)
+    {
+        if (_table.empty()) {
+            return;
+        }
+        bool added = false;
+        for (int i = 0; i < 4; i++) {
+            uint8_t& c = _table[_index(hash, i)];
+            if (c < 15) {
+                c++;
+                added = true;
+            }
+        }
+        if (added && ++_additions >= _sampleSize) {
+            _halve();
+        }
+    }
+
+    int32_t frequency(uint32_t hash) const
+    {
+        if (_table.empty()) {
+            return 0;
+        }
+        int32_t freq = 15;
+        for (int i = 0; i < 4; i++) {
+            int32_t c = _table[_index(hash, i)];
+            if (c < freq) {
+                freq = c;
+            }
+        }
+        return freq;
+    }
+
+private:
+    inline uint32_t _index(uint32_t hash, int row) const
+    {
+        static const uint32_t seeds[4] = { 0x97cb3127u, 0xab7a6b29u, 0x5f356495u, 0x3c6ef372u };
+        uint32_t h = (hash ^ seeds[row]) * 0x9e3779b1u;
+        h ^= h >> 15;
+        return (uint32_t)row * (_mask + 1) + (h & _mask);
+    }
+
+    void _halve()
+    {
+        for (size_t i = 0; i < _table.size(); i++) {
+            _table[i] >>= 1;
+        }
+        _additions /= 2;
+    }
+
+    std::vector<uint8_t> _table;
+    uint32_t _mask;
+    int32_t _additions;
+    int32_t _sampleSize;
+};
+
+/*
+ * 分片LRU缓存：按hash高位选分片，每个分片独立加锁，多线程get/put只在同一分片上竞争。
+ * 节点是侵入式的，LRU双链和hash桶链都在节点里；分片满时直接复用淘汰的尾节点，满载后put不再分配内存。
+ * Hash是编译期策略（默认std::hash），不经过虚函数和std::function。
+ * admission为true时启用TinyLFU准入：访问频率在getCache时记录（先get未命中再put算一次访问），
+ * 分片满时新条目的频率不高于淘汰对象就不插入，列大目录这类一次性扫描不会把热条目挤出去。
+ * 每个条目计1，容量按条目数计算；同key已存在时putCache返回false，与LruCache一致
+ */
+template < typename CKey, typename CValue, typename Hash = std::hash< CKey >, int Shards = 8 >
+class ShardedLruCache
+{
+public:
+    ShardedLruCache(int32_t maxSize, bool admission = false);
+    ~ShardedLruCache();
+
+    bool putCache(const CKey& key, const CValue& v);
+    bool getCache(const CKey& key, CValue& v);
+
+    void resize(int32_t maxSize);
+    void erase();
+    void trim(float rate);
+    bool available() const { return _maxSize > 0; }
+    int32_t getCacheSize() const { return _cacheSize.load(std::memory_order_relaxed); }
+    int32_t getMaxCacheSize() const { return _maxSize; }
+
+private:
+    struct Node {
+        Node(const CKey& k, const CValue& v) : prev(NULL), next(NULL), hnext(NULL), hash(0), key(k), value(v) {}
+        Node* prev;
+        Node* next;
+        Node* hnext;
+        uint32_t hash;
+        CKey key;
+        CValue value;
+    };
+
+    struct Shard {
+        Shard() : head(NULL), tail(NULL), mask(0), size(0), capacity(0) {}
+        JQuick::Mutex mutex;
+        Node* head;
+        Node* tail;
+        std::vector<Node*> buckets;
+        uint32_t mask;
+        int32_t size;
+        int32_t capacity;
+        LruFrequencySketch sketch;
+        // 避免相邻分片的锁落在同一缓存行
+        char pad[64];
+    };
+
+    static inline uint32_t _mix(size_t h)
+    {
+        uint64_t x = (uint64_t)h;
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        return (uint32_t)(x ^ (x >> 32));
+    }
+    inline Shard& _shardOf(uint32_t hash) { return _shards[(hash >> 16) % Shards]; }
+
+    void _setCapacityLocked(Shard& s, int32_t capacity);
+    Node* _findLocked(Shard& s, uint32_t hash, const CKey& key) const;
+    void _linkLocked(Shard& s, Node* n);
+    void _unlinkLocked(Shard& s, Node* n);
+    void _evictLocked(Shard& s, int32_t capacity);
+    static int32_t _shardCapacity(int32_t maxSize, int idx)
+    {
+        return maxSize / Shards + (idx < maxSize % Shards ? 1 : 0);
+    }
+
+private:
+    int32_t _maxSize;
+    bool _admission;
+    std::atomic<int32_t> _cacheSize;
+    Hash _hash;
+    Shard _shards[Shards];
+};
+
+template < typename CKey, typename CValue, typename Hash, int Shards >
+ShardedLruCache< CKey, CValue, Hash, Shards >::ShardedLruCache(int32_t maxSize, bool admission) :
+        _maxSize(maxSize < 0 ? 0 : maxSize),
+        _admission(admission),
+        _cacheSize(0)
+{
+    for (int i = 0; i < Shards; i++) {
+        JQuick::Mutex::Autolock l(_shards[i].mutex);
+        _setCapacityLocked(_shards[i], _shardCapacity(_maxSize, i));
+    }
+}
+
+template < typename CKey, typename CValue, typename Hash, int Shards >
+ShardedLruCache< CKey, CValue, Hash, Shards >::~ShardedLruCache()
+{
+    erase();
+}
+
+template < typename CKey, typename CValue, typename Hash, int Shards >
+bool ShardedLruCache< CKey, CValue, Hash, Shards >::putCache(const CKey& key, const CValue& v)
+{
+    uint32_t hash = _mix(_hash(key));
+    Shard& s = _shardOf(hash);
+    JQuick::Mutex::Autolock l(s.mutex);
+    if (s.capacity <= 0) {
+        return false;
+    }
+    if (_findLocked(s, hash, key) != NULL) {
+        return false;
+    }
+    Node* n;
+    if (s.size >= s.capacity) {
+        Node* victim = s.tail;
+        if (_admission && s.sketch.frequency(hash) <= s.sketch.frequency(victim->hash)) {
+            return false;
+        }
+        // 复用尾节点
+        _unlinkLocked(s, victim);
+        n = victim;
+        n->key = key;
+        n->value = v;
+    } else {
+        n = new Node(key, v);
+        _cacheSize.fetch_add(1, std::memory_order_relaxed);
+    }
+    n->hash = hash;
+    _linkLocked(s, n);
+    return true;
+}
+
+template < typename CKey, typename CValue, typename Hash, int Shards >
+bool ShardedLruCache< CKey, CValue, Hash, Shards >::getCache(const CKey& key, CValue& v)
+{
+    uint32_t hash = _mix(_hash(key));
+    Shard& s = _shardOf(hash);
+    JQuick::Mutex::Autolock l(s.mutex);
+    if (_admission) {
+        s.sketch.increment(hash);
+    }
+    Node* n = _findLocked(s, hash, key);
+    if (n == NULL) {
+        return false;
+    }
+    if (n != s.head) {
+        // 移到表头
+        n->prev->next = n->next;
+        if (n->next) {
+            n->next->prev = n->prev;
+        } else {
+            s.tail = n->prev;
+        }
+        n->prev = NULL;
+        n->next = s.head;
+        s.head->prev = n;
+        s.head = n;
+    }
+    v = n->value;
+    return true;
+}
+
+template < typename CKey, typename CValue, typename Hash, int Shards >
+void ShardedLruCache< CKey, CValue, Hash, Shards >::resize(int32_t maxSize)
+{
+    if (maxSize < 0) maxSize = 0;
+    if (_maxSize == maxSize) {
+        return;
+    }
+    _maxSize = maxSize;
+    for (int i = 0; i < Shards; i++) {
+        JQuick::Mutex::Autolock l(_shards[i].mutex);
+        _setCapacityLocked(_shards[i], _shardCapacity(maxSize, i));
+    }
+}
+
+template < typename CKey, typename CValue, typename Hash, int Shards >
+void ShardedLruCache< CKey, CValue, Hash, Shards >::erase()
+{
+    for (int i = 0; i < Shards; i++) {
+        JQuick::Mutex::Autolock l(_shards[i].mutex);
+        _evictLocked(_shards[i], 0);
+    }
+}
+
+template < typename CKey, typename CValue, typename Hash, int Shards >
+void ShardedLruCache< CKey, CValue, Hash, Shards >::trim(float rate)
+{
+    for (int i = 0; i < Shards; i++) {
+        Shard& s = _shards[i];
+        JQuick::Mutex::Autolock l(s.mutex);
+        int32_t newSize = int32_t(s.capacity * rate);
+        _evictLocked(s, newSize > 0 ? newSize : 0);
+    }
+}
+
+// 桶数取不小于容量的2的幂，容量变化时按LRU链重新挂桶
+template < typename CKey, typename CValue, typename Hash, int Shards >
+void ShardedLruCache< CKey, CValue, Hash, Shards >::_setCapacityLocked(Shard& s, int32_t capacity)
+{
+    _evictLocked(s, capacity);
+    s.capacity = capacity;
+    uint32_t nbuckets = 4;
+    while ((int32_t)nbuckets < capacity) {
+        nbuckets <<= 1;
+    }
+    if (nbuckets != s.buckets.size()) {
+        s.buckets.assign(nbuckets, NULL);
+        s.mask = nbuckets - 1;
+        for (Node* n = s.head; n != NULL; n = n->next) {
+            Node*& b = s.buckets[n->hash & s.mask];
+            n->hnext = b;
+            b = n;
+        }
+    }
+    if (_admission) {
+        s.sketch.reset(capacity);
+    }
+}
+
+template < typename CKey, typename CValue, typename Hash, int Shards >
+typename ShardedLruCache< CKey, CValue, Hash, Shards >::Node*
+ShardedLruCache< CKey, CValue, Hash, Shards >::_findLocked(Shard& s, uint32_t hash, const CKey& key) const
+{
+    for (Node* n = s.buckets[hash & s.mask]; n != NULL; n = n->hnext) {
+        if (n->hash == hash && n->key == key) {
+            return n;
+        }
+    }
+    return NULL;
+}
+
+template < typename CKey, typename CValue, typename Hash, int Shards >
+void ShardedLruCache< CKey, CValue, Hash, Shards >::_linkLocked(Shard& s, Node* n)
+{
+    Node*& b = s.buckets[n->hash & s.mask];
+    n->hnext = b;
+    b = n;
+    n->prev = NULL;
+    n->next = s.head;
+    if (s.head) {
+        s.head->prev = n;
+    } else {
+        s.tail = n;
+    }
+    s.head = n;
+    s.size++;
+}
+
+template < typename CKey, typename CValue, typename Hash, int Shards >
+void ShardedLruCache< CKey, CValue, Hash, Shards >::_unlinkLocked(Shard& s, Node* n)
+{
+    Node** pp = &s.buckets[n->hash & s.mask];
+    while (*pp != n) {
+        pp = &(*pp)->hnext;
+    }
+    *pp = n->hnext;
+    if (n->prev) {
+        n->prev->next = n->next;
+    } else {
+        s.head = n->next;
+    }
+    if (n->next) {
+        n->next->prev = n->prev;
+    } else {
+        s.tail = n->prev;
+    }
+    s.size--;
+}
+
+template < typename CKey, typename CValue, typename Hash, int Shards >
+void ShardedLruCache< CKey, CValue, Hash, Shards >::_evictLocked(Shard& s, int32_t capacity)
+{
+    while (s.size > capacity) {
+        Node* victim = s.tail;
+        _unlinkLocked(s, victim);
+        delete victim;
+        _cacheSize.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+}  // namespace JQuick
+
+#endif  //___JQUICK_SHARDEDLRUCACHE_H___
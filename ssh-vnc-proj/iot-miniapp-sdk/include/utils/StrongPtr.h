@@ -71,6 +71,12 @@ public:
     sp(U* other);
     template < typename U >
     sp(const sp< U >& other);
+    // 移动不改引用计数
+    sp(sp< T >&& other) noexcept :
+            m_ptr(other.m_ptr)
+    {
+        other.m_ptr = 0;
+    }
 
     ~sp();
 
@@ -83,6 +89,17 @@ public:
     sp& operator=(const sp< U >& other);
     template < typename U >
     sp& operator=(U* other);
+    sp& operator=(sp< T >&& other) noexcept
+    {
+        if (this != &other) {
+            T* old = m_ptr;
+            m_ptr = other.m_ptr;
+            other.m_ptr = 0;
+            if (old)
+                old->UNREF();
+        }
+        return *this;
+    }
 
     // Reset
 
@@ -3,23 +3,46 @@
 #include "JQuickContext.h"
 #include "utils/log.h"
 #include <assert.h>
+#include <string.h>
+#include "port/jquick_time.h"
 
 #define JQ_ASYNC_MARK_AND_RELEASE_DIRECTLY
+// 一次批处理最多占用JS线程的时间，剩下的重新抛送，给其他消息让路
+#define JQ_ASYNC_DRAIN_BUDGET_NS (8 * 1000 * 1000LL)
 
 namespace JQUTIL_NS {
 
 //static
-uint32_t JQAsyncExecutor::_tokenId = 0;
+std::atomic<uint32_t> JQAsyncExecutor::_pinSeq(0);
 
-static void _addCallback(JSContext* ctx, uint32_t token, int type, JSValue val);
-static void _removeCallback(JSContext* ctx, uint32_t token, int type);
+static void _addCallback(JSContext* ctx, uint32_t pin, JSValue val);
+static void _removeCallback(JSContext* ctx, uint32_t pin);
 
-static void _CallDescVec(JSContext *ctx, std::vector<JQCallbackDesc> descVec, const JQErrorDesc * errDesc, int argc, JSValueConst *argv, bool callCustomParams=true);
+static void _CallDescVec(JSContext *ctx, const JQCallbackDesc *descs, int count, const JQErrorDesc * errDesc, int argc, JSValueConst *argv, bool callCustomParams=true);
 #ifndef JQ_ASYNC_MARK_AND_RELEASE_DIRECTLY
 static void _OnGCCollectNextStep(JSContext *ctx, std::map<uint32_t/*callbackid*/, std::vector<JQCallbackDesc>/*callback list*/> callbackMap);
 #endif
 
+struct JQAsyncExecutor::Completion {
+    enum Kind {
+        KIND_JSON,
+        KIND_BSON,
+        KIND_ERROR,
+        KIND_REMOVE,
+    };
+    Completion *next;
+    Kind kind;
+    uint32_t callbackid;
+    bool autoDel;
+    bool hasErrDesc;
+    std::string json;  // KIND_JSON的结果，KIND_ERROR的message
+    Bson bson;
+    JQErrorDesc errDesc;
+};
+
 JQAsyncExecutor::JQAsyncExecutor(JSContext *ctx, JQuick::sp<JQuick::Handler> jsHandler/*=NULL*/)
+    : _completions(NULL)
+    , _drainPosted(false)
 {
     _ctxHolder = getOrCreateCtxHolder(ctx);
     // NOTE: create JQAsyncExecutor should in JSThread
@@ -50,7 +73,7 @@ void _OnGCCollectNextStep(JSContext *ctx, std::map<uint32_t/*callbackid*/, std::
         errDesc.name = "GCDestroyedError";
         errDesc.message = "destroyed by GC";
         // last arg is false, bacause we do not known how to call error type of JQCallbackType_CustomParams
-        _CallDescVec(ctx, iter0.second, &errDesc, 0, NULL, false);
+        _CallDescVec(ctx, iter0.second.data(), iter0.second.size(), &errDesc, 0, NULL, false);
         for (auto &iter1: iter0.second) {
             JS_FreeValue(ctx, iter1.func);
         }
@@ -60,7 +83,21 @@ void _OnGCCollectNextStep(JSContext *ctx, std::map<uint32_t/*callbackid*/, std::
 #endif
 
 JQAsyncExecutor::~JQAsyncExecutor()
-{}
+{
+    // 批处理任务持有强引用，走到这里说明没有在途的批次，剩下的只释放不回调
+    Completion *c = _completions.exchange(NULL);
+    while (c) {
+        Completion *next = c->next;
+        delete c;
+        c = next;
+    }
+    c = _backlogHead;
+    while (c) {
+        Completion *next = c->next;
+        delete c;
+        c = next;
+    }
+}
 
 // function callback, return callbackid
 uint32_t JQAsyncExecutor::addCallback(JSValueConst callback, JQCallbackType type/*=JQCallbackType_Std*/)
@@ -72,10 +109,11 @@ uint32_t JQAsyncExecutor::addCallback(JSValueConst callback, JQCallbackType type
     }
     JSContext *ctx = ctxHolder->ctx;
 
-    uint32_t callbackid = _genId();
-    _callbackMap[callbackid] = std::vector<JQCallbackDesc>();
-    _callbackMap[callbackid].push_back({.type=type, .func=callback});
-    _addCallback(ctx, callbackid, type, JS_DupValue(ctx, callback));
+    JQCallbackDesc desc = {.type=type, .func=JS_DupValue(ctx, callback), .pin=0};
+    uint32_t callbackid = _allocSlot(ctx, &desc, 1);
+    if (callbackid == 0) {
+        JS_FreeValue(ctx, desc.func);
+    }
     return callbackid;
 }
 
@@ -89,13 +127,12 @@ void JQAsyncExecutor::removeCallback(uint32_t callbackid)
     JSContext *ctx = ctxHolder->ctx;
 
     // find callback
-    auto iter = _callbackMap.find(callbackid);
-    if (iter == _callbackMap.end()) {
+    JQCallbackSlot *slot = _findSlot(callbackid);
+    if (!slot) {
         LOGD("JQAsyncExecutor::removeCallback not found callbackid %d, this is unexpected, may cause memleak on async callback", callbackid);
         return;
     }
-    _freeDescVec(ctx, iter->first, iter->second);
-    _callbackMap.erase(iter);
+    _freeSlot(ctx, slot);
 }
 
 uint32_t JQAsyncExecutor::createPromiseId(JSContext *ctx, JSValue *outPromiseOrException, const std::string &tip)
@@ -109,10 +146,11 @@ uint32_t JQAsyncExecutor::createPromiseId(JSContext *ctx, JSValue *outPromiseOrE
         return 0;
     }
 
+    JSAtom tipAtom = jq_ctx_cache(ctx)->atomTip;
     JSValue tipVal = JS_NewStringLen(ctx, tip.c_str(), tip.size());
-    JS_SetPropertyStr(ctx, resolving_funcs[0], "tip", JS_DupValue(ctx, tipVal));
-    JS_SetPropertyStr(ctx, resolving_funcs[1], "tip", JS_DupValue(ctx, tipVal));
-    JS_SetPropertyStr(ctx, *outPromiseOrException, "tip", JS_DupValue(ctx, tipVal));
+    JS_SetProperty(ctx, resolving_funcs[0], tipAtom, JS_DupValue(ctx, tipVal));
+    JS_SetProperty(ctx, resolving_funcs[1], tipAtom, JS_DupValue(ctx, tipVal));
+    JS_SetProperty(ctx, *outPromiseOrException, tipAtom, JS_DupValue(ctx, tipVal));
     JS_FreeValue(ctx, tipVal);
 
     uint32_t promiseCbId = _addResolvingFuncs(ctx, resolving_funcs[0], resolving_funcs[1]);
@@ -135,8 +173,7 @@ void JQAsyncExecutor::onCallbackJSON(uint32_t callbackid, const std::string &jso
 
     JSValue res = JS_UNDEFINED;
     // find callback
-    auto iter = _callbackMap.find(callbackid);
-    if (iter == _callbackMap.end()) {
+    if (!_findSlot(callbackid)) {
         LOGD("JQAsyncExecutor::onCallbackJSON not found callbackid %d, this is unexpected, may cause memleak on async callback", callbackid);
         return;
     }
@@ -148,18 +185,10 @@ void JQAsyncExecutor::onCallbackJSON(uint32_t callbackid, const std::string &jso
         }
     }
 
-    _CallDescVec(ctx, iter->second, errDesc, 1, &res);
+    _callSlot(ctx, callbackid, errDesc, 1, &res, autoDel);
 
     // exit:
     JS_FreeValue(ctx, res);
-    // clean callback
-    if (autoDel) {
-        auto iter = _callbackMap.find(callbackid);
-        if (iter != _callbackMap.end()) {
-            _freeDescVec(ctx, iter->first, iter->second);
-            _callbackMap.erase(iter);
-        }
-    }
 }
 
 void JQAsyncExecutor::onCallback(uint32_t callbackid, const Bson &bson, const JQErrorDesc * errDesc/*=nullptr*/, bool autoDel/*=true*/)
@@ -173,38 +202,34 @@ void JQAsyncExecutor::onCallback(uint32_t callbackid, const Bson &bson, const JQ
 
     JSValue res = JS_UNDEFINED;
     // find callback
-    auto iter = _callbackMap.find(callbackid);
-    if (iter == _callbackMap.end()) {
+    if (!_findSlot(callbackid)) {
         LOGD("JQAsyncExecutor::onCallback not found callbackid %d, this is unexpected, may cause memleak on async callback", callbackid);
         return;
     }
     // call callback
     res = bsonToJSValue(ctx, bson);
 
-    _CallDescVec(ctx, iter->second, errDesc, 1, &res);
+    _callSlot(ctx, callbackid, errDesc, 1, &res, autoDel);
 
     // exit:
     JS_FreeValue(ctx, res);
-    // clean callback
-    if (autoDel) {
-        auto iter = _callbackMap.find(callbackid);
-        if (iter != _callbackMap.end()) {
-            _freeDescVec(ctx, iter->first, iter->second);
-            _callbackMap.erase(iter);
-        }
-    }
 }
 
 // static
-void _CallDescVec(JSContext *ctx, std::vector<JQCallbackDesc> descVec, const JQErrorDesc * errDesc, int argc, JSValueConst *argv, bool callCustomParams/*=true*/)
+void _CallDescVec(JSContext *ctx, const JQCallbackDesc *descs, int count, const JQErrorDesc * errDesc, int argc, JSValueConst *argv, bool callCustomParams/*=true*/)
 {
     JS_DupContext(ctx);
 
-    for (auto &desc: descVec) {
-        JS_DupValue(ctx, desc.func);
+    // 回调里可能移除/复用该槽位，先拷到栈上并持有引用
+    JQCallbackDesc descVec[JQ_CALLBACK_INLINE];
+    count = count > JQ_CALLBACK_INLINE ? JQ_CALLBACK_INLINE : count;
+    for (int i = 0; i < count; i++) {
+        descVec[i] = descs[i];
+        JS_DupValue(ctx, descVec[i].func);
     }
 
-    for (auto &desc: descVec) {
+    for (int i = 0; i < count; i++) {
+        JQCallbackDesc &desc = descVec[i];
         JSValue ret = JS_UNDEFINED;
         if (desc.type == JQCallbackType_Resolve || desc.type == JQCallbackType_Reject) {
             // resolve(res) OR reject(error)
@@ -218,7 +243,7 @@ void _CallDescVec(JSContext *ctx, std::vector<JQCallbackDesc> descVec, const JQE
                 if (desc.type == JQCallbackType_Reject) {
                     JSValue error = errDesc->createJSValue(ctx);
                     if (argv && !JS_IsUndefined(argv[0])) {
-                        JS_SetPropertyStr(ctx, error, "res", JS_DupValue(ctx, argv[0]));
+                        JS_SetProperty(ctx, error, jq_ctx_cache(ctx)->atomRes, JS_DupValue(ctx, argv[0]));
                     }
                     ret = JS_Call(ctx, desc.func, JS_UNDEFINED, 1, &error);
                     JS_FreeValue(ctx, error);
@@ -266,17 +291,90 @@ void _CallDescVec(JSContext *ctx, std::vector<JQCallbackDesc> descVec, const JQE
         JS_FreeValue(ctx, ret);
     }
 
-    for (auto &desc: descVec) {
-        JS_FreeValue(ctx, desc.func);
+    for (int i = 0; i < count; i++) {
+        JS_FreeValue(ctx, descVec[i].func);
     }
 
     JS_FreeContext(ctx);
 }
 
-void JQAsyncExecutor::_freeDescVec(JSContext *ctx, uint32_t callbackid, std::vector<JQCallbackDesc> &descVec)
+uint32_t JQAsyncExecutor::_allocSlot(JSContext *ctx, const JQCallbackDesc *descs, int count)
+{
+    uint32_t index;
+    if (!_freeSlots.empty()) {
+        index = _freeSlots.back();
+        _freeSlots.pop_back();
+    } else {
+        if (_slots.size() >= JQ_CALLBACK_SLOT_MAX) {
+            LOGE("JQAsyncExecutor too many pending callbacks");
+            return 0;
+        }
+        index = _slots.size();
+        JQCallbackSlot empty;
+        memset(&empty, 0, sizeof(empty));
+        _slots.push_back(empty);
+    }
+
+    JQCallbackSlot &slot = _slots[index];
+    // generation只用剩下的高位，回绕后也不会与槽位号冲突
+    slot.generation = (slot.generation + 1) & ((1u << (32 - JQ_CALLBACK_SLOT_BITS)) - 1);
+    slot.id = (slot.generation << JQ_CALLBACK_SLOT_BITS) | (index + 1);
+    slot.count = count;
+    for (int i = 0; i < count; i++) {
+        slot.descs[i] = descs[i];
+        slot.descs[i].pin = ++_pinSeq;
+        // 全局表持有一份引用，让gc能遍历到；槽位里的func与它共用这份引用
+        _addCallback(ctx, slot.descs[i].pin, slot.descs[i].func);
+    }
+    return slot.id;
+}
+
+JQCallbackSlot* JQAsyncExecutor::_findSlot(uint32_t callbackid)
 {
-    for (auto &desc: descVec) {
-        _removeCallback(ctx, callbackid, desc.type);
+    uint32_t index = (callbackid & JQ_CALLBACK_SLOT_MAX);
+    if (index == 0 || index > _slots.size()) {
+        return NULL;
+    }
+    JQCallbackSlot *slot = &_slots[index - 1];
+    return slot->id == callbackid ? slot : NULL;
+}
+
+const JQCallbackSlot* JQAsyncExecutor::_findSlot(uint32_t callbackid) const
+{
+    return const_cast<JQAsyncExecutor*>(this)->_findSlot(callbackid);
+}
+
+void JQAsyncExecutor::_freeSlot(JSContext *ctx, JQCallbackSlot *slot)
+{
+    uint32_t index = (slot->id & JQ_CALLBACK_SLOT_MAX) - 1;
+    int count = slot->count;
+    uint32_t pins[JQ_CALLBACK_INLINE];
+    for (int i = 0; i < count; i++) {
+        pins[i] = slot->descs[i].pin;
+    }
+    slot->id = 0;
+    slot->count = 0;
+    _freeSlots.push_back(index);
+    // 删除全局表项可能触发finalizer重入，槽位先回收好
+    for (int i = 0; i < count; i++) {
+        _removeCallback(ctx, pins[i]);
+    }
+}
+
+void JQAsyncExecutor::_callSlot(JSContext *ctx, uint32_t callbackid, const JQErrorDesc * errDesc, int argc, JSValueConst *argv, bool autoDel)
+{
+    JQCallbackSlot *slot = _findSlot(callbackid);
+    if (!slot) {
+        return;
+    }
+    _CallDescVec(ctx, slot->descs, slot->count, errDesc, argc, argv);
+
+    // clean callback, slot may be removed or reused by callback
+    if (autoDel) {
+        slot = _findSlot(callbackid);
+        if (slot) {
+            _freeSlot(ctx, slot);
+        }
     }
 }
 
@@ -290,23 +388,12 @@ void JQAsyncExecutor::onCallbackJSValue(uint32_t callbackid, int argc, JSValueCo
     JSContext *ctx = ctxHolder->ctx;
 
     // find callback
-    auto iter = _callbackMap.find(callbackid);
-    if (iter == _callbackMap.end()) {
+    if (!_findSlot(callbackid)) {
         LOGD("JQAsyncExecutor::onCallbackJSValue not found callbackid %d, this is unexpected, may cause memleak on async callback", callbackid);
         return;
     }
 
-    _CallDescVec(ctx, iter->second, errDesc, argc, argv);
-
-    // exit:
-    // clean callback
-    if (autoDel) {
-        auto iter = _callbackMap.find(callbackid);
-        if (iter != _callbackMap.end()) {
-            _freeDescVec(ctx, iter->first, iter->second);
-            _callbackMap.erase(iter);
-        }
-    }
+    _callSlot(ctx, callbackid, errDesc, argc, argv, autoDel);
 }
 
 void JQAsyncExecutor::onError(int callbackid, const std::string &message, int code/*=0*/, const std::string &name/*=""*/, bool autoDel/*=true*/)
@@ -319,8 +406,7 @@ void JQAsyncExecutor::onError(int callbackid, const std::string &message, int co
     JSContext *ctx = ctxHolder->ctx;
 
     // find callback
-    auto iter = _callbackMap.find(callbackid);
-    if (iter == _callbackMap.end()) {
+    if (!_findSlot(callbackid)) {
         LOGD("JQAsyncExecutor::onError not found callbackid %d, this is unexpected, may cause memleak on async callback", callbackid);
         return;
     }
@@ -329,34 +415,26 @@ void JQAsyncExecutor::onError(int callbackid, const std::string &message, int co
     errDesc.name = name;
     errDesc.message = message;
     errDesc.code = code;
-    _CallDescVec(ctx, iter->second, &errDesc, 0, NULL);
-
-    // exit:
-    // clean callback
-    if (autoDel) {
-        auto iter = _callbackMap.find(callbackid);
-        if (iter != _callbackMap.end()) {
-            _freeDescVec(ctx, iter->first, iter->second);
-            _callbackMap.erase(iter);
-        }
-    }
+    _callSlot(ctx, callbackid, &errDesc, 0, NULL, autoDel);
 }
 
 uint32_t JQAsyncExecutor::_addResolvingFuncs(JSContext *ctx, JSValue resolve, JSValue reject)
 {
-    uint32_t callbackid = _genId();
-    _callbackMap[callbackid].push_back({.type=JQCallbackType_Resolve, .func=resolve});
-    _callbackMap[callbackid].push_back({.type=JQCallbackType_Reject, .func=reject});
-
-    _addCallback(ctx, callbackid, JQCallbackType_Resolve, resolve);
-    _addCallback(ctx, callbackid, JQCallbackType_Reject, reject);
-
+    JQCallbackDesc descs[2] = {
+        {.type=JQCallbackType_Resolve, .func=resolve, .pin=0},
+        {.type=JQCallbackType_Reject, .func=reject, .pin=0},
+    };
+    uint32_t callbackid = _allocSlot(ctx, descs, 2);
+    if (callbackid == 0) {
+        JS_FreeValue(ctx, resolve);
+        JS_FreeValue(ctx, reject);
+    }
     return callbackid;
 }
 
 bool JQAsyncExecutor::hasCallbackid(uint32_t callbackid) const
 {
-    return _callbackMap.find(callbackid) != _callbackMap.end();
+    return _findSlot(callbackid) != NULL;
 }
 
 JQuick::sp<JQuick::Handler> JQAsyncExecutor::jsHandler()
@@ -369,14 +447,15 @@ JSValue JQErrorDesc::createJSValue(JSContext *ctx) const
     if (!customValue.is_null()) {
         return bsonToJSValue(ctx, customValue);
     } else {
+        JQCtxCache *cache = jq_ctx_cache(ctx);
         JSValue error = JS_NewError(ctx);
         if (!name.empty()) {
-            JS_SetPropertyStr(ctx, error, "name", JS_NewStringLen(ctx, name.c_str(), name.size()));
+            JS_SetProperty(ctx, error, cache->atomName, JS_NewStringLen(ctx, name.c_str(), name.size()));
         }
         if (!message.empty()) {
-            JS_SetPropertyStr(ctx, error, "message", JS_NewStringLen(ctx, message.c_str(), message.size()));
+            JS_SetProperty(ctx, error, cache->atomMessage, JS_NewStringLen(ctx, message.c_str(), message.size()));
         }
-        JS_SetPropertyStr(ctx, error, "code", JS_NewInt32(ctx, code));
+        JS_SetProperty(ctx, error, cache->atomCode, JS_NewInt32(ctx, code));
         return error;
     }
 }
@@ -385,92 +464,164 @@ JSValue JQErrorDesc::createJSValue(JSContext *ctx) const
 void JQAsyncExecutor::removeCallbackAsync(uint32_t callbackid)
 {
     if (callbackid > 0) {
-        _jsHandler->run(new JQuick::FunctionalTask(JQuick::bind(&JQAsyncExecutor::removeCallback, JQuick::sp<JQAsyncExecutor>(this), callbackid)));
+        Completion *c = new Completion();
+        c->kind = Completion::KIND_REMOVE;
+        c->callbackid = callbackid;
+        c->autoDel = true;
+        c->hasErrDesc = false;
+        _pushCompletion(c);
     }
 }
 
 void JQAsyncExecutor::onCallbackJSONAsync(uint32_t callbackid, const std::string &json, const JQErrorDesc * errDesc/*=nullptr*/, bool autoDel/*=true*/)
 {
     if (callbackid > 0) {
-        JQErrorDesc errDesc0;
-        if (errDesc) errDesc0 = *errDesc;
-        _jsHandler->run(new JQuick::FunctionalTask(JQuick::bind(&JQAsyncExecutor::_onCallbackJSONJSThread, JQuick::sp<JQAsyncExecutor>(this), callbackid, json, errDesc0, autoDel, errDesc != NULL)));
+        Completion *c = new Completion();
+        c->kind = Completion::KIND_JSON;
+        c->callbackid = callbackid;
+        c->autoDel = autoDel;
+        c->hasErrDesc = errDesc != NULL;
+        c->json = json;
+        if (errDesc) c->errDesc = *errDesc;
+        _pushCompletion(c);
     }
 }
 
 void JQAsyncExecutor::onCallbackAsync(uint32_t callbackid, const Bson &bson, const JQErrorDesc * errDesc/*=nullptr*/, bool autoDel/*=true*/)
 {
     if (callbackid > 0) {
-        JQErrorDesc errDesc0;
-        if (errDesc) errDesc0 = *errDesc;
-        _jsHandler->run(new JQuick::FunctionalTask(JQuick::bind(&JQAsyncExecutor::_onCallbackJSThread, JQuick::sp<JQAsyncExecutor>(this), callbackid, bson, errDesc0, autoDel, errDesc != NULL)));
+        Completion *c = new Completion();
+        c->kind = Completion::KIND_BSON;
+        c->callbackid = callbackid;
+        c->autoDel = autoDel;
+        c->hasErrDesc = errDesc != NULL;
+        c->bson = bson;
+        if (errDesc) c->errDesc = *errDesc;
+        _pushCompletion(c);
     }
 }
 
 void JQAsyncExecutor::onErrorAsync(uint32_t callbackid, const std::string &message, int code/*=0*/, const std::string &name/*=""*/, bool autoDel/*=true*/)
 {
     if (callbackid > 0) {
-        _jsHandler->run(new JQuick::FunctionalTask(JQuick::bind(&JQAsyncExecutor::onError, JQuick::sp<JQAsyncExecutor>(this), callbackid, message, code, name, autoDel)));
+        Completion *c = new Completion();
+        c->kind = Completion::KIND_ERROR;
+        c->callbackid = callbackid;
+        c->autoDel = autoDel;
+        c->hasErrDesc = true;
+        c->errDesc.name = name;
+        c->errDesc.message = message;
+        c->errDesc.code = code;
+        _pushCompletion(c);
     }
 }
 
-void JQAsyncExecutor::_onCallbackJSONJSThread(uint32_t callbackid, const std::string &json, const JQErrorDesc &errDesc, bool autoDel, bool hasErrDesc)
+void JQAsyncExecutor::_pushCompletion(Completion *c)
 {
-    onCallbackJSON(callbackid, json, hasErrDesc ? &errDesc: NULL, autoDel);
+    Completion *head = _completions.load(std::memory_order_relaxed);
+    do {
+        c->next = head;
+    } while (!_completions.compare_exchange_weak(head, c, std::memory_order_release, std::memory_order_relaxed));
+
+    // 已经有批处理任务在排队就不再抛送；用post而不是run，回调里再发起的完成不会在JS线程上直接重入_drainCompletions
+    if (!_drainPosted.exchange(true, std::memory_order_acq_rel)) {
+        _jsHandler->post(new JQUniqueFuncTask(JQuick::bind(&JQAsyncExecutor::_drainCompletions, JQuick::sp<JQAsyncExecutor>(this))));
+    }
 }
 
-void JQAsyncExecutor::_onCallbackJSThread(uint32_t callbackid, const Bson &bson, const JQErrorDesc &errDesc, bool autoDel, bool hasErrDesc)
+// run js thread
+void JQAsyncExecutor::_drainCompletions()
 {
-    onCallback(callbackid, bson, hasErrDesc ? &errDesc: NULL, autoDel);
+    // 先清标记再取，之后入栈的会再抛一个批次，不会漏
+    _drainPosted.store(false, std::memory_order_seq_cst);
+
+    // 栈是后进先出，倒过来接在上一轮剩下的后面，保持完成顺序
+    Completion *batch = _completions.exchange(NULL, std::memory_order_acquire);
+    Completion *reversed = NULL;
+    Completion *tail = batch;
+    while (batch) {
+        Completion *next = batch->next;
+        batch->next = reversed;
+        reversed = batch;
+        batch = next;
+    }
+    if (reversed) {
+        if (_backlogTail) {
+            _backlogTail->next = reversed;
+        } else {
+            _backlogHead = reversed;
+        }
+        _backlogTail = tail;
+    }
+
+    long long start = jquick_get_current_time_ns();
+    while (_backlogHead) {
+        Completion *c = _backlogHead;
+        _backlogHead = c->next;
+        if (!_backlogHead) {
+            _backlogTail = NULL;
+        }
+        _runCompletion(c);
+        delete c;
+        if (_backlogHead && jquick_get_current_time_ns() - start > JQ_ASYNC_DRAIN_BUDGET_NS) {
+            break;
+        }
+    }
+
+    // 时间片用完，排到队尾（不能用run，在JS线程上会直接重入）
+    if (_backlogHead && !_drainPosted.exchange(true, std::memory_order_acq_rel)) {
+        _jsHandler->post(new JQUniqueFuncTask(JQuick::bind(&JQAsyncExecutor::_drainCompletions, JQuick::sp<JQAsyncExecutor>(this))));
+    }
 }
 
-static std::string getFixedMapString()
+void JQAsyncExecutor::_runCompletion(Completion *c)
 {
-    static std::string fixedMap;
-    if (fixedMap.empty()) {
-        // must get key with some library identifier, because of multi shared libraries may have multi code
-        fixedMap = jq_printf("__jq_AE_cbMap_%p", &getFixedMapString);
+    const JQErrorDesc *errDesc = c->hasErrDesc ? &c->errDesc : NULL;
+    switch (c->kind) {
+    case Completion::KIND_JSON:
+        onCallbackJSON(c->callbackid, c->json, errDesc, c->autoDel);
+        break;
+    case Completion::KIND_BSON:
+        onCallback(c->callbackid, c->bson, errDesc, c->autoDel);
+        break;
+    case Completion::KIND_ERROR:
+        onError(c->callbackid, c->errDesc.message, c->errDesc.code, c->errDesc.name, c->autoDel);
+        break;
+    case Completion::KIND_REMOVE:
+        removeCallback(c->callbackid);
+        break;
     }
-    return fixedMap;
 }
 
+// 以整数key存取，不用每次拼字符串、新建atom
 //static
-void _addCallback(JSContext* ctx, uint32_t token, int type, JSValue val)
+void _addCallback(JSContext* ctx, uint32_t pin, JSValue val)
 {
+    JSAtom cbMapAtom = jq_ctx_cache(ctx)->atomAsyncCbMap;
     JSValue globalObject = JS_GetGlobalObject(ctx);
-    std::string fixedMap = getFixedMapString();
-    JSAtom cbMapAtom = JS_NewAtom(ctx, fixedMap.c_str());
     JSValue cbMapObj = JS_GetProperty(ctx, globalObject, cbMapAtom);
     if (JS_IsUndefined(cbMapObj)) {
         cbMapObj = JS_NewObject(ctx);
         JS_SetProperty(ctx, globalObject, cbMapAtom, JS_DupValue(ctx, cbMapObj));
     }
 
-    std::string cbKey = jq_printf("%d-%d", token, type);
-    JS_SetPropertyStr(ctx, cbMapObj, cbKey.c_str(), val);
-    LOGD("JQAsyncExecutor::_addCallback key: %s on map: %s", cbKey.c_str(), fixedMap.c_str());
+    JS_SetPropertyUint32(ctx, cbMapObj, pin, val);
     JS_FreeValue(ctx, cbMapObj);
-    JS_FreeAtom(ctx, cbMapAtom);
     JS_FreeValue(ctx, globalObject);
 }
 
 //static
-void _removeCallback(JSContext* ctx, uint32_t token, int type)
+void _removeCallback(JSContext* ctx, uint32_t pin)
 {
     JSValue globalObject = JS_GetGlobalObject(ctx);
-    std::string fixedMap = getFixedMapString();
-    JSAtom cbMapAtom = JS_NewAtom(ctx, fixedMap.c_str());
-    JSValue cbMapObj = JS_GetProperty(ctx, globalObject, cbMapAtom);
+    JSValue cbMapObj = JS_GetProperty(ctx, globalObject, jq_ctx_cache(ctx)->atomAsyncCbMap);
     if (!JS_IsUndefined(cbMapObj)) {
-        std::string cbKey = jq_printf("%d-%d", token, type);
-        JSAtom cbKeyAtom = JS_NewAtom(ctx, cbKey.c_str());
+        JSAtom cbKeyAtom = JS_NewAtomUInt32(ctx, pin);
         JS_DeleteProperty(ctx, cbMapObj, cbKeyAtom, 0);
-        LOGD("JQAsyncExecutor::_removeCallback key: %s from map: %s", cbKey.c_str(), fixedMap.c_str());
         JS_FreeAtom(ctx, cbKeyAtom);
     }
 
     JS_FreeValue(ctx, cbMapObj);
-    JS_FreeAtom(ctx, cbMapAtom);
     JS_FreeValue(ctx, globalObject);
 }
 
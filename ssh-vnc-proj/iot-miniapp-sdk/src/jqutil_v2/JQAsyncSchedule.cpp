@@ -2,6 +2,8 @@
 #include "jqutil_v2/JQObjectTemplate.h"
 #include "jqutil_v2/JQNamedThread.h"
 #include "jqutil_v2/JQTemplateEnv.h"
+#include "jqutil_v2/JQTrace.h"
+#include "jqutil_v2/jqmisc.h"
 #include <map>
 
 namespace JQUTIL_NS {
@@ -102,9 +104,28 @@ JQAsyncInfo& JQAsyncScheduleInfo::asyncInfo()
     return *_asyncInfo;
 }
 
+JQAsyncSchedule::JQAsyncSchedule(const JQAsyncSchedule &o)
+    : _mode(o._mode)
+    , _hook(o._hook)
+{
+}
+
+JQAsyncSchedule& JQAsyncSchedule::operator=(const JQAsyncSchedule &o)
+{
+    if (this != &o) {
+        _mode = o._mode;
+        _hook = o._hook;
+        _routeReady = false;
+        _routePrefix.clear();
+        _routeId = -1;
+    }
+    return *this;
+}
+
 void JQAsyncSchedule::setMode(int mode)
 {
     _mode = mode;
+    _routeReady = false;
 }
 
 void JQAsyncSchedule::setHook(JQAsyncScheduleHook hook)
@@ -113,13 +134,22 @@ void JQAsyncSchedule::setHook(JQAsyncScheduleHook hook)
 }
 
 // NOTE: run in module thread
-static void AsyncCaller(JQAsyncCallbackType async_cb, JQAsyncInfo info)
+// info由绑定闭包独占，属性回调通过info里的模板引用保活，不再随闭包拷贝一份std::function
+// 排队时间（投递到开始执行）和回调执行时间分开记
+static inline void AsyncRun(JQAsyncInfo &info, int32_t traceId, long long enqueueNs)
 {
-    async_cb(info);
+    long long startNs = JQTraceNowNs();
+    JQTraceRecordWait(traceId, startNs - enqueueNs);
+    info.property().async_cb(info);
+    JQTraceRecord(traceId, JQTraceNowNs() - startNs, 0, 0);
 }
 
-void JQAsyncSchedule::dispatch(JQuick::sp<JQObjectTemplate> objTpl, JQuick::sp<JQBaseObject> cppObj,
-                               JQObjectProperty &property, JQAsyncInfo &asyncInfo)
+static void AsyncCaller(const JQAsyncInfo &info, int32_t traceId, long long enqueueNs)
+{
+    AsyncRun(const_cast<JQAsyncInfo&>(info), traceId, enqueueNs);
+}
+
+void JQAsyncSchedule::_prepareRoute(JQObjectTemplate *objTpl)
 {
     std::string key;
     if (_mode & MODE_MODULE) {
@@ -131,30 +161,75 @@ void JQAsyncSchedule::dispatch(JQuick::sp<JQObjectTemplate> objTpl, JQuick::sp<J
     if (_mode & MODE_APP) {
         key += "<a>" + objTpl->appid();
     }
-    if (_mode & MODE_OBJECT) {
-        key += "<o>" + std::to_string((intptr_t)cppObj.get());
+    _routePrefix = key;
+    // MODE_OBJECT时前缀的路由号只用来识别对象上缓存的路由是否属于本模板
+    _routeId = InternNamedThread(_routePrefix);
+    _routeReady = true;
+}
+
+std::string JQAsyncSchedule::_objectKey(JQBaseObject *cppObj) const
+{
+    return _routePrefix + "<o>" + std::to_string((intptr_t)cppObj);
+}
+
+int32_t JQAsyncSchedule::_objectRoute(JQBaseObject *cppObj)
+{
+    if (!cppObj) {
+        return InternNamedThread(_objectKey(cppObj));
+    }
+    if (cppObj->_asyncRouteId < 0 || cppObj->_asyncRouteOwner != _routeId) {
+        if (cppObj->_asyncRouteId >= 0) {
+            ReleaseNamedThread(cppObj->_asyncRouteId);
+        }
+        cppObj->_asyncRouteId = InternNamedThread(_objectKey(cppObj));
+        cppObj->_asyncRouteOwner = _routeId;
     }
+    return cppObj->_asyncRouteId;
+}
+
+void JQAsyncSchedule::dispatch(JQObjectTemplate *objTpl, JQBaseObject *cppObj,
+                               JQAsyncInfo &&asyncInfo)
+{
+    if (!_routeReady) {
+        _prepareRoute(objTpl);
+    }
+    int32_t routeId = (_mode & MODE_OBJECT) ? _objectRoute(cppObj) : _routeId;
+
+    const JQObjectProperty &property = asyncInfo.property();
+    if (property.traceId < 0) {
+        property.traceId = JQTraceRegister((objTpl->functionName() + "." + property.getName(objTpl->context())).c_str());
+    }
+    int32_t traceId = property.traceId;
+    long long enqueueNs = JQTraceNowNs();
 
     if (_hook) {
         JQAsyncScheduleInfo info;
         info._cppObj = cppObj;
         info._objTpl = objTpl;
         info._asyncInfo = &asyncInfo;
-        info._outThreadName = key;
+        info._outThreadName = (_mode & MODE_OBJECT) ? _objectKey(cppObj) : _routePrefix;
+        std::string key = info._outThreadName;
         _hook(info);
-        JQuick::Closure c = JQuick::bind(AsyncCaller, property.async_cb, asyncInfo);
+        // 只有宿主ThreadPool需要Closure，其余去向都内联存放
+        auto c = JQuick::bind(AsyncCaller, std::move(asyncInfo), traceId, enqueueNs);
         if (info._outThreadPool) {
-            info._outThreadPool->execute("JQAsyncSchedule", "dispatch", c);
+            info._outThreadPool->execute("JQAsyncSchedule", "dispatch", std::move(c));
         } else if (info._outHandler.get()) {
-            info._outHandler->post(new JQuick::FunctionalTask(c));
+            info._outHandler->post(new JQUniqueFuncTask(std::move(c)));
+        } else if (info._outThreadName == key) {
+            PostOnNamedThread(routeId, std::move(c),
+                              info._outThreadStackSize, info._outThreadPriority,
+                              info._outThreadKeepAliveMs);
         } else if (!info._outThreadName.empty()) {
-            PostOnNamedThread(info._outThreadName, c,
+            PostOnNamedThread(info._outThreadName, std::move(c),
                               info._outThreadStackSize, info._outThreadPriority,
                               info._outThreadKeepAliveMs);
         }
     } else {
-        JQuick::Closure c = JQuick::bind(AsyncCaller, property.async_cb, asyncInfo);
-        PostOnNamedThread(key, c);
+        // 默认路径：info连同追踪编号、投递时间直接移动进任务节点的内联存储，不经过bind和堆上的闭包对象
+        PostOnNamedThread(routeId, [info = std::move(asyncInfo), traceId, enqueueNs]() mutable {
+            AsyncRun(info, traceId, enqueueNs);
+        });
     }
 }
 
@@ -3,6 +3,7 @@
 #include "jqutil_v2/JQObjectTemplate.h"
 #include "jqutil_v2/JQFunctionTemplate.h"
 #include "jqutil_v2/JQAsyncExecutor.h"
+#include "jqutil_v2/JQNamedThread.h"
 #include "jqutil_v2/JQTemplateEnv.h"
 
 // #define ENABLE_DUP_CONTEXT
@@ -22,6 +23,9 @@ JQBaseObject::JQBaseObject()
 
 JQBaseObject::~JQBaseObject()
 {
+    if (_asyncRouteId >= 0) {
+        ReleaseNamedThread(_asyncRouteId);
+    }
 #ifdef ENABLE_JQBASEOBJECT_FLAG
     if (_asyncExecutorFlag()) {
         _setAsyncExecutorFlag(false);
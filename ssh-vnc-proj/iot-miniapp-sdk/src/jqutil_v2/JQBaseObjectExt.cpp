@@ -103,7 +103,12 @@ JQObjectSignalRegister::JQObjectSignalRegister(JQuick::wp<JQBaseObject> object)
 // static
 JSValue JQObjectSignalRegister::_SignalSubscribe(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv, int magic, JSValueConst *refs)
 {
-    uint32_t prop = (uint32_t)magic;
+    JQObjectTemplate *objTpl = JQUnwrapRefSimple<JQObjectTemplate>(refs[JQ_REFS_TPL_INDEX]);
+    const JQObjectProperty *property = objTpl->_propertyAt(magic);
+    if (!property) {
+        return JS_ThrowInternalError(ctx, "cannot get JQObjectTemplate property");
+    }
+    uint32_t prop = property->prop;
     JQBaseObject* cppObj = JQUnwrapRefSimple<JQBaseObject>(refs[JQ_REFS_CPP_INDEX]);
     if (!cppObj) {
         return JS_ThrowInternalError(ctx, "no cppObj to be subscribed");
@@ -122,7 +127,12 @@ JSValue JQObjectSignalRegister::_SignalSubscribe(JSContext *ctx, JSValueConst th
 // static
 JSValue JQObjectSignalRegister::_SignalUnsubscribe(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv, int magic, JSValueConst *refs)
 {
-    uint32_t prop = (uint32_t)magic;
+    JQObjectTemplate *objTpl = JQUnwrapRefSimple<JQObjectTemplate>(refs[JQ_REFS_TPL_INDEX]);
+    const JQObjectProperty *property = objTpl->_propertyAt(magic);
+    if (!property) {
+        return JS_ThrowInternalError(ctx, "cannot get JQObjectTemplate property");
+    }
+    uint32_t prop = property->prop;
     JQBaseObject* cppObj = JQUnwrapRefSimple<JQBaseObject>(refs[JQ_REFS_CPP_INDEX]);
     if (!cppObj) {
         return JS_ThrowInternalError(ctx, "no cppObj to be unsubscribed");
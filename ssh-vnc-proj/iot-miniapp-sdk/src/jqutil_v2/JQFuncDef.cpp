@@ -215,17 +215,14 @@ void JQAsyncInfo::postJSThread(JQJSThreadCallback func) const
         return;
     }
 
-    executor->jsHandler()->run(new JQuick::FunctionalTask(
+    executor->jsHandler()->run(new JQUniqueFuncTask(
             JQuick::bind(&JQAsyncInfo::Caller_postJSThread, func, *this)));
 }
 
 std::string JQParamsHolder::ParamsToString() const
 {
-    Bson::array array;
-    for (auto &item: _params) {
-        array.push_back(item);
-    }
-    return Bson(array).dump();
+    Bson::array array(_params.begin(), _params.end());
+    return Bson(std::move(array)).dump();
 }
 
 bool JQAsyncInfo::isSettled() const
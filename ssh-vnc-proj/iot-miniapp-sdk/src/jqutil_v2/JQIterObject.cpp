@@ -2,6 +2,7 @@
 #include "jqutil_v2/JQObjectTemplate.h"
 #include "jqutil_v2/JQTemplateEnv.h"
 #include "jqutil_v2/JQTypes.h"
+#include "jqutil_v2/JQAsyncSchedule.h"
 
 namespace JQUTIL_NS {
 
@@ -192,4 +193,81 @@ void JQIterObject::OnGCMark(JSRuntime *rt, JSValueConst val, JS_MarkFunc *mark_f
     JS_MarkValue(rt, _target, mark_func);
 }
 
+// == JQAsyncIterObject START ==
+static JSValue _async_iter_self(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv)
+{
+    return JS_DupValue(ctx, this_val);
+}
+
+static const JSCFunctionListEntry async_iter_funcs[] = {
+        JS_CFUNC_DEF("[Symbol.asyncIterator]", 0, _async_iter_self),
+};
+
+JQAsyncIterObject::JQAsyncIterObject()
+    :JQIterObject()
+{}
+
+JQAsyncIterObject::~JQAsyncIterObject()
+{}
+
+// static
+void JQAsyncIterObject::InitTpl(JQFunctionTemplateRef &tpl)
+{
+    tpl->SetProtoMethodPromise("next", &JQAsyncIterObject::_next);
+    tpl->SetProtoMethodPromise("return", &JQAsyncIterObject::_return);
+    // 每个迭代器一个串行路由，不同迭代器之间互不阻塞
+    tpl->setAsyncScheduleMode(JQAsyncSchedule::MODE_MODULE | JQAsyncSchedule::MODE_FUNCTION |
+                              JQAsyncSchedule::MODE_OBJECT);
+}
+
+void JQAsyncIterObject::OnInit()
+{
+    // 不调用JQIterObject::OnInit，同步的next会遮住原型上的异步next
+    JS_SetPropertyFunctionList(getContext(), getJSValue(), async_iter_funcs, countof(async_iter_funcs));
+}
+
+// NOTE: run in object async thread
+void JQAsyncIterObject::_next(JQAsyncInfo &info)
+{
+    if (done) {
+        info.postJSON("{\"done\":true}");
+        return;
+    }
+
+    JQAsyncIterPage page;
+    int ret = onAsyncIteratorNext(page);
+    if (ret < 0) {
+        done = true;
+        info.postError(JQErrorDesc("JQAsyncIterError", jq_printf("next page failed: %d", ret), ret));
+    } else if (ret == 0) {
+        done = true;
+        info.postJSON("{\"done\":true}");
+    } else {
+        index++;
+        if (page._isJSON) {
+            std::string json;
+            json.reserve(page._json.size() + 24);
+            json.append("{\"done\":false,\"value\":").append(page._json).append("}");
+            page._json.clear();
+            info.postJSON(json);
+        } else {
+            BsonObjectBuilder result;
+            result.add("done", false);
+            result.add("value", std::move(page._value));
+            info.post(result.build());
+        }
+    }
+}
+
+// NOTE: run in object async thread
+void JQAsyncIterObject::_return(JQAsyncInfo &info)
+{
+    if (!done) {
+        done = true;
+        onAsyncIteratorReturn();
+    }
+    info.postJSON("{\"done\":true}");
+}
+// == JQAsyncIterObject END ==
+
 }  // namespace JQUTIL_NS
\ No newline at end of file
@@ -0,0 +1,196 @@
+#include "jqutil_v2/JQLaneDispatcher.h"
+#include "jqutil_v2/jqmisc.h"
+#include "port/jquick_time.h"
+#include <string.h>
+#include <map>
+
+// 泵单次最多占用JS线程的时间，超过后让出
+#define LANE_SLICE_NS (8 * 1000 * 1000LL)
+// 低优先级任务等待超过该时间，下一次取任务时优先执行
+#define LANE_STARVE_NS (100 * 1000 * 1000LL)
+
+namespace JQUTIL_NS {
+
+static const char* const s_laneNames[JQ_LANE_COUNT] = {"input", "interactive", "bulk", "idle"};
+
+// 按Looper登记，弱引用：不延长实例和它持有的Handler的生命周期
+static JQuick::Mutex s_dispatcherLock;
+static std::map<JQuick::Looper*, JQuick::wp<JQLaneDispatcher> > s_dispatchers;
+
+// static
+JQuick::sp<JQLaneDispatcher> JQLaneDispatcher::Get(JQuick::sp<JQuick::Handler> handler)
+{
+    JQuick::Mutex::Autolock l(s_dispatcherLock);
+    JQuick::wp<JQLaneDispatcher> &w = s_dispatchers[handler->getLooper().get()];
+    JQuick::sp<JQLaneDispatcher> d = w.promote();
+    if (!d.get()) {
+        d = new JQLaneDispatcher(handler);
+        w = d;
+    }
+    return d;
+}
+
+// static
+JQuick::sp<JQLaneDispatcher> JQLaneDispatcher::Find(JQuick::sp<JQuick::Looper> looper)
+{
+    JQuick::Mutex::Autolock l(s_dispatcherLock);
+    auto it = s_dispatchers.find(looper.get());
+    if (it == s_dispatchers.end()) {
+        return NULL;
+    }
+    return it->second.promote();
+}
+
+JQLaneDispatcher::JQLaneDispatcher(JQuick::sp<JQuick::Handler> handler)
+    : _handler(handler)
+    , _pumpPosted(false)
+{
+    memset(_stats, 0, sizeof(_stats));
+}
+
+JQLaneDispatcher::~JQLaneDispatcher()
+{
+    // 同一Looper上可能已经登记了新实例，只删已失效的自己那一项
+    JQuick::Mutex::Autolock l(s_dispatcherLock);
+    auto it = s_dispatchers.find(_handler->getLooper().get());
+    if (it != s_dispatchers.end() && it->second.get() == NULL) {
+        s_dispatchers.erase(it);
+    }
+}
+
+void JQLaneDispatcher::post(JQLane lane, JQuick::UniqueClosure func)
+{
+    if (lane < 0 || lane >= JQ_LANE_COUNT) {
+        lane = JQ_LANE_INTERACTIVE;
+    }
+    Item item;
+    item.func = std::move(func);
+    item.enqueueNs = jquick_get_current_time_ns();
+
+    JQuick::Mutex::Autolock l(_lock);
+    _lanes[lane].push_back(std::move(item));
+    _postPumpLocked();
+}
+
+void JQLaneDispatcher::getStats(JQLaneStats stats[JQ_LANE_COUNT]) const
+{
+    JQuick::Mutex::Autolock l(_lock);
+    for (int i = 0; i < JQ_LANE_COUNT; i++) {
+        stats[i] = _stats[i];
+        stats[i].depth = (int32_t)_lanes[i].size();
+    }
+}
+
+Bson JQLaneDispatcher::statsToBson() const
+{
+    JQLaneStats stats[JQ_LANE_COUNT];
+    getStats(stats);
+    BsonObjectBuilder lanes;
+    lanes.reserve(JQ_LANE_COUNT);
+    for (int i = 0; i < JQ_LANE_COUNT; i++) {
+        const JQLaneStats &s = stats[i];
+        Bson::array hist;
+        hist.reserve(JQ_LANE_HIST_BUCKETS);
+        for (int b = 0; b < JQ_LANE_HIST_BUCKETS; b++) {
+            hist.push_back(Bson((double)s.hist[b]));
+        }
+        BsonObjectBuilder lane;
+        lane.reserve(5);
+        lane.add("count", (double)s.count);
+        lane.add("depth", (int)s.depth);
+        lane.add("maxUs", (double)s.maxUs);
+        lane.add("meanUs", s.count ? (double)s.totalUs / s.count : 0.0);
+        lane.add("hist", Bson(std::move(hist)));
+        lanes.add(s_laneNames[i], lane.build());
+    }
+    return lanes.build();
+}
+
+void JQLaneDispatcher::_postPumpLocked()
+{
+    if (_pumpPosted) {
+        return;
+    }
+    _pumpPosted = true;
+    _handler->post(new JQUniqueFuncTask(JQuick::bind(&JQLaneDispatcher::_pump, JQuick::sp<JQLaneDispatcher>(this))));
+}
+
+bool JQLaneDispatcher::_takeLocked(long long nowNs, Item &item, int &lane)
+{
+    lane = -1;
+    if (!_lanes[JQ_LANE_INPUT].empty()) {
+        lane = JQ_LANE_INPUT;
+    } else {
+        // 饥饿保护：等太久的低优先级任务插队一次
+        for (int i = JQ_LANE_COUNT - 1; i > JQ_LANE_INTERACTIVE; i--) {
+            if (!_lanes[i].empty() && nowNs - _lanes[i].front().enqueueNs > LANE_STARVE_NS) {
+                lane = i;
+                break;
+            }
+        }
+        for (int i = JQ_LANE_INTERACTIVE; lane < 0 && i < JQ_LANE_COUNT; i++) {
+            if (!_lanes[i].empty()) {
+                lane = i;
+            }
+        }
+    }
+    if (lane < 0) {
+        return false;
+    }
+    item = std::move(_lanes[lane].front());
+    _lanes[lane].pop_front();
+    return true;
+}
+
+void JQLaneDispatcher::_recordLocked(int lane, long long waitNs)
+{
+    JQLaneStats &s = _stats[lane];
+    uint64_t us = waitNs > 0 ? (uint64_t)(waitNs / 1000) : 0;
+    int bucket = 0;
+    while (bucket < JQ_LANE_HIST_BUCKETS - 1 && us >= (64ULL << bucket)) {
+        bucket++;
+    }
+    s.hist[bucket]++;
+    s.count++;
+    s.totalUs += us;
+    if (us > s.maxUs) {
+        s.maxUs = us;
+    }
+}
+
+// run js thread
+void JQLaneDispatcher::_pump()
+{
+    long long startNs = jquick_get_current_time_ns();
+    long long nowNs = startNs;
+    while (true) {
+        Item item;
+        int lane;
+        {
+            JQuick::Mutex::Autolock l(_lock);
+            if (!_takeLocked(nowNs, item, lane)) {
+                _pumpPosted = false;
+                return;
+            }
+            _recordLocked(lane, nowNs - item.enqueueNs);
+        }
+        item.func();
+
+        nowNs = jquick_get_current_time_ns();
+        if (nowNs - startNs > LANE_SLICE_NS) {
+            break;
+        }
+    }
+
+    // 时间片用完，排到宿主队列末尾，先让宿主处理输入等消息
+    JQuick::Mutex::Autolock l(_lock);
+    _pumpPosted = false;
+    for (int i = 0; i < JQ_LANE_COUNT; i++) {
+        if (!_lanes[i].empty()) {
+            _postPumpLocked();
+            break;
+        }
+    }
+}
+
+}  // namespace JQUTIL_NS
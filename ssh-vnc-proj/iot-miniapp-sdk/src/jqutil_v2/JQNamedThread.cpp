@@ -3,38 +3,178 @@
 #include "utils/log.h"
 #include "port/jquick_mutex.h"
 #include "port/jquick_condition.h"
+#include "port/jquick_time.h"
+#include <sched.h>
+#include <atomic>
 #include <string>
 #include <map>
-#include <queue>
+#include <unordered_map>
+#include <vector>
 
 #define DEBUG_JQ_NAMED_THREAD
 
-namespace JQUTIL_NS {
+// 路由表两级：256块 x 256项，块按需分配，发布后只读
+#define ROUTE_CHUNK_SHIFT 8
+#define ROUTE_CHUNK_SIZE (1 << ROUTE_CHUNK_SHIFT)
+#define ROUTE_CHUNKS 256
+// 队列取空后先让出几轮CPU再睡，突发抛送时不用每次都唤醒
+#define NAMED_THREAD_SPIN 16
+// 按名字抛送时线程本地缓存的名字数，超过后清空重来
+#define NAME_ROUTE_CACHE_MAX 64
 
-static JQuick::Mutex NamedThread_mutex;
+namespace JQUTIL_NS {
 
 class NamedThread;
+
+// Vyukov侵入式MPSC队列：多个抛送方无锁入队，只有该路由的线程出队
+struct NamedTaskNode {
+    std::atomic<NamedTaskNode*> next;
+    JQuick::UniqueClosure func;
+};
+
+class NamedTaskQueue {
+public:
+    NamedTaskQueue()
+    {
+        _stub.next.store(NULL, std::memory_order_relaxed);
+        _head.store(&_stub, std::memory_order_relaxed);
+        _tail = &_stub;
+    }
+
+    ~NamedTaskQueue()
+    {
+        NamedTaskNode *node;
+        while ((node = pop()) != NULL) {
+            delete node;
+        }
+    }
+
+    void push(NamedTaskNode *node)
+    {
+        node->next.store(NULL, std::memory_order_relaxed);
+        NamedTaskNode *prev = _head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    // 抛送方正在入队的中间态也返回NULL，由唤醒协议兜底
+    NamedTaskNode* pop()
+    {
+        NamedTaskNode *tail = _tail;
+        NamedTaskNode *next = tail->next.load(std::memory_order_acquire);
+        if (tail == &_stub) {
+            if (!next) {
+                return NULL;
+            }
+            _tail = next;
+            tail = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (next) {
+            _tail = next;
+            return tail;
+        }
+        if (tail != _head.load(std::memory_order_acquire)) {
+            return NULL;
+        }
+        push(&_stub);
+        next = tail->next.load(std::memory_order_acquire);
+        if (next) {
+            _tail = next;
+            return tail;
+        }
+        return NULL;
+    }
+
+private:
+    std::atomic<NamedTaskNode*> _head;
+    NamedTaskNode *_tail;
+    NamedTaskNode _stub;
+};
+
+enum {
+    ROUTE_IDLE = 0,     // 没有线程
+    ROUTE_RUNNING,      // 线程在跑，入队即可
+    ROUTE_PARKED,       // 线程在等，入队后需要唤醒
+};
+
+// 每个线程名一个路由，路由对象不释放只复用；队列挂在路由上，线程空闲退出重建后继续消费
+struct NamedRoute {
+    std::string name;
+    NamedTaskQueue queue;
+    std::atomic<int32_t> state;
+    // 只用于线程创建/退出、等待唤醒，抛送到运行中的线程不加锁
+    JQuick::Mutex lock;
+    JQuick::Condition cond;
+    bool released = false;
+
+    std::atomic<uint64_t> posted;
+    std::atomic<uint64_t> executed;
+    std::atomic<uint32_t> spawns;
+    std::atomic<uint32_t> idleExpiries;
+    std::atomic<int32_t> depth;
+    std::atomic<int32_t> depthHighWater;
+
+    NamedRoute(): state(ROUTE_IDLE)
+    {
+        resetStats();
+    }
+
+    void resetStats()
+    {
+        posted.store(0);
+        executed.store(0);
+        spawns.store(0);
+        idleExpiries.store(0);
+        depth.store(0);
+        depthHighWater.store(0);
+    }
+};
+
 class NamedThreadManager {
 public:
     static NamedThreadManager* Instance();
-    NamedThread* postOnThreadLocked(const std::string &name, JQuick::Closure c,
-                                    int32_t stackSize, int32_t priority, uint32_t keepAliveMs);
-    NamedThread* removeThreadLocked(const std::string &name);
+    int32_t intern(const std::string &name);
+    // 先查线程本地缓存，不加锁；没有再走intern
+    int32_t lookup(const std::string &name);
+    void post(int32_t routeId, JQuick::UniqueClosure &c,
+              int32_t stackSize, int32_t priority, uint32_t keepAliveMs);
+    void release(int32_t routeId);
+    void stats(std::vector<JQNamedThreadStats> &out);
+
+    inline NamedRoute* route(int32_t routeId) const
+    {
+        if (routeId < 0 || routeId >= ROUTE_CHUNKS * ROUTE_CHUNK_SIZE) {
+            return NULL;
+        }
+        std::atomic<NamedRoute*> *chunk = _chunks[routeId >> ROUTE_CHUNK_SHIFT].load(std::memory_order_acquire);
+        return chunk ? chunk[routeId & (ROUTE_CHUNK_SIZE - 1)].load(std::memory_order_acquire) : NULL;
+    }
 
 protected:
     NamedThreadManager();
 
 protected:
     friend class NamedThread;
-    std::map<std::string, NamedThread*> _nameThreadMap;
+    void recycle(int32_t routeId);
+
+    // 只在驻留/释放时使用
+    JQuick::Mutex _internLock;
+    std::map<std::string, int32_t> _nameRouteMap;
+    // 每次释放路由加一，线程本地的名字缓存据此整体失效
+    std::atomic<uint32_t> _internEpoch{0};
+    std::vector<int32_t> _freeRoutes;
+    int32_t _routeCount = 0;
+    std::atomic<std::atomic<NamedRoute*>*> _chunks[ROUTE_CHUNKS];
 };
 
 class NamedThread: public JQuick::Thread {
 public:
-    NamedThread(const std::string &name, int32_t priority,
+    NamedThread(NamedRoute *route, int32_t routeId, int32_t priority,
                 int32_t stackSize, uint32_t keepAliveMs,
                 JQuick::ReleaseThreadFunction releaseFunc):
-            JQuick::Thread(name, priority, releaseFunc)
+            JQuick::Thread(route->name, priority, releaseFunc)
+            , _route(route)
+            , _routeId(routeId)
             , _stackSize(stackSize)
             , _keepAliveMs(keepAliveMs > 30000 ? 30000: keepAliveMs)
     {
@@ -47,43 +187,73 @@ public:
 
     virtual void run()
     {
+        NamedRoute *r = _route;
+        bool recycle = false;
+        int spins = 0;
         while (true) {
-            JQuick::Closure c;
-            {
-                JQuick::Mutex::Autolock l(NamedThread_mutex);
-                if (_funcQueue.size() == 0 && _keepAliveMs > 0) {
+            NamedTaskNode *node = r->queue.pop();
+            if (node) {
+                spins = 0;
+                r->depth--;
+                node->func();
+                delete node;
+                r->executed.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            if (++spins < NAMED_THREAD_SPIN) {
+                sched_yield();
+                continue;
+            }
+            spins = 0;
+
+            // 先声明要睡再复查队列，与post里先入队再读状态配对，不会丢唤醒
+            r->state.store(ROUTE_PARKED, std::memory_order_seq_cst);
+            if (r->depth.load(std::memory_order_seq_cst) > 0) {
+                int32_t expect = ROUTE_PARKED;
+                r->state.compare_exchange_strong(expect, ROUTE_RUNNING);
+                continue;
+            }
+
+            JQuick::Mutex::Autolock l(r->lock);
+            if (_keepAliveMs > 0) {
 #ifdef DEBUG_JQ_NAMED_THREAD
-                    LOGD("NamedThread::run %s, wait keepAliveMs %d START", _threadName.c_str(), _keepAliveMs);
+                LOGD("NamedThread::run %s, wait keepAliveMs %d START", _threadName.c_str(), _keepAliveMs);
 #endif
-                    _condition.waitRelative(NamedThread_mutex, _keepAliveMs);
+                long long deadline = jquick_get_current_time() + _keepAliveMs;
+                while (r->state.load() == ROUTE_PARKED) {
+                    long long left = deadline - jquick_get_current_time();
+                    if (left <= 0) {
+                        break;
+                    }
+                    r->cond.waitRelative(r->lock, (int)left);
+                }
 #ifdef DEBUG_JQ_NAMED_THREAD
-                    LOGD("NamedThread::run %s, wait keepAliveMs %d END", _threadName.c_str(), _keepAliveMs);
+                LOGD("NamedThread::run %s, wait keepAliveMs %d END", _threadName.c_str(), _keepAliveMs);
 #endif
-                }
+            }
 
-                if (_funcQueue.size() == 0) {
-                    NamedThreadManager::Instance()->removeThreadLocked(_threadName);
-                    break;
-                }
-                c = _funcQueue.front();
-                _funcQueue.pop();
+            // 超时仍无任务则退出，之后的抛送看到IDLE会新建线程
+            int32_t expect = ROUTE_PARKED;
+            if (r->state.compare_exchange_strong(expect, ROUTE_IDLE)) {
+                r->idleExpiries++;
+                recycle = r->released;
+#ifdef DEBUG_JQ_NAMED_THREAD
+                LOGD("NamedThread removed %s", _threadName.c_str());
+#endif
+                break;
             }
-            c();
+        }
+        if (recycle) {
+            NamedThreadManager::Instance()->recycle(_routeId);
         }
         Thread::run();
     }
 
-    void postClosureLocked(JQuick::Closure &c)
-    {
-        _funcQueue.push(c);
-        _condition.signal();
-    }
-
 protected:
+    NamedRoute *_route;
+    int32_t _routeId;
     int32_t _stackSize;
     uint32_t _keepAliveMs;
-    std::queue<JQuick::Closure> _funcQueue;
-    JQuick::Condition _condition;
 };
 
 // static
@@ -100,67 +270,211 @@ NamedThreadManager* NamedThreadManager::Instance()
 }
 
 NamedThreadManager::NamedThreadManager()
-{}
+{
+    for (int i = 0; i < ROUTE_CHUNKS; i++) {
+        _chunks[i].store(NULL, std::memory_order_relaxed);
+    }
+}
 
-NamedThread* NamedThreadManager::postOnThreadLocked(
-        const std::string &name, JQuick::Closure c,
-        int32_t stackSize, int32_t priority, uint32_t keepAliveMs)
+int32_t NamedThreadManager::intern(const std::string &name)
 {
-    NamedThread *thread;
-    auto iter = _nameThreadMap.find(name);
-    if (iter == _nameThreadMap.end()) {
-        // create
-        thread = new NamedThread(name, stackSize, priority, keepAliveMs, &NamedThreadRelease);
-        // add thread
-        _nameThreadMap[name] = thread;
-        thread->start();
-#ifdef DEBUG_JQ_NAMED_THREAD
-        LOGD("NamedThread added %s", name.c_str());
-#endif
+    JQuick::Mutex::Autolock l(_internLock);
+    auto iter = _nameRouteMap.find(name);
+    if (iter != _nameRouteMap.end()) {
+        return iter->second;
+    }
+
+    int32_t routeId;
+    NamedRoute *r;
+    if (!_freeRoutes.empty()) {
+        routeId = _freeRoutes.back();
+        _freeRoutes.pop_back();
+        r = route(routeId);
+        JQuick::Mutex::Autolock rl(r->lock);
+        r->name = name;
+        r->released = false;
+        r->resetStats();
     } else {
-        thread = iter->second;
+        if (_routeCount >= ROUTE_CHUNKS * ROUTE_CHUNK_SIZE) {
+            LOGE("NamedThread route table full, drop %s", name.c_str());
+            return -1;
+        }
+        routeId = _routeCount++;
+        std::atomic<NamedRoute*> *chunk = _chunks[routeId >> ROUTE_CHUNK_SHIFT].load(std::memory_order_relaxed);
+        if (!chunk) {
+            chunk = new std::atomic<NamedRoute*>[ROUTE_CHUNK_SIZE];
+            for (int i = 0; i < ROUTE_CHUNK_SIZE; i++) {
+                chunk[i].store(NULL, std::memory_order_relaxed);
+            }
+            _chunks[routeId >> ROUTE_CHUNK_SHIFT].store(chunk, std::memory_order_release);
+        }
+        r = new NamedRoute();
+        r->name = name;
+        chunk[routeId & (ROUTE_CHUNK_SIZE - 1)].store(r, std::memory_order_release);
     }
+    _nameRouteMap[name] = routeId;
+    return routeId;
+}
 
-    thread->postClosureLocked(c);
+struct NameRouteCache {
+    uint32_t epoch = 0;
+    std::unordered_map<std::string, int32_t> routes;
+};
+static thread_local NameRouteCache t_nameRoutes;
 
-    return thread;
+int32_t NamedThreadManager::lookup(const std::string &name)
+{
+    NameRouteCache &c = t_nameRoutes;
+    uint32_t epoch = _internEpoch.load(std::memory_order_acquire);
+    if (c.epoch != epoch) {
+        c.routes.clear();
+        c.epoch = epoch;
+    }
+    auto iter = c.routes.find(name);
+    if (iter != c.routes.end()) {
+        return iter->second;
+    }
+
+    int32_t routeId = intern(name);
+    if (routeId >= 0) {
+        if (c.routes.size() >= NAME_ROUTE_CACHE_MAX) {
+            c.routes.clear();
+        }
+        c.routes.emplace(name, routeId);
+    }
+    return routeId;
 }
 
-NamedThread* NamedThreadManager::removeThreadLocked(const std::string &name)
+void NamedThreadManager::post(int32_t routeId, JQuick::UniqueClosure &c,
+                              int32_t stackSize, int32_t priority, uint32_t keepAliveMs)
 {
-    NamedThread *thread = NULL;
-    auto iter = _nameThreadMap.find(name);
-    if (iter != _nameThreadMap.end()) {
-        // remove
-        thread = iter->second;
-        _nameThreadMap.erase(iter);
+    NamedRoute *r = route(routeId);
+    if (!r) {
+        LOGE("NamedThread invalid route %d", routeId);
+        return;
+    }
+
+    NamedTaskNode *node = new NamedTaskNode();
+    node->func = std::move(c);
+    r->posted.fetch_add(1, std::memory_order_relaxed);
+    int32_t depth = ++r->depth;
+    int32_t high = r->depthHighWater.load(std::memory_order_relaxed);
+    while (depth > high && !r->depthHighWater.compare_exchange_weak(high, depth, std::memory_order_relaxed)) {
+    }
+    r->queue.push(node);
+
+    int32_t state = r->state.load(std::memory_order_seq_cst);
+    while (true) {
+        if (state == ROUTE_RUNNING) {
+            return;
+        }
+        if (state == ROUTE_PARKED) {
+            if (r->state.compare_exchange_strong(state, ROUTE_RUNNING)) {
+                JQuick::Mutex::Autolock l(r->lock);
+                r->cond.signal();
+                return;
+            }
+            continue;
+        }
+
+        JQuick::Mutex::Autolock l(r->lock);
+        state = r->state.load();
+        if (state != ROUTE_IDLE) {
+            continue;
+        }
+        r->state.store(ROUTE_RUNNING);
+        r->spawns++;
+        NamedThread *thread = new NamedThread(r, routeId, priority, stackSize, keepAliveMs, &NamedThreadRelease);
+        thread->start();
 #ifdef DEBUG_JQ_NAMED_THREAD
-        LOGD("NamedThread removed %s", name.c_str());
+        LOGD("NamedThread added %s", r->name.c_str());
 #endif
+        return;
+    }
+}
+
+void NamedThreadManager::release(int32_t routeId)
+{
+    NamedRoute *r = route(routeId);
+    if (!r) {
+        return;
     }
-    return thread;
 
+    bool idle;
+    {
+        JQuick::Mutex::Autolock l(_internLock);
+        JQuick::Mutex::Autolock rl(r->lock);
+        if (r->released) {
+            return;
+        }
+        auto iter = _nameRouteMap.find(r->name);
+        if (iter != _nameRouteMap.end() && iter->second == routeId) {
+            _nameRouteMap.erase(iter);
+        }
+        r->released = true;
+        _internEpoch.fetch_add(1, std::memory_order_release);
+        idle = r->state.load() == ROUTE_IDLE;
+    }
+    // 线程还在的话由线程退出时回收
+    if (idle) {
+        recycle(routeId);
+    }
 }
 
-void PostOnNamedThread(const std::string &name, JQuick::Closure c,
+void NamedThreadManager::recycle(int32_t routeId)
+{
+    JQuick::Mutex::Autolock l(_internLock);
+    _freeRoutes.push_back(routeId);
+}
+
+void NamedThreadManager::stats(std::vector<JQNamedThreadStats> &out)
+{
+    JQuick::Mutex::Autolock l(_internLock);
+    out.clear();
+    out.reserve(_nameRouteMap.size());
+    for (auto &iter: _nameRouteMap) {
+        NamedRoute *r = route(iter.second);
+        JQNamedThreadStats item;
+        item.name = iter.first;
+        item.posted = r->posted.load(std::memory_order_relaxed);
+        item.executed = r->executed.load(std::memory_order_relaxed);
+        item.spawns = r->spawns.load(std::memory_order_relaxed);
+        item.idleExpiries = r->idleExpiries.load(std::memory_order_relaxed);
+        item.depth = r->depth.load(std::memory_order_relaxed);
+        item.depthHighWater = r->depthHighWater.load(std::memory_order_relaxed);
+        item.alive = r->state.load(std::memory_order_relaxed) != ROUTE_IDLE;
+        out.push_back(item);
+    }
+}
+
+int32_t InternNamedThread(const std::string &name)
+{
+    return NamedThreadManager::Instance()->intern(name);
+}
+
+void PostOnNamedThread(int32_t routeId, JQuick::UniqueClosure c,
                        int32_t stackSize/*=0*/, int32_t priority/*=0*/,
                        uint32_t keepAliveMs/*=10000*/)
 {
-    JQuick::Mutex::Autolock _lock(NamedThread_mutex);
-    // first get or create Thread
-    NamedThreadManager::Instance()->postOnThreadLocked(name, c, stackSize, priority, keepAliveMs);
+    NamedThreadManager::Instance()->post(routeId, c, stackSize, priority, keepAliveMs);
+}
+
+void ReleaseNamedThread(int32_t routeId)
+{
+    NamedThreadManager::Instance()->release(routeId);
 }
 
-static void StdFuncCaller(std::function<void()> c)
+void GetNamedThreadStats(std::vector<JQNamedThreadStats> &out)
 {
-    c();
+    NamedThreadManager::Instance()->stats(out);
 }
 
-void PostOnNamedThread(const std::string &name, std::function<void()> c,
-                         int32_t stackSize/*=0*/, int32_t priority/*=0*/,
-                         uint32_t keepAliveMs/*=10000*/)
+void PostOnNamedThread(const std::string &name, JQuick::UniqueClosure c,
+                       int32_t stackSize/*=0*/, int32_t priority/*=0*/,
+                       uint32_t keepAliveMs/*=10000*/)
 {
-    PostOnNamedThread(name, JQuick::bind(StdFuncCaller, c), stackSize, priority, keepAliveMs);
+    NamedThreadManager *m = NamedThreadManager::Instance();
+    m->post(m->lookup(name), c, stackSize, priority, keepAliveMs);
 }
 
-}  // namespace JQUTIL_NS
\ No newline at end of file
+}  // namespace JQUTIL_NS
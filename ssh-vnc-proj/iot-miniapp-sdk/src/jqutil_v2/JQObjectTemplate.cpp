@@ -260,7 +260,14 @@ JQObjectProperty& JQObjectTemplate::_setProperty(JSAtom prop, JQObjectProperty &
     }
     // else
     property.prop = prop;
-    return _propertyMap.emplace(JS_DupAtom(_tplCtx, prop), property).first->second;
+    std::pair<std::map<JSAtom, JQObjectProperty>::iterator, bool> ret =
+        _propertyMap.emplace(JS_DupAtom(_tplCtx, prop), property);
+    if (ret.second) {
+        assert(_propertySlots.size() < 0x7fff);
+        ret.first->second.slot = (int)_propertySlots.size();
+        _propertySlots.push_back(&ret.first->second);
+    }
+    return ret.first->second;
 }
 
 // static
@@ -270,15 +277,15 @@ JSValue JQObjectTemplate::Caller(JSContext *ctx, JSValueConst this_val,
                                  JSValueConst *refs)
 {
     JSValue result = JS_UNDEFINED;
-    JSAtom prop = (JSAtom)magic;
 
     JQObjectTemplate *objTpl = JQUnwrapRefSimple<JQObjectTemplate>(refs[JQ_REFS_TPL_INDEX]);
 
-    auto iter = objTpl->_propertyMap.find(prop);
-    if (iter == objTpl->_propertyMap.end()) {
+    // magic是注入时写入的属性下标
+    JQObjectProperty *slotProperty = objTpl->_propertyAt(magic);
+    if (!slotProperty) {
         return JS_ThrowInternalError(ctx, "cannot get JQObjectTemplate property");
     }
-    JQObjectProperty &property = iter->second;
+    JQObjectProperty &property = *slotProperty;
 
 #define CREATE_FUNCTION_INFO \
     JQFunctionInfo info(ctx); \
@@ -393,7 +400,7 @@ JSValue JQObjectTemplate::Caller(JSContext *ctx, JSValueConst this_val,
             infoAsync._callbackId = 0;
         }
 
-        objTpl->_asyncSchedule.dispatch(objTpl, thisCppObj, property, infoAsync);  // to call property.async_cb
+        objTpl->_asyncSchedule.dispatch(objTpl, thisCppObj, std::move(infoAsync));  // to call property.async_cb
     } else if (property.type == JQ_PROPERTY_ASYNC_STD_CALLBACK) {
         CREATE_ASYNC_INFO
 
@@ -423,17 +430,18 @@ JSValue JQObjectTemplate::Caller(JSContext *ctx, JSValueConst this_val,
         if (notSettled) {
             if (!paramsPrepared) {
                 // parepare default params
+                infoAsync._params.reserve(argc);
                 for (int idx=0; idx < argc; idx++) {
                     infoAsync._params.push_back(JSValueToBson(ctx, argv[idx]));
                 }
             }
-            objTpl->_asyncSchedule.dispatch(objTpl, thisCppObj, property, infoAsync);  // to call property.async_cb
+            objTpl->_asyncSchedule.dispatch(objTpl, thisCppObj, std::move(infoAsync));  // to call property.async_cb
         }
     } else if (property.type == JQ_PROPERTY_PROMISE_CALLBACK) {
         CREATE_ASYNC_INFO
 
         // result is promise object, or exception
-        const char* propName = JS_AtomToCString(ctx, prop);
+        const char* propName = JS_AtomToCString(ctx, property.prop);
         std::string tip = objTpl->functionName() + "." + propName;
         JS_FreeCString(ctx, propName);
         infoAsync._callbackId = thisCppObj->getOrCreateAsyncExecutor()->createPromiseId(ctx, &result, tip);
@@ -449,11 +457,12 @@ JSValue JQObjectTemplate::Caller(JSContext *ctx, JSValueConst this_val,
             if (notSettled) {
                 if (!paramsPrepared) {
                     // parepare default params
+                    infoAsync._params.reserve(argc);
                     for (int idx=0; idx < argc; idx++) {
                         infoAsync._params.push_back(JSValueToBson(ctx, argv[idx]));
                     }
                 }
-                objTpl->_asyncSchedule.dispatch(objTpl, thisCppObj, property, infoAsync);  // to call property.async_cb
+                objTpl->_asyncSchedule.dispatch(objTpl, thisCppObj, std::move(infoAsync));  // to call property.async_cb
             }
         }
     } else {
@@ -529,9 +538,9 @@ void JQObjectTemplate::injectProperties(JSValueConst result, int refsCount, JSVa
             iter.second.type == JQ_ACCESSOR_FUNCTION_CALLBACK) {
             // accessor
             JSValue getter = JS_NewCFunctionData(_tplCtx, GetterCaller,
-                                                 0, /*magic*/prop, refsCount, refs);
+                                                 0, /*magic*/iter.second.slot, refsCount, refs);
             JSValue setter = JS_NewCFunctionData(_tplCtx, SetterCaller,
-                                                 0, /*magic*/prop, refsCount, refs);
+                                                 0, /*magic*/iter.second.slot, refsCount, refs);
 
             JS_DefinePropertyGetSet(_tplCtx, result, prop, getter, setter, iter.second.flags);
         } else if (iter.second.type == JQ_ACCESSOR_FUNCTION_TEMPLATE) {
@@ -548,7 +557,7 @@ void JQObjectTemplate::injectProperties(JSValueConst result, int refsCount, JSVa
                    iter.second.type == JQ_PROPERTY_PROMISE_CALLBACK) {
             // function
             JSValue func = JS_NewCFunctionData(_tplCtx, FuncCaller,
-                                               0, /*magic*/prop, refsCount, refs);
+                                               0, /*magic*/iter.second.slot, refsCount, refs);
             JS_DefinePropertyValue(_tplCtx, result, prop, func, iter.second.flags);
         } else if (iter.second.type == JQ_PROPERTY_FUNCTION_TEMPLATE) {
             JS_DefinePropertyValue(_tplCtx, result, prop, iter.second.get_tpl->GetFunction(), iter.second.flags);
@@ -578,8 +587,8 @@ void JQObjectTemplate::injectProperties(JSValueConst result, int refsCount, JSVa
             }
             // then construct signal property to set on to instance
             JSValue publisherObj = JS_NewObject(_tplCtx);
-            JSValue onFunc = JS_NewCFunctionData(_tplCtx, JQObjectSignalRegister::_SignalSubscribe, 1, /*magic*/prop, refsCount, refs);
-            JSValue offFunc = JS_NewCFunctionData(_tplCtx, JQObjectSignalRegister::_SignalUnsubscribe, 1, /*magic*/prop, refsCount, refs);
+            JSValue onFunc = JS_NewCFunctionData(_tplCtx, JQObjectSignalRegister::_SignalSubscribe, 1, /*magic*/iter.second.slot, refsCount, refs);
+            JSValue offFunc = JS_NewCFunctionData(_tplCtx, JQObjectSignalRegister::_SignalUnsubscribe, 1, /*magic*/iter.second.slot, refsCount, refs);
             JS_DefinePropertyValueStr(_tplCtx, publisherObj, "on", onFunc, 0);
             JS_DefinePropertyValueStr(_tplCtx, publisherObj, "off", offFunc, 0);
             JS_DefinePropertyValue(_tplCtx, result, prop, publisherObj, iter.second.flags);
@@ -590,13 +599,13 @@ void JQObjectTemplate::injectProperties(JSValueConst result, int refsCount, JSVa
             }
             // then construct signal property to set on to instance
             JSValue publisherObj = JS_NewObject(_tplCtx);
-            JSValue onFunc = JS_NewCFunctionData(_tplCtx, JQObjectSignalRegister::_SignalSubscribe, 1, /*magic*/ prop, refsCount, refs);
-            JSValue offFunc = JS_NewCFunctionData(_tplCtx, JQObjectSignalRegister::_SignalUnsubscribe, 1, /*magic*/ prop, refsCount, refs);
+            JSValue onFunc = JS_NewCFunctionData(_tplCtx, JQObjectSignalRegister::_SignalSubscribe, 1, /*magic*/ iter.second.slot, refsCount, refs);
+            JSValue offFunc = JS_NewCFunctionData(_tplCtx, JQObjectSignalRegister::_SignalUnsubscribe, 1, /*magic*/ iter.second.slot, refsCount, refs);
             JS_DefinePropertyValueStr(_tplCtx, publisherObj, "on", onFunc, 0);
             JS_DefinePropertyValueStr(_tplCtx, publisherObj, "off", offFunc, 0);
 
-            JSValue getter = JS_NewCFunctionData(_tplCtx, GetterCaller, 1, /*magic*/ prop, refsCount, refs);
-            JSValue setter = JS_NewCFunctionData(_tplCtx, SetterCaller, 1, /*magic*/ prop, refsCount, refs);
+            JSValue getter = JS_NewCFunctionData(_tplCtx, GetterCaller, 1, /*magic*/ iter.second.slot, refsCount, refs);
+            JSValue setter = JS_NewCFunctionData(_tplCtx, SetterCaller, 1, /*magic*/ iter.second.slot, refsCount, refs);
             JSAtom prop_value = JS_NewAtom(_tplCtx, "value");
             JS_DefinePropertyGetSet(_tplCtx, publisherObj, prop_value, getter, setter, 0);
             JS_FreeAtom(_tplCtx, prop_value);
@@ -814,8 +823,11 @@ JQObjectTemplateRef JQObjectTemplate::clone() const
     JQObjectTemplateRef result = new JQObjectTemplate(_tplEnv);
     JSContext *ctx = _tplCtx;
     result->_propertyMap = _propertyMap;
+    result->_propertySlots.reserve(_propertySlots.size());
     for (auto &iter: result->_propertyMap) {
         JS_DupAtom(ctx, iter.first);
+        iter.second.slot = (int)result->_propertySlots.size();
+        result->_propertySlots.push_back(&iter.second);
     }
     result->_objCreator = _objCreator;
     result->_asyncSchedule = _asyncSchedule;
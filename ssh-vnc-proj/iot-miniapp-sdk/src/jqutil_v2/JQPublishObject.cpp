@@ -13,6 +13,7 @@ JQPublishObject::JQPublishObject()
 
 void JQPublishObject::OnInit()
 {
+    _dispatcher = JQLaneDispatcher::Get(jsHandler());
     hookGCMark([this](JQBaseObject*, JSRuntime *rt, JSValueConst val, JS_MarkFunc *mark_func) {
       for (auto &iter0: _topicCallbacksMap) {
           for (auto &iter1: iter0.second) {
@@ -27,6 +28,7 @@ void JQPublishObject::OnInit()
           }
       }
       _topicCallbacksMap.clear();
+      _shapes.clear(ctx);
     });
 }
 
@@ -221,7 +223,7 @@ void JQPublishObject::_OnPublish(const std::string &topic, const Bson &bson)
 
     JSContext* ctx = JS_DupContext(getContext());
 
-    jsval = bsonToJSValue(ctx, bson);
+    jsval = bsonToJSValue(ctx, bson, &_shapes);
 
     if (JS_IsException(jsval)) {
         jq_dump_error(ctx);
@@ -247,7 +249,17 @@ exit:
     JS_FreeContext(ctx);
 }
 
-void JQPublishObject::publishJSON(const std::string &topic, const std::string &json, JQPublishType pubType/*=JQ_PUBLISH_TYPE_AUTO*/)
+void JQPublishObject::_dispatchAsync(JQLane lane, JQuick::UniqueClosure c)
+{
+    if (_dispatcher.get()) {
+        _dispatcher->post(lane, std::move(c));
+    } else {
+        JQLaneDispatcher::Get(jsHandler())->post(lane, std::move(c));
+    }
+}
+
+void JQPublishObject::publishJSON(const std::string &topic, std::string json, JQPublishType pubType/*=JQ_PUBLISH_TYPE_AUTO*/,
+                                  JQLane lane/*=JQ_LANE_INTERACTIVE*/)
 {
     bool sync = false;
     if (pubType == JQ_PUBLISH_TYPE_AUTO) {
@@ -261,11 +273,16 @@ void JQPublishObject::publishJSON(const std::string &topic, const std::string &j
     if (sync) {
         _OnPublishJSON(topic, json);
     } else {
-        jsHandler()->run(new JQuick::FunctionalTask(JQuick::bind(&JQPublishObject::_OnPublishJSON, JQuick::sp<JQPublishObject>(this), topic, json)));
+        // 小闭包直接存在分道队列里，json移动进去不再拷贝
+        JQuick::sp<JQPublishObject> self(this);
+        _dispatchAsync(lane, [self, topic, json = std::move(json)]() {
+            self->_OnPublishJSON(topic, json);
+        });
     }
 }
 
-void JQPublishObject::publish(const std::string &topic, const Bson &bson, JQPublishType pubType/*=JQ_PUBLISH_TYPE_AUTO*/)
+void JQPublishObject::publish(const std::string &topic, const Bson &bson, JQPublishType pubType/*=JQ_PUBLISH_TYPE_AUTO*/,
+                              JQLane lane/*=JQ_LANE_INTERACTIVE*/)
 {
     bool sync = false;
     if (pubType == JQ_PUBLISH_TYPE_AUTO) {
@@ -279,7 +296,10 @@ void JQPublishObject::publish(const std::string &topic, const Bson &bson, JQPubl
     if (sync) {
         _OnPublish(topic, bson);
     } else {
-        jsHandler()->run(new JQuick::FunctionalTask(JQuick::bind(&JQPublishObject::_OnPublish, JQuick::sp<JQPublishObject>(this), topic, bson)));
+        JQuick::sp<JQPublishObject> self(this);
+        _dispatchAsync(lane, [self, topic, bson]() {
+            self->_OnPublish(topic, bson);
+        });
     }
 }
 
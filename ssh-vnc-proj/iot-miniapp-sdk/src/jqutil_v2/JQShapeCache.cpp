@@ -0,0 +1,77 @@
+#include "jqutil_v2/JQShapeCache.h"
+
+namespace JQUTIL_NS {
+
+JQShapeCache::JQShapeCache()
+{
+    for (int i = 0; i < JQ_SHAPE_CACHE_SLOTS; i++) {
+        _slots[i].hash = 0;
+    }
+    _stats.hits = 0;
+    _stats.misses = 0;
+}
+
+// run js thread
+const JSAtom* JQShapeCache::lookup(JSContext *ctx, const Bson::object &obj)
+{
+    size_t n = obj.size();
+    if (n == 0 || n > JQ_SHAPE_MAX_KEYS) {
+        return NULL;
+    }
+
+    // FNV-1a，key之间加分隔，命中后再逐个比较key确认
+    uint32_t hash = 2166136261u;
+    for (auto &iter: obj) {
+        for (char c: iter.first) {
+            hash = (hash ^ (uint8_t)c) * 16777619u;
+        }
+        hash = (hash ^ 0xff) * 16777619u;
+    }
+
+    Shape &shape = _slots[hash % JQ_SHAPE_CACHE_SLOTS];
+    if (shape.hash == hash && shape.keys.size() == n) {
+        size_t i = 0;
+        for (auto &iter: obj) {
+            if (iter.first != shape.keys[i]) {
+                break;
+            }
+            i++;
+        }
+        if (i == n) {
+            _stats.hits++;
+            return shape.atoms.data();
+        }
+    }
+
+    _stats.misses++;
+    _freeShape(ctx, shape);
+    shape.hash = hash;
+    shape.keys.reserve(n);
+    shape.atoms.reserve(n);
+    for (auto &iter: obj) {
+        shape.keys.push_back(iter.first);
+        shape.atoms.push_back(JS_NewAtomLen(ctx, iter.first.data(), iter.first.size()));
+    }
+    return shape.atoms.data();
+}
+
+// run js thread
+void JQShapeCache::clear(JSContext *ctx)
+{
+    for (int i = 0; i < JQ_SHAPE_CACHE_SLOTS; i++) {
+        _freeShape(ctx, _slots[i]);
+    }
+}
+
+// static
+void JQShapeCache::_freeShape(JSContext *ctx, Shape &shape)
+{
+    for (JSAtom atom: shape.atoms) {
+        JS_FreeAtom(ctx, atom);
+    }
+    shape.atoms.clear();
+    shape.keys.clear();
+    shape.hash = 0;
+}
+
+}  // namespace JQUTIL_NS
@@ -43,7 +43,7 @@ void JQTemplateEnv::postJSThread(std::function<void()> func)
 
 void JQTemplateEnv::postNamedThread(const std::string &name, std::function<void()> func)
 {
-    PostOnNamedThread(name, func);
+    PostOnNamedThread(name, std::move(func));
 }
 
 JSValueConst JQTemplateEnv::getFunction(const std::string &funcName)
@@ -0,0 +1,317 @@
+#include "jqutil_v2/JQTrace.h"
+
+#ifndef JQ_TRACE_DISABLE
+
+#include "utils/Mutex.h"
+#include <string.h>
+#include <atomic>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// 每个2的幂区间再分的档数（2^TRACE_SUB_BITS）
+#define TRACE_SUB_BITS 2
+#define TRACE_SUB (1 << TRACE_SUB_BITS)
+// 128档覆盖到约2^33us，更大的落在最后一档
+#define TRACE_BUCKETS 128
+#define TRACE_OVERFLOW_ID (JQ_TRACE_MAX_APIS - 1)
+
+namespace JQUTIL_NS {
+
+// 只由所属线程写，读方在注册表锁下relaxed读，允许看到略旧的值
+struct TraceHist {
+    std::atomic<uint32_t> counts[TRACE_BUCKETS];
+    std::atomic<uint64_t> sumUs;
+    std::atomic<uint64_t> maxUs;
+};
+
+struct TraceSlot {
+    std::atomic<uint64_t> bytesIn;
+    std::atomic<uint64_t> bytesOut;
+    TraceHist exec;
+    TraceHist wait;
+};
+
+// 汇总用的普通计数
+struct TraceHistSum {
+    uint64_t counts[TRACE_BUCKETS];
+    uint64_t total;
+    uint64_t sumUs;
+    uint64_t maxUs;
+};
+
+struct TraceTotals {
+    uint64_t bytesIn;
+    uint64_t bytesOut;
+    TraceHistSum exec;
+    TraceHistSum wait;
+};
+
+struct TraceThreadBuf;
+
+static JQuick::Mutex s_traceLock;
+static std::vector<std::string> s_traceNames;
+static std::vector<TraceThreadBuf*> s_traceBufs;
+// 已退出线程的累计，按需分配
+static TraceTotals* s_traceRetired[JQ_TRACE_MAX_APIS];
+
+static thread_local JQTraceScope* t_traceScope = NULL;
+
+static inline int bucketOf(uint64_t us)
+{
+    if (us < TRACE_SUB) {
+        return (int)us;
+    }
+    int msb = 63 - __builtin_clzll(us);
+    int idx = (msb - TRACE_SUB_BITS + 1) * TRACE_SUB + (int)((us >> (msb - TRACE_SUB_BITS)) & (TRACE_SUB - 1));
+    return idx < TRACE_BUCKETS ? idx : TRACE_BUCKETS - 1;
+}
+
+// 该档能代表的最大值
+static inline uint64_t bucketHigh(int idx)
+{
+    if (idx < TRACE_SUB) {
+        return idx;
+    }
+    int shift = idx / TRACE_SUB - 1;
+    uint64_t low = (uint64_t)(TRACE_SUB + idx % TRACE_SUB) << shift;
+    return low + (1ULL << shift) - 1;
+}
+
+static inline void bump32(std::atomic<uint32_t> &a, uint32_t n)
+{
+    a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+static inline void bump64(std::atomic<uint64_t> &a, uint64_t n)
+{
+    a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+static inline void histRecord(TraceHist &h, long long ns)
+{
+    uint64_t us = ns > 0 ? (uint64_t)(ns / 1000) : 0;
+    bump32(h.counts[bucketOf(us)], 1);
+    bump64(h.sumUs, us);
+    if (us > h.maxUs.load(std::memory_order_relaxed)) {
+        h.maxUs.store(us, std::memory_order_relaxed);
+    }
+}
+
+static void histAdd(TraceHistSum &sum, const TraceHist &h)
+{
+    for (int i = 0; i < TRACE_BUCKETS; i++) {
+        uint32_t c = h.counts[i].load(std::memory_order_relaxed);
+        sum.counts[i] += c;
+        sum.total += c;
+    }
+    sum.sumUs += h.sumUs.load(std::memory_order_relaxed);
+    sum.maxUs = std::max(sum.maxUs, (uint64_t)h.maxUs.load(std::memory_order_relaxed));
+}
+
+static void histMerge(TraceHistSum &sum, const TraceHistSum &other)
+{
+    for (int i = 0; i < TRACE_BUCKETS; i++) {
+        sum.counts[i] += other.counts[i];
+    }
+    sum.total += other.total;
+    sum.sumUs += other.sumUs;
+    sum.maxUs = std::max(sum.maxUs, other.maxUs);
+}
+
+static void totalsAdd(TraceTotals &t, const TraceSlot &s)
+{
+    t.bytesIn += s.bytesIn.load(std::memory_order_relaxed);
+    t.bytesOut += s.bytesOut.load(std::memory_order_relaxed);
+    histAdd(t.exec, s.exec);
+    histAdd(t.wait, s.wait);
+}
+
+struct TraceThreadBuf {
+    std::atomic<TraceSlot*> slots[JQ_TRACE_MAX_APIS];
+
+    TraceThreadBuf()
+    {
+        for (int i = 0; i < JQ_TRACE_MAX_APIS; i++) {
+            slots[i].store(NULL, std::memory_order_relaxed);
+        }
+        JQuick::Mutex::Autolock l(s_traceLock);
+        s_traceBufs.push_back(this);
+    }
+
+    // 线程退出：计数并入总账后释放
+    ~TraceThreadBuf()
+    {
+        JQuick::Mutex::Autolock l(s_traceLock);
+        for (int i = 0; i < JQ_TRACE_MAX_APIS; i++) {
+            TraceSlot* s = slots[i].load(std::memory_order_relaxed);
+            if (!s) {
+                continue;
+            }
+            if (!s_traceRetired[i]) {
+                s_traceRetired[i] = new TraceTotals();
+            }
+            totalsAdd(*s_traceRetired[i], *s);
+            delete s;
+        }
+        s_traceBufs.erase(std::find(s_traceBufs.begin(), s_traceBufs.end(), this));
+    }
+
+    // 只由所属线程调用
+    inline TraceSlot* slot(int32_t id)
+    {
+        TraceSlot* s = slots[id].load(std::memory_order_relaxed);
+        if (!s) {
+            s = new TraceSlot();
+            slots[id].store(s, std::memory_order_release);
+        }
+        return s;
+    }
+};
+
+static thread_local TraceThreadBuf t_traceBuf;
+
+int32_t JQTraceRegister(const char* name)
+{
+    JQuick::Mutex::Autolock l(s_traceLock);
+    if (s_traceNames.empty()) {
+        s_traceNames.reserve(JQ_TRACE_MAX_APIS);
+    }
+    for (size_t i = 0; i < s_traceNames.size(); i++) {
+        if (s_traceNames[i] == name) {
+            return (int32_t)i;
+        }
+    }
+    if ((int32_t)s_traceNames.size() >= TRACE_OVERFLOW_ID) {
+        return TRACE_OVERFLOW_ID;
+    }
+    s_traceNames.push_back(name);
+    return (int32_t)s_traceNames.size() - 1;
+}
+
+void JQTraceRecord(int32_t id, long long execNs, uint64_t bytesIn, uint64_t bytesOut)
+{
+    if (id < 0 || id >= JQ_TRACE_MAX_APIS) {
+        return;
+    }
+    TraceSlot* s = t_traceBuf.slot(id);
+    histRecord(s->exec, execNs);
+    if (bytesIn) {
+        bump64(s->bytesIn, bytesIn);
+    }
+    if (bytesOut) {
+        bump64(s->bytesOut, bytesOut);
+    }
+}
+
+void JQTraceRecordWait(int32_t id, long long waitNs)
+{
+    if (id < 0 || id >= JQ_TRACE_MAX_APIS) {
+        return;
+    }
+    histRecord(t_traceBuf.slot(id)->wait, waitNs);
+}
+
+void JQTraceAddBytes(uint64_t bytesIn, uint64_t bytesOut)
+{
+    if (t_traceScope) {
+        t_traceScope->addBytes(bytesIn, bytesOut);
+    }
+}
+
+JQTraceScope::JQTraceScope(int32_t id)
+    : _id(id)
+    , _startNs(jquick_get_current_time_ns())
+    , _bytesIn(0)
+    , _bytesOut(0)
+    , _prev(t_traceScope)
+{
+    t_traceScope = this;
+}
+
+JQTraceScope::~JQTraceScope()
+{
+    t_traceScope = _prev;
+    JQTraceRecord(_id, jquick_get_current_time_ns() - _startNs, _bytesIn, _bytesOut);
+}
+
+// 取不小于p比例的那一档的上界，不超过实测最大值
+static double histPercentile(const TraceHistSum &h, double p)
+{
+    uint64_t target = (uint64_t)(h.total * p);
+    if (target < 1) {
+        target = 1;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < TRACE_BUCKETS; i++) {
+        seen += h.counts[i];
+        if (seen >= target) {
+            return (double)std::min(bucketHigh(i), h.maxUs);
+        }
+    }
+    return (double)h.maxUs;
+}
+
+static Bson histToBson(const TraceHistSum &h)
+{
+    BsonObjectBuilder b;
+    b.reserve(5);
+    b.add("p50", histPercentile(h, 0.50));
+    b.add("p90", histPercentile(h, 0.90));
+    b.add("p99", histPercentile(h, 0.99));
+    b.add("max", (double)h.maxUs);
+    b.add("mean", (double)h.sumUs / h.total);
+    return b.build();
+}
+
+Bson JQTraceStats()
+{
+    BsonObjectBuilder apis;
+    TraceTotals t;
+    JQuick::Mutex::Autolock l(s_traceLock);
+    for (int32_t id = 0; id < JQ_TRACE_MAX_APIS; id++) {
+        const char* name;
+        if (id < (int32_t)s_traceNames.size()) {
+            name = s_traceNames[id].c_str();
+        } else if (id == TRACE_OVERFLOW_ID) {
+            name = "(overflow)";
+        } else {
+            continue;
+        }
+
+        memset(&t, 0, sizeof(t));
+        if (s_traceRetired[id]) {
+            t.bytesIn = s_traceRetired[id]->bytesIn;
+            t.bytesOut = s_traceRetired[id]->bytesOut;
+            histMerge(t.exec, s_traceRetired[id]->exec);
+            histMerge(t.wait, s_traceRetired[id]->wait);
+        }
+        for (size_t i = 0; i < s_traceBufs.size(); i++) {
+            TraceSlot* s = s_traceBufs[i]->slots[id].load(std::memory_order_acquire);
+            if (s) {
+                totalsAdd(t, *s);
+            }
+        }
+        if (t.exec.total == 0 && t.wait.total == 0) {
+            continue;
+        }
+
+        BsonObjectBuilder api;
+        api.reserve(5);
+        api.add("calls", (double)t.exec.total);
+        api.add("bytesIn", (double)t.bytesIn);
+        api.add("bytesOut", (double)t.bytesOut);
+        if (t.exec.total) {
+            api.add("us", histToBson(t.exec));
+        }
+        if (t.wait.total) {
+            api.add("waitUs", histToBson(t.wait));
+        }
+        apis.add(name, api.build());
+    }
+    return apis.build();
+}
+
+}  // namespace JQUTIL_NS
+
+#endif  // JQ_TRACE_DISABLE
@@ -44,18 +44,9 @@ JQArrayBufferView::JQArrayBufferView(JSContext *ctx, JSValueConst value)
     : JQValue(ctx, value), _length(0), _offset(0), _bytes_per_element(0),
     _array_buffer(JS_UNDEFINED), _data(nullptr), _data_size(0)
 {
-    _array_buffer = JS_GetTypedArrayBuffer(_ctx, _value, &_offset, &_length, &_bytes_per_element);
-    if (JS_IsException(_array_buffer)) {
-        // may be an arrayBuffer, use default case
-        _offset = 0;
-        _bytes_per_element = 1;
-        _array_buffer = JQ_ToArrayBuffer(ctx, _value);
-        _data = JS_GetArrayBuffer(ctx, &_data_size, _array_buffer);
-        _length = _data_size;
-        JS_ResetUncatchableError(ctx);
-    } else {
-        _data = JS_GetArrayBuffer(ctx, &_data_size, _array_buffer);
-    }
+    // 借用底层内存，不拷贝；不是ArrayBuffer及其视图时_data为空
+    _array_buffer = JQ_BorrowArrayBuffer(_ctx, _value, &_data, &_offset, &_length, &_bytes_per_element);
+    _data_size = _data ? _offset + _length : 0;
 }
 JQArrayBufferView::~JQArrayBufferView()
 {
@@ -65,6 +56,16 @@ JQArrayBufferView::~JQArrayBufferView()
 JQObject::~JQObject()
 {
     _clearKeyValueMap();
+    _clearPropCache();
+}
+
+void JQObject::_clearPropCache()
+{
+    for (auto &iter: _propCache) {
+        JS_FreeAtom(_ctx, iter.atom);
+        JS_FreeValue(_ctx, iter.value);
+    }
+    _propCache.clear();
 }
 
 void JQObject::_clearKeyValueMap()
@@ -121,32 +122,64 @@ fail:
     goto done;
 }
 
-bool JQObject::getBool(const std::string &prop)
+JQObject::PropEntry& JQObject::_propEntry(JSAtom prop)
+{
+    for (auto &iter: _propCache) {
+        if (iter.atom == prop) return iter;
+    }
+    PropEntry entry = {JS_DupAtom(_ctx, prop), JS_UNDEFINED, false, -1};
+    _propCache.push_back(entry);
+    return _propCache.back();
+}
+
+bool JQObject::has(JSAtom prop)
+{
+    PropEntry &entry = _propEntry(prop);
+    if (entry.has < 0) {
+        // 异常按没有处理，和原来一致，也缓存下来
+        entry.has = JS_HasProperty(_ctx, _value, prop) == 1 ? 1 : 0;
+    }
+    return entry.has == 1;
+}
+
+JSValueConst JQObject::getValue(JSAtom prop)
 {
-    JSValueConst val = getValue(prop);
-    if (JS_IsException(val)) return false;
-    // NOTE: -1 is exception, treating as false
-    return JS_ToBool(_ctx, val) == 1;
+    PropEntry &entry = _propEntry(prop);
+    if (!entry.loaded) {
+        // val will be hold
+        entry.value = JS_GetProperty(_ctx, _value, prop);
+        entry.loaded = true;
+    }
+    return entry.value;
 }
 
 JSValueConst JQObject::getValue(const std::string &prop)
 {
-    auto iter = _keyValueMap.find(prop);
-    if (iter != _keyValueMap.end()) return iter->second;
-    JSValue val = JS_GetPropertyStr(_ctx, _value, prop.c_str());
-    _keyValueMap[prop] = val;
+    JSAtom atom = JS_NewAtomLen(_ctx, prop.data(), prop.size());
+    if (atom == 0) return JS_EXCEPTION;
+    JSValueConst val = getValue(atom);
+    JS_FreeAtom(_ctx, atom);
     return val;
 }
 
-std::string JQObject::getString(const std::string &prop)
+static std::string JQValueToString(JSContext *ctx, JSValueConst val)
 {
-    JSValueConst val = getValue(prop);
     size_t len;
-    const char* str = JS_ToCStringLen(_ctx, &len, val);
+    const char* str = JS_ToCStringLen(ctx, &len, val);
     if (!str) return "";
     std::string result = std::string(str, len);
-    JS_FreeCString(_ctx, str);
+    JS_FreeCString(ctx, str);
     return result;
 }
 
+std::string JQObject::getString(JSAtom prop)
+{
+    return JQValueToString(_ctx, getValue(prop));
+}
+
+std::string JQObject::getString(const std::string &prop)
+{
+    return JQValueToString(_ctx, getValue(prop));
+}
+
 }  // namespace JQUTIL_NS
\ No newline at end of file
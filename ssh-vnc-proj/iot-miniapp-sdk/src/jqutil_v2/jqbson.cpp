@@ -20,63 +20,80 @@
  */
 
 #include "jqutil_v2/jqbson.h"
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cmath>
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
 #include <limits>
+#if defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+#endif
 
 namespace JQUTIL_NS {
+inline namespace bson_flat {
 
 static const int max_depth = 200;
 
-using std::map;
 using std::string;
 using std::vector;
 //using std::make_shared;
 //using std::initializer_list;
 //using std::move;
 
-/* Helper for representing null - just a do-nothing struct, plus comparison
- * operators so the helpers in BsonValue work. We can't use NULL_t because
- * it may not be orderable.
- */
-struct NullStruct {
-    bool operator==(NullStruct) const
-    {
-        return true;
-    }
-    bool operator<(NullStruct) const
-    {
-        return false;
-    }
-};
-
 /* * * * * * * * * * * * * * * * * * * *
  * Serialization
  */
 
-static void dump(NullStruct, string& out)
+// 整数转十进制，不走snprintf
+static inline void append_uint(unsigned long long value, bool negative, string& out)
 {
-    out += "null";
+    char buf[24];
+    char* p = buf + sizeof buf;
+    do {
+        *--p = static_cast< char >('0' + value % 10);
+        value /= 10;
+    } while (value);
+    if (negative)
+        *--p = '-';
+    out.append(p, buf + sizeof buf - p);
 }
 
 static void dump(double value, string& out)
 {
-    if (std::isfinite(value)) {
-        char buf[32];
-        snprintf(buf, sizeof buf, "%.17g", value);
-        out += buf;
-    } else {
+    if (!std::isfinite(value)) {
         out += "null";
+        return;
+    }
+    // 整数值的double（时间戳、大小等）直接按整数输出
+    if (value == std::floor(value) && std::fabs(value) < 1e15 && (value != 0 || !std::signbit(value))) {
+        long long v = static_cast< long long >(value);
+        append_uint(v < 0 ? 0ULL - static_cast< unsigned long long >(v) : v, v < 0, out);
+        return;
+    }
+    char buf[32];
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    // 标准库带浮点to_chars（GCC 11+）时直接取最短可往返表示
+    std::to_chars_result r = std::to_chars(buf, buf + sizeof buf, value);
+    out.append(buf, r.ptr - buf);
+#else
+    // 最短可往返表示：%g会去掉末尾0，从15位起找第一个strtod回来相等的精度
+    for (int prec = 15; prec <= 17; prec++) {
+        snprintf(buf, sizeof buf, "%.*g", prec, value);
+        if (prec == 17 || std::strtod(buf, NULL) == value)
+            break;
     }
+    out += buf;
+#endif
 }
 
 static void dump(int value, string& out)
 {
-    char buf[32];
-    snprintf(buf, sizeof buf, "%d", value);
-    out += buf;
+    append_uint(value < 0 ? 0ULL - static_cast< unsigned long long >(static_cast< long long >(value)) : value, value < 0, out);
 }
 
 static void dump(bool value, string& out)
@@ -84,45 +101,93 @@ static void dump(bool value, string& out)
     out += value ? "true" : "false";
 }
 
+/* escape_in_word(v)
+ *
+ * SWAR：一次检查8个字节里是否有需要转义的：'"'、'\\'、控制字符，以及0xE2（可能是U+2028/2029的首字节）。
+ * 只用于快速跳过，有命中时再逐字节确认。
+ */
+static inline bool escape_in_word(uint64_t v)
+{
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t highs = 0x8080808080808080ULL;
+    uint64_t quote = v ^ (ones * '"');
+    uint64_t slash = v ^ (ones * '\\');
+    uint64_t e2 = v ^ (ones * 0xe2);
+    uint64_t hit = ((v - ones * 0x20) & ~v)
+                   | ((quote - ones) & ~quote)
+                   | ((slash - ones) & ~slash)
+                   | ((e2 - ones) & ~e2);
+    return (hit & highs) != 0;
+}
+
 static void dump(const string& value, string& out)
 {
+    static const char hex[] = "0123456789abcdef";
+    const char* s = value.data();
+    const size_t len = value.size();
+    size_t run = 0;  // 尚未输出的原样片段起点
+    size_t i = 0;
+
+    out.reserve(out.size() + len + 2);
     out += '"';
-    for (size_t i = 0; i < value.length(); i++) {
-        const char ch = value[i];
+    while (i < len) {
+        if (i + 8 <= len) {
+            uint64_t word;
+            memcpy(&word, s + i, 8);
+            if (!escape_in_word(word)) {
+                i += 8;
+                continue;
+            }
+        }
+
+        const uint8_t ch = static_cast< uint8_t >(s[i]);
+        const char* rep = NULL;
+        char ubuf[7];
+        size_t skip = 1;
         if (ch == '\\') {
-            out += "\\\\";
+            rep = "\\\\";
         } else if (ch == '"') {
-            out += "\\\"";
+            rep = "\\\"";
         } else if (ch == '\b') {
-            out += "\\b";
+            rep = "\\b";
         } else if (ch == '\f') {
-            out += "\\f";
+            rep = "\\f";
         } else if (ch == '\n') {
-            out += "\\n";
+            rep = "\\n";
         } else if (ch == '\r') {
-            out += "\\r";
+            rep = "\\r";
         } else if (ch == '\t') {
-            out += "\\t";
-        } else if (static_cast< uint8_t >(ch) <= 0x1f) {
-            char buf[8];
-            snprintf(buf, sizeof buf, "\\u%04x", ch);
-            out += buf;
-        } else if (static_cast< uint8_t >(ch) == 0xe2 && static_cast< uint8_t >(value[i + 1]) == 0x80 && static_cast< uint8_t >(value[i + 2]) == 0xa8) {
-            out += "\\u2028";
-            i += 2;
-        } else if (static_cast< uint8_t >(ch) == 0xe2 && static_cast< uint8_t >(value[i + 1]) == 0x80 && static_cast< uint8_t >(value[i + 2]) == 0xa9) {
-            out += "\\u2029";
-            i += 2;
-        } else {
-            out += ch;
+            rep = "\\t";
+        } else if (ch <= 0x1f) {
+            ubuf[0] = '\\';
+            ubuf[1] = 'u';
+            ubuf[2] = '0';
+            ubuf[3] = '0';
+            ubuf[4] = hex[ch >> 4];
+            ubuf[5] = hex[ch & 0xf];
+            ubuf[6] = '\0';
+            rep = ubuf;
+        } else if (ch == 0xe2 && i + 2 < len && static_cast< uint8_t >(s[i + 1]) == 0x80
+                   && (static_cast< uint8_t >(s[i + 2]) == 0xa8 || static_cast< uint8_t >(s[i + 2]) == 0xa9)) {
+            rep = static_cast< uint8_t >(s[i + 2]) == 0xa8 ? "\\u2028" : "\\u2029";
+            skip = 3;
+        }
+
+        if (rep) {
+            out.append(s + run, i - run);
+            out += rep;
+            run = i + skip;
         }
+        i += skip;
     }
+    out.append(s + run, len - run);
     out += '"';
 }
 
 static void dump(const Bson::array& values, string& out)
 {
     bool first = true;
+    out.reserve(out.size() + values.size() * 4 + 2);
     out += "[";
 
     for (unsigned i = 0; i < values.size(); i++) {
@@ -141,9 +206,10 @@ static void dump(const Bson::array& values, string& out)
 static void dump(const Bson::object& values, string& out)
 {
     bool first = true;
+    out.reserve(out.size() + values.size() * 16 + 2);
     out += "{";
 
-    for (std::map< std::string, Bson >::const_iterator iter = values.begin(); iter != values.end(); iter++) {
+    for (Bson::object::const_iterator iter = values.begin(); iter != values.end(); iter++) {
         if (!first) {
             out += ", ";
         }
@@ -163,192 +229,101 @@ static void dump(const Bson::binary& value, string& out)
     out += "null";
 }
 
-void Bson::dump(string& out) const
-{
-    m_ptr->dump(out);
-}
-
 /* * * * * * * * * * * * * * * * * * * *
- * Value wrappers
+ * Boxed values
  */
 
-template < Bson::Type tag, typename T >
-class Value : public BsonValue
-{  //!OCLint
-protected:
-    // Constructors
-    explicit Value(const T& value) :
-            m_value(value) {}
-
-    // Get type tag
-    Bson::Type type() const
-    {
-        return tag;
-    }
-
-    // Comparisons
-    bool equals(const BsonValue* other) const
-    {
-        return m_value == static_cast< const Value< tag, T >* >(other)->m_value;
-    }
-    bool less(const BsonValue* other) const
-    {
-        return m_value < static_cast< const Value< tag, T >* >(other)->m_value;
-    }
-
-    const T m_value;
-    void dump(string& out) const
-    {
-        JQUTIL_NS::dump(m_value, out);
-    }
-};
-
-class BsonDouble : public Value< Bson::DOUBLE, double >
-{
-    double number_value() const
-    {
-        return m_value;
-    }
-    double double_value() const
-    {
-        return m_value;
-    }
-    int int_value() const
-    {
-        return static_cast< int >(m_value);
-    }
-    bool equals(const BsonValue* other) const
-    {
-        return m_value == other->number_value();
-    }
-    bool less(const BsonValue* other) const
-    {
-        return m_value < other->number_value();
-    }
-
-public:
-    explicit BsonDouble(double value) :
-            Value(value) {}
+// string/array/object/binary的堆节点：引用计数和值在同一次分配里，类型由持有它的Bson记录
+struct BsonNode {
+    std::atomic< int32_t > refs;
+    BsonNode() :
+            refs(1) {}
 };
 
-class BsonInt : public Value< Bson::INT, int >
-{
-    double number_value() const
-    {
-        return m_value;
-    }
-    double double_value() const
-    {
-        return m_value;
-    }
-    int int_value() const
-    {
-        return m_value;
-    }
-    bool equals(const BsonValue* other) const
-    {
-        return m_value == other->number_value();
-    }
-    bool less(const BsonValue* other) const
-    {
-        return m_value < other->number_value();
-    }
-
-public:
-    explicit BsonInt(int value) :
-            Value(value) {}
+template < typename T >
+struct BsonBox : public BsonNode {
+    explicit BsonBox(const T& v) :
+            value(v) {}
+    explicit BsonBox(T&& v) :
+            value(std::move(v)) {}
+    T value;
 };
 
-class BsonBoolean : public Value< Bson::BOOL, bool >
-{
-    bool bool_value() const
-    {
-        return m_value;
-    }
-
-public:
-    explicit BsonBoolean(bool value) :
-            Value(value) {}
-};
+typedef BsonBox< string > BsonStringBox;
+typedef BsonBox< Bson::array > BsonArrayBox;
+typedef BsonBox< Bson::object > BsonObjectBox;
+typedef BsonBox< Bson::binary > BsonBinaryBox;
 
-class BsonString : public Value< Bson::STRING, string >
+void Bson::retain(BsonNode* node)
 {
-    const string& string_value() const
-    {
-        return m_value;
-    }
-
-public:
-    explicit BsonString(const string& value) :
-            Value(value) {}
-};
+    node->refs.fetch_add(1, std::memory_order_relaxed);
+}
 
-class BsonArray : public Value< Bson::ARRAY, Bson::array >
+void Bson::release(uint8_t type, BsonNode* node)
 {
-    const Bson::array& array_items() const
-    {
-        return m_value;
+    if (node->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        return;
     }
-    const Bson& operator[](size_t i) const;
-
-public:
-    explicit BsonArray(const Bson::array& value) :
-            Value(value) {}
-};
-
-class BsonObject : public Value< Bson::OBJECT, Bson::object >
-{
-    const Bson::object& object_items() const
-    {
-        return m_value;
+    switch (type) {
+        case STRING:
+            delete static_cast< BsonStringBox* >(node);
+            break;
+        case ARRAY:
+            delete static_cast< BsonArrayBox* >(node);
+            break;
+        case OBJECT:
+            delete static_cast< BsonObjectBox* >(node);
+            break;
+        case BINARY:
+            delete static_cast< BsonBinaryBox* >(node);
+            break;
+        default:
+            assert(false);
+            break;
     }
-    const Bson& operator[](const string& key) const;
-
-public:
-    explicit BsonObject(const Bson::object& value) :
-            Value(value) {}
-};
-
-class BsonNull : public Value< Bson::NUL, NullStruct >
-{
-public:
-    BsonNull() :
-            Value(NullStruct()) {}
-};
+}
 
-class BsonBinary: public Value< Bson::BINARY, Bson::binary >
+void Bson::dump(string& out) const
 {
-    const Bson::binary& binary_value() const
-    {
-        return m_value;
+    switch (m_type) {
+        case DOUBLE:
+            JQUTIL_NS::dump(m_u.d, out);
+            break;
+        case INT:
+            JQUTIL_NS::dump(m_u.i, out);
+            break;
+        case BOOL:
+            JQUTIL_NS::dump(m_u.b, out);
+            break;
+        case STRING:
+            JQUTIL_NS::dump(string_value(), out);
+            break;
+        case ARRAY:
+            JQUTIL_NS::dump(array_items(), out);
+            break;
+        case OBJECT:
+            JQUTIL_NS::dump(object_items(), out);
+            break;
+        case BINARY:
+            JQUTIL_NS::dump(binary_value(), out);
+            break;
+        default:
+            out += "null";
+            break;
     }
-
-public:
-    explicit BsonBinary(const Bson::binary& value) :
-            Value(value) {}
-};
+}
 
 /* * * * * * * * * * * * * * * * * * * *
  * Static globals - static-init-safe
  */
 struct Statics {
-    //    const std::shared_ptr<BsonValue> null = make_shared<BsonNull>();
-    //    const std::shared_ptr<BsonValue> t = make_shared<BsonBoolean>(true);
-    //    const std::shared_ptr<BsonValue> f = make_shared<BsonBoolean>(false);
-    const static JQuick::sp< BsonValue > null;
-    const static JQuick::sp< BsonValue > t;
-    const static JQuick::sp< BsonValue > f;
     const string empty_string;
     const vector< Bson > empty_vector;
-    const map< string, Bson > empty_map;
+    const Bson::object empty_map;
     const vector< uint8_t > empty_binary;
     Statics() {}
 };
 
-const JQuick::sp< BsonValue > Statics::null = new BsonNull;
-const JQuick::sp< BsonValue > Statics::t = new BsonBoolean(true);
-const JQuick::sp< BsonValue > Statics::f = new BsonBoolean(false);
-
 static const Statics& statics()
 {
     static const Statics* s = new Statics();
@@ -357,7 +332,6 @@ static const Statics& statics()
 
 static const Bson& static_null()
 {
-    // This has to be separate, not in Statics, because Bson() accesses statics().null.
     static const Bson* json_null = new Bson();
     return *json_null;
 }
@@ -366,150 +340,208 @@ static const Bson& static_null()
  * Constructors
  */
 
-Bson::Bson() :
-        m_ptr(statics().null) {}
-Bson::Bson(double value) :
-        m_ptr(new BsonDouble(value)) {}
-Bson::Bson(int value) :
-        m_ptr(new BsonInt(value)) {}
-Bson::Bson(bool value) :
-        m_ptr(value ? statics().t : statics().f) {}
 Bson::Bson(const string& value) :
-        m_ptr(new BsonString(value)) {}
+        m_type(STRING) { m_u.node = new BsonStringBox(value); }
+Bson::Bson(string&& value) :
+        m_type(STRING) { m_u.node = new BsonStringBox(std::move(value)); }
 Bson::Bson(const char* value) :
-        m_ptr(new BsonString(value)) {}
+        m_type(STRING) { m_u.node = new BsonStringBox(string(value)); }
 Bson::Bson(const Bson::array& values) :
-        m_ptr(new BsonArray(values)) {}
+        m_type(ARRAY) { m_u.node = new BsonArrayBox(values); }
+Bson::Bson(Bson::array&& values) :
+        m_type(ARRAY) { m_u.node = new BsonArrayBox(std::move(values)); }
 Bson::Bson(const Bson::object& values) :
-        m_ptr(new BsonObject(values)) {}
+        m_type(OBJECT) { m_u.node = new BsonObjectBox(values); }
+Bson::Bson(Bson::object&& values) :
+        m_type(OBJECT) { m_u.node = new BsonObjectBox(std::move(values)); }
 Bson::Bson(const Bson::binary& value) :
-        m_ptr(new BsonBinary(value)) {}
+        m_type(BINARY) { m_u.node = new BsonBinaryBox(value); }
+Bson::Bson(Bson::binary&& value) :
+        m_type(BINARY) { m_u.node = new BsonBinaryBox(std::move(value)); }
 
 /* * * * * * * * * * * * * * * * * * * *
  * Accessors
  */
 
-Bson::Type Bson::type() const
-{
-    return m_ptr->type();
-}
-double Bson::number_value() const
-{
-    return m_ptr->number_value();
-}
-double Bson::double_value() const
-{
-    return m_ptr->double_value();
-}
-int Bson::int_value() const
-{
-    return m_ptr->int_value();
-}
-bool Bson::bool_value() const
-{
-    return m_ptr->bool_value();
-}
 const string& Bson::string_value() const
 {
-    return m_ptr->string_value();
+    if (m_type != STRING)
+        return statics().empty_string;
+    return static_cast< const BsonStringBox* >(m_u.node)->value;
 }
 const vector< Bson >& Bson::array_items() const
 {
-    return m_ptr->array_items();
+    if (m_type != ARRAY)
+        return statics().empty_vector;
+    return static_cast< const BsonArrayBox* >(m_u.node)->value;
 }
-const map< string, Bson >& Bson::object_items() const
+const Bson::object& Bson::object_items() const
 {
-    return m_ptr->object_items();
-}
-const Bson& Bson::operator[](size_t i) const
-{
-    return (*m_ptr)[i];
-}
-const Bson& Bson::operator[](const string& key) const
-{
-    return (*m_ptr)[key];
+    if (m_type != OBJECT)
+        return statics().empty_map;
+    return static_cast< const BsonObjectBox* >(m_u.node)->value;
 }
 const Bson::binary& Bson::binary_value() const
 {
-    return m_ptr->binary_value();
-}
-
-double BsonValue::number_value() const
-{
-    return 0;
-}
-double BsonValue::double_value() const
-{
-    return 0;
+    if (m_type != BINARY)
+        return statics().empty_binary;
+    return static_cast< const BsonBinaryBox* >(m_u.node)->value;
 }
-int BsonValue::int_value() const
-{
-    return 0;
-}
-bool BsonValue::bool_value() const
+const Bson& Bson::operator[](size_t i) const
 {
-    return false;
+    if (m_type != ARRAY)
+        return static_null();
+    const Bson::array& items = static_cast< const BsonArrayBox* >(m_u.node)->value;
+    return i < items.size() ? items[i] : static_null();
 }
-const string& BsonValue::string_value() const
+const Bson& Bson::operator[](const string& key) const
 {
-    return statics().empty_string;
+    if (m_type != OBJECT)
+        return static_null();
+    const Bson::object& items = static_cast< const BsonObjectBox* >(m_u.node)->value;
+    Bson::object::const_iterator iter = items.find(key);
+    return (iter == items.end()) ? static_null() : iter->second;
 }
-const vector< Bson >& BsonValue::array_items() const
+
+/* * * * * * * * * * * * * * * * * * * *
+ * Comparison
+ */
+
+bool Bson::operator==(const Bson& other) const
 {
-    return statics().empty_vector;
+    if (m_type != other.m_type)
+        return false;
+
+    switch (m_type) {
+        case NUL:
+            return true;
+        case DOUBLE:
+        case INT:
+            return number_value() == other.number_value();
+        case BOOL:
+            return m_u.b == other.m_u.b;
+        case STRING:
+            return m_u.node == other.m_u.node || string_value() == other.string_value();
+        case ARRAY:
+            return m_u.node == other.m_u.node || array_items() == other.array_items();
+        case OBJECT:
+            return m_u.node == other.m_u.node || object_items() == other.object_items();
+        case BINARY:
+            return m_u.node == other.m_u.node || binary_value() == other.binary_value();
+        default:
+            return false;
+    }
 }
-const map< string, Bson >& BsonValue::object_items() const
+
+bool Bson::operator<(const Bson& other) const
 {
-    return statics().empty_map;
+    if (m_type != other.m_type)
+        return m_type < other.m_type;
+    if (boxed() && m_u.node == other.m_u.node)
+        return false;
+
+    switch (m_type) {
+        case DOUBLE:
+        case INT:
+            return number_value() < other.number_value();
+        case BOOL:
+            return m_u.b < other.m_u.b;
+        case STRING:
+            return string_value() < other.string_value();
+        case ARRAY:
+            return array_items() < other.array_items();
+        case OBJECT:
+            return object_items() < other.object_items();
+        case BINARY:
+            return binary_value() < other.binary_value();
+        default:
+            return false;
+    }
 }
-const Bson& BsonValue::operator[](size_t) const
+
+/* * * * * * * * * * * * * * * * * * * *
+ * Object
+ */
+
+struct KeyLess {
+    bool operator()(const BsonMap::value_type& item, const string& key) const
+    {
+        return item.first < key;
+    }
+    bool operator()(const BsonMap::value_type& a, const BsonMap::value_type& b) const
+    {
+        return a.first < b.first;
+    }
+};
+
+BsonMap::iterator BsonMap::lower_bound(const string& key)
 {
-    return static_null();
+    return std::lower_bound(m_items.begin(), m_items.end(), key, KeyLess());
 }
-const Bson& BsonValue::operator[](const string&) const
+
+BsonMap::iterator BsonMap::find(const string& key)
 {
-    return static_null();
+    iterator iter = lower_bound(key);
+    return (iter != m_items.end() && iter->first == key) ? iter : m_items.end();
 }
-const std::vector<uint8_t>& BsonValue::binary_value() const
+
+BsonMap::const_iterator BsonMap::find(const string& key) const
 {
-    return statics().empty_binary;
+    const_iterator iter = std::lower_bound(m_items.begin(), m_items.end(), key, KeyLess());
+    return (iter != m_items.end() && iter->first == key) ? iter : m_items.end();
 }
 
-const Bson& BsonObject::operator[](const string& key) const
+Bson& BsonMap::operator[](const string& key)
 {
-    Bson::object::const_iterator iter = m_value.find(key);
-    return (iter == m_value.end()) ? static_null() : iter->second;
+    iterator iter = lower_bound(key);
+    if (iter == m_items.end() || iter->first != key) {
+        iter = m_items.insert(iter, value_type(key, Bson()));
+    }
+    return iter->second;
 }
-const Bson& BsonArray::operator[](size_t i) const
+
+std::pair< BsonMap::iterator, bool > BsonMap::insert(const value_type& item)
 {
-    if (i >= m_value.size())
-        return static_null();
-    else
-        return m_value[i];
+    iterator iter = lower_bound(item.first);
+    if (iter != m_items.end() && iter->first == item.first) {
+        return std::make_pair(iter, false);
+    }
+    return std::make_pair(m_items.insert(iter, item), true);
 }
 
-/* * * * * * * * * * * * * * * * * * * *
- * Comparison
- */
-
-bool Bson::operator==(const Bson& other) const
+size_t BsonMap::erase(const string& key)
 {
-    if (m_ptr == other.m_ptr)
-        return true;
-    if (m_ptr->type() != other.m_ptr->type())
-        return false;
-
-    return m_ptr->equals(other.m_ptr.get());
+    iterator iter = find(key);
+    if (iter == m_items.end()) {
+        return 0;
+    }
+    m_items.erase(iter);
+    return 1;
 }
 
-bool Bson::operator<(const Bson& other) const
+Bson BsonObjectBuilder::build()
 {
-    if (m_ptr == other.m_ptr)
-        return false;
-    if (m_ptr->type() != other.m_ptr->type())
-        return m_ptr->type() < other.m_ptr->type();
+    BsonMap result;
+    result.m_items.swap(m_items);
 
-    return m_ptr->less(other.m_ptr.get());
+    std::vector< BsonMap::value_type >& items = result.m_items;
+    if (!std::is_sorted(items.begin(), items.end(), KeyLess())) {
+        // 稳定排序保证同名key的先后，去重时保留最后一次
+        std::stable_sort(items.begin(), items.end(), KeyLess());
+    }
+    size_t out = 0;
+    for (size_t i = 0; i < items.size(); i++) {
+        if (out > 0 && items[out - 1].first == items[i].first) {
+            items[out - 1].second = std::move(items[i].second);
+            continue;
+        }
+        if (out != i) {
+            items[out] = std::move(items[i]);
+        }
+        out++;
+    }
+    items.erase(items.begin() + out, items.end());
+    return Bson(std::move(result));
 }
 
 /* * * * * * * * * * * * * * * * * * * *
@@ -544,7 +576,9 @@ static inline bool in_range(long x, long lower, long upper)
 struct BsonParser {
     /* State
      */
-    const string& str;
+    // 输入必须以'\0'结尾，部分判断依赖str[size]读到0
+    const char* str;
+    size_t size;
     size_t i;
     string& err;
     bool failed;
@@ -587,23 +621,23 @@ struct BsonParser {
         bool comment_found = false;
         if (str[i] == '/') {
             i++;
-            if (i == str.size())
+            if (i == size)
                 return fail("unexpected end of input after start of comment", false);
             if (str[i] == '/') {  // inline comment
                 i++;
                 // advance until next line, or end of input
-                while (i < str.size() && str[i] != '\n') {
+                while (i < size && str[i] != '\n') {
                     i++;
                 }
                 comment_found = true;
             } else if (str[i] == '*') {  // multiline comment
                 i++;
-                if (i > str.size() - 2)
+                if (i > size - 2)
                     return fail("unexpected end of input inside multi-line comment", false);
                 // advance until closing tokens
                 while (!(str[i] == '*' && str[i + 1] == '/')) {
                     i++;
-                    if (i > str.size() - 2)
+                    if (i > size - 2)
                         return fail(
                                 "unexpected end of input inside multi-line comment", false);
                 }
@@ -643,7 +677,7 @@ struct BsonParser {
         consume_garbage();
         if (failed)
             return (char)0;
-        if (i == str.size())
+        if (i == size)
             return fail("unexpected end of input", (char)0);
 
         return str[i++];
@@ -684,7 +718,21 @@ struct BsonParser {
         string out;
         long last_escaped_codepoint = -1;
         while (true) {
-            if (i == str.size())
+            // 不需要处理的字符成段拷贝
+            size_t start = i;
+            while (i < size) {
+                uint8_t c = static_cast< uint8_t >(str[i]);
+                if (c == '"' || c == '\\' || c < 0x20)
+                    break;
+                i++;
+            }
+            if (i > start) {
+                encode_utf8(last_escaped_codepoint, out);
+                last_escaped_codepoint = -1;
+                out.append(str + start, i - start);
+            }
+
+            if (i == size)
                 return fail("unexpected end of input in string", "");
 
             char ch = str[i++];
@@ -697,36 +745,29 @@ struct BsonParser {
             if (in_range(ch, 0, 0x1f))
                 return fail("unescaped " + esc(ch) + " in string", "");
 
-            // The usual case: non-escaped characters
-            if (ch != '\\') {
-                encode_utf8(last_escaped_codepoint, out);
-                last_escaped_codepoint = -1;
-                out += ch;
-                continue;
-            }
-
             // Handle escapes
-            if (i == str.size())
+            if (i == size)
                 return fail("unexpected end of input in string", "");
 
             ch = str[i++];
 
             if (ch == 'u') {
                 // Extract 4-byte escape sequence
-                string esc = str.substr(i, 4);
-                // Explicitly check length of the substring. The following loop
-                // relies on std::string returning the terminating NUL when
-                // accessing str[length]. Checking here reduces brittleness.
-                if (esc.length() < 4) {
-                    return fail("bad \\u escape: " + esc, "");
-                }
+                long codepoint = 0;
                 for (size_t j = 0; j < 4; j++) {
-                    if (!in_range(esc[j], 'a', 'f') && !in_range(esc[j], 'A', 'F') && !in_range(esc[j], '0', '9'))
-                        return fail("bad \\u escape: " + esc, "");
+                    char h = i + j < size ? str[i + j] : 0;
+                    int digit;
+                    if (in_range(h, '0', '9'))
+                        digit = h - '0';
+                    else if (in_range(h, 'a', 'f'))
+                        digit = h - 'a' + 10;
+                    else if (in_range(h, 'A', 'F'))
+                        digit = h - 'A' + 10;
+                    else
+                        return fail("bad \\u escape: " + string(str + i, std::min< size_t >(4, size - i)), "");
+                    codepoint = (codepoint << 4) | digit;
                 }
 
-                long codepoint = strtol(esc.data(), NULL, 16);
-
                 // JSON specifies that characters outside the BMP shall be encoded as a pair
                 // of 4-hex-digit \u escapes encoding their surrogate pair components. Check
                 // whether we're in the middle of such a beast: the previous codepoint was an
@@ -790,8 +831,16 @@ struct BsonParser {
             return fail("invalid " + esc(str[i]) + " in number");
         }
 
+        // 不超过9个字符（含符号）的整数不会溢出int，边扫描边累加，不再走atoi
         if (str[i] != '.' && str[i] != 'e' && str[i] != 'E' && (i - start_pos) <= static_cast< size_t >(std::numeric_limits< int >::digits10)) {
-            return std::atoi(str.c_str() + start_pos);
+            size_t k = start_pos;
+            bool negative = str[k] == '-';
+            if (negative)
+                k++;
+            int value = 0;
+            for (; k < i; k++)
+                value = value * 10 + (str[k] - '0');
+            return negative ? -value : value;
         }
 
         // Decimal part
@@ -818,7 +867,7 @@ struct BsonParser {
                 i++;
         }
 
-        return std::strtod(str.c_str() + start_pos, NULL);
+        return std::strtod(str + start_pos, NULL);
     }
 
     /* expect(str, res)
@@ -826,15 +875,16 @@ struct BsonParser {
      * Expect that 'str' starts at the character that was just read. If it does, advance
      * the input and return res. If not, flag an error.
      */
-    Bson expect(const string& expected, Bson res)
+    Bson expect(const char* expected, Bson res)
     {
         assert(i != 0);
         i--;
-        if (str.compare(i, expected.length(), expected) == 0) {
-            i += expected.length();
+        size_t len = strlen(expected);
+        if (size - i >= len && memcmp(str + i, expected, len) == 0) {
+            i += len;
             return res;
         } else {
-            return fail("parse error: expected " + expected + ", got " + str.substr(i, expected.length()));
+            return fail("parse error: expected " + string(expected) + ", got " + string(str + i, std::min(len, size - i)));
         }
     }
 
@@ -870,10 +920,10 @@ struct BsonParser {
             return parse_string();
 
         if (ch == '{') {
-            map< string, Bson > data;
+            BsonObjectBuilder data;
             ch = get_next_token();
             if (ch == '}')
-                return data;
+                return data.build();
 
             while (1) {
                 if (ch != '"')
@@ -887,7 +937,8 @@ struct BsonParser {
                 if (ch != ':')
                     return fail("expected ':' in object, got " + esc(ch));
 
-                data[/*std::move(key)*/ key] = parse_json(depth + 1);
+                Bson value = parse_json(depth + 1);
+                data.add(std::move(key), std::move(value));
                 if (failed)
                     return Bson();
 
@@ -899,14 +950,14 @@ struct BsonParser {
 
                 ch = get_next_token();
             }
-            return data;
+            return data.build();
         }
 
         if (ch == '[') {
             vector< Bson > data;
             ch = get_next_token();
             if (ch == ']')
-                return data;
+                return Bson(std::move(data));
 
             while (1) {
                 i--;
@@ -923,7 +974,7 @@ struct BsonParser {
                 ch = get_next_token();
                 (void)ch;
             }
-            return data;
+            return Bson(std::move(data));
         }
 
         return fail("expected value, got " + esc(ch));
@@ -931,28 +982,42 @@ struct BsonParser {
 };
 // }  // namespace
 
-Bson Bson::parse(const string& in, string& err, BsonParse strategy)
+static Bson parse_buffer(const char* in, size_t size, string& err, BsonParse strategy)
 {
-    BsonParser parser = {in, 0, err, false, strategy};
+    BsonParser parser = {in, size, 0, err, false, strategy};
     Bson result = parser.parse_json(0);
 
     // Check for any trailing garbage
     parser.consume_garbage();
     if (parser.failed)
         return Bson();
-    if (parser.i != in.size())
+    if (parser.i != size)
         return parser.fail("unexpected trailing " + esc(in[parser.i]));
 
     return result;
 }
 
+Bson Bson::parse(const string& in, string& err, BsonParse strategy)
+{
+    return parse_buffer(in.c_str(), in.size(), err, strategy);
+}
+
+Bson Bson::parse(const char* in, string& err, BsonParse strategy)
+{
+    if (!in) {
+        err = "null input";
+        return Bson();
+    }
+    return parse_buffer(in, strlen(in), err, strategy);
+}
+
 // Documented in json11.hpp
 vector< Bson > Bson::parse_multi(const string& in,
                                  std::string::size_type& parser_stop_pos,
                                  string& err,
                                  BsonParse strategy)
 {
-    BsonParser parser = {in, 0, err, false, strategy};
+    BsonParser parser = {in.c_str(), in.size(), 0, err, false, strategy};
     parser_stop_pos = 0;
     vector< Bson > json_vec;
     while (parser.i != in.size() && !parser.failed) {
@@ -989,4 +1054,5 @@ vector< Bson > Bson::parse_multi(const string& in,
 //    return true;
 //}
 
+}  // inline namespace bson_flat
 }  // namespace JQUTIL_NS
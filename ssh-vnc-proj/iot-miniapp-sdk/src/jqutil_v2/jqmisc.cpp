@@ -1,9 +1,12 @@
 #include "jqutil_v2/jqmisc.h"
 #include "jqutil_v2/jqbson.h"
 #include "jqutil_v2/JQRefCpp.h"
+#include "jqutil_v2/JQShapeCache.h"
 #include "utils/log.h"
+#include "utils/Mutex.h"
 #include "utils/REF.h"
 #include <string.h>
+#include <map>
 #include <string>
 #include <stdarg.h>
 #include <stdio.h>
@@ -150,7 +153,7 @@ JSValue jq_bind_obj_func(JSContext *ctx, JSValueConst obj, const std::string &fu
     return result;
 }
 
-JSValue _deserializeJson(JSContext *ctx, const Bson& obj)
+JSValue _deserializeJson(JSContext *ctx, const Bson& obj, JQShapeCache *shapes)
 {
     if (obj.is_null()) {
         return JS_NULL;
@@ -161,18 +164,36 @@ JSValue _deserializeJson(JSContext *ctx, const Bson& obj)
     } else if (obj.is_bool()) {
         return JS_NewBool(ctx, obj.bool_value());
     } else if (obj.is_string()) {
-        return JS_NewString(ctx, obj.string_value().c_str());
+        const std::string &str = obj.string_value();
+        return JS_NewStringLen(ctx, str.data(), str.size());
     } else if (obj.is_array()) {
         JSValue jarr = JS_NewArray(ctx);
         int idx = 0;
         for (auto &item: obj.array_items()) {
-            JS_SetPropertyUint32(ctx, jarr, idx++, _deserializeJson(ctx, item));
+            JS_SetPropertyUint32(ctx, jarr, idx++, _deserializeJson(ctx, item, shapes));
         }
         return jarr;
     } else if (obj.is_object()) {
+        // 按atom直接定义属性，与JSON.parse一致，不走原型链上的setter
+        const Bson::object &items = obj.object_items();
         JSValue jobj = JS_NewObject(ctx);
-        for (auto &iter: obj.object_items()) {
-            JS_SetPropertyStr(ctx, jobj, iter.first.c_str(), _deserializeJson(ctx, iter.second));
+        if (shapes && items.size() <= JQ_SHAPE_MAX_KEYS) {
+            // 子值先转换完再取本层atom，避免子对象的查找把本层布局挤出缓存
+            JSValue vals[JQ_SHAPE_MAX_KEYS];
+            size_t n = 0;
+            for (auto &iter: items) {
+                vals[n++] = _deserializeJson(ctx, iter.second, shapes);
+            }
+            const JSAtom *atoms = n > 0 ? shapes->lookup(ctx, items) : NULL;
+            for (size_t i = 0; i < n; i++) {
+                JS_DefinePropertyValue(ctx, jobj, atoms[i], vals[i], JS_PROP_C_W_E);
+            }
+            return jobj;
+        }
+        for (auto &iter: items) {
+            JSAtom atom = JS_NewAtomLen(ctx, iter.first.data(), iter.first.size());
+            JS_DefinePropertyValue(ctx, jobj, atom, _deserializeJson(ctx, iter.second, shapes), JS_PROP_C_W_E);
+            JS_FreeAtom(ctx, atom);
         }
         return jobj;
     } else if (obj.is_binary()) {
@@ -185,99 +206,120 @@ JSValue _deserializeJson(JSContext *ctx, const Bson& obj)
 
 JSValue bsonToJSValue(JSContext *ctx, const Bson& json)
 {
-    return _deserializeJson(ctx, json);
+    return _deserializeJson(ctx, json, NULL);
 }
 
-Bson _serializeJson(JSContext *ctx, JSValueConst value)
+JSValue bsonToJSValue(JSContext *ctx, const Bson& json, JQShapeCache *shapes)
+{
+    return _deserializeJson(ctx, json, shapes);
+}
+
+// 嵌套层数上限，循环引用或过深的对象在这里截断，不会把JS线程的栈打爆
+#define JQ_BSON_MAX_DEPTH 64
+// 数组元素个数上限，稀疏数组的length可能很大
+#define JQ_BSON_MAX_ARRAY_LENGTH (1 << 20)
+
+static Bson _serializeJson(JSContext *ctx, JSValueConst value, int depth)
 {
     if (JS_VALUE_GET_TAG(value) == JS_TAG_INT) {
-        int32_t val = 0;
-        JS_ToInt32(ctx, &val, value);
-        return Bson(val);
+        return Bson(JS_VALUE_GET_INT(value));
     } else if (JS_TAG_IS_FLOAT64(JS_VALUE_GET_TAG(value))) {
-        double val = 0;
-        JS_ToFloat64(ctx, &val, value);
-        return Bson(val);
+        return Bson(JS_VALUE_GET_FLOAT64(value));
     } else if (JS_IsUndefined(value) || JS_IsNull(value)) {
         return Bson();
     } else if (JS_IsBool(value)) {
-        return Bson(JS_ToBool(ctx, value) == 1);
+        return Bson(JS_VALUE_GET_BOOL(value) != 0);
     } else if (JS_IsString(value)) {
         size_t plen;
         const char* cstr = JS_ToCStringLen(ctx, &plen, value);
         Bson result(std::string(cstr, plen));
         JS_FreeCString(ctx, cstr);
         return result;
-    } else if (JQ_IsABOrABView(ctx, value)) {
-        size_t byteLength;
-        JSValue ab = JQ_ToArrayBuffer(ctx, value);
-        const uint8_t* buf = JS_GetArrayBuffer(ctx, &byteLength, ab);
-        Bson::binary bin;
-        if (buf) {
-            bin.resize(byteLength);
-            memcpy(bin.data(), buf, byteLength);
-        }
-        JS_FreeValue(ctx, ab);
-        return bin;
-    } else if (JS_IsArray(ctx, value)) {
-        // array
+    } else if (!JS_IsObject(value)) {
+        return Bson();
+    }
+
+    if (depth >= JQ_BSON_MAX_DEPTH) {
+        LOGE("JSValueToBson exceeds max depth %d, may be circular, truncated", JQ_BSON_MAX_DEPTH);
+        return Bson();
+    }
+
+    if (JS_IsArray(ctx, value) > 0) {
         Bson::array result;
 
         uint32_t len = 0;
-        JSValue len0 = JS_GetPropertyStr(ctx, value, "length");
+        JSValue len0 = JS_GetProperty(ctx, value, jq_ctx_cache(ctx)->atomLength);
         JS_ToUint32(ctx, &len, len0);
         JS_FreeValue(ctx, len0);
+        if (len > JQ_BSON_MAX_ARRAY_LENGTH) {
+            LOGE("JSValueToBson array length %u exceeds %d, truncated", len, JQ_BSON_MAX_ARRAY_LENGTH);
+            len = JQ_BSON_MAX_ARRAY_LENGTH;
+        }
 
-        for (unsigned idx=0; idx < len; idx++) {
+        // 稀疏数组的length可能很大，预留有上限；整数下标取值走quickjs内部的快速数组路径，不经过atom
+        result.reserve(len < 1024 ? len : 1024);
+        for (uint32_t idx = 0; idx < len; idx++) {
             JSValue item = JS_GetPropertyUint32(ctx, value, idx);
-            result.push_back(_serializeJson(ctx, item));
+            result.push_back(_serializeJson(ctx, item, depth + 1));
             JS_FreeValue(ctx, item);
         }
 
-        return result;
-    } else if (JS_IsObject(value)) {
-        Bson::object result;
-        uint32_t len, i;
-        JSPropertyEnum *tab;
-        const char *key;
-        JSValue val;
-
-        if (JS_GetOwnPropertyNames(ctx, &tab, &len, value,
-                JS_GPN_STRING_MASK | JS_GPN_ENUM_ONLY) < 0) {
-            return false;
+        return Bson(std::move(result));
+    }
+
+    // 二进制直接从视图覆盖的那段内存拷一次，不经过JS辅助函数，也不会拷整个底层buffer
+    uint8_t *bufferData = NULL;
+    size_t byteOffset = 0, byteLength = 0;
+    JSValue ab = JQ_BorrowArrayBuffer(ctx, value, &bufferData, &byteOffset, &byteLength);
+    if (!JS_IsUndefined(ab)) {
+        Bson::binary bin;
+        if (bufferData) {
+            bin.assign(bufferData + byteOffset, bufferData + byteOffset + byteLength);
         }
+        JS_FreeValue(ctx, ab);
+        return Bson(std::move(bin));
+    }
 
-        for(i = 0; i < len; i++) {
-            key = JS_AtomToCString(ctx, tab[i].atom);
-            if (!key) {
-                continue;
-            }
+    BsonObjectBuilder result;
+    uint32_t len, i;
+    JSPropertyEnum *tab;
+    const char *key;
+    JSValue val;
 
-            val = JS_GetProperty(ctx, value, tab[i].atom);
-            if (JS_IsException(val)) {
-                JS_FreeCString(ctx, key);
-                continue;
-            }
+    if (JS_GetOwnPropertyNames(ctx, &tab, &len, value,
+            JS_GPN_STRING_MASK | JS_GPN_ENUM_ONLY) < 0) {
+        return false;
+    }
 
-            result[key] = _serializeJson(ctx, val);
+    result.reserve(len);
+    for(i = 0; i < len; i++) {
+        key = JS_AtomToCString(ctx, tab[i].atom);
+        if (!key) {
+            continue;
+        }
 
-            JS_FreeValue(ctx, val);
+        val = JS_GetProperty(ctx, value, tab[i].atom);
+        if (JS_IsException(val)) {
             JS_FreeCString(ctx, key);
+            continue;
         }
 
-        for(i = 0; i < len; i++)
-            JS_FreeAtom(ctx, tab[i].atom);
-        js_free(ctx, tab);
+        result.add(key, _serializeJson(ctx, val, depth + 1));
 
-        return result;
-    } else {
-        return Bson();
+        JS_FreeValue(ctx, val);
+        JS_FreeCString(ctx, key);
     }
+
+    for(i = 0; i < len; i++)
+        JS_FreeAtom(ctx, tab[i].atom);
+    js_free(ctx, tab);
+
+    return result.build();
 }
 
 Bson JSValueToBson(JSContext *ctx, JSValueConst val)
 {
-    return _serializeJson(ctx, val);
+    return _serializeJson(ctx, val, 0);
 }
 
 JSValue mapToJSValue(JSContext* ctx, const std::map<std::string, std::string> &map)
@@ -312,21 +354,117 @@ JSValue getOrCreateFunc(JSContext *ctx, const char* funcName, const char* funcCo
 
 bool JQ_IsABOrABView(JSContext *ctx, JSValueConst val)
 {
-    // isView is true, when object is typedarray and dataview, then checking the ArrayBuffer type
-    static const char* funcCode = \
-"function(obj){return ArrayBuffer.isView(obj) || obj instanceof ArrayBuffer;}";
-    JSValue func = getOrCreateFunc(ctx, "IsABOrABView", funcCode);
-    if (JS_IsException(func)) {
+    uint8_t *bufferData;
+    size_t byteOffset, byteLength;
+    JSValue ab = JQ_BorrowArrayBuffer(ctx, val, &bufferData, &byteOffset, &byteLength);
+    bool result = !JS_IsUndefined(ab);
+    JS_FreeValue(ctx, ab);
+    return result;
+}
+
+static inline void _clearException(JSContext *ctx)
+{
+    JS_FreeValue(ctx, JS_GetException(ctx));
+}
+
+// val instanceof ctor，ctor被改写成非函数等出错时按false处理
+static bool _isInstanceOf(JSContext *ctx, JSValueConst val, JSValueConst ctor)
+{
+    int ret = JS_IsInstanceOf(ctx, val, ctor);
+    if (ret < 0) {
+        _clearException(ctx);
         return false;
     }
-    JSValue ret = JS_Call(ctx, func, JS_UNDEFINED, 1, &val);
-    JS_FreeValue(ctx, func);
-    if (JS_IsException(ret)) {
-        jq_dump_error(ctx);
-        return false;
+    return ret > 0;
+}
+
+static size_t _toSize(JSContext *ctx, JSValueConst obj, JSAtom atom)
+{
+    JSValue v = JS_GetProperty(ctx, obj, atom);
+    uint32_t n = 0;
+    if (JS_IsException(v) || JS_ToUint32(ctx, &n, v) < 0) {
+        _clearException(ctx);
+        n = 0;
+    }
+    JS_FreeValue(ctx, v);
+    return n;
+}
+
+JSValue JQ_BorrowArrayBuffer(JSContext *ctx, JSValueConst val, uint8_t **bufferData,
+                             size_t *byteOffset, size_t *byteLength, size_t *bytesPerElement/*=NULL*/)
+{
+    size_t bpe = 1;
+    *bufferData = NULL;
+    *byteOffset = 0;
+    *byteLength = 0;
+    if (!JS_IsObject(val) || JS_IsFunction(ctx, val)) {
+        return JS_UNDEFINED;
+    }
+
+    JQCtxCache *cache = jq_ctx_cache(ctx);
+    JSValue globalObject = JS_GetGlobalObject(ctx);
+    JSValue result = JS_UNDEFINED;
+    size_t bufferSize = 0;
+
+    JSValue ctor = JS_GetProperty(ctx, globalObject, cache->atomArrayBuffer);
+    if (_isInstanceOf(ctx, val, ctor)) {
+        *bufferData = JS_GetArrayBuffer(ctx, &bufferSize, val);
+        if (*bufferData) {
+            *byteLength = bufferSize;
+            result = JS_DupValue(ctx, val);
+        } else {
+            // 已detach，或只是原型链上挂了ArrayBuffer.prototype
+            _clearException(ctx);
+        }
+    } else {
+        // 所有TypedArray的公共基类%TypedArray%不在全局对象上，从Uint8Array的原型取
+        JSValue u8Ctor = JS_GetProperty(ctx, globalObject, cache->atomUint8Array);
+        JSValue typedArrayCtor = JS_GetProperty(ctx, u8Ctor, cache->atomProto);
+        JS_FreeValue(ctx, u8Ctor);
+        if (_isInstanceOf(ctx, val, typedArrayCtor)) {
+            result = JS_GetTypedArrayBuffer(ctx, val, byteOffset, byteLength, &bpe);
+            if (JS_IsException(result)) {
+                _clearException(ctx);
+                result = JS_UNDEFINED;
+                *byteOffset = 0;
+                *byteLength = 0;
+                bpe = 1;
+            }
+        } else {
+            JS_FreeValue(ctx, ctor);
+            ctor = JS_GetProperty(ctx, globalObject, cache->atomDataView);
+            if (_isInstanceOf(ctx, val, ctor)) {
+                result = JS_GetProperty(ctx, val, cache->atomBuffer);
+                if (JS_IsException(result)) {
+                    _clearException(ctx);
+                    result = JS_UNDEFINED;
+                } else {
+                    *byteOffset = _toSize(ctx, val, cache->atomByteOffset);
+                    *byteLength = _toSize(ctx, val, cache->atomByteLength);
+                }
+            }
+        }
+        JS_FreeValue(ctx, typedArrayCtor);
+
+        if (!JS_IsUndefined(result)) {
+            *bufferData = JS_GetArrayBuffer(ctx, &bufferSize, result);
+            if (!*bufferData || *byteOffset + *byteLength > bufferSize) {
+                // 底层buffer已detach
+                if (!*bufferData) {
+                    _clearException(ctx);
+                }
+                *bufferData = NULL;
+                *byteOffset = 0;
+                *byteLength = 0;
+            }
+        }
+    }
+    JS_FreeValue(ctx, ctor);
+    JS_FreeValue(ctx, globalObject);
+
+    if (bytesPerElement) {
+        *bytesPerElement = bpe;
     }
-    bool result = 1 == JS_ToBool(ctx, ret);
-    JS_FreeValue(ctx, ret);
     return result;
 }
 
@@ -350,23 +488,9 @@ JSValue JQ_NewUint8Array(JSContext *ctx, JSValueConst arg0, JSValueConst arg1/*=
 
 JSValue JQ_ToArrayBuffer(JSContext *ctx, JSValueConst value)
 {
-    static const char* funcCode = \
-"function(obj){"
-"if (ArrayBuffer.isView(obj)) return obj.buffer;"
-"else if (obj instanceof ArrayBuffer) return obj;"
-"else return undefined;"
-"}";
-    JSValue func = getOrCreateFunc(ctx, "ToArrayBuffer", funcCode);
-    if (JS_IsException(func)) {
-        return func;
-    }
-    JSValue ret = JS_Call(ctx, func, JS_UNDEFINED, 1, &value);
-    JS_FreeValue(ctx, func);
-    if (JS_IsException(ret)) {
-        jq_dump_error(ctx);
-        return ret;
-    }
-    return ret;
+    uint8_t *bufferData;
+    size_t byteOffset, byteLength;
+    return JQ_BorrowArrayBuffer(ctx, value, &bufferData, &byteOffset, &byteLength);
 }
 
 JQStdFuncTask::JQStdFuncTask(std::function<void()> func)
@@ -383,6 +507,20 @@ void JQStdFuncTask::run()
     }
 }
 
+JQUniqueFuncTask::JQUniqueFuncTask(JQuick::UniqueClosure func)
+        :_func(std::move(func))
+{}
+
+JQUniqueFuncTask::~JQUniqueFuncTask()
+{}
+
+void JQUniqueFuncTask::run()
+{
+    if (!_func.isNull()) {
+        _func();
+    }
+}
+
 int jq_vsnprintf(char *outBuf, size_t size, const char* format, va_list ap)
 {
 #ifdef _WIN32
@@ -440,26 +578,115 @@ CtxHolder::~CtxHolder()
 
 JQuick::wp<CtxHolder> getOrCreateCtxHolder(JSContext *ctx)
 {
-    JSValue globalObject = JS_GetGlobalObject(ctx);
-    static std::string nameStr = jq_printf("__jq_ctxWp_%p", &getOrCreateCtxHolder).c_str();
-    JSAtom nameAtom = JS_NewAtomLen(ctx, nameStr.c_str(), nameStr.size());
-    JQuick::sp<CtxHolder> ctxHolder;
+    return jq_ctx_cache(ctx)->holder;
+}
 
-    JSValue holderObj = JS_GetProperty(ctx, globalObject, nameAtom);
-    ctxHolder = JQUnwrapRefSimple<CtxHolder>(holderObj);
-    if (ctxHolder == NULL) {
-        // else create/set the pointer and return
-        ctxHolder = new CtxHolder(ctx);
-        JS_DefinePropertyValue(ctx, globalObject, nameAtom,
-                               JQRefCppSimple::NewJSValue(ctx, ctxHolder.get()), 0);
+// == JQCtxCache START ==
+// 按ctx查缓存的侧表；context的opaque留给宿主，这里不占用
+static JQuick::Mutex s_ctxCacheLock;
+static std::map<JSContext*, JQCtxCache*> s_ctxCaches;
+// 每个JS线程通常只有一个context，上次命中的直接返回，不加锁
+static thread_local JQCtxCache* t_lastCtxCache = NULL;
+static JSClassID g_JQCtxCache_classid = 0;
+
+static void __jq_ctx_cache_finalizer(JSRuntime *rt, JSValue v)
+{
+    JQCtxCache *cache = (JQCtxCache*)JS_GetOpaque(v, g_JQCtxCache_classid);
+    if (!cache) {
+        return;
+    }
+    JS_SetOpaque(v, NULL);
+    {
+        JQuick::Mutex::Autolock l(s_ctxCacheLock);
+        std::map<JSContext*, JQCtxCache*>::iterator iter = s_ctxCaches.find(cache->ctx);
+        if (iter != s_ctxCaches.end() && iter->second == cache) {
+            s_ctxCaches.erase(iter);
+        }
+    }
+    if (t_lastCtxCache == cache) {
+        t_lastCtxCache = NULL;
     }
 
-    JS_FreeValue(ctx, holderObj);
-    JS_FreeAtom(ctx, nameAtom);
+    JSAtom atoms[] = {
+        cache->atomLength, cache->atomThen, cache->atomCode, cache->atomData, cache->atomMsg,
+        cache->atomName, cache->atomMessage, cache->atomStack, cache->atomTip, cache->atomRes,
+        cache->atomArrayBuffer, cache->atomDataView, cache->atomUint8Array, cache->atomProto,
+        cache->atomBuffer, cache->atomByteOffset, cache->atomByteLength, cache->atomAsyncCbMap,
+    };
+    for (size_t i = 0; i < countof(atoms); i++) {
+        JS_FreeAtomRT(rt, atoms[i]);
+    }
+    // holder随之释放，JQAsyncExecutor里的弱引用之后promote失败
+    delete cache;
+}
+
+static JQCtxCache* _createCtxCache(JSContext *ctx)
+{
+    if (g_JQCtxCache_classid == 0 || !JS_IsRegisteredClass(JS_GetRuntime(ctx), g_JQCtxCache_classid)) {
+        JSClassDef ClassDef = {
+                "JQCtxCache",
+                .finalizer = __jq_ctx_cache_finalizer,
+        };
+        JS_NewClassID(&g_JQCtxCache_classid);
+        JS_NewClass(JS_GetRuntime(ctx), g_JQCtxCache_classid, &ClassDef);
+    }
+
+    JQCtxCache *cache = new JQCtxCache();
+    cache->ctx = ctx;
+    cache->holder = new CtxHolder(ctx);
+    cache->atomLength = JS_NewAtom(ctx, "length");
+    cache->atomThen = JS_NewAtom(ctx, "then");
+    cache->atomCode = JS_NewAtom(ctx, "code");
+    cache->atomData = JS_NewAtom(ctx, "data");
+    cache->atomMsg = JS_NewAtom(ctx, "msg");
+    cache->atomName = JS_NewAtom(ctx, "name");
+    cache->atomMessage = JS_NewAtom(ctx, "message");
+    cache->atomStack = JS_NewAtom(ctx, "stack");
+    cache->atomTip = JS_NewAtom(ctx, "tip");
+    cache->atomRes = JS_NewAtom(ctx, "res");
+    cache->atomArrayBuffer = JS_NewAtom(ctx, "ArrayBuffer");
+    cache->atomDataView = JS_NewAtom(ctx, "DataView");
+    cache->atomUint8Array = JS_NewAtom(ctx, "Uint8Array");
+    cache->atomProto = JS_NewAtom(ctx, "__proto__");
+    cache->atomBuffer = JS_NewAtom(ctx, "buffer");
+    cache->atomByteOffset = JS_NewAtom(ctx, "byteOffset");
+    cache->atomByteLength = JS_NewAtom(ctx, "byteLength");
+    // 多个动态库各有一份代码，key要带库标识
+    std::string cbMapName = jq_printf("__jq_AE_cbMap_%p", &_createCtxCache);
+    cache->atomAsyncCbMap = JS_NewAtomLen(ctx, cbMapName.c_str(), cbMapName.size());
+
+    // 挂到全局对象上，全局对象回收时finalizer释放缓存
+    std::string nameStr = jq_printf("__jq_ctxCache_%p", &_createCtxCache);
+    JSValue cacheObj = JS_NewObjectClass(ctx, g_JQCtxCache_classid);
+    JS_SetOpaque(cacheObj, cache);
+    JSValue globalObject = JS_GetGlobalObject(ctx);
+    JS_DefinePropertyValueStr(ctx, globalObject, nameStr.c_str(), cacheObj, 0);
     JS_FreeValue(ctx, globalObject);
+    return cache;
+}
+
+// run js thread
+JQCtxCache* jq_ctx_cache(JSContext *ctx)
+{
+    JQCtxCache *cache = t_lastCtxCache;
+    if (cache != NULL && cache->ctx == ctx) {
+        return cache;
+    }
 
-    return ctxHolder;
+    {
+        JQuick::Mutex::Autolock l(s_ctxCacheLock);
+        std::map<JSContext*, JQCtxCache*>::iterator iter = s_ctxCaches.find(ctx);
+        cache = iter != s_ctxCaches.end() ? iter->second : NULL;
+    }
+    if (cache == NULL) {
+        cache = _createCtxCache(ctx);
+        JQuick::Mutex::Autolock l(s_ctxCacheLock);
+        s_ctxCaches[ctx] = cache;
+    }
+    t_lastCtxCache = cache;
+    return cache;
 }
+// == JQCtxCache END ==
 
 class GetSetHolder: public JQuick::REF_BASE {
 public:
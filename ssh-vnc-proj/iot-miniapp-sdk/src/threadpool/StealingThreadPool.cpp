@@ -0,0 +1,915 @@
+#include "threadpool/StealingThreadPool.h"
+#include "looper/Thread.h"
+#include "port/jquick_time.h"
+#include <sched.h>
+#include <vector>
+
+// 每个worker队列的初始容量（2的幂），满了翻倍
+#define STEALING_DEQUE_INIT 256
+// 组表两级：256块 x 256项，块按需分配；超过STEALING_SOFT_GROUPS后先回收空闲组，没有空闲的才继续扩
+#define GROUP_CHUNK_SHIFT 8
+#define GROUP_CHUNK_SIZE (1 << GROUP_CHUNK_SHIFT)
+#define GROUP_CHUNKS 256
+#define STEALING_SOFT_GROUPS 1024
+// 回收中的组pending先置成这个值，无锁查表命中该组的提交方据此放弃
+#define GROUP_RECYCLING (-(1 << 30))
+// 驻留表初始槽数（2的幂），已用槽（含删除标记）超过一半时重建
+#define GROUP_TABLE_INIT 64
+#define GROUP_SLOT_EMPTY (-1)
+#define GROUP_SLOT_DELETED (-2)
+// 动态线程空闲多久退出
+#define STEALING_IDLE_EXIT_MS 10000
+// 找不到任务时先让出几轮CPU再睡，突发提交时不用每次都走唤醒
+#define STEALING_SPIN 32
+// 线程本地节点缓存上限，超出后批量还给全局池
+#define NODE_CACHE_MAX 256
+#define NODE_BATCH 64
+#define NODE_GLOBAL_MAX 4096
+
+namespace JQuick
+{
+enum {
+    NODE_PENDING = 0,
+    NODE_RUNNING,
+    NODE_CANCELLED,
+};
+
+struct StealingTaskNode {
+    StealingTaskNode* next;
+    UniqueClosure func;
+    ThreadPoolTask* task;
+    int32_t group;
+    uint32_t epoch;
+    std::atomic< int32_t > state;
+};
+
+struct StealingGroup {
+    // name和hash只在组未发布或回收中（pending为GROUP_RECYCLING）时写，占住组之后读是安全的
+    std::string name;
+    std::atomic< uint32_t > hash;
+    // removeTaskGroup时加一，入队时记下的epoch不一致的任务不再执行
+    std::atomic< uint32_t > epoch;
+    // 已提交未取出的任务数加上internGroup的占用数，非0的组不会被回收
+    std::atomic< int32_t > pending;
+    // internGroup的占用数，持_groupLock读写
+    int32_t pins;
+};
+
+struct StealingGroupTable {
+    int32_t mask;
+    // 非空槽数，含删除标记
+    int32_t used;
+    std::atomic< int32_t >* slots;
+
+    StealingGroupTable(int32_t cap) : mask(cap - 1), used(0), slots(new std::atomic< int32_t >[cap])
+    {
+        for (int32_t i = 0; i < cap; i++) {
+            slots[i].store(GROUP_SLOT_EMPTY, std::memory_order_relaxed);
+        }
+    }
+    ~StealingGroupTable() { delete[] slots; }
+};
+
+static inline uint32_t groupHash(const std::string& groupId)
+{
+    // FNV-1a，groupId都很短
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < groupId.size(); i++) {
+        h = (h ^ (uint8_t)groupId[i]) * 16777619u;
+    }
+    return h;
+}
+
+// ====================== 任务节点池 ======================
+static Mutex s_nodeLock;
+static StealingTaskNode* s_nodeFree = NULL;
+static int32_t s_nodeFreeCount = 0;
+
+struct NodeCache {
+    StealingTaskNode* head;
+    int32_t count;
+
+    NodeCache() : head(NULL), count(0) {}
+    ~NodeCache()
+    {
+        while (head) {
+            StealingTaskNode* n = head;
+            head = n->next;
+            delete n;
+        }
+    }
+};
+static thread_local NodeCache t_nodeCache;
+
+static StealingTaskNode* allocNode()
+{
+    NodeCache& c = t_nodeCache;
+    if (!c.head) {
+        // 提交方通常不是执行方，节点由worker批量归还到全局池，这里一次取一批
+        Mutex::Autolock l(s_nodeLock);
+        for (int32_t i = 0; i < NODE_BATCH && s_nodeFree; i++) {
+            StealingTaskNode* n = s_nodeFree;
+            s_nodeFree = n->next;
+            s_nodeFreeCount--;
+            n->next = c.head;
+            c.head = n;
+            c.count++;
+        }
+    }
+
+    StealingTaskNode* n = c.head;
+    if (n) {
+        c.head = n->next;
+        c.count--;
+    } else {
+        n = new StealingTaskNode();
+    }
+    n->next = NULL;
+    n->task = NULL;
+    n->group = -1;
+    n->epoch = 0;
+    n->state.store(NODE_PENDING, std::memory_order_relaxed);
+    return n;
+}
+
+static void freeNode(StealingTaskNode* n)
+{
+    // 释放闭包捕获的对象，不能等到节点被复用
+    n->func.reset();
+    n->task = NULL;
+
+    NodeCache& c = t_nodeCache;
+    n->next = c.head;
+    c.head = n;
+    c.count++;
+    if (c.count <= NODE_CACHE_MAX) {
+        return;
+    }
+
+    StealingTaskNode* batch = NULL;
+    for (int32_t i = 0; i < NODE_BATCH; i++) {
+        StealingTaskNode* m = c.head;
+        c.head = m->next;
+        c.count--;
+        m->next = batch;
+        batch = m;
+    }
+    Mutex::Autolock l(s_nodeLock);
+    while (batch) {
+        StealingTaskNode* m = batch;
+        batch = m->next;
+        if (s_nodeFreeCount >= NODE_GLOBAL_MAX) {
+            delete m;
+            continue;
+        }
+        m->next = s_nodeFree;
+        s_nodeFree = m;
+        s_nodeFreeCount++;
+    }
+}
+
+// ====================== Chase-Lev双端队列 ======================
+// 只有所属worker调用push/pop（底部），任意线程可以steal（顶部）
+// 参考 Lê et al. "Correct and Efficient Work-Stealing for Weak Memory Models"
+class StealingDeque
+{
+public:
+    struct Array {
+        int64_t mask;
+        std::atomic< StealingTaskNode* >* slots;
+
+        Array(int64_t cap) : mask(cap - 1), slots(new std::atomic< StealingTaskNode* >[cap]) {}
+        ~Array() { delete[] slots; }
+
+        inline StealingTaskNode* get(int64_t i) const { return slots[i & mask].load(std::memory_order_acquire); }
+        inline void put(int64_t i, StealingTaskNode* n) { slots[i & mask].store(n, std::memory_order_release); }
+    };
+
+    StealingDeque() : executed(0), stolen(0), _top(0), _bottom(0), _array(new Array(STEALING_DEQUE_INIT)) {}
+    ~StealingDeque()
+    {
+        delete _array.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < _retired.size(); i++) {
+            delete _retired[i];
+        }
+    }
+
+    void push(StealingTaskNode* n)
+    {
+        int64_t b = _bottom.load(std::memory_order_relaxed);
+        int64_t t = _top.load(std::memory_order_acquire);
+        Array* a = _array.load(std::memory_order_relaxed);
+        if (b - t > a->mask) {
+            a = grow(a, b, t);
+        }
+        a->put(b, n);
+        std::atomic_thread_fence(std::memory_order_release);
+        _bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    StealingTaskNode* pop()
+    {
+        int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+        Array* a = _array.load(std::memory_order_relaxed);
+        _bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = _top.load(std::memory_order_relaxed);
+
+        StealingTaskNode* n = NULL;
+        if (t <= b) {
+            n = a->get(b);
+            if (t == b) {
+                // 只剩最后一个，和steal竞争
+                if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                    n = NULL;
+                }
+                _bottom.store(b + 1, std::memory_order_relaxed);
+            }
+        } else {
+            _bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return n;
+    }
+
+    // 队列空或竞争失败都返回NULL
+    StealingTaskNode* steal()
+    {
+        int64_t t = _top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = _bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return NULL;
+        }
+        Array* a = _array.load(std::memory_order_acquire);
+        StealingTaskNode* n = a->get(t);
+        if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return NULL;
+        }
+        return n;
+    }
+
+    bool empty() const
+    {
+        return _bottom.load(std::memory_order_acquire) <= _top.load(std::memory_order_acquire);
+    }
+
+    // 所属worker写，getStats读，不需要精确
+    std::atomic< uint64_t > executed;
+    std::atomic< uint64_t > stolen;
+
+private:
+    Array* grow(Array* a, int64_t b, int64_t t)
+    {
+        Array* na = new Array((a->mask + 1) * 2);
+        for (int64_t i = t; i < b; i++) {
+            na->put(i, a->get(i));
+        }
+        // 偷取方可能还在读旧数组，延迟到队列销毁时释放
+        _retired.push_back(a);
+        _array.store(na, std::memory_order_release);
+        return na;
+    }
+
+    std::atomic< int64_t > _top;
+    std::atomic< int64_t > _bottom;
+    std::atomic< Array* > _array;
+    std::vector< Array* > _retired;
+};
+
+// ====================== worker ======================
+class StealingWorker : public Thread
+{
+public:
+    StealingWorker(StealingThreadPool* pool, int32_t slot, bool dynamic) :
+            Thread(pool->_poolName + "-" + std::to_string(slot)),
+            _pool(pool),
+            _slot(slot),
+            _dynamic(dynamic)
+    {
+    }
+
+    virtual size_t getStackSize() const
+    {
+        return _pool->_stackSize > 0 ? _pool->_stackSize : Thread::getStackSize();
+    }
+
+    virtual void run()
+    {
+        _pool->workerLoop(this);
+        Thread::run();
+    }
+
+    StealingThreadPool* _pool;
+    int32_t _slot;
+    bool _dynamic;
+};
+
+static thread_local StealingWorker* t_currentWorker = NULL;
+
+// ====================== StealingThreadPool ======================
+inline StealingGroup* StealingThreadPool::groupAt(int32_t id) const
+{
+    return _groupChunks[id >> GROUP_CHUNK_SHIFT].load(std::memory_order_acquire)[id & (GROUP_CHUNK_SIZE - 1)].load(std::memory_order_acquire);
+}
+
+StealingThreadPool::StealingThreadPool(const std::string& poolName, int32_t corePoolSize, int32_t dynamicPoolSize, size_t stackSize) :
+        _poolName(poolName),
+        _corePoolSize(corePoolSize > 0 ? corePoolSize : 1),
+        _maxPoolSize(_corePoolSize + (dynamicPoolSize > 0 ? dynamicPoolSize : 0)),
+        _stackSize(stackSize),
+        _liveWorkers(0),
+        _idleWorkers(0),
+        _shutdown(false),
+        _injectHead(NULL),
+        _injectTail(NULL),
+        _injectCount(0),
+        _sleepers(0),
+        _groupCount(0),
+        _groupCursor(0),
+        _injected(0),
+        _discarded(0)
+{
+    _deques = new StealingDeque[_maxPoolSize];
+    _slotLive = new std::atomic< int32_t >[_maxPoolSize];
+    for (int32_t i = 0; i < _maxPoolSize; i++) {
+        _slotLive[i].store(i < _corePoolSize ? 1 : 0);
+    }
+    _groupTable.store(new StealingGroupTable(GROUP_TABLE_INIT), std::memory_order_relaxed);
+    _groupChunks = new std::atomic< std::atomic< StealingGroup* >* >[GROUP_CHUNKS];
+    for (int32_t i = 0; i < GROUP_CHUNKS; i++) {
+        _groupChunks[i].store(NULL, std::memory_order_relaxed);
+    }
+    for (int32_t i = 0; i < _corePoolSize; i++) {
+        startWorker(i);
+    }
+}
+
+StealingThreadPool::~StealingThreadPool()
+{
+    delete[] _deques;
+    delete[] _slotLive;
+    for (int32_t i = 0; i < _groupCount; i++) {
+        delete groupAt(i);
+    }
+    for (int32_t i = 0; i < GROUP_CHUNKS; i++) {
+        delete[] _groupChunks[i].load(std::memory_order_relaxed);
+    }
+    delete[] _groupChunks;
+    delete _groupTable.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < _retiredTables.size(); i++) {
+        delete _retiredTables[i];
+    }
+}
+
+void StealingThreadPool::execute(ThreadPoolTask* task)
+{
+    if (!task) {
+        return;
+    }
+    if (_shutdown.load()) {
+        task->tryCleanup();
+        return;
+    }
+
+    StealingTaskNode* node = allocNode();
+    node->task = task;
+    if (!task->_groupId.empty()) {
+        node->group = acquireGroup(task->_groupId);
+    }
+    {
+        Mutex::Autolock l(_trackLock);
+        _tracked[task] = node;
+    }
+    submit(node);
+}
+
+void StealingThreadPool::execute(UniqueClosure func)
+{
+    if (func.isNull() || _shutdown.load()) {
+        return;
+    }
+    StealingTaskNode* node = allocNode();
+    node->func = std::move(func);
+    submit(node);
+}
+
+void StealingThreadPool::execute(const std::string& groupId, const std::string& taskName, JQuick::UniqueClosure func)
+{
+    if (func.isNull() || _shutdown.load()) {
+        return;
+    }
+    StealingTaskNode* node = allocNode();
+    node->func = std::move(func);
+    if (!groupId.empty()) {
+        node->group = acquireGroup(groupId);
+    }
+    submit(node);
+}
+
+int32_t StealingThreadPool::internGroup(const std::string& groupId)
+{
+    int32_t id = acquireGroup(groupId);
+    if (id >= 0) {
+        // acquireGroup加的那一次占用留给句柄
+        Mutex::Autolock l(_groupLock);
+        groupAt(id)->pins++;
+    }
+    return id;
+}
+
+void StealingThreadPool::releaseGroup(int32_t group)
+{
+    if (group < 0) {
+        return;
+    }
+    StealingGroup* g = groupAt(group);
+    {
+        Mutex::Autolock l(_groupLock);
+        g->pins--;
+    }
+    g->pending--;
+}
+
+void StealingThreadPool::execute(int32_t group, JQuick::UniqueClosure func)
+{
+    if (func.isNull() || _shutdown.load()) {
+        return;
+    }
+    StealingTaskNode* node = allocNode();
+    node->func = std::move(func);
+    if (group >= 0) {
+        // 句柄占着组，不会回收，不用核对
+        groupAt(group)->pending.fetch_add(1);
+        node->group = group;
+    }
+    submit(node);
+}
+
+bool StealingThreadPool::removeTask(ThreadPoolTask* task)
+{
+    Mutex::Autolock l(_trackLock);
+    std::map< ThreadPoolTask*, StealingTaskNode* >::iterator it = _tracked.find(task);
+    if (it == _tracked.end()) {
+        return false;
+    }
+    // 节点留在队列里，被取出时发现已取消再释放
+    int32_t expect = NODE_PENDING;
+    bool removed = it->second->state.compare_exchange_strong(expect, NODE_CANCELLED);
+    _tracked.erase(it);
+    return removed;
+}
+
+int32_t StealingThreadPool::removeTaskGroup(const std::string& groupId)
+{
+    // 持锁期间槽位不会被回收给别的groupId
+    Mutex::Autolock l(_groupLock);
+    int32_t id = findGroupLocked(groupId, groupHash(groupId));
+    if (id < 0) {
+        return 0;
+    }
+    StealingGroup* g = groupAt(id);
+    g->epoch++;
+    int32_t pending = g->pending.load() - g->pins;
+    return pending > 0 ? pending : 0;
+}
+
+void StealingThreadPool::shutdown()
+{
+    Mutex::Autolock l(_parkLock);
+    _shutdown.store(true);
+    _parkCond.broadcast();
+}
+
+void StealingThreadPool::getStats(StealingPoolStats& stats) const
+{
+    stats.executed = 0;
+    stats.stolen = 0;
+    for (int32_t i = 0; i < _maxPoolSize; i++) {
+        stats.executed += _deques[i].executed.load(std::memory_order_relaxed);
+        stats.stolen += _deques[i].stolen.load(std::memory_order_relaxed);
+    }
+    stats.injected = _injected.load(std::memory_order_relaxed);
+    stats.discarded = _discarded.load(std::memory_order_relaxed);
+    stats.liveWorkers = _liveWorkers.load(std::memory_order_relaxed);
+}
+
+int32_t StealingThreadPool::acquireGroup(const std::string& groupId)
+{
+    uint32_t hash = groupHash(groupId);
+    int32_t id = lookupGroup(groupId, hash);
+    if (id >= 0) {
+        return id;
+    }
+
+    Mutex::Autolock l(_groupLock);
+    id = findGroupLocked(groupId, hash);
+    if (id >= 0) {
+        // 持锁时不会有回收，直接占住
+        groupAt(id)->pending++;
+        return id;
+    }
+    if (_groupCount >= STEALING_SOFT_GROUPS) {
+        id = recycleGroup(groupId, hash);
+    }
+    if (id < 0) {
+        id = newGroup(groupId, hash);
+    }
+    if (id < 0) {
+        return -1;
+    }
+    groupAt(id)->pending++;
+    tableInsertLocked(id, hash);
+    return id;
+}
+
+// 不加锁查表并占住，没找到或撞上回收中的组返回-1，由调用方持锁重查
+int32_t StealingThreadPool::lookupGroup(const std::string& groupId, uint32_t hash)
+{
+    StealingGroupTable* t = _groupTable.load(std::memory_order_acquire);
+    for (int32_t n = 0; n <= t->mask; n++) {
+        int32_t id = t->slots[(hash + n) & t->mask].load(std::memory_order_acquire);
+        if (id == GROUP_SLOT_EMPTY) {
+            return -1;
+        }
+        if (id == GROUP_SLOT_DELETED) {
+            continue;
+        }
+        StealingGroup* g = groupAt(id);
+        if (g->hash.load(std::memory_order_relaxed) != hash) {
+            continue;
+        }
+        // 先占住再核对名字：占住之后不会被回收改名
+        if (g->pending.fetch_add(1) < 0) {
+            g->pending--;
+            return -1;
+        }
+        if (g->name == groupId) {
+            return id;
+        }
+        g->pending--;
+    }
+    return -1;
+}
+
+// 持_groupLock调用
+int32_t StealingThreadPool::findGroupLocked(const std::string& groupId, uint32_t hash) const
+{
+    StealingGroupTable* t = _groupTable.load(std::memory_order_relaxed);
+    for (int32_t n = 0; n <= t->mask; n++) {
+        int32_t id = t->slots[(hash + n) & t->mask].load(std::memory_order_relaxed);
+        if (id == GROUP_SLOT_EMPTY) {
+            return -1;
+        }
+        if (id != GROUP_SLOT_DELETED && groupAt(id)->name == groupId) {
+            return id;
+        }
+    }
+    return -1;
+}
+
+// 持_groupLock调用，删除标记加上新项超过一半时按现有组数重建，旧表留到pool销毁（无锁读方可能还在用）
+void StealingThreadPool::tableInsertLocked(int32_t id, uint32_t hash)
+{
+    StealingGroupTable* t = _groupTable.load(std::memory_order_relaxed);
+    if ((t->used + 1) * 2 > t->mask + 1) {
+        int32_t live = 0;
+        for (int32_t i = 0; i <= t->mask; i++) {
+            if (t->slots[i].load(std::memory_order_relaxed) >= 0) {
+                live++;
+            }
+        }
+        int32_t cap = GROUP_TABLE_INIT;
+        while (cap < (live + 1) * 4) {
+            cap <<= 1;
+        }
+        StealingGroupTable* nt = new StealingGroupTable(cap);
+        for (int32_t i = 0; i <= t->mask; i++) {
+            int32_t old = t->slots[i].load(std::memory_order_relaxed);
+            if (old < 0) {
+                continue;
+            }
+            uint32_t h = groupAt(old)->hash.load(std::memory_order_relaxed);
+            int32_t n = 0;
+            while (nt->slots[(h + n) & nt->mask].load(std::memory_order_relaxed) != GROUP_SLOT_EMPTY) {
+                n++;
+            }
+            nt->slots[(h + n) & nt->mask].store(old, std::memory_order_relaxed);
+            nt->used++;
+        }
+        _retiredTables.push_back(t);
+        _groupTable.store(nt, std::memory_order_release);
+        t = nt;
+    }
+    int32_t n = 0;
+    int32_t slot;
+    while ((slot = t->slots[(hash + n) & t->mask].load(std::memory_order_relaxed)) >= 0) {
+        n++;
+    }
+    if (slot == GROUP_SLOT_EMPTY) {
+        t->used++;
+    }
+    t->slots[(hash + n) & t->mask].store(id, std::memory_order_release);
+}
+
+// 持_groupLock调用
+void StealingThreadPool::tableRemoveLocked(int32_t id, uint32_t hash)
+{
+    StealingGroupTable* t = _groupTable.load(std::memory_order_relaxed);
+    for (int32_t n = 0; n <= t->mask; n++) {
+        std::atomic< int32_t >& slot = t->slots[(hash + n) & t->mask];
+        int32_t v = slot.load(std::memory_order_relaxed);
+        if (v == GROUP_SLOT_EMPTY) {
+            return;
+        }
+        if (v == id) {
+            slot.store(GROUP_SLOT_DELETED, std::memory_order_release);
+            return;
+        }
+    }
+}
+
+// 持_groupLock调用，表全满时返回-1
+int32_t StealingThreadPool::newGroup(const std::string& groupId, uint32_t hash)
+{
+    if (_groupCount >= GROUP_CHUNKS * GROUP_CHUNK_SIZE) {
+        return -1;
+    }
+    int32_t id = _groupCount;
+    std::atomic< StealingGroup* >* chunk = _groupChunks[id >> GROUP_CHUNK_SHIFT].load(std::memory_order_relaxed);
+    if (!chunk) {
+        chunk = new std::atomic< StealingGroup* >[GROUP_CHUNK_SIZE];
+        for (int32_t i = 0; i < GROUP_CHUNK_SIZE; i++) {
+            chunk[i].store(NULL, std::memory_order_relaxed);
+        }
+        _groupChunks[id >> GROUP_CHUNK_SHIFT].store(chunk, std::memory_order_release);
+    }
+    StealingGroup* g = new StealingGroup();
+    g->name = groupId;
+    g->hash.store(hash);
+    g->epoch.store(0);
+    g->pending.store(0);
+    g->pins = 0;
+    chunk[id & (GROUP_CHUNK_SIZE - 1)].store(g, std::memory_order_release);
+    _groupCount++;
+    return id;
+}
+
+// 持_groupLock调用，找不到没有排队任务的组时返回-1
+int32_t StealingThreadPool::recycleGroup(const std::string& groupId, uint32_t hash)
+{
+    for (int32_t n = 0; n < _groupCount; n++) {
+        int32_t id = _groupCursor;
+        _groupCursor = (id + 1) % _groupCount;
+        StealingGroup* g = groupAt(id);
+        int32_t expect = 0;
+        if (!g->pending.compare_exchange_strong(expect, GROUP_RECYCLING)) {
+            continue;
+        }
+        tableRemoveLocked(id, g->hash.load(std::memory_order_relaxed));
+        // 改名要在恢复pending之前：之后无锁查表占住该组的一方读到的一定是新名字
+        g->name = groupId;
+        g->hash.store(hash);
+        // 回收期间查表方临时加上的计数留着，由它们自己减掉
+        g->pending.fetch_sub(GROUP_RECYCLING);
+        return id;
+    }
+    return -1;
+}
+
+void StealingThreadPool::submit(StealingTaskNode* node)
+{
+    // 组已在acquireGroup里占住
+    if (node->group >= 0) {
+        node->epoch = groupAt(node->group)->epoch.load();
+    }
+
+    StealingWorker* self = t_currentWorker;
+    if (self && self->_pool == this) {
+        // 任务里再提交的子任务进自己的队列，无锁
+        _deques[self->_slot].push(node);
+    } else {
+        Mutex::Autolock l(_injectLock);
+        if (_injectTail) {
+            _injectTail->next = node;
+        } else {
+            _injectHead = node;
+        }
+        _injectTail = node;
+        _injectCount++;
+        _injected.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // 没有空闲worker且还有动态名额，拉起一个动态线程
+    if (_idleWorkers.load() == 0 && _liveWorkers.load() < _maxPoolSize && !_shutdown.load()) {
+        for (int32_t i = _corePoolSize; i < _maxPoolSize; i++) {
+            int32_t expect = 0;
+            if (_slotLive[i].compare_exchange_strong(expect, 1)) {
+                startWorker(i);
+                break;
+            }
+        }
+    }
+    wakeOne();
+}
+
+StealingTaskNode* StealingThreadPool::takeInjected()
+{
+    if (_injectCount.load(std::memory_order_relaxed) == 0) {
+        return NULL;
+    }
+    Mutex::Autolock l(_injectLock);
+    StealingTaskNode* node = _injectHead;
+    if (node) {
+        _injectHead = node->next;
+        if (!_injectHead) {
+            _injectTail = NULL;
+        }
+        node->next = NULL;
+        _injectCount--;
+    }
+    return node;
+}
+
+StealingTaskNode* StealingThreadPool::steal(int32_t self)
+{
+    for (int32_t i = 1; i < _maxPoolSize; i++) {
+        StealingTaskNode* node = _deques[(self + i) % _maxPoolSize].steal();
+        if (node) {
+            return node;
+        }
+    }
+    return NULL;
+}
+
+bool StealingThreadPool::hasWork() const
+{
+    if (_injectCount.load() > 0) {
+        return true;
+    }
+    for (int32_t i = 0; i < _maxPoolSize; i++) {
+        if (!_deques[i].empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void StealingThreadPool::wakeOne()
+{
+    // 与workerLoop里sleepers++后再检查队列配对，保证不会丢唤醒
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_sleepers.load() > 0) {
+        Mutex::Autolock l(_parkLock);
+        _parkCond.signal();
+    }
+}
+
+void StealingThreadPool::discardNode(StealingTaskNode* node)
+{
+    if (node->task) {
+        {
+            Mutex::Autolock l(_trackLock);
+            std::map< ThreadPoolTask*, StealingTaskNode* >::iterator it = _tracked.find(node->task);
+            if (it != _tracked.end() && it->second == node) {
+                _tracked.erase(it);
+            }
+        }
+        node->task->tryCleanup();
+    }
+    _discarded.fetch_add(1, std::memory_order_relaxed);
+    freeNode(node);
+}
+
+void StealingThreadPool::runNode(StealingWorker* worker, StealingTaskNode* node)
+{
+    if (node->group >= 0) {
+        // 先核对epoch再释放占用，释放之后槽位可能被回收给别的组
+        StealingGroup* g = groupAt(node->group);
+        bool stale = node->epoch != g->epoch.load();
+        g->pending--;
+        if (stale) {
+            discardNode(node);
+            return;
+        }
+    }
+    int32_t expect = NODE_PENDING;
+    if (_shutdown.load() || !node->state.compare_exchange_strong(expect, NODE_RUNNING)) {
+        discardNode(node);
+        return;
+    }
+
+    if (node->task) {
+        ThreadPoolTask* task = node->task;
+        {
+            Mutex::Autolock l(_trackLock);
+            _tracked.erase(task);
+        }
+        task->run();
+        task->tryCleanup();
+    } else {
+        node->func();
+    }
+    _deques[worker->_slot].executed.fetch_add(1, std::memory_order_relaxed);
+    freeNode(node);
+}
+
+void StealingThreadPool::startWorker(int32_t slot)
+{
+    _liveWorkers++;
+    StealingWorker* worker = new StealingWorker(this, slot, slot >= _corePoolSize);
+    worker->start();
+}
+
+void StealingThreadPool::workerLoop(StealingWorker* worker)
+{
+    t_currentWorker = worker;
+    StealingDeque& own = _deques[worker->_slot];
+    long long idleSince = 0;
+    int32_t spins = 0;
+
+    while (true) {
+        StealingTaskNode* node = own.pop();
+        if (!node) {
+            node = takeInjected();
+        }
+        if (!node) {
+            node = steal(worker->_slot);
+            if (node) {
+                own.stolen.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        if (node) {
+            spins = 0;
+            idleSince = 0;
+            runNode(worker, node);
+            continue;
+        }
+
+        // shutdown后把队列里剩下的都取出丢弃，取空了再退出
+        if (_shutdown.load()) {
+            break;
+        }
+        if (++spins < STEALING_SPIN) {
+            sched_yield();
+            continue;
+        }
+        spins = 0;
+
+        Mutex::Autolock l(_parkLock);
+        _sleepers++;
+        _idleWorkers++;
+        bool exitIdle = false;
+        if (!_shutdown.load() && !hasWork()) {
+            int32_t waitMs = 1000;
+            if (worker->_dynamic) {
+                long long now = jquick_get_current_time();
+                if (idleSince == 0) {
+                    idleSince = now;
+                }
+                long long left = idleSince + STEALING_IDLE_EXIT_MS - now;
+                if (left <= 0 && own.empty()) {
+                    exitIdle = true;
+                } else if (left > 0 && left < waitMs) {
+                    waitMs = (int32_t)left;
+                }
+            }
+            if (!exitIdle) {
+                _parkCond.waitRelative(_parkLock, waitMs);
+            }
+        }
+        _sleepers--;
+        _idleWorkers--;
+        if (exitIdle) {
+            break;
+        }
+    }
+    workerExit(worker);
+}
+
+void StealingThreadPool::workerExit(StealingWorker* worker)
+{
+    t_currentWorker = NULL;
+    _slotLive[worker->_slot].store(0);
+
+    bool last;
+    {
+        Mutex::Autolock l(_parkLock);
+        last = --_liveWorkers == 0 && _shutdown.load();
+    }
+    if (!last) {
+        return;
+    }
+
+    // 最后一个退出的worker清理残留任务并释放pool
+    StealingTaskNode* node;
+    while ((node = takeInjected()) != NULL) {
+        discardNode(node);
+    }
+    for (int32_t i = 0; i < _maxPoolSize; i++) {
+        while ((node = _deques[i].steal()) != NULL) {
+            discardNode(node);
+        }
+    }
+    delete this;
+}
+}  // namespace JQuick
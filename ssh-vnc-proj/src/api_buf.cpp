@@ -0,0 +1,147 @@
+#include "include/api_buf.h"
+#include "utils/Mutex.h"
+#include <stdlib.h>
+#include <string.h>
+#include <jsoncpp/json/json.h>
+#include <map>
+#include <string>
+
+// 尺寸分级：8K起每级x4，每级最多缓存2块，轮询类接口反复调用时不再malloc
+#define SCRATCH_MIN_SHIFT 13
+#define SCRATCH_CLASSES 5
+#define SCRATCH_KEEP 2
+
+struct ScratchClass {
+    char* blocks[SCRATCH_KEEP];
+    int count;
+};
+
+struct ApiCounter {
+    uint64_t calls;
+    uint64_t bytes;
+    uint64_t max;
+    uint64_t grows;
+    uint64_t fails;
+};
+
+static JQuick::Mutex buf_mutex;
+static ScratchClass scratch_classes[SCRATCH_CLASSES];
+static uint64_t scratch_hits = 0;
+static uint64_t scratch_misses = 0;
+static uint64_t scratch_large = 0;
+// key是导出接口名（字符串常量）
+static std::map<std::string, ApiCounter> api_counters;
+
+static int class_size(int idx) {
+    return 1 << (SCRATCH_MIN_SHIFT + idx * 2);
+}
+
+static int class_of(int size) {
+    for (int i = 0; i < SCRATCH_CLASSES; i++) {
+        if (size <= class_size(i)) return i;
+    }
+    return -1;
+}
+
+char* api_scratch_get(int min_size, int* cap) {
+    if (min_size <= 0 || min_size > API_RESULT_MAX) return NULL;
+    int idx = class_of(min_size);
+    if (idx < 0) {
+        {
+            JQuick::Mutex::Autolock l(buf_mutex);
+            scratch_large++;
+        }
+        *cap = min_size;
+        return (char*)malloc(min_size);
+    }
+
+    *cap = class_size(idx);
+    {
+        JQuick::Mutex::Autolock l(buf_mutex);
+        ScratchClass& c = scratch_classes[idx];
+        if (c.count > 0) {
+            scratch_hits++;
+            return c.blocks[--c.count];
+        }
+        scratch_misses++;
+    }
+    return (char*)malloc(*cap);
+}
+
+void api_scratch_put(char* buf, int cap) {
+    if (!buf) return;
+    int idx = class_of(cap);
+    if (idx >= 0 && class_size(idx) == cap) {
+        JQuick::Mutex::Autolock l(buf_mutex);
+        ScratchClass& c = scratch_classes[idx];
+        if (c.count < SCRATCH_KEEP) {
+            c.blocks[c.count++] = buf;
+            return;
+        }
+    }
+    free(buf);
+}
+
+char* api_result_dup(const char* api, const char* data, int len) {
+    char* out = (char*)malloc(len + 1);
+    if (!out) {
+        api_stats_fail(api);
+        return NULL;
+    }
+    memcpy(out, data, len);
+    out[len] = '\0';
+
+    JQuick::Mutex::Autolock l(buf_mutex);
+    ApiCounter& c = api_counters[api];
+    c.calls++;
+    c.bytes += len;
+    if ((uint64_t)len > c.max) c.max = len;
+    return out;
+}
+
+void api_stats_grow(const char* api) {
+    JQuick::Mutex::Autolock l(buf_mutex);
+    api_counters[api].grows++;
+}
+
+void api_stats_fail(const char* api) {
+    JQuick::Mutex::Autolock l(buf_mutex);
+    ApiCounter& c = api_counters[api];
+    c.calls++;
+    c.fails++;
+}
+
+int api_buf_stats_impl(char* buf, int buf_len) {
+    if (!buf || buf_len <= 1) return -1;
+
+    Json::Value root;
+    {
+        JQuick::Mutex::Autolock l(buf_mutex);
+        Json::Value scratch;
+        scratch["hits"] = (Json::UInt64)scratch_hits;
+        scratch["misses"] = (Json::UInt64)scratch_misses;
+        scratch["large"] = (Json::UInt64)scratch_large;
+        root["scratch"] = scratch;
+
+        Json::Value apis(Json::objectValue);
+        for (std::map<std::string, ApiCounter>::iterator it = api_counters.begin(); it != api_counters.end(); ++it) {
+            Json::Value item;
+            item["calls"] = (Json::UInt64)it->second.calls;
+            item["bytes"] = (Json::UInt64)it->second.bytes;
+            item["max"] = (Json::UInt64)it->second.max;
+            item["grows"] = (Json::UInt64)it->second.grows;
+            item["fails"] = (Json::UInt64)it->second.fails;
+            apis[it->first] = item;
+        }
+        root["apis"] = apis;
+    }
+
+    Json::StreamWriterBuilder writer;
+    writer["indentation"] = "";
+    std::string json_str = Json::writeString(writer, root);
+    int len = json_str.length();
+    if (len > buf_len - 1) return len;
+    memcpy(buf, json_str.c_str(), len);
+    buf[len] = '\0';
+    return len;
+}
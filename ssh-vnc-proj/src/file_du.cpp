@@ -0,0 +1,504 @@
+#include "include/file_du.h"
+#include "threadpool/StealingThreadPool.h"
+#include "utils/Functional.h"
+#include "utils/Mutex.h"
+#include "utils/REF.h"
+#include "port/jquick_time.h"
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdio.h>
+#include <jsoncpp/json/json.h>
+#include <atomic>
+#include <deque>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+// 分析线程池的线程数，所有分析任务共用，目录按任务拆开后一棵大子树也能用满
+#define DU_MAX_WORKERS 4
+// 目录缓存条目上限，超出后淘汰最久未用的条目
+#define DU_CACHE_MAX 16384
+// 目录缓存有效期：子目录里的文件原地改写不会更新目录mtime，没有监听的目录靠它限定数据陈旧的时长
+#define DU_CACHE_TTL_MS (10 * 60 * 1000)
+
+// ====================== 目录缓存 ======================
+struct DuDirKey {
+    dev_t dev;
+    ino_t ino;
+
+    bool operator<(const DuDirKey& o) const {
+        return dev != o.dev ? dev < o.dev : ino < o.ino;
+    }
+};
+
+// 只缓存目录直属部分，子目录总量每次由子目录自己的缓存汇总
+// 这样任意深处的目录变化只影响它自己这一条，祖先无需作废
+struct DuDirInfo {
+    time_t mtime;
+    long mtime_nsec;
+    long long cached_ms;
+    uint64_t own_bytes;
+    uint64_t own_files;
+    std::vector<std::string> subdirs;
+    // 硬链接文件（nlink>1）单独记录，汇总时按inode去重，与du一致
+    std::vector<std::pair<ino_t, uint64_t> > linked;
+};
+
+struct DuCacheEntry {
+    DuDirInfo info;
+    std::list<DuDirKey>::iterator lru;
+};
+
+// du_lru表头为最近使用，两者都受du_cache_mutex保护
+static JQuick::Mutex du_cache_mutex;
+static std::map<DuDirKey, DuCacheEntry> du_cache;
+static std::list<DuDirKey> du_lru;
+
+static void cache_erase_locked(std::map<DuDirKey, DuCacheEntry>::iterator it) {
+    du_lru.erase(it->second.lru);
+    du_cache.erase(it);
+}
+
+static bool cache_lookup(const struct stat& st, DuDirInfo& info) {
+    DuDirKey key = {st.st_dev, st.st_ino};
+    JQuick::Mutex::Autolock l(du_cache_mutex);
+    std::map<DuDirKey, DuCacheEntry>::iterator it = du_cache.find(key);
+    if (it == du_cache.end()) return false;
+    // mtime不同说明目录项有增删改名，超过有效期的也不再信任
+    const DuDirInfo& cached = it->second.info;
+    if (cached.mtime != st.st_mtim.tv_sec || cached.mtime_nsec != st.st_mtim.tv_nsec ||
+        jquick_get_current_time() - cached.cached_ms > DU_CACHE_TTL_MS) {
+        cache_erase_locked(it);
+        return false;
+    }
+    du_lru.splice(du_lru.begin(), du_lru, it->second.lru);
+    info = cached;
+    return true;
+}
+
+static void cache_store(const struct stat& st, const DuDirInfo& info) {
+    DuDirKey key = {st.st_dev, st.st_ino};
+    JQuick::Mutex::Autolock l(du_cache_mutex);
+    std::map<DuDirKey, DuCacheEntry>::iterator it = du_cache.find(key);
+    if (it != du_cache.end()) {
+        it->second.info = info;
+        du_lru.splice(du_lru.begin(), du_lru, it->second.lru);
+        return;
+    }
+    while (du_cache.size() >= DU_CACHE_MAX) {
+        cache_erase_locked(du_cache.find(du_lru.back()));
+    }
+    du_lru.push_front(key);
+    DuCacheEntry& entry = du_cache[key];
+    entry.info = info;
+    entry.lru = du_lru.begin();
+}
+
+// ====================== 分析任务 ======================
+struct DuTotals {
+    uint64_t bytes;
+    uint64_t files;
+    uint64_t dirs;
+};
+
+// 根目录下的一个子目录：整棵子树按目录拆成任务交给线程池，大子树也能分到所有worker上
+// 子树里每个目录算完就累加进来，pending归零即整项收敛
+struct DuChild {
+    DuChild() : pending(0), bytes(0), files(0), dirs(0) {}
+
+    std::string name;
+    // 已提交还没算完的目录数
+    std::atomic<int> pending;
+    std::atomic<uint64_t> bytes;
+    std::atomic<uint64_t> files;
+    std::atomic<uint64_t> dirs;
+};
+
+// 一条待下发的子项，下发时再转成file_du_item或JSON
+struct DuItem {
+    std::string name;
+    bool is_dir;
+    DuTotals t;
+};
+
+class DuJob : public JQuick::REF_BASE {
+public:
+    DuJob() : id(0), sink(NULL), userdata(NULL), root_dev(0), refresh(false), children(NULL), pending(0),
+              cached_dirs(0), scanned_dirs(0), cancelled(false), detached(false), done(false),
+              start_ms(0) {
+        memset(&totals, 0, sizeof(totals));
+    }
+    virtual ~DuJob() { delete[] children; }
+
+    int id;
+    std::string root;
+    file_du_sink sink;
+    void* userdata;
+    dev_t root_dev;
+    // 忽略已有缓存全部重新读取，结果仍写回缓存
+    bool refresh;
+
+    DuChild* children;
+    // 整个任务已提交还没执行完的目录任务数，归零即结束
+    std::atomic<int> pending;
+    std::atomic<int> cached_dirs;
+    std::atomic<int> scanned_dirs;
+    std::atomic<bool> cancelled;
+
+    // 已计入的硬链接inode（不跨文件系统，只需ino）
+    JQuick::Mutex link_lock;
+    std::set<ino_t> seen_links;
+
+    // 以下受out_lock保护
+    JQuick::Mutex out_lock;
+    bool detached;
+    bool done;
+    DuTotals totals;
+    std::deque<std::string> queued;
+
+    long long start_ms;
+};
+
+static JQuick::Mutex du_mutex;
+static std::map<int, JQuick::sp<DuJob> > du_jobs;
+static int du_id_seq = 0;
+static JQuick::StealingThreadPool* du_pool = NULL;
+// 池和组都常驻，驻留一次，之后按组号提交不再查名字
+static int32_t du_group = -1;
+
+static void submit_dir(const JQuick::sp<DuJob>& job, DuChild* child, const std::string& path);
+
+static std::string join_path(const std::string& dir, const char* name) {
+    if (!dir.empty() && dir[dir.size() - 1] == '/') return dir + name;
+    return dir + "/" + name;
+}
+
+static uint64_t disk_bytes(const struct stat& st) {
+    return (uint64_t)st.st_blocks * 512;
+}
+
+// 读取目录直属部分：文件占用累加，同一文件系统的子目录记下名字
+static bool scan_own(DuJob* job, const std::string& path, DuDirInfo& info) {
+    DIR* dir = opendir(path.c_str());
+    if (!dir) return false;
+
+    info.own_bytes = 0;
+    info.own_files = 0;
+    info.subdirs.clear();
+    info.linked.clear();
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        const char* name = entry->d_name;
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) continue;
+        struct stat st;
+        if (fstatat(dirfd(dir), name, &st, AT_SYMLINK_NOFOLLOW) != 0) continue;
+        if (S_ISDIR(st.st_mode)) {
+            // 不跨文件系统，/proc等挂载点自然被跳过
+            if (st.st_dev == job->root_dev) info.subdirs.push_back(name);
+        } else if (st.st_nlink > 1) {
+            info.linked.push_back(std::make_pair(st.st_ino, disk_bytes(st)));
+        } else {
+            info.own_bytes += disk_bytes(st);
+            info.own_files++;
+        }
+    }
+    closedir(dir);
+    return true;
+}
+
+static bool first_link(DuJob* job, ino_t ino) {
+    JQuick::Mutex::Autolock l(job->link_lock);
+    return job->seen_links.insert(ino).second;
+}
+
+// 算一个目录的直属部分，子目录再提交回线程池；worker里提交的任务进它自己的队列，
+// 自己按后进先出往深处走，空闲worker从队列另一头偷离根更近的大子树
+static void du_dir(const JQuick::sp<DuJob>& job, DuChild* child, const std::string& path) {
+    struct stat st;
+    if (lstat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) return;
+    DuDirInfo info;
+    if (!job->refresh && cache_lookup(st, info)) {
+        job->cached_dirs++;
+    } else {
+        if (!scan_own(job.get(), path, info)) return;
+        job->scanned_dirs++;
+        info.mtime = st.st_mtim.tv_sec;
+        info.mtime_nsec = st.st_mtim.tv_nsec;
+        info.cached_ms = jquick_get_current_time();
+        cache_store(st, info);
+    }
+
+    uint64_t bytes = disk_bytes(st) + info.own_bytes;
+    uint64_t files = info.own_files;
+    for (size_t i = 0; i < info.linked.size(); i++) {
+        if (!first_link(job.get(), info.linked[i].first)) continue;
+        bytes += info.linked[i].second;
+        files++;
+    }
+    child->bytes += bytes;
+    child->files += files;
+    child->dirs++;
+    for (size_t i = 0; i < info.subdirs.size() && !job->cancelled; i++) {
+        submit_dir(job, child, join_path(path, info.subdirs[i].c_str()));
+    }
+}
+
+static std::string item_json(const DuItem& item, Json::StreamWriterBuilder& writer) {
+    Json::Value v;
+    v["name"] = item.name;
+    v["is_dir"] = item.is_dir;
+    v["bytes"] = (Json::UInt64)item.t.bytes;
+    v["files"] = (Json::UInt64)item.t.files;
+    v["dirs"] = (Json::UInt64)item.t.dirs;
+    return Json::writeString(writer, v);
+}
+
+static void deliver(DuJob* job, const std::vector<DuItem>& items, const DuTotals& t) {
+    JQuick::Mutex::Autolock l(job->out_lock);
+    job->totals.bytes += t.bytes;
+    job->totals.files += t.files;
+    job->totals.dirs += t.dirs;
+    if (job->detached || items.empty()) return;
+    if (job->sink) {
+        std::vector<file_du_item> out(items.size());
+        for (size_t i = 0; i < items.size(); i++) {
+            out[i].name = items[i].name.c_str();
+            out[i].is_dir = items[i].is_dir;
+            out[i].bytes = items[i].t.bytes;
+            out[i].files = items[i].t.files;
+            out[i].dirs = items[i].t.dirs;
+        }
+        job->sink(job->id, &out[0], (int)out.size(), NULL, job->userdata);
+    } else {
+        Json::StreamWriterBuilder writer;
+        writer["indentation"] = "";
+        for (size_t i = 0; i < items.size(); i++) {
+            job->queued.push_back(item_json(items[i], writer));
+        }
+    }
+}
+
+// 调用方持有out_lock
+static void make_summary(DuJob* job, file_du_summary& summary) {
+    summary.bytes = job->totals.bytes;
+    summary.files = job->totals.files;
+    summary.dirs = job->totals.dirs;
+    summary.cached_dirs = job->cached_dirs.load();
+    summary.scanned_dirs = job->scanned_dirs.load();
+    summary.cancelled = job->cancelled.load();
+    summary.ms = jquick_get_current_time() - job->start_ms;
+}
+
+static std::string summary_json(DuJob* job) {
+    file_du_summary s;
+    make_summary(job, s);
+    Json::Value summary;
+    summary["bytes"] = (Json::UInt64)s.bytes;
+    summary["files"] = (Json::UInt64)s.files;
+    summary["dirs"] = (Json::UInt64)s.dirs;
+    summary["cached_dirs"] = s.cached_dirs;
+    summary["scanned_dirs"] = s.scanned_dirs;
+    summary["cancelled"] = s.cancelled != 0;
+    summary["ms"] = (Json::Int64)s.ms;
+    Json::StreamWriterBuilder writer;
+    writer["indentation"] = "";
+    return Json::writeString(writer, summary);
+}
+
+static void finish_job(DuJob* job) {
+    {
+        JQuick::Mutex::Autolock l(job->out_lock);
+        job->done = true;
+        if (job->detached || !job->sink) return;
+        file_du_summary summary;
+        make_summary(job, summary);
+        job->sink(job->id, NULL, 0, &summary, job->userdata);
+    }
+
+    // 推送模式结果已全部下发，无需等待poll
+    JQuick::Mutex::Autolock l(du_mutex);
+    std::map<int, JQuick::sp<DuJob> >::iterator it = du_jobs.find(job->id);
+    if (it != du_jobs.end() && it->second.get() == job) du_jobs.erase(it);
+}
+
+static void run_dir(const JQuick::sp<DuJob>& job, DuChild* child, const std::string& path) {
+    // 取消后排队中的任务只做计数，很快排空
+    if (!job->cancelled) du_dir(job, child, path);
+
+    if (--child->pending == 0 && !job->cancelled) {
+        // 每个子目录收敛后立即下发，前端可以边算边排序
+        std::vector<DuItem> items(1);
+        items[0].name = child->name;
+        items[0].is_dir = true;
+        items[0].t.bytes = child->bytes;
+        items[0].t.files = child->files;
+        items[0].t.dirs = child->dirs;
+        deliver(job.get(), items, items[0].t);
+    }
+    if (--job->pending == 0) finish_job(job.get());
+}
+
+static void submit_dir(const JQuick::sp<DuJob>& job, DuChild* child, const std::string& path) {
+    // 先计数再提交，父目录任务结束前子任务已经记上，pending不会提前归零
+    child->pending++;
+    job->pending++;
+    du_pool->execute(du_group, [job, child, path]() { run_dir(job, child, path); });
+}
+
+int file_du_start_impl(const char* path, int refresh, file_du_sink sink, void* userdata) {
+    if (!path) return -1;
+    struct stat st;
+    if (lstat(path, &st) != 0 || !S_ISDIR(st.st_mode)) return -2;
+
+    JQuick::sp<DuJob> job = new DuJob();
+    job->root = path;
+    job->sink = sink;
+    job->userdata = userdata;
+    job->root_dev = st.st_dev;
+    job->refresh = refresh != 0;
+    job->start_ms = jquick_get_current_time();
+
+    // 根目录本身总是重新读取，直属文件第一批就下发
+    DIR* dir = opendir(path);
+    if (!dir) return -3;
+    std::vector<std::string> subdirs;
+    std::vector<DuItem> files;
+    DuTotals own = {disk_bytes(st), 0, 1};
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        const char* name = entry->d_name;
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) continue;
+        struct stat cst;
+        if (fstatat(dirfd(dir), name, &cst, AT_SYMLINK_NOFOLLOW) != 0) continue;
+        if (S_ISDIR(cst.st_mode)) {
+            if (cst.st_dev == job->root_dev) subdirs.push_back(name);
+            continue;
+        }
+        DuTotals t = {disk_bytes(cst), 1, 0};
+        if (cst.st_nlink > 1 && !first_link(job.get(), cst.st_ino)) t.bytes = 0;
+        files.push_back(DuItem());
+        files.back().name = name;
+        files.back().is_dir = false;
+        files.back().t = t;
+        own.bytes += t.bytes;
+        own.files++;
+    }
+    closedir(dir);
+
+    job->children = new DuChild[subdirs.size()];
+    for (size_t i = 0; i < subdirs.size(); i++) {
+        job->children[i].name.swap(subdirs[i]);
+    }
+
+    {
+        JQuick::Mutex::Autolock l(du_mutex);
+        if (!du_pool) {
+            du_pool = new JQuick::StealingThreadPool("file_du", DU_MAX_WORKERS);
+            du_group = du_pool->internGroup("file_du");
+        }
+        job->id = ++du_id_seq;
+        du_jobs[job->id] = job;
+    }
+
+    // sink在du_mutex外回调；worker还没开始，直属文件这一批一定最先下发
+    deliver(job.get(), files, own);
+    // 多占一个计数，子目录都提交完再由池里的任务放掉，没有子目录时也由它在工作线程上走结束流程
+    job->pending = 1;
+    for (size_t i = 0; i < subdirs.size(); i++) {
+        submit_dir(job, &job->children[i], join_path(job->root, job->children[i].name.c_str()));
+    }
+    du_pool->execute(du_group, [job]() {
+        if (--job->pending == 0) finish_job(job.get());
+    });
+    return job->id;
+}
+
+int file_du_poll_impl(int du_id, char* buf, int buf_len) {
+    if (!buf || buf_len < 512) return -1;
+
+    JQuick::sp<DuJob> job;
+    {
+        JQuick::Mutex::Autolock l(du_mutex);
+        std::map<int, JQuick::sp<DuJob> >::iterator it = du_jobs.find(du_id);
+        if (it == du_jobs.end()) return -2;
+        job = it->second;
+    }
+
+    std::string out;
+    bool finished = false;
+    {
+        JQuick::Mutex::Autolock l(job->out_lock);
+        // 按条取走，放不下的留到下次poll；预留结尾统计字段的空间
+        size_t limit = (size_t)buf_len - 1 - 256;
+        std::string items;
+        while (!job->queued.empty()) {
+            const std::string& item = job->queued.front();
+            if (items.size() + item.size() + 1 > limit) {
+                if (items.empty()) job->queued.pop_front();
+                break;
+            }
+            if (!items.empty()) items += ',';
+            items += item;
+            job->queued.pop_front();
+        }
+        finished = job->done && job->queued.empty();
+        if (finished) {
+            // summary是完整对象，去掉结尾的}再拼上items
+            std::string summary = summary_json(job.get());
+            summary.erase(summary.size() - 1);
+            out = "{\"done\":true," + summary.substr(1) + ",\"items\":[" + items + "]}";
+        } else {
+            out = "{\"done\":false,\"items\":[" + items + "]}";
+        }
+    }
+
+    if (finished) {
+        JQuick::Mutex::Autolock l(du_mutex);
+        du_jobs.erase(du_id);
+    }
+    int len = out.size();
+    memcpy(buf, out.c_str(), len);
+    buf[len] = '\0';
+    return len;
+}
+
+int file_du_cancel_impl(int du_id) {
+    JQuick::sp<DuJob> job;
+    {
+        JQuick::Mutex::Autolock l(du_mutex);
+        std::map<int, JQuick::sp<DuJob> >::iterator it = du_jobs.find(du_id);
+        if (it == du_jobs.end()) return -1;
+        job = it->second;
+        du_jobs.erase(it);
+    }
+
+    job->cancelled = true;
+    JQuick::Mutex::Autolock l(job->out_lock);
+    job->detached = true;
+    job->queued.clear();
+    return 0;
+}
+
+void file_du_invalidate_impl(const char* path) {
+    if (!path) return;
+    struct stat st;
+    std::string dir_path = path;
+    if (lstat(path, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        // 文件（或已被删除的路径）作废其所在目录
+        size_t pos = dir_path.find_last_of('/');
+        if (pos == std::string::npos) return;
+        dir_path = pos == 0 ? "/" : dir_path.substr(0, pos);
+        if (lstat(dir_path.c_str(), &st) != 0) return;
+    }
+
+    DuDirKey key = {st.st_dev, st.st_ino};
+    JQuick::Mutex::Autolock l(du_cache_mutex);
+    std::map<DuDirKey, DuCacheEntry>::iterator it = du_cache.find(key);
+    if (it != du_cache.end()) cache_erase_locked(it);
+}
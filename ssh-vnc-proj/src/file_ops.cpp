@@ -9,21 +9,51 @@
 #include <md4c-html.h>
 #include <string.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <stdio.h>
 #include <pwd.h>
 #include <grp.h>
+#include <string>
 
 static void md_output_callback(const MD_CHAR* data, MD_SIZE size, void* userdata) {
-    char** ctx = (char**)userdata;
-    char* buf = ctx[0];
-    int* remain_len = (int*)ctx[1];
+    std::string* out = (std::string*)userdata;
+    out->append(data, size);
+}
 
-    if (size <= 0 || *remain_len <= 1) return;
-    MD_SIZE write_len = size < (MD_SIZE)(*remain_len - 1) ? size : (MD_SIZE)(*remain_len - 1);
-    memcpy(buf, data, write_len);
+// 结果放进buf；放不下时返回所需长度，由导出层扩容重试（见api_buf.h）
+static int copy_out(const std::string& str, char* buf, int buf_len) {
+    int len = str.length();
+    if (len > buf_len - 1) return len;
+    memcpy(buf, str.c_str(), len);
+    buf[len] = '\0';
+    return len;
+}
 
-    ctx[0] += write_len;
-    *remain_len -= write_len;
+// 超大文件的所需长度截到INT_MAX，导出层会按API_RESULT_MAX拒绝
+static int needed_len(off_t size) {
+    return size > INT_MAX ? INT_MAX : (int)size;
+}
+
+// 长度未知的文件（/proc、管道）读满buf后再探一个字节，还有数据就按翻倍估一个所需长度
+static int more_len(int fd, int buf_len) {
+    char c;
+    if (read(fd, &c, 1) <= 0) return 0;
+    return buf_len > INT_MAX / 2 ? INT_MAX : buf_len * 2;
+}
+
+// 整个文件读进内存，不受结果缓冲大小限制
+static int read_whole(const char* path, std::string& out) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) out.reserve(st.st_size);
+    char chunk[8192];
+    ssize_t n;
+    while ((n = read(fd, chunk, sizeof(chunk))) > 0) {
+        out.append(chunk, n);
+    }
+    close(fd);
+    return n < 0 ? -1 : (int)out.size();
 }
 
 // 原有_impl函数（不变，仅file_chown_impl补实现）
@@ -47,40 +77,79 @@ int file_list_impl(const char* path, char* buf, int buf_len) {
 
     Json::StreamWriterBuilder writer;
     writer["indentation"] = "";
-    std::string json_str = Json::writeString(writer, root);
-
-    int len = json_str.length();
-    if (len > buf_len - 1) len = buf_len - 1;
-    memcpy(buf, json_str.c_str(), len);
-    buf[len] = '\0';
-    return 0;
+    return copy_out(Json::writeString(writer, root), buf, buf_len);
 }
 
-int file_list_via_ssh_impl(const char* path, char* buf, int buf_len) {
-    char cmd[256];
-    snprintf(cmd, sizeof(cmd), "ls -l %s", path);
-    ssh_write_stream_impl(cmd);
-    return ssh_read_stream_impl(buf, buf_len);
+// 走独立的exec通道，不往交互终端的shell里敲命令，输出里也没有回显和提示符
+SshExec* file_list_via_ssh_impl(const char* path) {
+    if (!path) return nullptr;
+    std::string cmd = "ls -l " + ssh_shell_quote(path) + " 2>&1";
+    return ssh_exec_open_impl(cmd.c_str());
 }
 
 int file_read_text_impl(const char* path, char* buf, int buf_len) {
+    if (buf == nullptr || buf_len <= 0) return -1;
     int fd = open(path, O_RDONLY);
     if (fd < 0) return -1;
-    int len = read(fd, buf, buf_len - 1);
+
+    // 普通文件大小已知，放不下直接返回所需长度；/proc等st_size为0的读满为止
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > buf_len - 1) {
+        close(fd);
+        return needed_len(st.st_size);
+    }
+    int len = 0;
+    ssize_t n;
+    while (len < buf_len - 1 && (n = read(fd, buf + len, buf_len - 1 - len)) > 0) {
+        len += n;
+    }
+    if (len == buf_len - 1) {
+        int more = more_len(fd, buf_len);
+        if (more > 0) {
+            close(fd);
+            return more;
+        }
+    }
     close(fd);
     buf[len] = '\0';
     return len;
 }
 
 int file_read_hex_impl(const char* path, char* buf, int buf_len) {
+    if (buf == nullptr || buf_len <= 0) return -1;
     int fd = open(path, O_RDONLY);
     if (fd < 0) return -1;
-    unsigned char data[1];
-    int len = 0;
 
-    while (read(fd, data, 1) > 0 && len < buf_len - 4) {
-        snprintf(buf + len, 4, "%02x ", data[0]);
-        len += 3;
+    // 每字节输出"xx "三个字符，超过INT_MAX / 3字节的文件所需长度直接按INT_MAX报
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > (buf_len - 1) / 3) {
+        close(fd);
+        return st.st_size > INT_MAX / 3 ? INT_MAX : (int)st.st_size * 3;
+    }
+    static const char hex[] = "0123456789abcdef";
+    unsigned char data[4096];
+    int len = 0;
+    bool eof = false;
+    while (len + 3 <= buf_len - 1) {
+        size_t want = (buf_len - 1 - len) / 3;
+        if (want > sizeof(data)) want = sizeof(data);
+        ssize_t n = read(fd, data, want);
+        if (n <= 0) {
+            eof = true;
+            break;
+        }
+        for (ssize_t i = 0; i < n; i++) {
+            buf[len++] = hex[data[i] >> 4];
+            buf[len++] = hex[data[i] & 0x0f];
+            buf[len++] = ' ';
+        }
+    }
+    if (!eof) {
+        int more = more_len(fd, buf_len);
+        if (more > 0) {
+            close(fd);
+            return more;
+        }
     }
     close(fd);
     buf[len] = '\0';
@@ -90,24 +159,20 @@ int file_read_hex_impl(const char* path, char* buf, int buf_len) {
 int file_render_md_impl(const char* path, char* buf, int buf_len) {
     if (buf == nullptr || buf_len <= 0) return -1;
 
-    char md_content[8192] = {0};
-    int content_len = file_read_text_impl(path, md_content, sizeof(md_content));
-    if (content_len < 0) return -1;
-
-    char* buf_ptr = buf;
-    int remain_len = buf_len;
-    char* ctx[] = {buf_ptr, (char*)&remain_len};
+    std::string md_content;
+    if (read_whole(path, md_content) < 0) return -1;
 
+    std::string html;
+    html.reserve(md_content.size() + md_content.size() / 2);
     md_html(
-        md_content,
-        content_len,
+        md_content.c_str(),
+        md_content.size(),
         md_output_callback,
-        ctx,
+        &html,
         MD_FLAG_NOHTML,
         0
     );
-    *buf_ptr = '\0';
-    return strlen(buf);
+    return copy_out(html, buf, buf_len);
 }
 
 int file_write_impl(const char* path, const char* content) {
@@ -146,10 +211,15 @@ int file_lsattr_impl(const char* path, char* buf, int buf_len) {
     FILE* fp = popen(cmd, "r");
     if (!fp) return -1;
 
-    int len = fread(buf, 1, buf_len - 1, fp);
+    // 对目录lsattr会列出所有条目，读完整输出
+    std::string out;
+    char chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), fp)) > 0) {
+        out.append(chunk, n);
+    }
     pclose(fp);
-    buf[len] = '\0';
-    return len;
+    return copy_out(out, buf, buf_len);
 }
 
 // ✅ 补实现：file_delete_impl（删除文件/目录）
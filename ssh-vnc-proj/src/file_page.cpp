@@ -0,0 +1,230 @@
+#include "include/file_page.h"
+#include "include/ssh_conn_manager.h"
+#include "utils/Mutex.h"
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <jsoncpp/json/json.h>
+#include <map>
+#include <string>
+
+enum {
+    PAGE_LIST = 1,
+    PAGE_TEXT,
+    PAGE_SSH_LIST,
+};
+
+struct FilePage {
+    int kind;
+    std::string path;
+    DIR* dir;
+    int fd;
+    off_t offset;
+    bool started;
+    bool eof;
+    // 远端列表：本游标独占的exec通道，取第一页时打开
+    SshExec* exec;
+    // 远端列表：上一页末尾被切开的UTF-8字符，接到下一页开头
+    std::string carry;
+    // 列表页放不下调用方缓冲时留在这里，下次直接给出
+    std::string pending;
+};
+
+static JQuick::Mutex page_mutex;
+static std::map<int, FilePage*> pages;
+static int page_seq = 0;
+
+static int page_add(FilePage* page) {
+    JQuick::Mutex::Autolock l(page_mutex);
+    if (++page_seq <= 0) page_seq = 1;
+    pages[page_seq] = page;
+    return page_seq;
+}
+
+static FilePage* page_find(int page_id) {
+    JQuick::Mutex::Autolock l(page_mutex);
+    std::map<int, FilePage*>::iterator it = pages.find(page_id);
+    return it == pages.end() ? NULL : it->second;
+}
+
+static FilePage* page_new(int kind, const char* path) {
+    FilePage* page = new FilePage();
+    page->kind = kind;
+    page->path = path;
+    page->dir = NULL;
+    page->fd = -1;
+    page->offset = 0;
+    page->started = false;
+    page->eof = false;
+    page->exec = NULL;
+    return page;
+}
+
+int file_page_list_open_impl(const char* path) {
+    if (!path) return -1;
+    DIR* dir = opendir(path);
+    if (!dir) return -2;
+    FilePage* page = page_new(PAGE_LIST, path);
+    page->dir = dir;
+    return page_add(page);
+}
+
+int file_page_text_open_impl(const char* path) {
+    if (!path) return -1;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -2;
+    FilePage* page = page_new(PAGE_TEXT, path);
+    page->fd = fd;
+    return page_add(page);
+}
+
+int file_page_ssh_list_open_impl(const char* path) {
+    if (!path) return -1;
+    // ls命令在取第一页时才发出
+    return page_add(page_new(PAGE_SSH_LIST, path));
+}
+
+// 字段与file_list_impl一致
+static int list_next(FilePage* page, int page_items, char* buf, int buf_len) {
+    if (page->pending.empty()) {
+        if (page->eof) return 0;
+        Json::Value root(Json::arrayValue);
+        struct dirent* entry;
+        while ((int)root.size() < page_items && (entry = readdir(page->dir)) != nullptr) {
+            std::string full_path = page->path + "/" + entry->d_name;
+            struct stat st;
+            if (stat(full_path.c_str(), &st) != 0) continue;
+
+            Json::Value item;
+            item["name"] = entry->d_name;
+            item["size"] = (Json::UInt64)st.st_size;
+            root.append(item);
+        }
+        if ((int)root.size() < page_items) page->eof = true;
+        if (root.empty()) return 0;
+
+        Json::StreamWriterBuilder writer;
+        writer["indentation"] = "";
+        page->pending = Json::writeString(writer, root);
+    }
+
+    int len = page->pending.size();
+    if (len > buf_len - 1) return len;
+    memcpy(buf, page->pending.data(), len);
+    buf[len] = '\0';
+    page->pending.clear();
+    return len;
+}
+
+int utf8_cut(const char* buf, int len) {
+    int cut = len;
+    int back = 0;
+    while (cut > 0 && back < 4 && ((unsigned char)buf[cut - 1] & 0xc0) == 0x80) {
+        cut--;
+        back++;
+    }
+    if (cut > 0 && ((unsigned char)buf[cut - 1] & 0xc0) == 0xc0) {
+        // 多字节字符的首字节，看它要求的长度是否已经完整
+        unsigned char lead = buf[cut - 1];
+        int need = lead >= 0xf0 ? 4 : (lead >= 0xe0 ? 3 : 2);
+        if (back + 1 < need) cut--;
+        else cut = len;
+    } else {
+        cut = len;
+    }
+    return cut > 0 ? cut : len;
+}
+
+// 行太长放不下时退到UTF-8字符边界，不把多字节字符切成两半
+static int text_cut(const char* buf, int len) {
+    for (int i = len - 1; i >= 0; i--) {
+        if (buf[i] == '\n') return i + 1;
+    }
+    return utf8_cut(buf, len);
+}
+
+static int text_next(FilePage* page, char* buf, int buf_len) {
+    if (page->eof || buf_len <= 1) return 0;
+    int want = buf_len - 1;
+    int len = 0;
+    ssize_t n;
+    while (len < want && (n = pread(page->fd, buf + len, want - len, page->offset + len)) > 0) {
+        len += n;
+    }
+    if (len < want) {
+        page->eof = true;
+    } else {
+        len = text_cut(buf, len);
+    }
+    page->offset += len;
+    buf[len] = '\0';
+    return len;
+}
+
+// 在本游标独占的exec通道上执行ls，不碰交互终端的shell通道；以通道EOF判断结束
+// 每页在UTF-8字符边界截断，中文文件名不会被拆到两页里各自转成JS字符串
+static int ssh_list_next(FilePage* page, char* buf, int buf_len) {
+    if (page->eof) return 0;
+    int pre = (int)page->carry.size();
+    if (buf_len <= pre + 1) return -1;
+    if (!page->exec) {
+        std::string cmd = "ls -l " + ssh_shell_quote(page->path) + " 2>&1";
+        page->exec = ssh_exec_open_impl(cmd.c_str());
+        if (!page->exec) {
+            page->eof = true;
+            return -4;
+        }
+    }
+    memcpy(buf, page->carry.data(), pre);
+    int n = ssh_exec_read_impl(page->exec, buf + pre, buf_len - pre);
+    if (n < 0) {
+        page->eof = true;
+        return -5;
+    }
+    if (n == 0) {
+        // 输出以残缺字符结尾，原样交出
+        page->eof = true;
+        page->carry.clear();
+        buf[pre] = '\0';
+        return pre;
+    }
+    int len = pre + n;
+    int cut = utf8_cut(buf, len);
+    page->carry.assign(buf + cut, len - cut);
+    buf[cut] = '\0';
+    return cut;
+}
+
+int file_page_next_impl(int page_id, int page_items, char* buf, int buf_len) {
+    if (buf == nullptr || buf_len <= 0) return -1;
+    FilePage* page = page_find(page_id);
+    if (!page) return -2;
+
+    switch (page->kind) {
+    case PAGE_LIST:
+        return list_next(page, page_items > 0 ? page_items : 1, buf, buf_len);
+    case PAGE_TEXT:
+        return text_next(page, buf, buf_len);
+    case PAGE_SSH_LIST:
+        return ssh_list_next(page, buf, buf_len);
+    }
+    return -3;
+}
+
+void file_page_close_impl(int page_id) {
+    FilePage* page = NULL;
+    {
+        JQuick::Mutex::Autolock l(page_mutex);
+        std::map<int, FilePage*>::iterator it = pages.find(page_id);
+        if (it == pages.end()) return;
+        page = it->second;
+        pages.erase(it);
+    }
+    if (page->dir) closedir(page->dir);
+    if (page->exec) ssh_exec_close_impl(page->exec);
+    if (page->fd >= 0) close(page->fd);
+    delete page;
+}
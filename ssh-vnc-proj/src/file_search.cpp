@@ -0,0 +1,515 @@
+#include "include/file_search.h"
+#include "include/file_page.h"
+#include "threadpool/StealingThreadPool.h"
+#include "utils/Functional.h"
+#include "utils/Mutex.h"
+#include "utils/Condition.h"
+#include "utils/REF.h"
+#include "port/jquick_time.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <unistd.h>
+#include <string.h>
+#include <jsoncpp/json/json.h>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+// 每个搜索最多占用的工作线程数
+#define SEARCH_MAX_WORKERS 4
+// 总命中上限，超出后停止搜索并标记truncated
+#define SEARCH_MAX_HITS 2000
+// 单个文件最多报告的命中行数
+#define SEARCH_MAX_PER_FILE 20
+// 大于该值的文件不做内容搜索
+#define SEARCH_MAX_FILE_SIZE (64 * 1024 * 1024)
+// 前4KB出现NUL视为二进制文件，跳过内容搜索（同grep -I）
+#define SEARCH_BINARY_PROBE 4096
+// 命中行预览长度
+#define SEARCH_LINE_PREVIEW 120
+// 单个目录内命中攒到这么多条就先下发，不等目录扫完
+#define SEARCH_BATCH_HITS 64
+
+// 工作线程本地攒的一批命中，下发时再转成file_search_hit或JSON
+struct SearchHit {
+    std::string path;
+    int line;
+    std::string text;
+    bool is_dir;
+};
+typedef std::vector<SearchHit> HitBatch;
+
+// 每个工作线程一个目录队列：自己从队尾取（深度优先，局部性好），空闲时从别人队头偷
+struct DirQueue {
+    JQuick::Mutex lock;
+    std::deque<std::string> dirs;
+};
+
+class SearchJob : public JQuick::REF_BASE {
+public:
+    SearchJob() : id(0), sink(NULL), userdata(NULL), nworkers(0), queues(NULL),
+                  pending(0), active(0), hit_count(0), cancelled(false), work_seq(0), idle_waiters(0),
+                  detached(false), done(false), truncated(false), start_ms(0), rare_index(0) {}
+    virtual ~SearchJob() { delete[] queues; }
+
+    int id;
+    std::string root;
+    std::string glob;
+    std::string text;
+    file_search_sink sink;
+    void* userdata;
+
+    int nworkers;
+    DirQueue* queues;
+    // 已入队或正在处理的目录数，归零即遍历结束
+    std::atomic<int> pending;
+    std::atomic<int> active;
+    std::atomic<int> hit_count;
+    std::atomic<bool> cancelled;
+
+    // 没有目录可取的worker在idle_cond上等，入队新目录、遍历结束、取消时唤醒
+    // work_seq每次入队加一，worker等待前对比，避免错过取目录失败之后的入队
+    JQuick::Mutex idle_lock;
+    JQuick::Condition idle_cond;
+    std::atomic<uint32_t> work_seq;
+    std::atomic<int> idle_waiters;
+
+    // 以下受out_lock保护
+    JQuick::Mutex out_lock;
+    bool detached;
+    bool done;
+    bool truncated;
+    std::deque<std::string> queued;
+
+    long long start_ms;
+    // text中最罕见字节的位置，memchr以它为锚点
+    size_t rare_index;
+};
+
+static JQuick::Mutex search_mutex;
+static std::map<int, JQuick::sp<SearchJob> > searches;
+static int search_id_seq = 0;
+static JQuick::StealingThreadPool* search_pool = NULL;
+// 池和组都常驻，驻留一次，之后按组号提交不再查名字
+static int32_t search_group = -1;
+
+static int worker_count() {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1) n = 1;
+    if (n > SEARCH_MAX_WORKERS) n = SEARCH_MAX_WORKERS;
+    return (int)n;
+}
+
+// 越靠前越常见；文本里的空格、小写元音等做锚点会让memchr频繁误停
+static size_t pick_rare_index(const std::string& text) {
+    static const char common[] = " etaoinsrhldcu\n\tmfpgwybv,.ETAOINS_-/=0123456789";
+    size_t best = 0;
+    int best_rank = -1;
+    for (size_t i = 0; i < text.size(); i++) {
+        const char* p = (const char*)memchr(common, text[i], sizeof(common) - 1);
+        int rank = p ? (int)(p - common) : (int)sizeof(common);
+        if (rank > best_rank) {
+            best_rank = rank;
+            best = i;
+        }
+    }
+    return best;
+}
+
+static std::string join_path(const std::string& dir, const char* name) {
+    if (!dir.empty() && dir[dir.size() - 1] == '/') return dir + name;
+    return dir + "/" + name;
+}
+
+// 伪文件系统读起来慢甚至会阻塞，除非就是从里面开始搜
+static bool skip_dir(const SearchJob* job, const std::string& path) {
+    static const char* const pseudo[] = {"/proc", "/sys", "/dev"};
+    for (size_t i = 0; i < sizeof(pseudo) / sizeof(pseudo[0]); i++) {
+        if (path == pseudo[i] && job->root.compare(0, path.size(), path) != 0) return true;
+    }
+    return false;
+}
+
+static bool name_matches(const SearchJob* job, const char* name) {
+    return job->glob.empty() || fnmatch(job->glob.c_str(), name, 0) == 0;
+}
+
+static void wake_idle(SearchJob* job, bool all) {
+    if (job->idle_waiters == 0) return;
+    JQuick::Mutex::Autolock l(job->idle_lock);
+    if (all) {
+        job->idle_cond.broadcast();
+    } else {
+        job->idle_cond.signal();
+    }
+}
+
+static void push_dir(SearchJob* job, int self, const std::string& path) {
+    job->pending++;
+    {
+        DirQueue& q = job->queues[self];
+        JQuick::Mutex::Autolock l(q.lock);
+        q.dirs.push_back(path);
+    }
+    job->work_seq++;
+    wake_idle(job, false);
+}
+
+// 先登记idle_waiters再比对work_seq，与push_dir先加work_seq再看idle_waiters配对，两边至少一方看得到对方
+static void wait_idle(SearchJob* job, uint32_t seq) {
+    JQuick::Mutex::Autolock l(job->idle_lock);
+    job->idle_waiters++;
+    while (job->work_seq == seq && job->pending > 0 && !job->cancelled) {
+        job->idle_cond.wait(job->idle_lock);
+    }
+    job->idle_waiters--;
+}
+
+static bool take_dir(SearchJob* job, int self, std::string& out) {
+    {
+        DirQueue& q = job->queues[self];
+        JQuick::Mutex::Autolock l(q.lock);
+        if (!q.dirs.empty()) {
+            out.swap(q.dirs.back());
+            q.dirs.pop_back();
+            return true;
+        }
+    }
+    for (int i = 1; i < job->nworkers; i++) {
+        DirQueue& victim = job->queues[(self + i) % job->nworkers];
+        JQuick::Mutex::Autolock l(victim.lock);
+        if (!victim.dirs.empty()) {
+            // 偷队头：离根更近，子树更大，一次偷到的活更多
+            out.swap(victim.dirs.front());
+            victim.dirs.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool claim_hit(SearchJob* job) {
+    if (job->hit_count.fetch_add(1) >= SEARCH_MAX_HITS) {
+        job->hit_count--;
+        JQuick::Mutex::Autolock l(job->out_lock);
+        job->truncated = true;
+        job->cancelled = true;
+        wake_idle(job, true);
+        return false;
+    }
+    return true;
+}
+
+static void scan_file(SearchJob* job, const std::string& path, HitBatch& hits) {
+    int fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) return;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0 ||
+        st.st_size > SEARCH_MAX_FILE_SIZE || (size_t)st.st_size < job->text.size()) {
+        close(fd);
+        return;
+    }
+    size_t size = (size_t)st.st_size;
+    void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return;
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    const char* data = (const char*)map;
+    const char* end = data + size;
+    size_t probe = size < SEARCH_BINARY_PROBE ? size : SEARCH_BINARY_PROBE;
+    if (memchr(data, 0, probe)) {
+        munmap(map, size);
+        return;
+    }
+
+    const char* needle = job->text.c_str();
+    size_t nlen = job->text.size();
+    size_t rare = job->rare_index;
+    char anchor = needle[rare];
+
+    // 行号随扫描位置增量累加，不回头重数
+    const char* line_start = data;
+    int line_no = 1;
+    int found = 0;
+    const char* p = data + rare;
+    while (p < end && found < SEARCH_MAX_PER_FILE) {
+        p = (const char*)memchr(p, anchor, end - p);
+        if (!p) break;
+        const char* cand = p - rare;
+        if ((size_t)(end - cand) < nlen) break;
+        if (memcmp(cand, needle, nlen) != 0) {
+            p++;
+            continue;
+        }
+
+        const char* nl;
+        while ((nl = (const char*)memchr(line_start, '\n', cand - line_start)) != NULL) {
+            line_start = nl + 1;
+            line_no++;
+        }
+        const char* line_end = (const char*)memchr(cand, '\n', end - cand);
+        if (!line_end) line_end = end;
+        if (!claim_hit(job)) break;
+
+        // 长行截取命中位置附近的一段，两端都落在UTF-8字符边界上
+        const char* preview = line_start;
+        if (cand + nlen - preview > SEARCH_LINE_PREVIEW) preview = cand - SEARCH_LINE_PREVIEW / 3;
+        if (preview < line_start) preview = line_start;
+        while (preview < cand && ((unsigned char)*preview & 0xc0) == 0x80) preview++;
+        size_t preview_len = line_end - preview;
+        if (preview_len > SEARCH_LINE_PREVIEW) {
+            preview_len = utf8_cut(preview, SEARCH_LINE_PREVIEW);
+        }
+        hits.push_back(SearchHit());
+        SearchHit& hit = hits.back();
+        hit.path = path;
+        hit.line = line_no;
+        hit.text.assign(preview, preview_len);
+        hit.is_dir = false;
+        found++;
+
+        // 一行只报一次
+        if (line_end == end) break;
+        line_start = line_end + 1;
+        line_no++;
+        p = line_start + rare;
+    }
+    munmap(map, size);
+}
+
+static std::string hit_to_json(const SearchHit& hit, Json::StreamWriterBuilder& writer) {
+    Json::Value item;
+    item["path"] = hit.path;
+    if (hit.line > 0) {
+        item["line"] = hit.line;
+        item["text"] = hit.text;
+    } else {
+        item["is_dir"] = hit.is_dir;
+    }
+    return Json::writeString(writer, item);
+}
+
+static void deliver(SearchJob* job, HitBatch& hits) {
+    if (hits.empty()) return;
+
+    JQuick::Mutex::Autolock l(job->out_lock);
+    if (!job->detached) {
+        if (job->sink) {
+            std::vector<file_search_hit> out(hits.size());
+            for (size_t i = 0; i < hits.size(); i++) {
+                out[i].path = hits[i].path.c_str();
+                out[i].line = hits[i].line;
+                out[i].text = hits[i].line > 0 ? hits[i].text.c_str() : NULL;
+                out[i].is_dir = hits[i].is_dir;
+            }
+            job->sink(job->id, &out[0], (int)out.size(), NULL, job->userdata);
+        } else {
+            Json::StreamWriterBuilder writer;
+            writer["indentation"] = "";
+            for (size_t i = 0; i < hits.size(); i++) {
+                job->queued.push_back(hit_to_json(hits[i], writer));
+            }
+        }
+    }
+    hits.clear();
+}
+
+static void add_name_hit(HitBatch& hits, const std::string& path, bool is_dir) {
+    hits.push_back(SearchHit());
+    SearchHit& hit = hits.back();
+    hit.path = path;
+    hit.line = 0;
+    hit.is_dir = is_dir;
+}
+
+static void scan_dir(SearchJob* job, int self, const std::string& path, HitBatch& hits) {
+    DIR* dir = opendir(path.c_str());
+    if (!dir) return;
+
+    struct dirent* entry;
+    while (!job->cancelled && (entry = readdir(dir)) != nullptr) {
+        const char* name = entry->d_name;
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) continue;
+        std::string full_path = join_path(path, name);
+
+        // 优先用d_type，避免每个条目一次stat；不跟随符号链接，防止成环
+        unsigned char type = entry->d_type;
+        if (type == DT_UNKNOWN) {
+            struct stat st;
+            if (lstat(full_path.c_str(), &st) != 0) continue;
+            type = S_ISDIR(st.st_mode) ? DT_DIR : (S_ISREG(st.st_mode) ? DT_REG : DT_LNK);
+        }
+
+        bool matched = name_matches(job, name);
+        if (type == DT_DIR) {
+            if (matched && job->text.empty() && claim_hit(job)) {
+                add_name_hit(hits, full_path, true);
+            }
+            if (!skip_dir(job, full_path)) push_dir(job, self, full_path);
+        } else if (matched) {
+            if (!job->text.empty()) {
+                if (type == DT_REG) scan_file(job, full_path, hits);
+            } else if (claim_hit(job)) {
+                add_name_hit(hits, full_path, false);
+            }
+        }
+        if (hits.size() >= SEARCH_BATCH_HITS) deliver(job, hits);
+    }
+    closedir(dir);
+    // 每个目录扫完就下发，首批结果不用等整棵树
+    deliver(job, hits);
+}
+
+static void finish_job(SearchJob* job) {
+    JQuick::Mutex::Autolock l(job->out_lock);
+    job->done = true;
+    if (job->detached || !job->sink) return;
+
+    file_search_summary summary;
+    summary.count = job->hit_count.load();
+    summary.cancelled = job->cancelled && !job->truncated;
+    summary.truncated = job->truncated;
+    summary.ms = jquick_get_current_time() - job->start_ms;
+    job->sink(job->id, NULL, 0, &summary, job->userdata);
+}
+
+static void search_worker(JQuick::sp<SearchJob> job, int self) {
+    HitBatch hits;
+    std::string dir;
+    while (!job->cancelled) {
+        uint32_t seq = job->work_seq;
+        if (!take_dir(job.get(), self, dir)) {
+            if (job->pending == 0) break;
+            // 其他线程正在展开目录，等它入队新目录或者整棵树走完
+            wait_idle(job.get(), seq);
+            continue;
+        }
+        scan_dir(job.get(), self, dir, hits);
+        if (--job->pending == 0) wake_idle(job.get(), true);
+    }
+
+    if (--job->active == 0) {
+        finish_job(job.get());
+        if (job->sink) {
+            // 推送模式结果已全部下发，无需等待poll
+            JQuick::Mutex::Autolock l(search_mutex);
+            std::map<int, JQuick::sp<SearchJob> >::iterator it = searches.find(job->id);
+            if (it != searches.end() && it->second.get() == job.get()) searches.erase(it);
+        }
+    }
+}
+
+int file_search_start_impl(const char* root, const char* name_glob, const char* text,
+                           file_search_sink sink, void* userdata) {
+    if (!root) return -1;
+    bool has_glob = name_glob && name_glob[0];
+    bool has_text = text && text[0];
+    if (!has_glob && !has_text) return -1;
+    struct stat st;
+    if (stat(root, &st) != 0 || !S_ISDIR(st.st_mode)) return -2;
+
+    JQuick::sp<SearchJob> job = new SearchJob();
+    job->root = root;
+    if (has_glob) job->glob = name_glob;
+    if (has_text) {
+        job->text = text;
+        job->rare_index = pick_rare_index(job->text);
+    }
+    job->sink = sink;
+    job->userdata = userdata;
+    job->nworkers = worker_count();
+    job->queues = new DirQueue[job->nworkers];
+    job->start_ms = jquick_get_current_time();
+
+    JQuick::Mutex::Autolock l(search_mutex);
+    if (!search_pool) {
+        search_pool = new JQuick::StealingThreadPool("file_search", SEARCH_MAX_WORKERS);
+        search_group = search_pool->internGroup("file_search");
+    }
+    job->id = ++search_id_seq;
+    searches[job->id] = job;
+
+    push_dir(job.get(), 0, job->root);
+    job->active = job->nworkers;
+    for (int i = 0; i < job->nworkers; i++) {
+        search_pool->execute(search_group, [job, i]() { search_worker(job, i); });
+    }
+    return job->id;
+}
+
+int file_search_poll_impl(int search_id, char* buf, int buf_len) {
+    if (!buf || buf_len < 512) return -1;
+
+    JQuick::sp<SearchJob> job;
+    {
+        JQuick::Mutex::Autolock l(search_mutex);
+        std::map<int, JQuick::sp<SearchJob> >::iterator it = searches.find(search_id);
+        if (it == searches.end()) return -2;
+        job = it->second;
+    }
+
+    std::string out;
+    bool finished = false;
+    {
+        JQuick::Mutex::Autolock l(job->out_lock);
+        // 按条取走，放不下的留到下次poll；预留结尾统计字段的空间
+        size_t limit = (size_t)buf_len - 1 - 128;
+        std::string hits;
+        while (!job->queued.empty()) {
+            const std::string& item = job->queued.front();
+            if (hits.size() + item.size() + 1 > limit) {
+                // 单条都放不下（超长路径），丢弃避免卡住后续结果
+                if (hits.empty()) job->queued.pop_front();
+                break;
+            }
+            if (!hits.empty()) hits += ',';
+            hits += item;
+            job->queued.pop_front();
+        }
+        finished = job->done && job->queued.empty();
+        if (finished) {
+            char tail[96];
+            snprintf(tail, sizeof(tail), "\"count\":%d,\"cancelled\":%s,\"truncated\":%s,\"ms\":%lld,",
+                     job->hit_count.load(), (job->cancelled && !job->truncated) ? "true" : "false",
+                     job->truncated ? "true" : "false", jquick_get_current_time() - job->start_ms);
+            out = std::string("{\"done\":true,") + tail + "\"hits\":[" + hits + "]}";
+        } else {
+            out = "{\"done\":false,\"hits\":[" + hits + "]}";
+        }
+    }
+
+    if (finished) {
+        JQuick::Mutex::Autolock l(search_mutex);
+        searches.erase(search_id);
+    }
+    int len = out.size();
+    memcpy(buf, out.c_str(), len);
+    buf[len] = '\0';
+    return len;
+}
+
+int file_search_cancel_impl(int search_id) {
+    JQuick::sp<SearchJob> job;
+    {
+        JQuick::Mutex::Autolock l(search_mutex);
+        std::map<int, JQuick::sp<SearchJob> >::iterator it = searches.find(search_id);
+        if (it == searches.end()) return -1;
+        job = it->second;
+        searches.erase(it);
+    }
+
+    job->cancelled = true;
+    wake_idle(job.get(), true);
+    // 工作线程持有job引用，自行退出后释放；这里只保证之后不再回调sink
+    JQuick::Mutex::Autolock l(job->out_lock);
+    job->detached = true;
+    job->queued.clear();
+    return 0;
+}
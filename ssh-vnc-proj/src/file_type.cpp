@@ -0,0 +1,211 @@
+#include "include/file_type.h"
+#include "utils/ShardedLruCache.h"
+#include "utils/Mutex.h"
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <magic.h>
+#include <jsoncpp/json/json.h>
+#include <string.h>
+#include <strings.h>
+#include <string>
+
+#define TYPE_CACHE_MAX 512
+// libmagic的文本/二进制判断看前几KB就够了，不读整个文件
+#define TYPE_PROBE_LEN 4096
+
+struct FileTypeKey {
+    dev_t dev;
+    ino_t ino;
+    time_t mtime;
+    long mtime_nsec;
+
+    bool operator==(const FileTypeKey& o) const {
+        return dev == o.dev && ino == o.ino && mtime == o.mtime && mtime_nsec == o.mtime_nsec;
+    }
+};
+
+// 只缓存由内容决定的mime/charset，viewer还和文件名有关（硬链接同ino不同名），每次现算
+struct FileTypeInfo {
+    std::string mime;
+    std::string charset;
+};
+
+struct FileTypeKeyHash {
+    size_t operator()(const FileTypeKey& key) const {
+        uint64_t h = (uint64_t)key.ino * 0x9E3779B97F4A7C15ULL;
+        h ^= (uint64_t)key.dev + (h << 6) + (h >> 2);
+        h ^= (uint64_t)key.mtime + (h << 6) + (h >> 2);
+        h ^= (uint64_t)key.mtime_nsec + (h << 6) + (h >> 2);
+        return (size_t)(h ^ (h >> 32));
+    }
+};
+
+// 文件被改写后mtime变化即是新key，旧条目自然被LRU淘汰；
+// 开TinyLFU准入，列一次大目录不会把常看的文件挤出缓存
+static JQuick::ShardedLruCache<FileTypeKey, FileTypeInfo, FileTypeKeyHash> type_cache(TYPE_CACHE_MAX, true);
+
+// magic_t不是线程安全的，数据库只加载一次，调用串行化
+static JQuick::Mutex magic_mutex;
+static magic_t magic_cookie = NULL;
+static bool magic_load_failed = false;
+
+static magic_t get_magic_locked() {
+    if (magic_cookie || magic_load_failed) return magic_cookie;
+    magic_t m = magic_open(MAGIC_MIME_TYPE | MAGIC_MIME_ENCODING | MAGIC_ERROR);
+    if (m && magic_load(m, NULL) == 0) {
+        magic_cookie = m;
+    } else {
+        if (m) magic_close(m);
+        magic_load_failed = true;
+    }
+    return magic_cookie;
+}
+
+static const char* special_mime(mode_t mode) {
+    if (S_ISDIR(mode)) return "inode/directory";
+    if (S_ISCHR(mode)) return "inode/chardevice";
+    if (S_ISBLK(mode)) return "inode/blockdevice";
+    if (S_ISFIFO(mode)) return "inode/fifo";
+    if (S_ISSOCK(mode)) return "inode/socket";
+    return NULL;
+}
+
+static int detect_locked(const char* path, FileTypeInfo& info) {
+    magic_t m = get_magic_locked();
+    if (!m) return -2;
+
+    // O_NONBLOCK防止stat和open之间文件被换成fifo时卡住
+    int fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) return -1;
+    char probe[TYPE_PROBE_LEN];
+    ssize_t len = read(fd, probe, sizeof(probe));
+    close(fd);
+    if (len < 0) return -1;
+
+    const char* res = magic_buffer(m, probe, len);
+    if (!res) return -3;
+
+    // 形如 "text/plain; charset=utf-8"
+    const char* sep = strchr(res, ';');
+    if (sep) {
+        info.mime.assign(res, sep - res);
+        const char* cs = strstr(sep, "charset=");
+        info.charset = cs ? cs + 8 : "";
+    } else {
+        info.mime = res;
+        info.charset.clear();
+    }
+    return 0;
+}
+
+static int lookup_type(const char* path, const struct stat& st, FileTypeInfo& info) {
+    const char* special = special_mime(st.st_mode);
+    if (special) {
+        info.mime = special;
+        info.charset.clear();
+        return 0;
+    }
+
+    FileTypeKey key;
+    key.dev = st.st_dev;
+    key.ino = st.st_ino;
+    key.mtime = st.st_mtim.tv_sec;
+    key.mtime_nsec = st.st_mtim.tv_nsec;
+    if (type_cache.getCache(key, info)) return 0;
+
+    int ret;
+    {
+        JQuick::Mutex::Autolock l(magic_mutex);
+        ret = detect_locked(path, info);
+    }
+    if (ret == 0) type_cache.putCache(key, info);
+    return ret;
+}
+
+static bool has_suffix(const char* name, const char* suffix) {
+    size_t n = strlen(name), s = strlen(suffix);
+    return n >= s && strcasecmp(name + n - s, suffix) == 0;
+}
+
+static const char* pick_viewer(const char* name, const FileTypeInfo& info) {
+    const std::string& mime = info.mime;
+    if (mime == "inode/directory") return "dir";
+    if (mime.compare(0, 6, "inode/") == 0) return "other";
+    if (mime.compare(0, 6, "image/") == 0) return "image";
+
+    bool textual = mime.compare(0, 5, "text/") == 0
+        || mime == "application/json" || mime == "application/xml"
+        || mime == "application/javascript" || mime == "application/x-empty"
+        || (!info.charset.empty() && info.charset != "binary");
+    if (!textual) return "hex";
+    if (has_suffix(name, ".md") || has_suffix(name, ".markdown")) return "md";
+    return "text";
+}
+
+static void fill_item(Json::Value& item, const char* name, const FileTypeInfo& info) {
+    item["mime"] = info.mime;
+    item["charset"] = info.charset;
+    item["viewer"] = pick_viewer(name, info);
+}
+
+static int write_json(const Json::Value& root, char* buf, int buf_len) {
+    Json::StreamWriterBuilder writer;
+    writer["indentation"] = "";
+    std::string json_str = Json::writeString(writer, root);
+
+    int len = json_str.length();
+    if (len > buf_len - 1) return len;
+    memcpy(buf, json_str.c_str(), len);
+    buf[len] = '\0';
+    return len;
+}
+
+int file_type_impl(const char* path, char* buf, int buf_len) {
+    if (!path || !buf || buf_len <= 1) return -1;
+    struct stat st;
+    if (stat(path, &st) != 0) return -1;
+
+    FileTypeInfo info;
+    int ret = lookup_type(path, st, info);
+    if (ret != 0) return ret;
+
+    const char* name = strrchr(path, '/');
+    name = name ? name + 1 : path;
+    Json::Value item;
+    fill_item(item, name, info);
+    return write_json(item, buf, buf_len);
+}
+
+int file_type_list_impl(const char* dir_path, char* buf, int buf_len) {
+    if (!dir_path || !buf || buf_len <= 1) return -1;
+    DIR* dir = opendir(dir_path);
+    if (!dir) return -1;
+
+    // 一次往返拿到整个列表的类型，单个文件识别失败只影响该条目
+    Json::Value root(Json::arrayValue);
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+        std::string full_path = std::string(dir_path) + "/" + entry->d_name;
+        struct stat st;
+        if (stat(full_path.c_str(), &st) != 0) continue;
+
+        FileTypeInfo info;
+        Json::Value item;
+        item["name"] = entry->d_name;
+        if (lookup_type(full_path.c_str(), st, info) == 0) {
+            fill_item(item, entry->d_name, info);
+        } else {
+            item["mime"] = "";
+            item["charset"] = "";
+            item["viewer"] = "hex";
+        }
+        root.append(item);
+    }
+    closedir(dir);
+
+    return write_json(root, buf, buf_len);
+}
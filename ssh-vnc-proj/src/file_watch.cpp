@@ -0,0 +1,406 @@
+#include "include/file_watch.h"
+#include "include/file_du.h"
+#include "looper/Thread.h"
+#include "utils/Mutex.h"
+#include "port/jquick_time.h"
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <jsoncpp/json/json.h>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+// 合并窗口：目录静默WATCH_QUIET_MS，或首个事件起WATCH_MAX_DELAY_MS后下发一次增量
+#define WATCH_QUIET_MS 50
+#define WATCH_MAX_DELAY_MS 250
+// poll模式下未取走的增量上限，超出后折叠为一条rescan
+#define WATCH_QUEUE_MAX 1024
+
+#define WATCH_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_MODIFY | \
+                    IN_CLOSE_WRITE | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF)
+
+enum {
+    WATCH_OP_ADD = 1,
+    WATCH_OP_REMOVE,
+    WATCH_OP_MODIFY,
+};
+
+struct WatchEntry {
+    int id;
+    int wd;
+    std::string path;
+    file_watch_sink sink;
+    void* userdata;
+
+    // 合并中的事件：name -> op
+    std::map<std::string, int> pending;
+    bool gone;
+    bool rescan;
+    long long first_ms;
+    long long last_ms;
+
+    // 无sink时缓存的增量（单条序列化结果）
+    std::deque<std::string> queued;
+};
+
+static JQuick::Mutex watch_mutex;
+static std::map<int, WatchEntry*> watches;
+static int watch_id_seq = 0;
+static int inotify_fd = -1;
+static int wake_pipe[2] = {-1, -1};
+static bool thread_running = false;
+
+static bool has_pending_locked(const WatchEntry* w) {
+    return !w->pending.empty() || w->gone || w->rescan;
+}
+
+static void touch_locked(WatchEntry* w, long long now) {
+    if (!has_pending_locked(w)) w->first_ms = now;
+    w->last_ms = now;
+}
+
+// 同一文件在窗口内的多次变化合并为一条
+static void merge_op_locked(WatchEntry* w, const std::string& name, int op, long long now) {
+    touch_locked(w, now);
+    std::map<std::string, int>::iterator it = w->pending.find(name);
+    if (it == w->pending.end()) {
+        w->pending[name] = op;
+        return;
+    }
+
+    int prev = it->second;
+    if (prev == WATCH_OP_ADD && op == WATCH_OP_REMOVE) {
+        // 临时文件：创建后又删除，不下发
+        w->pending.erase(it);
+    } else if (prev == WATCH_OP_ADD) {
+        // 新建后写入，仍是add
+    } else if (prev == WATCH_OP_REMOVE && op == WATCH_OP_ADD) {
+        // 删除后重建（如编辑器原子保存），视为modify
+        it->second = WATCH_OP_MODIFY;
+    } else if (op == WATCH_OP_REMOVE) {
+        it->second = WATCH_OP_REMOVE;
+    }
+}
+
+static bool is_due_locked(const WatchEntry* w, long long now) {
+    if (!has_pending_locked(w)) return false;
+    return now - w->last_ms >= WATCH_QUIET_MS || now - w->first_ms >= WATCH_MAX_DELAY_MS;
+}
+
+static int next_timeout_locked(long long now) {
+    long long deadline = -1;
+    for (std::map<int, WatchEntry*>::iterator it = watches.begin(); it != watches.end(); ++it) {
+        WatchEntry* w = it->second;
+        if (!has_pending_locked(w)) continue;
+        long long quiet = w->last_ms + WATCH_QUIET_MS;
+        long long max_delay = w->first_ms + WATCH_MAX_DELAY_MS;
+        long long due = quiet < max_delay ? quiet : max_delay;
+        if (deadline < 0 || due < deadline) deadline = due;
+    }
+    if (deadline < 0) return -1;
+    return deadline > now ? (int)(deadline - now) : 0;
+}
+
+static std::string join_path(const std::string& dir, const std::string& name) {
+    if (!dir.empty() && dir[dir.size() - 1] == '/') return dir + name;
+    return dir + "/" + name;
+}
+
+static const char* op_name(int op) {
+    switch (op) {
+        case WATCH_OP_ADD: return "add";
+        case WATCH_OP_REMOVE: return "remove";
+        default: return "modify";
+    }
+}
+
+static Json::Value make_delta(const char* op) {
+    Json::Value item;
+    item["op"] = op;
+    return item;
+}
+
+static Json::Value delta_to_json(const file_watch_delta& d) {
+    Json::Value item = make_delta(d.op);
+    if (d.name) item["name"] = d.name;
+    if (d.has_stat) {
+        item["size"] = (Json::UInt64)d.size;
+        item["is_dir"] = d.is_dir != 0;
+        item["mtime"] = (Json::Int64)d.mtime;
+    }
+    return item;
+}
+
+static void queue_delta_locked(WatchEntry* w, const file_watch_delta& d, Json::StreamWriterBuilder& writer) {
+    if (w->queued.size() >= WATCH_QUEUE_MAX) {
+        w->queued.clear();
+        w->queued.push_back(Json::writeString(writer, make_delta("rescan")));
+        return;
+    }
+    w->queued.push_back(Json::writeString(writer, delta_to_json(d)));
+}
+
+static file_watch_delta make_op(const char* op, const char* name) {
+    file_watch_delta d;
+    memset(&d, 0, sizeof(d));
+    d.op = op;
+    d.name = name;
+    return d;
+}
+
+static void flush_locked(WatchEntry* w) {
+    // name指向pending里的键，下发完才清空pending
+    std::vector<file_watch_delta> deltas;
+
+    // 目录内容有变化，du缓存里该目录的直属统计作废（含原地改写这种不更新目录mtime的情况）
+    if (w->rescan || !w->pending.empty()) {
+        file_du_invalidate_impl(w->path.c_str());
+    }
+
+    if (w->rescan) {
+        // 事件丢失，前端需要全量重新加载
+        deltas.push_back(make_op("rescan", NULL));
+    } else {
+        deltas.reserve(w->pending.size() + 1);
+        for (std::map<std::string, int>::iterator it = w->pending.begin(); it != w->pending.end(); ++it) {
+            int op = it->second;
+            file_watch_delta d = make_op(NULL, it->first.c_str());
+
+            if (op != WATCH_OP_REMOVE) {
+                // 只stat变化的条目，字段与file_list_impl保持一致
+                struct stat st;
+                if (stat(join_path(w->path, it->first).c_str(), &st) != 0) {
+                    if (op == WATCH_OP_ADD) continue;
+                    op = WATCH_OP_REMOVE;
+                } else {
+                    d.has_stat = 1;
+                    d.size = (uint64_t)st.st_size;
+                    d.is_dir = S_ISDIR(st.st_mode);
+                    d.mtime = (int64_t)st.st_mtime;
+                }
+            }
+            d.op = op_name(op);
+            deltas.push_back(d);
+        }
+    }
+    if (w->gone) {
+        deltas.push_back(make_op("gone", NULL));
+    }
+
+    if (!deltas.empty()) {
+        if (w->sink) {
+            w->sink(w->id, &deltas[0], (int)deltas.size(), w->userdata);
+        } else {
+            Json::StreamWriterBuilder writer;
+            writer["indentation"] = "";
+            for (size_t i = 0; i < deltas.size(); i++) {
+                queue_delta_locked(w, deltas[i], writer);
+            }
+        }
+    }
+
+    w->pending.clear();
+    w->rescan = false;
+    w->gone = false;
+}
+
+static void dispatch_event_locked(const struct inotify_event* ev, long long now) {
+    if (ev->mask & IN_Q_OVERFLOW) {
+        for (std::map<int, WatchEntry*>::iterator it = watches.begin(); it != watches.end(); ++it) {
+            touch_locked(it->second, now);
+            it->second->pending.clear();
+            it->second->rescan = true;
+        }
+        return;
+    }
+
+    for (std::map<int, WatchEntry*>::iterator it = watches.begin(); it != watches.end(); ++it) {
+        WatchEntry* w = it->second;
+        if (w->wd != ev->wd) continue;
+
+        if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+            touch_locked(w, now);
+            w->gone = true;
+            if (ev->mask & IN_IGNORED) w->wd = -1;  // 内核已移除该watch
+            continue;
+        }
+        if (ev->len == 0) continue;
+
+        int op = WATCH_OP_MODIFY;
+        if (ev->mask & (IN_CREATE | IN_MOVED_TO)) {
+            op = WATCH_OP_ADD;
+        } else if (ev->mask & (IN_DELETE | IN_MOVED_FROM)) {
+            op = WATCH_OP_REMOVE;
+        }
+        merge_op_locked(w, ev->name, op, now);
+    }
+}
+
+static void wake_watch_thread() {
+    if (wake_pipe[1] >= 0) {
+        char c = 1;
+        ssize_t ret = write(wake_pipe[1], &c, 1);
+        (void)ret;
+    }
+}
+
+class FileWatchThread : public JQuick::Thread {
+public:
+    FileWatchThread() : JQuick::Thread("file_watch") {}
+
+    virtual void run() {
+        char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+        while (true) {
+            int timeout;
+            {
+                JQuick::Mutex::Autolock l(watch_mutex);
+                if (watches.empty()) {
+                    thread_running = false;
+                    break;
+                }
+                timeout = next_timeout_locked(jquick_get_current_time());
+            }
+
+            struct pollfd fds[2];
+            fds[0].fd = inotify_fd;
+            fds[0].events = POLLIN;
+            fds[0].revents = 0;
+            fds[1].fd = wake_pipe[0];
+            fds[1].events = POLLIN;
+            fds[1].revents = 0;
+            int ret = poll(fds, 2, timeout);
+            if (ret < 0 && errno != EINTR) {
+                JQuick::Mutex::Autolock l(watch_mutex);
+                thread_running = false;
+                break;
+            }
+
+            if (ret > 0 && (fds[1].revents & POLLIN)) {
+                char drain[64];
+                while (read(wake_pipe[0], drain, sizeof(drain)) > 0) {}
+            }
+
+            JQuick::Mutex::Autolock l(watch_mutex);
+            long long now = jquick_get_current_time();
+            if (ret > 0 && (fds[0].revents & POLLIN)) {
+                ssize_t len;
+                while ((len = read(inotify_fd, buf, sizeof(buf))) > 0) {
+                    for (char* p = buf; p < buf + len; ) {
+                        const struct inotify_event* ev = (const struct inotify_event*)p;
+                        dispatch_event_locked(ev, now);
+                        p += sizeof(struct inotify_event) + ev->len;
+                    }
+                }
+            }
+            for (std::map<int, WatchEntry*>::iterator it = watches.begin(); it != watches.end(); ++it) {
+                if (is_due_locked(it->second, now)) flush_locked(it->second);
+            }
+        }
+        JQuick::Thread::run();
+    }
+};
+
+int file_watch_add_impl(const char* path, file_watch_sink sink, void* userdata) {
+    if (!path) return -1;
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISDIR(st.st_mode)) return -2;
+
+    JQuick::Mutex::Autolock l(watch_mutex);
+    if (inotify_fd < 0) {
+        inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotify_fd < 0) return -3;
+        if (pipe2(wake_pipe, O_NONBLOCK | O_CLOEXEC) != 0) {
+            close(inotify_fd);
+            inotify_fd = -1;
+            return -3;
+        }
+    }
+
+    int wd = inotify_add_watch(inotify_fd, path, WATCH_MASK);
+    if (wd < 0) return -4;
+
+    WatchEntry* w = new WatchEntry();
+    w->id = ++watch_id_seq;
+    w->wd = wd;
+    w->path = path;
+    w->sink = sink;
+    w->userdata = userdata;
+    w->gone = false;
+    w->rescan = false;
+    w->first_ms = 0;
+    w->last_ms = 0;
+    watches[w->id] = w;
+
+    if (!thread_running) {
+        thread_running = true;
+        (new FileWatchThread())->start();
+    }
+    return w->id;
+}
+
+int file_watch_poll_impl(int watch_id, char* buf, int buf_len) {
+    if (!buf || buf_len < 3) return -1;
+
+    JQuick::Mutex::Autolock l(watch_mutex);
+    std::map<int, WatchEntry*>::iterator it = watches.find(watch_id);
+    if (it == watches.end()) return -2;
+    WatchEntry* w = it->second;
+
+    // 按条取走，放不下的留到下次poll
+    int len = 0;
+    buf[len++] = '[';
+    while (!w->queued.empty()) {
+        const std::string& item = w->queued.front();
+        int need = (int)item.size() + (len > 1 ? 1 : 0);
+        if (len + need + 1 > buf_len - 1) {
+            if (len == 1) {
+                // 单条都放不下，只能让前端全量刷新
+                w->queued.pop_front();
+                w->queued.push_front("{\"op\":\"rescan\"}");
+                if ((int)w->queued.front().size() + 2 > buf_len - 1) break;
+                continue;
+            }
+            break;
+        }
+        if (len > 1) buf[len++] = ',';
+        memcpy(buf + len, item.c_str(), item.size());
+        len += item.size();
+        w->queued.pop_front();
+    }
+    buf[len++] = ']';
+    buf[len] = '\0';
+    return len;
+}
+
+int file_watch_remove_impl(int watch_id) {
+    JQuick::Mutex::Autolock l(watch_mutex);
+    std::map<int, WatchEntry*>::iterator it = watches.find(watch_id);
+    if (it == watches.end()) return -1;
+    WatchEntry* w = it->second;
+    watches.erase(it);
+
+    // 同一目录的多个监听共享一个wd，最后一个移除时才释放
+    bool shared = false;
+    for (std::map<int, WatchEntry*>::iterator iter = watches.begin(); iter != watches.end(); ++iter) {
+        if (iter->second->wd == w->wd) {
+            shared = true;
+            break;
+        }
+    }
+    if (w->wd >= 0 && !shared) {
+        inotify_rm_watch(inotify_fd, w->wd);
+    }
+    delete w;
+
+    // 让监听线程在没有watch时退出
+    wake_watch_thread();
+    return 0;
+}
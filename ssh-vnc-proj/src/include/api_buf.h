@@ -0,0 +1,33 @@
+#ifndef API_BUF_H
+#define API_BUF_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 导出接口的结果缓冲
+// _impl填充函数约定：返回写入长度（不含'\0'）；buf放不下时返回所需长度（>= buf_len）且内容不可用
+// 可重复读但长度未知的（/proc文件）写满后确认还有数据时，返回估计的所需长度（>= buf_len）
+// 读走就没了的（流、管道）写满buf_len - 1即视为可能还有，由调用方换大缓冲继续
+
+// 临时缓冲按尺寸分级复用（8K/32K/128K/512K/2M），更大的直接malloc，超过API_RESULT_MAX返回NULL
+#define API_RESULT_MAX (32 * 1024 * 1024)
+char* api_scratch_get(int min_size, int* cap);
+void api_scratch_put(char* buf, int cap);
+
+// 按实际长度malloc一份返回给前端（仍由前端框架free释放），并记入该接口的计数
+char* api_result_dup(const char* api, const char* data, int len);
+// 扩容重试、失败计数
+void api_stats_grow(const char* api);
+void api_stats_fail(const char* api);
+
+// {"scratch":{"hits":..,"misses":..,"large":..},"apis":{"file_list":{"calls":..,"bytes":..,"max":..,"grows":..,"fails":..}}}
+int api_buf_stats_impl(char* buf, int buf_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef FILE_DU_H
+#define FILE_DU_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 目录占用分析（du -x）：并行计算path下每个子项的递归磁盘占用，算完一个下发一个
+// 分批产出 [{"name":"log","is_dir":true,"bytes":1048576,"files":120,"dirs":8}, ...]
+// 结束时产出 {"bytes":..,"files":..,"dirs":..,"cached_dirs":..,"scanned_dirs":..,"cancelled":false,"ms":..}
+typedef struct {
+    const char* name;
+    int is_dir;
+    uint64_t bytes;
+    uint64_t files;
+    uint64_t dirs;
+} file_du_item;
+
+typedef struct {
+    uint64_t bytes;
+    uint64_t files;
+    uint64_t dirs;
+    int cached_dirs;
+    int scanned_dirs;
+    int cancelled;
+    long long ms;
+} file_du_summary;
+
+// 推送模式直接给出结构化结果，指针只在回调期间有效；summary非空表示结束，此时items为空
+typedef void (*file_du_sink)(int du_id, const file_du_item* items, int count,
+                             const file_du_summary* summary, void* userdata);
+
+// 每个目录的直属文件统计按(dev, ino, mtime)缓存，目录内容不变时不再readdir/stat其中的文件；
+// 缓存超过10分钟即失效，refresh非0时忽略缓存全部重新读取
+int file_du_start_impl(const char* path, int refresh, file_du_sink sink, void* userdata);
+// poll模式输出JSON文本 {"done":false,"items":[...]}，结束且取完后输出done=true及统计字段，之后该du_id失效
+int file_du_poll_impl(int du_id, char* buf, int buf_len);
+// 返回后不会再有sink回调
+int file_du_cancel_impl(int du_id);
+// 文件原地改写不会更新目录mtime，由调用方（如目录监听）显式作废；path为文件时作废其所在目录
+void file_du_invalidate_impl(const char* path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
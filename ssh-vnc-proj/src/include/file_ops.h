@@ -7,9 +7,11 @@
 extern "C" {
 #endif
 
-// 原有_impl函数（不变）
+// 原有_impl函数；带buf的返回写入长度，buf放不下时返回所需长度（约定见api_buf.h）
 int file_list_impl(const char* path, char* buf, int buf_len);
-int file_list_via_ssh_impl(const char* path, char* buf, int buf_len);
+// 在独立exec通道上执行ls -l path，输出用ssh_exec_read_impl读到EOF，用完ssh_exec_close_impl（见ssh_conn_manager.h）
+typedef struct SshExec SshExec;
+SshExec* file_list_via_ssh_impl(const char* path);
 int file_read_text_impl(const char* path, char* buf, int buf_len);
 int file_read_hex_impl(const char* path, char* buf, int buf_len);
 int file_render_md_impl(const char* path, char* buf, int buf_len);
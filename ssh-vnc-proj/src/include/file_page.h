@@ -0,0 +1,36 @@
+#ifndef FILE_PAGE_H
+#define FILE_PAGE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 分页游标：目录列表、文本查看、远端列表按页按需产出，常驻内存以一页为界（JS侧异步迭代见jq_module.cpp）
+// 页大小上限：目录页按项数，文本/远端列表页按字节数
+#define FILE_PAGE_MAX_ITEMS 4096
+#define FILE_PAGE_MAX_BYTES (1024 * 1024)
+// 打开返回page_id（>0），失败返回负数
+int file_page_list_open_impl(const char* path);
+int file_page_text_open_impl(const char* path);
+int file_page_ssh_list_open_impl(const char* path);
+
+// 取下一页写入buf：返回写入长度，0表示已取完，负数出错；约定同api_buf.h，放不下时返回所需长度（>= buf_len），
+// 这一页留在游标里，换大缓冲再取
+// 列表页为 [{"name":"hosts","size":158}, ...]，最多page_items项
+// 文本页最多buf_len - 1字节，在行尾（一行放不下时在UTF-8字符边界）截断，剩余的留到下一页
+// 远端列表页为ls -l输出的一段原文，在UTF-8字符边界截断，在本游标独占的exec通道上执行，通道EOF即结束（见ssh_exec_open_impl）
+// 远端列表走本库自己的会话（ssh_connect），与宿主$falcon按connId管理的连接无关
+// 同一page_id的next/close由调用方串行调用
+int file_page_next_impl(int page_id, int page_items, char* buf, int buf_len);
+void file_page_close_impl(int page_id);
+
+// buf前len字节末尾是不完整的UTF-8多字节字符时，返回去掉它之后的长度，否则返回len
+int utf8_cut(const char* buf, int len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef FILE_SEARCH_H
+#define FILE_SEARCH_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 递归搜索：name_glob按文件名匹配（fnmatch），text非空时再搜索文件内容，两者至少给一个
+// 命中分批产出 [{"path":"/etc/hosts","line":3,"text":"127.0.0.1 localhost"}, ...]
+// 只按文件名搜索时为 [{"path":"/etc/hosts","is_dir":false}, ...]
+// 结束时产出 {"count":12,"cancelled":false,"truncated":false,"ms":35}
+typedef struct {
+    const char* path;
+    // 内容命中的行号和行预览；只按文件名搜索时line为0、text为NULL，改用is_dir
+    int line;
+    const char* text;
+    int is_dir;
+} file_search_hit;
+
+typedef struct {
+    int count;
+    int cancelled;
+    int truncated;
+    long long ms;
+} file_search_summary;
+
+// 推送模式直接给出结构化结果，指针只在回调期间有效；summary非空表示结束，此时hits为空
+typedef void (*file_search_sink)(int search_id, const file_search_hit* hits, int count,
+                                 const file_search_summary* summary, void* userdata);
+
+// sink为空时结果缓存在内部（JSON文本），由file_search_poll_impl取走；sink在工作线程回调（已串行化），不可在其中调用file_search_*
+int file_search_start_impl(const char* root, const char* name_glob, const char* text,
+                           file_search_sink sink, void* userdata);
+// 输出 {"done":false,"hits":[...]}，结束且取完后输出done=true及统计字段，之后该search_id失效
+int file_search_poll_impl(int search_id, char* buf, int buf_len);
+// 返回后不会再有sink回调
+int file_search_cancel_impl(int search_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef FILE_TYPE_H
+#define FILE_TYPE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 文件类型识别（libmagic）：只读文件首块，结果按(dev, ino, mtime)缓存
+// 只处理本机路径；SSH远端的文件（文件页列表）不经过这里
+// 单个文件输出 {"mime":"text/plain","charset":"utf-8","viewer":"text"}
+// viewer: dir / text / md / image / hex / other（设备、管道等不可预览）
+int file_type_impl(const char* path, char* buf, int buf_len);
+// 整个目录批量识别，输出 [{"name":"a.md","mime":"text/plain","charset":"utf-8","viewer":"md"}, ...]
+int file_type_list_impl(const char* dir_path, char* buf, int buf_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
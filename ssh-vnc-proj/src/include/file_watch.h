@@ -0,0 +1,35 @@
+#ifndef FILE_WATCH_H
+#define FILE_WATCH_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 目录监听（inotify）：突发事件合并后产出增量 [{op,name,size,is_dir,mtime}, ...]
+// op: add / remove / modify；目录本身被删除/移走时产出 gone，队列溢出时产出 rescan
+typedef struct {
+    const char* op;
+    // gone/rescan时为NULL
+    const char* name;
+    // 0时没有size/is_dir/mtime字段（remove/gone/rescan，或stat失败）
+    int has_stat;
+    uint64_t size;
+    int is_dir;
+    int64_t mtime;
+} file_watch_delta;
+
+// 推送模式直接给出结构化增量，由调用方转成自己的对象，不经过JSON文本；指针只在回调期间有效
+typedef void (*file_watch_sink)(int watch_id, const file_watch_delta* deltas, int count, void* userdata);
+
+// sink为空时增量缓存在内部队列，由file_watch_poll_impl取走（JSON文本）；sink在监听线程回调，不可在其中调用file_watch_*
+int file_watch_add_impl(const char* path, file_watch_sink sink, void* userdata);
+int file_watch_poll_impl(int watch_id, char* buf, int buf_len);
+int file_watch_remove_impl(int watch_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
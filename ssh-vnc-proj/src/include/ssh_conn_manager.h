@@ -28,8 +28,22 @@ int ssh_read_stream_impl(char* buf, int buf_len);
 int ssh_send_key_impl(const char* key);
 int ssh_send_esc_impl();
 
+// 后台命令（远端列表等）：在当前会话上单独开exec通道，不经过交互终端的shell通道，两边输出互不串读
+// 所有会话操作都在会话锁内进行，等待网络时不持锁；会话断开后旧通道上的读返回错误
+typedef struct SshExec SshExec;
+// 失败（未连接、开通道或exec失败、超时）返回NULL
+SshExec* ssh_exec_open_impl(const char* cmd);
+// 返回读到的字节数（buf以'\0'结尾，最多buf_len - 1），0表示命令输出已读完（通道EOF），负数出错/超时
+int ssh_exec_read_impl(SshExec* exec, char* buf, int buf_len);
+void ssh_exec_close_impl(SshExec* exec);
+
 #ifdef __cplusplus
 }
+
+#include <string>
+
+// 拼远端命令用：单引号包住参数，参数里的单引号写成'\''
+std::string ssh_shell_quote(const std::string& s);
 #endif
 
 #endif
\ No newline at end of file
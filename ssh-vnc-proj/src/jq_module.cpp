@@ -0,0 +1,444 @@
+#include "include/file_watch.h"
+#include "include/file_search.h"
+#include "include/file_du.h"
+#include "include/file_page.h"
+#include "include/api_buf.h"
+#include "jquick_config.h"
+#include "JQuickContext.h"
+#include "jqutil_v2/jqutil.h"
+#include "jsmodules/JSCModuleExtension.h"
+#include "port/jquick_time.h"
+#include <string.h>
+#include <string>
+#include <atomic>
+
+using namespace JQUTIL_NS;
+
+// JS侧原生模块：import native from 'ssh_vnc_native'
+// 需要推送/异步能力的接口放在这里，简单同步接口仍走ssh_vnc_core.cpp的C导出
+
+// ====================== FileWatcher：目录增量推送 ======================
+// const w = new native.FileWatcher('/etc'); w.on('change', deltas => {...}); w.close()
+class FileWatchObject : public JQPublishObject {
+public:
+    FileWatchObject() : _watchId(0), _selfRef(NULL) {}
+
+    virtual void OnInit() {
+        JQPublishObject::OnInit();
+    }
+
+    virtual void OnCtor(JQFunctionInfo& info) {
+        JSContext* ctx = info.GetContext();
+        JQString path(ctx, info[0]);
+        if (!path.isString()) {
+            info.GetReturnValue().ThrowTypeError("arg0 should be path as string type");
+            return;
+        }
+
+        // 监听线程只持有弱引用，JS对象回收后不再推送
+        _selfRef = new JQuick::wp<FileWatchObject>(this);
+        _watchId = file_watch_add_impl(path.get(), &FileWatchObject::OnDelta, _selfRef);
+        if (_watchId <= 0) {
+            int err = _watchId;
+            _release();
+            info.GetReturnValue().ThrowInternalError("watch %s failed: %d", path.get(), err);
+        }
+    }
+
+    virtual void OnGCCollect() {
+        _release();
+    }
+
+    void close(JQFunctionInfo& info) {
+        _release();
+    }
+
+private:
+    void _release() {
+        if (_watchId > 0) {
+            file_watch_remove_impl(_watchId);
+        }
+        _watchId = 0;
+        // remove之后不会再有回调，可以安全释放
+        delete _selfRef;
+        _selfRef = NULL;
+    }
+
+    // 运行在监听线程
+    static void OnDelta(int watch_id, const file_watch_delta* deltas, int count, void* userdata) {
+        JQuick::sp<FileWatchObject> self = ((JQuick::wp<FileWatchObject>*)userdata)->promote();
+        if (!self.get()) return;
+        Bson::array list;
+        list.reserve(count);
+        for (int i = 0; i < count; i++) {
+            const file_watch_delta& d = deltas[i];
+            BsonObjectBuilder item;
+            item.add("op", d.op);
+            if (d.name) item.add("name", d.name);
+            if (d.has_stat) {
+                item.add("size", (double)d.size);
+                item.add("is_dir", d.is_dir != 0);
+                item.add("mtime", (double)d.mtime);
+            }
+            list.push_back(item.build());
+        }
+        self->publish("change", Bson(std::move(list)), JQ_PUBLISH_TYPE_ASYNC);
+    }
+
+    int _watchId;
+    JQuick::wp<FileWatchObject>* _selfRef;
+};
+
+// ====================== FileSearch：并行递归搜索，结果分批推送 ======================
+// const s = new native.FileSearch('/etc', '*.conf', 'localhost');
+// s.on('hits', list => {...}); s.on('done', summary => {...}); s.cancel()
+class FileSearchObject : public JQPublishObject {
+public:
+    FileSearchObject() : _searchId(0), _selfRef(NULL) {}
+
+    virtual void OnInit() {
+        JQPublishObject::OnInit();
+    }
+
+    virtual void OnCtor(JQFunctionInfo& info) {
+        JSContext* ctx = info.GetContext();
+        JQString root(ctx, info[0]);
+        if (!root.isString()) {
+            info.GetReturnValue().ThrowTypeError("arg0 should be root path as string type");
+            return;
+        }
+        JQString glob(ctx, info[1]);
+        JQString text(ctx, info[2]);
+
+        _selfRef = new JQuick::wp<FileSearchObject>(this);
+        _searchId = file_search_start_impl(root.get(), glob.isString() ? glob.get() : NULL,
+                                           text.isString() ? text.get() : NULL,
+                                           &FileSearchObject::OnResult, _selfRef);
+        if (_searchId <= 0) {
+            int err = _searchId;
+            _release();
+            info.GetReturnValue().ThrowInternalError("search %s failed: %d", root.get(), err);
+        }
+    }
+
+    virtual void OnGCCollect() {
+        _release();
+    }
+
+    void cancel(JQFunctionInfo& info) {
+        _release();
+    }
+
+private:
+    void _release() {
+        if (_searchId > 0) {
+            file_search_cancel_impl(_searchId);
+        }
+        _searchId = 0;
+        delete _selfRef;
+        _selfRef = NULL;
+    }
+
+    // 运行在搜索工作线程（已串行化）
+    // 结果量大走批量分道，不挤占输入和界面刷新；done同一分道，保证在最后一批hits之后
+    static void OnResult(int search_id, const file_search_hit* hits, int count,
+                         const file_search_summary* summary, void* userdata) {
+        JQuick::sp<FileSearchObject> self = ((JQuick::wp<FileSearchObject>*)userdata)->promote();
+        if (!self.get()) return;
+        if (summary) {
+            BsonObjectBuilder done;
+            done.add("count", summary->count);
+            done.add("cancelled", summary->cancelled != 0);
+            done.add("truncated", summary->truncated != 0);
+            done.add("ms", (double)summary->ms);
+            self->publish("done", done.build(), JQ_PUBLISH_TYPE_ASYNC, JQ_LANE_BULK);
+            return;
+        }
+        Bson::array list;
+        list.reserve(count);
+        for (int i = 0; i < count; i++) {
+            BsonObjectBuilder item;
+            item.add("path", hits[i].path);
+            if (hits[i].text) {
+                item.add("line", hits[i].line);
+                item.add("text", hits[i].text);
+            } else {
+                item.add("is_dir", hits[i].is_dir != 0);
+            }
+            list.push_back(item.build());
+        }
+        self->publish("hits", Bson(std::move(list)), JQ_PUBLISH_TYPE_ASYNC, JQ_LANE_BULK);
+    }
+
+    int _searchId;
+    JQuick::wp<FileSearchObject>* _selfRef;
+};
+
+// ====================== DiskUsage：目录占用分析，子目录算完即推送 ======================
+// const du = new native.DiskUsage('/data');  第二个参数为true时忽略目录缓存重新统计
+// du.on('items', list => {...}); du.on('done', summary => {...}); du.cancel()
+class DiskUsageObject : public JQPublishObject {
+public:
+    DiskUsageObject() : _duId(0), _selfRef(NULL) {}
+
+    virtual void OnInit() {
+        JQPublishObject::OnInit();
+    }
+
+    virtual void OnCtor(JQFunctionInfo& info) {
+        JSContext* ctx = info.GetContext();
+        JQString path(ctx, info[0]);
+        if (!path.isString()) {
+            info.GetReturnValue().ThrowTypeError("arg0 should be path as string type");
+            return;
+        }
+
+        int refresh = JS_ToBool(ctx, info[1]) > 0;
+
+        _selfRef = new JQuick::wp<DiskUsageObject>(this);
+        _duId = file_du_start_impl(path.get(), refresh, &DiskUsageObject::OnResult, _selfRef);
+        if (_duId <= 0) {
+            int err = _duId;
+            _release();
+            info.GetReturnValue().ThrowInternalError("du %s failed: %d", path.get(), err);
+        }
+    }
+
+    virtual void OnGCCollect() {
+        _release();
+    }
+
+    void cancel(JQFunctionInfo& info) {
+        _release();
+    }
+
+private:
+    void _release() {
+        if (_duId > 0) {
+            file_du_cancel_impl(_duId);
+        }
+        _duId = 0;
+        delete _selfRef;
+        _selfRef = NULL;
+    }
+
+    // 运行在分析工作线程（已串行化）
+    static void OnResult(int du_id, const file_du_item* items, int count,
+                         const file_du_summary* summary, void* userdata) {
+        JQuick::sp<DiskUsageObject> self = ((JQuick::wp<DiskUsageObject>*)userdata)->promote();
+        if (!self.get()) return;
+        if (summary) {
+            BsonObjectBuilder done;
+            done.add("bytes", (double)summary->bytes);
+            done.add("files", (double)summary->files);
+            done.add("dirs", (double)summary->dirs);
+            done.add("cached_dirs", summary->cached_dirs);
+            done.add("scanned_dirs", summary->scanned_dirs);
+            done.add("cancelled", summary->cancelled != 0);
+            done.add("ms", (double)summary->ms);
+            self->publish("done", done.build(), JQ_PUBLISH_TYPE_ASYNC, JQ_LANE_BULK);
+            return;
+        }
+        Bson::array list;
+        list.reserve(count);
+        for (int i = 0; i < count; i++) {
+            BsonObjectBuilder item;
+            item.add("name", items[i].name);
+            item.add("is_dir", items[i].is_dir != 0);
+            item.add("bytes", (double)items[i].bytes);
+            item.add("files", (double)items[i].files);
+            item.add("dirs", (double)items[i].dirs);
+            list.push_back(item.build());
+        }
+        self->publish("items", Bson(std::move(list)), JQ_PUBLISH_TYPE_ASYNC, JQ_LANE_BULK);
+    }
+
+    int _duId;
+    JQuick::wp<DiskUsageObject>* _selfRef;
+};
+
+// ====================== 分页异步迭代：目录列表/文本查看/远端列表 ======================
+// for await (const list of new native.DirPages('/etc', 200)) {...}        每页 [{"name":..,"size":..}, ...]
+// for await (const text of new native.TextPages('/var/log/messages', 65536)) {...}  每页一段文本，在行尾截断
+// for await (const text of new native.RemoteListPages('/home', 16384)) {...}        每页ls -l输出的一段（本库ssh_connect的会话）
+// 页在原生侧按需产出，JS侧不取下一页就不读，break时关闭游标
+class FilePagesObject : public JQAsyncIterObject {
+public:
+    enum Kind {
+        KIND_DIR,
+        KIND_TEXT,
+        KIND_REMOTE_LIST,
+    };
+
+    FilePagesObject(Kind kind) : _kind(kind), _pageId(0), _pageSize(0) {}
+
+    virtual ~FilePagesObject() {
+        _close();
+    }
+
+    virtual void OnCtor(JQFunctionInfo& info) {
+        JSContext* ctx = info.GetContext();
+        JQString path(ctx, info[0]);
+        if (!path.isString()) {
+            info.GetReturnValue().ThrowTypeError("arg0 should be path as string type");
+            return;
+        }
+        int32_t pageSize = 0;
+        if (info.Length() > 1) {
+            JS_ToInt32(ctx, &pageSize, info[1]);
+        }
+        // 目录页按项数，其他按字节数，超过上限按上限取
+        int maxSize = _kind == KIND_DIR ? FILE_PAGE_MAX_ITEMS : FILE_PAGE_MAX_BYTES;
+        _pageSize = pageSize > 0 ? pageSize : (_kind == KIND_DIR ? 256 : 64 * 1024);
+        if (_pageSize > maxSize) _pageSize = maxSize;
+
+        int pageId;
+        if (_kind == KIND_DIR) {
+            pageId = file_page_list_open_impl(path.get());
+        } else if (_kind == KIND_TEXT) {
+            pageId = file_page_text_open_impl(path.get());
+        } else {
+            pageId = file_page_ssh_list_open_impl(path.get());
+        }
+        if (pageId <= 0) {
+            info.GetReturnValue().ThrowInternalError("open pages %s failed: %d", path.get(), pageId);
+            return;
+        }
+        _pageId.store(pageId);
+    }
+
+protected:
+    // 运行在本对象的异步线程
+    virtual int onAsyncIteratorNext(JQAsyncIterPage& page) {
+        int pageId = _pageId.load();
+        if (pageId <= 0) return 0;
+        int items = _kind == KIND_DIR ? _pageSize : 0;
+        int cap = 0;
+        char* buf = api_scratch_get(_kind == KIND_DIR ? 8192 : _pageSize + 1, &cap);
+        // 分级缓冲可能比页大，文本按页大小取
+        int room = (_kind == KIND_DIR || cap < _pageSize + 1) ? cap : _pageSize + 1;
+        int len = buf ? file_page_next_impl(pageId, items, buf, room) : -1;
+        if (buf && _kind == KIND_DIR && len >= cap) {
+            // 列表页放不下，按所需长度换缓冲再取同一页
+            api_scratch_put(buf, cap);
+            buf = api_scratch_get(len + 1, &cap);
+            len = buf ? file_page_next_impl(pageId, items, buf, cap) : -1;
+        }
+        if (len > 0) {
+            if (_kind == KIND_DIR) {
+                page.setJSON(std::string(buf, len));
+            } else {
+                page.set(Bson(std::string(buf, len)));
+            }
+        } else {
+            _close();
+        }
+        api_scratch_put(buf, cap);
+        return len;
+    }
+
+    virtual void onAsyncIteratorReturn() {
+        _close();
+    }
+
+private:
+    // 析构可能在JS线程，next/return在本对象的异步线程，游标只由先取到id的一方关闭
+    void _close() {
+        int pageId = _pageId.exchange(0);
+        if (pageId > 0) {
+            file_page_close_impl(pageId);
+        }
+    }
+
+    Kind _kind;
+    std::atomic<int> _pageId;
+    int _pageSize;
+};
+
+// native.stats()：各接口调用次数、入/出字节、耗时和排队时间分位数（us），见JQTrace.h；
+// "(lanes)"项是本线程推送分道的排队时延，见JQLaneDispatcher.h，还没有推送对象时没有这一项
+static JSValue native_stats(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv) {
+    Bson apis = JQTraceStats();
+    JQuick::sp<JQLaneDispatcher> lanes = JQLaneDispatcher::Find(JQuick::getJSLooper(JS_GetRuntime(ctx)));
+    if (!lanes.get()) {
+        return bsonToJSValue(ctx, apis);
+    }
+    BsonObjectBuilder stats;
+    stats.reserve(apis.object_items().size() + 1);
+    for (auto& it : apis.object_items()) {
+        stats.add(it.first, it.second);
+    }
+    stats.add("(lanes)", lanes->statsToBson());
+    return bsonToJSValue(ctx, stats.build());
+}
+
+// native.now()：开机以来的毫秒数（带小数），单调递增，不受系统改时间影响
+static JSValue native_now(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv) {
+    return JS_NewFloat64(ctx, jquick_get_current_time_ns() / 1e6);
+}
+
+static void set_module_class(JQuick::sp<JQModuleEnv> env, JQFunctionTemplateRef tpl) {
+    JSContext* ctx = env->context();
+    JSValue func = tpl->GetFunction();
+    env->setModuleField(tpl->name(), func);
+    JS_FreeValue(ctx, func);
+}
+
+static int ssh_vnc_native_init(JSContext* ctx, JSModuleDef* m) {
+    JQuick::sp<JQModuleEnv> env = JQModuleEnv::CreateModule(ctx, m, "ssh_vnc_native");
+
+    JQFunctionTemplateRef watchTpl = JQFunctionTemplate::New(env, "FileWatcher");
+    watchTpl->InstanceTemplate()->setObjectCreator([]() {
+        return new FileWatchObject();
+    });
+    JQPublishObject::InitTpl(watchTpl);
+    watchTpl->SetProtoMethod("close", &FileWatchObject::close);
+    set_module_class(env, watchTpl);
+
+    JQFunctionTemplateRef searchTpl = JQFunctionTemplate::New(env, "FileSearch");
+    searchTpl->InstanceTemplate()->setObjectCreator([]() {
+        return new FileSearchObject();
+    });
+    JQPublishObject::InitTpl(searchTpl);
+    searchTpl->SetProtoMethod("cancel", &FileSearchObject::cancel);
+    set_module_class(env, searchTpl);
+
+    JQFunctionTemplateRef duTpl = JQFunctionTemplate::New(env, "DiskUsage");
+    duTpl->InstanceTemplate()->setObjectCreator([]() {
+        return new DiskUsageObject();
+    });
+    JQPublishObject::InitTpl(duTpl);
+    duTpl->SetProtoMethod("cancel", &DiskUsageObject::cancel);
+    set_module_class(env, duTpl);
+
+    static const struct {
+        const char* name;
+        FilePagesObject::Kind kind;
+    } pageClasses[] = {
+        {"DirPages", FilePagesObject::KIND_DIR},
+        {"TextPages", FilePagesObject::KIND_TEXT},
+        {"RemoteListPages", FilePagesObject::KIND_REMOTE_LIST},
+    };
+    for (size_t i = 0; i < sizeof(pageClasses) / sizeof(pageClasses[0]); i++) {
+        FilePagesObject::Kind kind = pageClasses[i].kind;
+        JQFunctionTemplateRef pagesTpl = JQFunctionTemplate::New(env, pageClasses[i].name);
+        pagesTpl->InstanceTemplate()->setObjectCreator([kind]() {
+            return new FilePagesObject(kind);
+        });
+        JQAsyncIterObject::InitTpl(pagesTpl);
+        set_module_class(env, pagesTpl);
+    }
+
+    JSValue statsFunc = JS_NewCFunction(ctx, native_stats, "stats", 0);
+    env->setModuleField("stats", statsFunc);
+    JS_FreeValue(ctx, statsFunc);
+
+    JSValue nowFunc = JS_NewCFunction(ctx, native_now, "now", 0);
+    env->setModuleField("now", nowFunc);
+    JS_FreeValue(ctx, nowFunc);
+
+    env->setModuleExportDone();
+    return 0;
+}
+
+DEF_MODULE(ssh_vnc_native, ssh_vnc_native_init)
@@ -6,10 +6,29 @@
 #include <fcntl.h>
 #include <string.h>
 #include <stdlib.h>
+#include <poll.h>
+#include "utils/Mutex.h"
+#include "port/jquick_time.h"
+
+// exec通道无数据/打不开时最长等待
+#define SSH_EXEC_TIMEOUT_MS 15000
+// 非阻塞会话上等socket的单次上限，期间不持有会话锁
+#define SSH_EXEC_POLL_MS 100
 
 static int sock_fd = -1;
 static LIBSSH2_SESSION* ssh_session = nullptr;
 static LIBSSH2_CHANNEL* ssh_channel = nullptr;
+// 会话锁：libssh2同一会话不能多线程同时调用，交互终端（JS线程）和后台exec通道都在锁内操作
+static JQuick::Mutex ssh_mutex;
+// 每次断开加一，旧会话上的exec通道据此判断已随会话释放
+static int ssh_generation = 0;
+
+struct SshExec {
+    LIBSSH2_CHANNEL* channel;
+    int generation;
+};
+
+static void disconnect_locked();
 
 // 原有_impl函数（仅修正ssh_connect_with_key_impl→ssh_connect_key_impl）
 int ssh_global_init_impl() {
@@ -17,8 +36,9 @@ int ssh_global_init_impl() {
 }
 
 int ssh_connect_impl(const char* ip, const char* port, const char* user, const char* pass) {
+    JQuick::Mutex::Autolock l(ssh_mutex);
     if (ssh_session != nullptr) {
-        ssh_disconnect_impl();
+        disconnect_locked();
     }
 
     sock_fd = socket(AF_INET, SOCK_STREAM, 0);
@@ -79,8 +99,9 @@ int ssh_connect_impl(const char* ip, const char* port, const char* user, const c
 
 // ✅ 修正：ssh_connect_with_key_impl → ssh_connect_key_impl
 int ssh_connect_key_impl(const char* ip, const char* port, const char* user, const char* key_path) {
+    JQuick::Mutex::Autolock l(ssh_mutex);
     if (ssh_session != nullptr) {
-        ssh_disconnect_impl();
+        disconnect_locked();
     }
 
     sock_fd = socket(AF_INET, SOCK_STREAM, 0);
@@ -140,6 +161,12 @@ int ssh_connect_key_impl(const char* ip, const char* port, const char* user, con
 }
 
 void ssh_disconnect_impl() {
+    JQuick::Mutex::Autolock l(ssh_mutex);
+    disconnect_locked();
+}
+
+static void disconnect_locked() {
+    ssh_generation++;
     if (ssh_channel != nullptr) {
         libssh2_channel_close(ssh_channel);
         libssh2_channel_free(ssh_channel);
@@ -159,11 +186,13 @@ void ssh_disconnect_impl() {
 }
 
 int ssh_write_stream_impl(const char* data) {
+    JQuick::Mutex::Autolock l(ssh_mutex);
     if (ssh_channel == nullptr) return -1;
     return libssh2_channel_write(ssh_channel, data, strlen(data));
 }
 
 int ssh_read_stream_impl(char* buf, int buf_len) {
+    JQuick::Mutex::Autolock l(ssh_mutex);
     if (ssh_channel == nullptr || buf == nullptr || buf_len <= 0) return -1;
     return libssh2_channel_read(ssh_channel, buf, buf_len - 1);
 }
@@ -193,10 +222,118 @@ int ssh_send_key_impl(const char* key) {
         snprintf(key_seq, sizeof(key_seq), "%s", key);
     }
 
+    JQuick::Mutex::Autolock l(ssh_mutex);
+    if (ssh_channel == nullptr) return -1;
     return libssh2_channel_write(ssh_channel, key_seq, strlen(key_seq));
 }
 
 // ✅ 补实现：ssh_send_esc_impl（发送ESC，vim必备）
 int ssh_send_esc_impl() {
     return ssh_send_key_impl("esc");
-}
\ No newline at end of file
+}
+
+// 在不持有会话锁的情况下按libssh2要求的方向等socket，超时或出错都返回，由调用方重试/判超时
+static void wait_socket(int fd, int dirs) {
+    if (fd < 0) return;
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = 0;
+    if (dirs & LIBSSH2_SESSION_BLOCK_INBOUND) pfd.events |= POLLIN;
+    if (dirs & LIBSSH2_SESSION_BLOCK_OUTBOUND) pfd.events |= POLLOUT;
+    if (pfd.events == 0) pfd.events = POLLIN;
+    poll(&pfd, 1, SSH_EXEC_POLL_MS);
+}
+
+// 通道仍属于当前会话
+static bool exec_alive_locked(SshExec* exec) {
+    return exec->channel != nullptr && ssh_session != nullptr && exec->generation == ssh_generation;
+}
+
+SshExec* ssh_exec_open_impl(const char* cmd) {
+    if (!cmd) return nullptr;
+    SshExec* exec = new SshExec();
+    exec->channel = nullptr;
+    exec->generation = 0;
+    long long deadline = jquick_get_current_time() + SSH_EXEC_TIMEOUT_MS;
+    while (true) {
+        int fd;
+        int dirs;
+        {
+            JQuick::Mutex::Autolock l(ssh_mutex);
+            if (ssh_session == nullptr) break;
+            if (exec->channel == nullptr) {
+                exec->channel = libssh2_channel_open_session(ssh_session);
+                exec->generation = ssh_generation;
+                if (exec->channel == nullptr && libssh2_session_last_errno(ssh_session) != LIBSSH2_ERROR_EAGAIN) break;
+            }
+            if (exec->channel != nullptr) {
+                if (!exec_alive_locked(exec)) break;
+                int rc = libssh2_channel_exec(exec->channel, cmd);
+                if (rc == 0) return exec;
+                if (rc != LIBSSH2_ERROR_EAGAIN) break;
+            }
+            fd = sock_fd;
+            dirs = libssh2_session_block_directions(ssh_session);
+        }
+        if (jquick_get_current_time() > deadline) break;
+        wait_socket(fd, dirs);
+    }
+    ssh_exec_close_impl(exec);
+    return nullptr;
+}
+
+int ssh_exec_read_impl(SshExec* exec, char* buf, int buf_len) {
+    if (exec == nullptr || buf == nullptr || buf_len <= 1) return -1;
+    long long deadline = jquick_get_current_time() + SSH_EXEC_TIMEOUT_MS;
+    while (true) {
+        int fd;
+        int dirs;
+        {
+            JQuick::Mutex::Autolock l(ssh_mutex);
+            if (!exec_alive_locked(exec)) return -2;
+            ssize_t n = libssh2_channel_read(exec->channel, buf, buf_len - 1);
+            if (n > 0) {
+                buf[n] = '\0';
+                return (int)n;
+            }
+            if (n < 0 && n != LIBSSH2_ERROR_EAGAIN) return -3;
+            // 读不到数据不代表结束，以通道EOF为准
+            if (libssh2_channel_eof(exec->channel)) return 0;
+            fd = sock_fd;
+            dirs = libssh2_session_block_directions(ssh_session);
+        }
+        if (jquick_get_current_time() > deadline) return -4;
+        wait_socket(fd, dirs);
+    }
+}
+
+std::string ssh_shell_quote(const std::string& s) {
+    std::string out = "'";
+    for (size_t i = 0; i < s.size(); i++) {
+        if (s[i] == '\'') out += "'\\''";
+        else out += s[i];
+    }
+    out += "'";
+    return out;
+}
+
+void ssh_exec_close_impl(SshExec* exec) {
+    if (exec == nullptr) return;
+    long long deadline = jquick_get_current_time() + SSH_EXEC_TIMEOUT_MS;
+    while (true) {
+        int fd;
+        int dirs;
+        {
+            JQuick::Mutex::Autolock l(ssh_mutex);
+            // 会话已断开时通道随会话一起释放了
+            if (!exec_alive_locked(exec)) break;
+            int rc = libssh2_channel_free(exec->channel);
+            if (rc != LIBSSH2_ERROR_EAGAIN) break;
+            fd = sock_fd;
+            dirs = libssh2_session_block_directions(ssh_session);
+        }
+        if (jquick_get_current_time() > deadline) break;
+        wait_socket(fd, dirs);
+    }
+    delete exec;
+}
@@ -1,164 +1,379 @@
 #include "include/ssh_conn_manager.h"
 #include "include/vnc_input.h"
 #include "include/file_ops.h"
+#include "include/file_watch.h"
+#include "include/file_type.h"
+#include "include/file_search.h"
+#include "include/file_du.h"
+#include "include/api_buf.h"
+#include "jqutil_v2/JQTrace.h"
 #include <stdlib.h>
 #include <string.h>
+#include <string>
 
-// 适配前端：内部分配固定buf（8192足够）
+// 结果按实际长度返回（前端框架自动free释放），填充用的临时缓冲按尺寸分级复用，见api_buf.h
+// 首次尝试的缓冲大小，多数结果一次放得下
 #define API_BUF_SIZE 8192
-#define API_MALLOC(size) malloc(size)
-#define API_FREE(ptr) free(ptr)
+// 轮询类接口单次最多取这么多，剩余的留到下次poll
+#define API_CHUNK_SIZE 32768
 
-// 工具：分配buf并返回（前端框架自动释放）
-static char* alloc_api_buf() {
-    return (char*)API_MALLOC(API_BUF_SIZE);
+// 可重复调用的填充函数：返回值>= cap表示放不下，按返回的所需长度换缓冲重试，不截断
+template <typename Fill>
+static char* call_sized(const char* api, Fill fill) {
+    int cap = 0;
+    char* buf = api_scratch_get(API_BUF_SIZE, &cap);
+    int len = -1;
+    while (buf) {
+        len = fill(buf, cap);
+        if (len < cap) break;
+        // 超过API_RESULT_MAX的取不到缓冲，按失败返回
+        int want = len < API_RESULT_MAX ? len + 1 : API_RESULT_MAX + 1;
+        api_scratch_put(buf, cap);
+        api_stats_grow(api);
+        buf = api_scratch_get(want, &cap);
+    }
+    char* result = NULL;
+    if (buf && len > 0) {
+        result = api_result_dup(api, buf, len);
+        JQ_TRACE_BYTES(0, len);
+    } else {
+        api_stats_fail(api);
+    }
+    api_scratch_put(buf, cap);
+    return result;
+}
+
+// 流式读取（读走就没了，不能重试）：写满就换更大的缓冲接着读，直到读空
+template <typename Read>
+static char* call_stream(const char* api, Read read_more) {
+    int cap = 0;
+    char* buf = api_scratch_get(API_BUF_SIZE, &cap);
+    int len = 0;
+    while (buf) {
+        int room = cap - len;
+        int n = read_more(buf + len, room);
+        if (n <= 0) break;
+        len += n;
+        if (n < room - 1) break;
+
+        int new_cap = 0;
+        char* bigger = api_scratch_get(cap * 2, &new_cap);
+        if (!bigger) break;
+        memcpy(bigger, buf, len);
+        api_scratch_put(buf, cap);
+        api_stats_grow(api);
+        buf = bigger;
+        cap = new_cap;
+    }
+    char* result = NULL;
+    if (buf && len > 0) {
+        result = api_result_dup(api, buf, len);
+        JQ_TRACE_BYTES(0, len);
+    } else {
+        api_stats_fail(api);
+    }
+    api_scratch_put(buf, cap);
+    return result;
+}
+
+// 读到EOF为止（exec通道）：read_more返回0表示读完，负数出错整体失败；写满就换更大的缓冲接着读
+// 和call_stream不同，一次读得少不代表读完，输出分几个包到达也不会被截断
+template <typename Read>
+static char* call_until_eof(const char* api, Read read_more) {
+    int cap = 0;
+    char* buf = api_scratch_get(API_BUF_SIZE, &cap);
+    int len = 0;
+    bool eof = false;
+    while (buf) {
+        if (cap - len <= 1) {
+            int new_cap = 0;
+            char* bigger = api_scratch_get(cap * 2, &new_cap);
+            if (!bigger) break;
+            memcpy(bigger, buf, len);
+            api_scratch_put(buf, cap);
+            api_stats_grow(api);
+            buf = bigger;
+            cap = new_cap;
+        }
+        int n = read_more(buf + len, cap - len);
+        if (n < 0) break;
+        if (n == 0) {
+            eof = true;
+            break;
+        }
+        len += n;
+    }
+    char* result = NULL;
+    if (buf && eof && len > 0) {
+        result = api_result_dup(api, buf, len);
+        JQ_TRACE_BYTES(0, len);
+    } else {
+        api_stats_fail(api);
+    }
+    api_scratch_put(buf, cap);
+    return result;
+}
+
+// 分段取结果（poll类）：每次取一段，放不下的由impl留到下次
+template <typename Fill>
+static char* call_chunk(const char* api, Fill fill) {
+    int cap = 0;
+    char* buf = api_scratch_get(API_CHUNK_SIZE, &cap);
+    if (!buf) return NULL;
+    int len = fill(buf, cap);
+    char* result = NULL;
+    if (len > 0 && len < cap) {
+        result = api_result_dup(api, buf, len);
+        JQ_TRACE_BYTES(0, len);
+    } else {
+        api_stats_fail(api);
+    }
+    api_scratch_put(buf, cap);
+    return result;
 }
 
 extern "C" {
 
 // ====================== SSH 导出（1:1匹配前端$api.ssh_xxx） ======================
 int ssh_global_init() {
+    JQ_TRACE_SCOPE("ssh_global_init");
     return ::ssh_global_init_impl();
 }
 
 int ssh_connect(const char* ip, const char* port, const char* user, const char* pass) {
+    JQ_TRACE_SCOPE("ssh_connect");
     return ::ssh_connect_impl(ip, port, user, pass);
 }
 
 int ssh_connect_key(const char* ip, const char* port, const char* user, const char* key_path) {
+    JQ_TRACE_SCOPE("ssh_connect_key");
     return ::ssh_connect_key_impl(ip, port, user, key_path);
 }
 
 void ssh_disconnect() {
+    JQ_TRACE_SCOPE("ssh_disconnect");
     ::ssh_disconnect_impl();
 }
 
 int ssh_exec(const char* cmd) {
+    JQ_TRACE_SCOPE("ssh_exec");
+    if (cmd) JQ_TRACE_BYTES(strlen(cmd), 0);
     return ::ssh_write_stream_impl(cmd);
 }
 
 char* ssh_read_stream() {
-    char* buf = alloc_api_buf();
-    if (!buf) return NULL;
-    int len = ::ssh_read_stream_impl(buf, API_BUF_SIZE - 1);
-    if (len <= 0) { API_FREE(buf); return NULL; }
-    buf[len] = '\0';
-    return buf;
+    JQ_TRACE_SCOPE("ssh_read_stream");
+    return call_stream("ssh_read_stream", [&](char* buf, int buf_len) {
+        return ::ssh_read_stream_impl(buf, buf_len);
+    });
 }
 
 int ssh_send_key(const char* key) {
+    JQ_TRACE_SCOPE("ssh_send_key");
     return ::ssh_send_key_impl(key);
 }
 
 int ssh_send_esc() {
+    JQ_TRACE_SCOPE("ssh_send_esc");
     return ::ssh_send_esc_impl();
 }
 
 // ====================== VNC 导出（1:1匹配前端$api.vnc_xxx） ======================
 int vnc_connect(const char* ip, const char* port, const char* pass) {
+    JQ_TRACE_SCOPE("vnc_connect");
     return ::vnc_connect_impl(ip, port, pass);
 }
 
 void vnc_disconnect() {
+    JQ_TRACE_SCOPE("vnc_disconnect");
     ::vnc_disconnect_impl();
 }
 
 char* vnc_read_frame() {
-    char* buf = alloc_api_buf();
-    if (!buf) return NULL;
-    int len = ::vnc_read_frame_impl(buf, API_BUF_SIZE - 1);
-    if (len <= 0) { API_FREE(buf); return NULL; }
-    buf[len] = '\0';
-    return buf;
+    JQ_TRACE_SCOPE("vnc_read_frame");
+    return call_sized("vnc_read_frame", [&](char* buf, int buf_len) {
+        return ::vnc_read_frame_impl(buf, buf_len);
+    });
 }
 
 int vnc_send_mouse(const char* evt_json) {
+    JQ_TRACE_SCOPE("vnc_send_mouse");
+    if (evt_json) JQ_TRACE_BYTES(strlen(evt_json), 0);
     return ::vnc_send_mouse_impl(evt_json);
 }
 
 int vnc_send_key(const char* key) {
+    JQ_TRACE_SCOPE("vnc_send_key");
     return ::vnc_send_key_impl(key);
 }
 
 void vnc_set_scale(float scale) {
+    JQ_TRACE_SCOPE("vnc_set_scale");
     ::vnc_set_scale_impl(scale);
 }
 
 // ====================== 文件 导出（1:1匹配前端$api.file_xxx） ======================
 char* file_list(const char* path) {
-    char* buf = alloc_api_buf();
-    if (!buf) return NULL;
-    int ret = ::file_list_impl(path, buf, API_BUF_SIZE - 1);
-    if (ret != 0) { API_FREE(buf); return NULL; }
-    return buf;
+    JQ_TRACE_SCOPE("file_list");
+    return call_sized("file_list", [&](char* buf, int buf_len) {
+        return ::file_list_impl(path, buf, buf_len);
+    });
 }
 
 char* file_list_via_ssh(const char* path) {
-    char* buf = alloc_api_buf();
-    if (!buf) return NULL;
-    int ret = ::file_list_via_ssh_impl(path, buf, API_BUF_SIZE - 1);
-    if (ret != 0) { API_FREE(buf); return NULL; }
-    return buf;
+    JQ_TRACE_SCOPE("file_list_via_ssh");
+    SshExec* exec = ::file_list_via_ssh_impl(path);
+    if (!exec) {
+        api_stats_fail("file_list_via_ssh");
+        return NULL;
+    }
+    char* result = call_until_eof("file_list_via_ssh", [&](char* buf, int buf_len) {
+        return ::ssh_exec_read_impl(exec, buf, buf_len);
+    });
+    ::ssh_exec_close_impl(exec);
+    return result;
 }
 
 char* file_read_text(const char* path) {
-    char* buf = alloc_api_buf();
-    if (!buf) return NULL;
-    int len = ::file_read_text_impl(path, buf, API_BUF_SIZE - 1);
-    if (len <= 0) { API_FREE(buf); return NULL; }
-    buf[len] = '\0';
-    return buf;
+    JQ_TRACE_SCOPE("file_read_text");
+    return call_sized("file_read_text", [&](char* buf, int buf_len) {
+        return ::file_read_text_impl(path, buf, buf_len);
+    });
 }
 
 char* file_read_hex(const char* path) {
-    char* buf = alloc_api_buf();
-    if (!buf) return NULL;
-    int len = ::file_read_hex_impl(path, buf, API_BUF_SIZE - 1);
-    if (len <= 0) { API_FREE(buf); return NULL; }
-    buf[len] = '\0';
-    return buf;
+    JQ_TRACE_SCOPE("file_read_hex");
+    return call_sized("file_read_hex", [&](char* buf, int buf_len) {
+        return ::file_read_hex_impl(path, buf, buf_len);
+    });
 }
 
 char* file_render_md(const char* path) {
-    char* buf = alloc_api_buf();
-    if (!buf) return NULL;
-    int len = ::file_render_md_impl(path, buf, API_BUF_SIZE - 1);
-    if (len <= 0) { API_FREE(buf); return NULL; }
-    buf[len] = '\0';
-    return buf;
+    JQ_TRACE_SCOPE("file_render_md");
+    return call_sized("file_render_md", [&](char* buf, int buf_len) {
+        return ::file_render_md_impl(path, buf, buf_len);
+    });
 }
 
 int file_write(const char* path, const char* content) {
+    JQ_TRACE_SCOPE("file_write");
+    if (content) JQ_TRACE_BYTES(strlen(content), 0);
     return ::file_write_impl(path, content);
 }
 
 int file_chmod(const char* path, const char* mode) {
+    JQ_TRACE_SCOPE("file_chmod");
     return ::file_chmod_impl(path, mode);
 }
 
 int file_chown(const char* path, const char* owner) {
+    JQ_TRACE_SCOPE("file_chown");
     return ::file_chown_impl(path, owner);
 }
 
 char* file_lsattr(const char* path) {
-    char* buf = alloc_api_buf();
-    if (!buf) return NULL;
-    int len = ::file_lsattr_impl(path, buf, API_BUF_SIZE - 1);
-    if (len <= 0) { API_FREE(buf); return NULL; }
-    buf[len] = '\0';
-    return buf;
+    JQ_TRACE_SCOPE("file_lsattr");
+    return call_sized("file_lsattr", [&](char* buf, int buf_len) {
+        return ::file_lsattr_impl(path, buf, buf_len);
+    });
 }
 
 int file_delete(const char* path) {
+    JQ_TRACE_SCOPE("file_delete");
     return ::file_delete_impl(path);
 }
 
 int file_rename(const char* old_path, const char* new_path) {
+    JQ_TRACE_SCOPE("file_rename");
     return ::file_rename_impl(old_path, new_path);
 }
 
 int file_mkdir(const char* path) {
+    JQ_TRACE_SCOPE("file_mkdir");
     return ::file_mkdir_impl(path);
 }
 
+// 文件类型识别：前端据viewer选择文本/十六进制/markdown/图片预览
+char* file_type(const char* path) {
+    JQ_TRACE_SCOPE("file_type");
+    return call_sized("file_type", [&](char* buf, int buf_len) {
+        return ::file_type_impl(path, buf, buf_len);
+    });
+}
+
+char* file_type_list(const char* path) {
+    JQ_TRACE_SCOPE("file_type_list");
+    return call_sized("file_type_list", [&](char* buf, int buf_len) {
+        return ::file_type_list_impl(path, buf, buf_len);
+    });
+}
+
+// 目录监听：返回watch_id，前端定时poll取增量（JS推送版见jq_module.cpp的FileWatcher）
+int file_watch_add(const char* path) {
+    JQ_TRACE_SCOPE("file_watch_add");
+    return ::file_watch_add_impl(path, NULL, NULL);
+}
+
+char* file_watch_poll(int watch_id) {
+    JQ_TRACE_SCOPE("file_watch_poll");
+    return call_chunk("file_watch_poll", [&](char* buf, int buf_len) {
+        return ::file_watch_poll_impl(watch_id, buf, buf_len);
+    });
+}
+
+int file_watch_remove(int watch_id) {
+    JQ_TRACE_SCOPE("file_watch_remove");
+    return ::file_watch_remove_impl(watch_id);
+}
+
+// 递归搜索：返回search_id，前端定时poll取结果直到done（JS推送版见jq_module.cpp的FileSearch）
+int file_search_start(const char* root, const char* name_glob, const char* text) {
+    JQ_TRACE_SCOPE("file_search_start");
+    return ::file_search_start_impl(root, name_glob, text, NULL, NULL);
+}
+
+char* file_search_poll(int search_id) {
+    JQ_TRACE_SCOPE("file_search_poll");
+    return call_chunk("file_search_poll", [&](char* buf, int buf_len) {
+        return ::file_search_poll_impl(search_id, buf, buf_len);
+    });
+}
+
+int file_search_cancel(int search_id) {
+    JQ_TRACE_SCOPE("file_search_cancel");
+    return ::file_search_cancel_impl(search_id);
+}
+
+// 目录占用分析：返回du_id，前端定时poll取结果直到done（JS推送版见jq_module.cpp的DiskUsage）
+int file_du_start(const char* path, int refresh) {
+    JQ_TRACE_SCOPE("file_du_start");
+    return ::file_du_start_impl(path, refresh, NULL, NULL);
+}
+
+char* file_du_poll(int du_id) {
+    JQ_TRACE_SCOPE("file_du_poll");
+    return call_chunk("file_du_poll", [&](char* buf, int buf_len) {
+        return ::file_du_poll_impl(du_id, buf, buf_len);
+    });
+}
+
+int file_du_cancel(int du_id) {
+    JQ_TRACE_SCOPE("file_du_cancel");
+    return ::file_du_cancel_impl(du_id);
+}
+
+// 结果缓冲统计：各接口调用次数、返回字节、扩容次数，以及临时缓冲复用命中
+char* api_buf_stats() {
+    JQ_TRACE_SCOPE("api_buf_stats");
+    return call_sized("api_buf_stats", [&](char* buf, int buf_len) {
+        return ::api_buf_stats_impl(buf, buf_len);
+    });
+}
+
+// 接口时延统计：各接口调用次数、入/出字节、耗时分位数（us），Release构建为{}
+char* api_trace_stats() {
+    std::string json = JQUTIL_NS::JQTraceStats().dump();
+    return api_result_dup("api_trace_stats", json.data(), json.size());
+}
+
 } // extern "C"
@@ -77,7 +77,7 @@ int vnc_read_frame_impl(char* buf, int buf_len) {
     snprintf(frame_data, sizeof(frame_data), "data:image/png;base64,%s", SIMULATE_FRAME_BASE64);
 
     int len = strlen(frame_data);
-    if (len > buf_len - 1) len = buf_len - 1;
+    if (len > buf_len - 1) return len;
     memcpy(buf, frame_data, len);
     buf[len] = '\0';
     return len;
@@ -1,4 +1,11 @@
+import { TimerHeap } from './timer-heap.js'
+import native from 'ssh_vnc_native'
+
 const DEBUG = false
+// 定时器用单调时钟，宿主没有performance.now()时用native模块的
+const monotonicNow = typeof performance !== 'undefined' && typeof performance.now === 'function'
+  ? () => performance.now()
+  : () => native.now()
 function _collectFalconEventIds(name, callback)
 {
   const evtList = $falcon.eventMap[name]
@@ -19,8 +26,8 @@ class PageRes extends $falcon.Page {
   constructor() {
     super()
     this.falconOnTokens = []  // [[token, name], ...]
-    this.timeoutTokens = new Set()  // [token, ...]
-    this.intervalTokens = new Set()  // [token, ...]
+    // setTimeout/setInterval共用，token由TimerHeap分配
+    this.timers = new TimerHeap(monotonicNow)
   }
 
   on(name, callback) {
@@ -48,25 +55,16 @@ class PageRes extends $falcon.Page {
     $falcon.trigger(name, options)
   }
   setTimeout(func, ms) {
-    const token = setTimeout(() => {
-      this.timeoutTokens.delete(token)
-      func()
-    }, ms)
-    this.timeoutTokens.add(token)
-    return token
+    return this.timers.add(func, ms, false)
   }
   setInterval(func, ms) {
-    const token = setInterval(func, ms)
-    this.intervalTokens.add(token)
-    return token
+    return this.timers.add(func, ms, true)
   }
   clearTimeout(token) {
-    this.timeoutTokens.delete(token)
-    clearTimeout(token)
+    this.timers.remove(token)
   }
   clearInterval(token) {
-    this.intervalTokens.delete(token)
-    clearInterval(token)
+    this.timers.remove(token)
   }
   release() {
     for (let [token, name] of this.falconOnTokens) {
@@ -74,16 +72,8 @@ class PageRes extends $falcon.Page {
       $falcon.off(name, token)
     }
     this.falconOnTokens.length = 0
-    for (let token of this.timeoutTokens) {
-      DEBUG && console.log(`release setTimeout token ${token}`)
-      clearTimeout(token)
-    }
-    this.timeoutTokens.clear()
-    for (let token of this.intervalTokens) {
-      DEBUG && console.log(`release setInterval token ${token}`)
-      clearInterval(token)
-    }
-    this.intervalTokens.clear()
+    DEBUG && console.log(`release ${this.timers.entries.size} timers`)
+    this.timers.clear()
   }
 }
 
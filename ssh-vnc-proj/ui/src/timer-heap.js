@@ -0,0 +1,211 @@
+// 页面定时器复用：所有定时器放在一个4叉最小堆里，宿主侧始终只挂一个setTimeout（最早到期的那个），
+// 宿主消息队列按when有序插入，定时器多时每次插入都要线性扫描，这里把它降成一个
+const ENTRY_POOL_MAX = 64
+
+export class TimerHeap {
+  // now: 单调时钟（毫秒），Date.now()会随系统校时跳变，定时器会提前或迟迟不到期
+  constructor(now) {
+    this.now = now
+    this.heap = []        // [entry, ...]，按(when, seq)排序
+    this.entries = new Map()  // token -> entry
+    this.pool = []
+    this.nextToken = 1
+    this.seq = 0
+    this.cancelled = 0
+    this.hostTimer = null
+    this.hostWhen = 0
+    this.onFire = () => this._fire()
+  }
+
+  add(func, ms, interval) {
+    ms = Math.max(0, Number(ms) || 0)
+    const entry = this.pool.pop() || {}
+    entry.token = this.nextToken++
+    entry.func = func
+    entry.interval = interval ? ms : -1
+    entry.when = this.now() + ms
+    entry.seq = this.seq++
+    entry.cancelled = false
+    this.entries.set(entry.token, entry)
+    this._push(entry)
+    this._arm()
+    return entry.token
+  }
+
+  remove(token) {
+    const entry = this.entries.get(token)
+    if (!entry) {
+      return false
+    }
+    // 惰性删除，到堆顶时丢弃；取消的太多时重建堆
+    this.entries.delete(token)
+    entry.cancelled = true
+    entry.func = null
+    this.cancelled++
+    if (this.cancelled > 32 && this.cancelled * 2 > this.heap.length) {
+      this._compact()
+    }
+    if (this.entries.size === 0) {
+      this._disarm()
+    }
+    return true
+  }
+
+  clear() {
+    this._disarm()
+    this.heap.length = 0
+    this.entries.clear()
+    this.cancelled = 0
+  }
+
+  _fire() {
+    this.hostTimer = null
+    const now = this.now()
+    let errors = null
+    // 只执行本轮开始前到期的，回调里新加的0ms定时器留给下一轮，不会饿死宿主消息
+    const limit = this.seq
+    while (this.heap.length > 0) {
+      const top = this.heap[0]
+      if (top.cancelled) {
+        this._pop()
+        this._release(top)
+        this.cancelled--
+        continue
+      }
+      if (top.when > now || top.seq >= limit) {
+        break
+      }
+      this._pop()
+      const func = top.func
+      if (top.interval >= 0) {
+        top.when = now + top.interval
+        top.seq = this.seq++
+        this._push(top)
+      } else {
+        this.entries.delete(top.token)
+        this._release(top)
+      }
+      // 一个回调抛异常不能打断本轮其他定时器，异常在重新挂上宿主定时器之后再抛给宿主
+      try {
+        func()
+      } catch (err) {
+        (errors || (errors = [])).push(err)
+      }
+    }
+    this._arm()
+    if (errors) {
+      for (let i = 1; i < errors.length; i++) {
+        const err = errors[i]
+        setTimeout(() => { throw err }, 0)
+      }
+      throw errors[0]
+    }
+  }
+
+  _arm() {
+    while (this.heap.length > 0 && this.heap[0].cancelled) {
+      this._release(this._pop())
+      this.cancelled--
+    }
+    if (this.heap.length === 0) {
+      this._disarm()
+      return
+    }
+    const when = this.heap[0].when
+    if (this.hostTimer !== null) {
+      if (this.hostWhen <= when) {
+        return
+      }
+      clearTimeout(this.hostTimer)
+    }
+    this.hostWhen = when
+    this.hostTimer = setTimeout(this.onFire, Math.max(0, when - this.now()))
+  }
+
+  _disarm() {
+    if (this.hostTimer !== null) {
+      clearTimeout(this.hostTimer)
+      this.hostTimer = null
+    }
+  }
+
+  _release(entry) {
+    entry.func = null
+    if (this.pool.length < ENTRY_POOL_MAX) {
+      this.pool.push(entry)
+    }
+  }
+
+  _compact() {
+    const live = this.heap.filter(e => !e.cancelled)
+    for (const e of this.heap) {
+      if (e.cancelled) {
+        this._release(e)
+      }
+    }
+    this.heap = live
+    this.cancelled = 0
+    for (let i = (live.length - 2) >> 2; i >= 0; i--) {
+      this._down(i)
+    }
+  }
+
+  _less(a, b) {
+    return a.when < b.when || (a.when === b.when && a.seq < b.seq)
+  }
+
+  _push(entry) {
+    this.heap.push(entry)
+    this._up(this.heap.length - 1)
+  }
+
+  _pop() {
+    const heap = this.heap
+    const top = heap[0]
+    const last = heap.pop()
+    if (heap.length > 0) {
+      heap[0] = last
+      this._down(0)
+    }
+    return top
+  }
+
+  _up(i) {
+    const heap = this.heap
+    const entry = heap[i]
+    while (i > 0) {
+      const parent = (i - 1) >> 2
+      if (!this._less(entry, heap[parent])) {
+        break
+      }
+      heap[i] = heap[parent]
+      i = parent
+    }
+    heap[i] = entry
+  }
+
+  _down(i) {
+    const heap = this.heap
+    const n = heap.length
+    const entry = heap[i]
+    while (true) {
+      const first = (i << 2) + 1
+      if (first >= n) {
+        break
+      }
+      let min = first
+      const end = Math.min(first + 4, n)
+      for (let c = first + 1; c < end; c++) {
+        if (this._less(heap[c], heap[min])) {
+          min = c
+        }
+      }
+      if (!this._less(heap[min], entry)) {
+        break
+      }
+      heap[i] = heap[min]
+      i = min
+    }
+    heap[i] = entry
+  }
+}